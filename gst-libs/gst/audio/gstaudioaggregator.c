@@ -148,6 +148,10 @@ struct _GstAudioAggregatorPrivate
   /* Readable with object lock, writable with both aag lock and object lock */
 
   gint64 offset;                /* Sample offset starting from 0 at segment.start */
+
+  /* Protected by the object lock */
+  /* Input buffers to aggregate at once with aggregate_buffers */
+  GArray *inputs;
 };
 
 #define GST_AUDIO_AGGREGATOR_LOCK(self)   g_mutex_lock (&(self)->priv->mutex);
@@ -267,6 +271,12 @@ gst_audio_aggregator_class_init (GstAudioAggregatorClass * klass)
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
+static void
+gst_audio_aggregator_input_clear (GstAudioAggregatorInput * input)
+{
+  gst_buffer_unref (input->buffer);
+}
+
 static void
 gst_audio_aggregator_init (GstAudioAggregator * aagg)
 {
@@ -276,6 +286,11 @@ gst_audio_aggregator_init (GstAudioAggregator * aagg)
 
   g_mutex_init (&aagg->priv->mutex);
 
+  aagg->priv->inputs = g_array_new (FALSE, FALSE,
+      sizeof (GstAudioAggregatorInput));
+  g_array_set_clear_func (aagg->priv->inputs,
+      (GDestroyNotify) gst_audio_aggregator_input_clear);
+
   aagg->priv->output_buffer_duration = DEFAULT_OUTPUT_BUFFER_DURATION;
   aagg->priv->alignment_threshold = DEFAULT_ALIGNMENT_THRESHOLD;
   aagg->priv->discont_wait = DEFAULT_DISCONT_WAIT;
@@ -294,6 +309,10 @@ gst_audio_aggregator_dispose (GObject * object)
 
   gst_caps_replace (&aagg->current_caps, NULL);
 
+  if (aagg->priv->inputs)
+    g_array_free (aagg->priv->inputs, TRUE);
+  aagg->priv->inputs = NULL;
+
   g_mutex_clear (&aagg->priv->mutex);
 
   G_OBJECT_CLASS (gst_audio_aggregator_parent_class)->dispose (object);
@@ -987,11 +1006,23 @@ gst_audio_aggregator_mix_buffer (GstAudioAggregator * aagg,
     return FALSE;
   }
 
-  filled = GST_AUDIO_AGGREGATOR_GET_CLASS (aagg)->aggregate_one_buffer (aagg,
-      pad, inbuf, pad->priv->position, outbuf, out_start, overlap);
+  if (GST_AUDIO_AGGREGATOR_GET_CLASS (aagg)->aggregate_buffers) {
+    GstAudioAggregatorInput input = { NULL, };
+
+    /* aggregated with the other pads once they all went through */
+    input.pad = pad;
+    input.buffer = gst_buffer_ref (inbuf);
+    input.in_offset = pad->priv->position;
+    input.out_offset = out_start;
+    input.num_frames = overlap;
+    g_array_append_val (aagg->priv->inputs, input);
+  } else {
+    filled = GST_AUDIO_AGGREGATOR_GET_CLASS (aagg)->aggregate_one_buffer (aagg,
+        pad, inbuf, pad->priv->position, outbuf, out_start, overlap);
 
-  if (filled)
-    GST_BUFFER_FLAG_UNSET (outbuf, GST_BUFFER_FLAG_GAP);
+    if (filled)
+      GST_BUFFER_FLAG_UNSET (outbuf, GST_BUFFER_FLAG_GAP);
+  }
 
   pad->priv->position += overlap;
   pad->priv->output_offset += overlap;
@@ -1279,6 +1310,15 @@ gst_audio_aggregator_aggregate (GstAggregator * agg, gboolean timeout)
       gst_aggregator_pad_drop_buffer (aggpad);
 
   }
+
+  if (aagg->priv->inputs->len > 0) {
+    GST_LOG_OBJECT (agg, "Mixing %u buffers", aagg->priv->inputs->len);
+    if (GST_AUDIO_AGGREGATOR_GET_CLASS (aagg)->aggregate_buffers (aagg,
+            (GstAudioAggregatorInput *) aagg->priv->inputs->data,
+            aagg->priv->inputs->len, outbuf))
+      GST_BUFFER_FLAG_UNSET (outbuf, GST_BUFFER_FLAG_GAP);
+    g_array_set_size (aagg->priv->inputs, 0);
+  }
   GST_OBJECT_UNLOCK (agg);
 
   if (dropped) {
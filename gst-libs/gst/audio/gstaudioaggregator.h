@@ -41,6 +41,7 @@ G_BEGIN_DECLS
 typedef struct _GstAudioAggregator GstAudioAggregator;
 typedef struct _GstAudioAggregatorPrivate GstAudioAggregatorPrivate;
 typedef struct _GstAudioAggregatorClass GstAudioAggregatorClass;
+typedef struct _GstAudioAggregatorInput GstAudioAggregatorInput;
 
 
 /************************
@@ -131,6 +132,30 @@ struct _GstAudioAggregator
   gpointer                 _gst_reserved[GST_PADDING];
 };
 
+/**
+ * GstAudioAggregatorInput:
+ * @pad: The pad @buffer was received on
+ * @buffer: The input buffer
+ * @in_offset: The first frame of @buffer to aggregate
+ * @out_offset: The frame of the output buffer it is aggregated to
+ * @num_frames: The number of frames to aggregate
+ *
+ * The part of an input buffer to aggregate to the output buffer.
+ *
+ * Since: 1.10
+ */
+struct _GstAudioAggregatorInput
+{
+  GstAudioAggregatorPad *pad;
+  GstBuffer *buffer;
+  guint in_offset;
+  guint out_offset;
+  guint num_frames;
+
+  /*< private >*/
+  gpointer _gst_reserved[GST_PADDING];
+};
+
 /**
  * GstAudioAggregatorClass:
  * @create_output_buffer: Create a new output buffer contains num_frames frames.
@@ -138,6 +163,10 @@ struct _GstAudioAggregator
  *  buffer.  The in_offset and out_offset are in "frames", which is
  *  the size of a sample times the number of channels. Returns TRUE if
  *  any non-silence was added to the buffer
+ * @aggregate_buffers: Aggregates the n_inputs input buffers to the output
+ *  buffer in one go, instead of calling @aggregate_one_buffer for each of
+ *  them. Called with the object lock held, but not the pad object locks.
+ *  Returns TRUE if any non-silence was added to the buffer. Since: 1.10
  */
 struct _GstAudioAggregatorClass {
   GstAggregatorClass   parent_class;
@@ -147,9 +176,11 @@ struct _GstAudioAggregatorClass {
   gboolean (* aggregate_one_buffer) (GstAudioAggregator * aagg,
       GstAudioAggregatorPad * pad, GstBuffer * inbuf, guint in_offset,
       GstBuffer * outbuf, guint out_offset, guint num_frames);
+  gboolean (* aggregate_buffers) (GstAudioAggregator * aagg,
+      GstAudioAggregatorInput * inputs, guint n_inputs, GstBuffer * outbuf);
 
   /*< private >*/
-  gpointer          _gst_reserved[GST_PADDING];
+  gpointer          _gst_reserved[GST_PADDING - 1];
 };
 
 /*************************
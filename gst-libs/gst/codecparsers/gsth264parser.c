@@ -85,6 +85,7 @@
 #endif
 
 #include "nalutils.h"
+#include "startcodes.h"
 #include "gsth264parser.h"
 
 #include <gst/base/gstbytereader.h>
@@ -2085,6 +2086,32 @@ GstH264ParserResult
 gst_h264_parser_parse_slice_hdr (GstH264NalParser * nalparser,
     GstH264NalUnit * nalu, GstH264SliceHdr * slice,
     gboolean parse_pred_weight_table, gboolean parse_dec_ref_pic_marking)
+{
+  return gst_h264_parser_parse_slice_hdr_with_depth (nalparser, nalu, slice,
+      GST_H264_SLICE_HDR_PARSE_DEPTH_FULL);
+}
+
+/**
+ * gst_h264_parser_parse_slice_hdr_with_depth:
+ * @nalparser: a #GstH264NalParser
+ * @nalu: The #GST_H264_NAL_SLICE #GstH264NalUnit to parse
+ * @slice: The #GstH264SliceHdr to fill.
+ * @depth: How much of the slice header to parse
+ *
+ * Parses @data, and fills the @slice structure up to @depth. With
+ * #GST_H264_SLICE_HDR_PARSE_DEPTH_AU_BOUNDARY, the fields following the
+ * picture order count (including the ref_pic_list_modification,
+ * pred_weight_table and dec_ref_pic_marking) are left to zero, as is
+ * the header_size.
+ *
+ * Returns: a #GstH264ParserResult
+ *
+ * Since: 1.10
+ */
+GstH264ParserResult
+gst_h264_parser_parse_slice_hdr_with_depth (GstH264NalParser * nalparser,
+    GstH264NalUnit * nalu, GstH264SliceHdr * slice,
+    GstH264SliceHdrParseDepth depth)
 {
   NalReader nr;
   gint pps_id;
@@ -2169,6 +2196,11 @@ gst_h264_parser_parse_slice_hdr (GstH264NalParser * nalparser,
       READ_SE (&nr, slice->delta_pic_order_cnt[1]);
   }
 
+  /* that's all that is needed to detect the first VCL NAL unit of a
+   * primary coded picture, see 7.4.1.2.4 */
+  if (depth == GST_H264_SLICE_HDR_PARSE_DEPTH_AU_BOUNDARY)
+    return GST_H264_PARSER_OK;
+
   if (pps->redundant_pic_cnt_present_flag)
     READ_UE_MAX (&nr, slice->redundant_pic_cnt, G_MAXINT8);
 
@@ -294,6 +294,23 @@ typedef enum
   GST_H264_S_SI_SLICE = 9
 } GstH264SliceType;
 
+/**
+ * GstH264SliceHdrParseDepth:
+ * @GST_H264_SLICE_HDR_PARSE_DEPTH_FULL: parse the whole slice header
+ * @GST_H264_SLICE_HDR_PARSE_DEPTH_AU_BOUNDARY: only parse the fields
+ *  needed to detect access unit boundaries, up to the picture order count
+ *
+ * How much of a slice header gst_h264_parser_parse_slice_hdr_with_depth()
+ * parses.
+ *
+ * Since: 1.10
+ */
+typedef enum
+{
+  GST_H264_SLICE_HDR_PARSE_DEPTH_FULL,
+  GST_H264_SLICE_HDR_PARSE_DEPTH_AU_BOUNDARY
+} GstH264SliceHdrParseDepth;
+
 typedef struct _GstH264NalParser              GstH264NalParser;
 
 typedef struct _GstH264NalUnit                GstH264NalUnit;
@@ -1036,6 +1053,10 @@ GstH264ParserResult gst_h264_parser_parse_slice_hdr   (GstH264NalParser *nalpars
                                                        GstH264SliceHdr *slice, gboolean parse_pred_weight_table,
                                                        gboolean parse_dec_ref_pic_marking);
 
+GstH264ParserResult gst_h264_parser_parse_slice_hdr_with_depth (GstH264NalParser *nalparser,
+                                                       GstH264NalUnit *nalu, GstH264SliceHdr *slice,
+                                                       GstH264SliceHdrParseDepth depth);
+
 GstH264ParserResult gst_h264_parser_parse_subset_sps  (GstH264NalParser *nalparser, GstH264NalUnit *nalu,
                                                        GstH264SPS *sps, gboolean parse_vui_params);
 
@@ -79,6 +79,7 @@
 #endif
 
 #include "nalutils.h"
+#include "startcodes.h"
 #include "gsth265parser.h"
 
 #include <gst/base/gstbytereader.h>
@@ -1904,6 +1905,33 @@ gst_h265_parser_parse_pps (GstH265Parser * parser,
 GstH265ParserResult
 gst_h265_parser_parse_slice_hdr (GstH265Parser * parser,
     GstH265NalUnit * nalu, GstH265SliceHdr * slice)
+{
+  return gst_h265_parser_parse_slice_hdr_with_depth (parser, nalu, slice,
+      GST_H265_SLICE_HDR_PARSE_DEPTH_FULL);
+}
+
+/**
+ * gst_h265_parser_parse_slice_hdr_with_depth:
+ * @parser: a #GstH265Parser
+ * @nalu: The #GST_H265_NAL_SLICE #GstH265NalUnit to parse
+ * @slice: The #GstH265SliceHdr to fill.
+ * @depth: How much of the slice header to parse
+ *
+ * Parses @data, and fills the @slice structure up to @depth. With
+ * #GST_H265_SLICE_HDR_PARSE_DEPTH_AU_BOUNDARY, parsing stops after the
+ * slice type and the fields following it (including the reference
+ * picture sets and the pred_weight_table) are left to zero.
+ * The resulting @slice_hdr structure shall be deallocated with
+ * gst_h265_slice_hdr_free() when it is no longer needed
+ *
+ * Returns: a #GstH265ParserResult
+ *
+ * Since: 1.10
+ */
+GstH265ParserResult
+gst_h265_parser_parse_slice_hdr_with_depth (GstH265Parser * parser,
+    GstH265NalUnit * nalu, GstH265SliceHdr * slice,
+    GstH265SliceHdrParseDepth depth)
 {
   NalReader nr;
   gint pps_id;
@@ -1970,6 +1998,11 @@ gst_h265_parser_parse_slice_hdr (GstH265Parser * parser,
     READ_UINT32 (&nr, slice->segment_address, n);
   }
 
+  /* dependent slice segments can't start a new picture */
+  if (depth == GST_H265_SLICE_HDR_PARSE_DEPTH_AU_BOUNDARY &&
+      slice->dependent_slice_segment_flag)
+    return GST_H265_PARSER_OK;
+
   if (!slice->dependent_slice_segment_flag) {
     for (i = 0; i < pps->num_extra_slice_header_bits; i++)
       nal_reader_skip (&nr, 1);
@@ -1981,6 +2014,9 @@ gst_h265_parser_parse_slice_hdr (GstH265Parser * parser,
     if (sps->separate_colour_plane_flag == 1)
       READ_UINT8 (&nr, slice->colour_plane_id, 2);
 
+    if (depth == GST_H265_SLICE_HDR_PARSE_DEPTH_AU_BOUNDARY)
+      return GST_H265_PARSER_OK;
+
     if ((nalu->type != GST_H265_NAL_SLICE_IDR_W_RADL)
         && (nalu->type != GST_H265_NAL_SLICE_IDR_N_LP)) {
       READ_UINT16 (&nr, slice->pic_order_cnt_lsb,
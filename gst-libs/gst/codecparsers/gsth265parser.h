@@ -220,6 +220,23 @@ typedef enum
   GST_H265_I_SLICE    = 2
 } GstH265SliceType;
 
+/**
+ * GstH265SliceHdrParseDepth:
+ * @GST_H265_SLICE_HDR_PARSE_DEPTH_FULL: parse the whole slice header
+ * @GST_H265_SLICE_HDR_PARSE_DEPTH_AU_BOUNDARY: only parse the fields
+ *  needed to detect access unit boundaries and the slice type
+ *
+ * How much of a slice header gst_h265_parser_parse_slice_hdr_with_depth()
+ * parses.
+ *
+ * Since: 1.10
+ */
+typedef enum
+{
+  GST_H265_SLICE_HDR_PARSE_DEPTH_FULL,
+  GST_H265_SLICE_HDR_PARSE_DEPTH_AU_BOUNDARY
+} GstH265SliceHdrParseDepth;
+
 typedef enum
 {
   GST_H265_QUANT_MATIX_4X4   = 0,
@@ -1025,6 +1042,11 @@ GstH265ParserResult gst_h265_parser_parse_slice_hdr (GstH265Parser   * parser,
                                                      GstH265NalUnit  * nalu,
                                                      GstH265SliceHdr * slice);
 
+GstH265ParserResult gst_h265_parser_parse_slice_hdr_with_depth (GstH265Parser   * parser,
+                                                     GstH265NalUnit  * nalu,
+                                                     GstH265SliceHdr * slice,
+                                                     GstH265SliceHdrParseDepth depth);
+
 GstH265ParserResult gst_h265_parser_parse_vps       (GstH265Parser   * parser,
                                                      GstH265NalUnit  * nalu,
                                                      GstH265VPS      * vps);
@@ -680,6 +680,34 @@ gst_vp9_parser_free (GstVp9Parser * parser)
 GstVp9ParserResult
 gst_vp9_parser_parse_frame_header (GstVp9Parser * parser,
     GstVp9FrameHdr * frame_hdr, const guint8 * data, gsize size)
+{
+  return gst_vp9_parser_parse_frame_header_with_depth (parser, frame_hdr,
+      data, size, GST_VP9_FRAME_HDR_PARSE_DEPTH_FULL);
+}
+
+/**
+ * gst_vp9_parser_parse_frame_header_with_depth:
+ * @parser: The #GstVp9Parser
+ * @frame_hdr: The #GstVp9FrameHdr to fill
+ * @data: The data to parse
+ * @size: The size of the @data to parse
+ * @depth: How much of the frame header to parse
+ *
+ * Parses the VP9 bitstream contained in @data, and fills in @frame_hdr
+ * up to @depth. With #GST_VP9_FRAME_HDR_PARSE_DEPTH_FRAME_SIZE, parsing
+ * stops after the frame type, color configuration and frame and display
+ * sizes, the following fields are left to zero. Only the reference frame
+ * sizes of @parser are then updated, not its loop filter and segmentation
+ * state, so the depth should not be changed in the middle of a stream.
+ *
+ * Returns: a #GstVp9ParserResult
+ *
+ * Since: 1.10
+ */
+GstVp9ParserResult
+gst_vp9_parser_parse_frame_header_with_depth (GstVp9Parser * parser,
+    GstVp9FrameHdr * frame_hdr, const guint8 * data, gsize size,
+    GstVp9FrameHdrParseDepth depth)
 {
   GstBitReader bit_reader;
   GstBitReader *br = &bit_reader;
@@ -767,11 +795,17 @@ gst_vp9_parser_parse_frame_header (GstVp9Parser * parser,
       parse_frame_size_from_refs (parser, frame_hdr, br);
       parse_display_frame_size (br, frame_hdr);
 
+      if (depth == GST_VP9_FRAME_HDR_PARSE_DEPTH_FRAME_SIZE)
+        goto done;
+
       frame_hdr->allow_high_precision_mv = gst_vp9_read_bit (br);
       frame_hdr->mcomp_filter_type = parse_interp_filter (br);
     }
   }
 
+  if (depth == GST_VP9_FRAME_HDR_PARSE_DEPTH_FRAME_SIZE)
+    goto done;
+
   frame_hdr->refresh_frame_context =
       frame_hdr->error_resilient_mode ? 0 : gst_vp9_read_bit (br);
   frame_hdr->frame_parallel_decoding_mode =
@@ -810,6 +844,87 @@ gst_vp9_parser_parse_frame_header (GstVp9Parser * parser,
       (gst_bit_reader_get_pos (br) + 7) / 8;
   return gst_vp9_parser_update (parser, frame_hdr);
 
+done:
+  /* later frames may take their size from this one */
+  reference_update (parser, frame_hdr);
+  return GST_VP9_PARSER_OK;
+
 error:
   return GST_VP9_PARSER_ERROR;
 }
+
+/**
+ * gst_vp9_parser_parse_superframe_info:
+ * @parser: The #GstVp9Parser
+ * @superframe_info: The #GstVp9SuperframeInfo to fill
+ * @data: The data to parse
+ * @size: The size of the @data to parse
+ *
+ * Parses the superframe index at the end of @data, if any, and fills in
+ * @superframe_info with the sizes of the frames it contains. Data without
+ * superframe index is reported as a superframe of a single frame.
+ *
+ * Returns: a #GstVp9ParserResult
+ *
+ * Since: 1.10
+ */
+GstVp9ParserResult
+gst_vp9_parser_parse_superframe_info (GstVp9Parser * parser,
+    GstVp9SuperframeInfo * superframe_info, const guint8 * data, gsize size)
+{
+  guint8 marker;
+  guint32 frames, mag, index_size, total = 0;
+  const guint8 *index;
+  guint i, j;
+
+  g_return_val_if_fail (parser != NULL, GST_VP9_PARSER_ERROR);
+  g_return_val_if_fail (superframe_info != NULL, GST_VP9_PARSER_ERROR);
+  g_return_val_if_fail (data != NULL, GST_VP9_PARSER_ERROR);
+
+  memset (superframe_info, 0, sizeof (*superframe_info));
+
+  if (size == 0)
+    return GST_VP9_PARSER_BROKEN_DATA;
+
+  /* the last byte is the superframe marker:
+   * 3 bits marker, 2 bits bytes_per_framesize - 1, 3 bits frames - 1 */
+  marker = data[size - 1];
+  if ((marker >> 5) != GST_VP9_SUPERFRAME_MARKER)
+    goto single_frame;
+
+  frames = (marker & 0x7) + 1;
+  mag = ((marker >> 3) & 0x3) + 1;
+  index_size = 2 + mag * frames;
+
+  /* the index starts with the same marker byte */
+  if (size < index_size || data[size - index_size] != marker)
+    goto single_frame;
+
+  index = data + size - index_size + 1;
+  for (i = 0; i < frames; i++) {
+    guint32 frame_size = 0;
+
+    for (j = 0; j < mag; j++)
+      frame_size |= (guint32) * index++ << (j * 8);
+
+    if (frame_size == 0 || frame_size > size - index_size - total) {
+      GST_ERROR ("Invalid size of frame %u in superframe", i);
+      return GST_VP9_PARSER_BROKEN_DATA;
+    }
+
+    superframe_info->frame_sizes[i] = frame_size;
+    total += frame_size;
+  }
+
+  superframe_info->bytes_per_framesize = mag;
+  superframe_info->frames_in_superframe = frames;
+  superframe_info->superframe_index_size = index_size;
+
+  return GST_VP9_PARSER_OK;
+
+single_frame:
+  superframe_info->frames_in_superframe = 1;
+  superframe_info->frame_sizes[0] = size;
+
+  return GST_VP9_PARSER_OK;
+}
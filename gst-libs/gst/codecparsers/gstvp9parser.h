@@ -60,6 +60,9 @@ G_BEGIN_DECLS
 
 #define GST_VP9_PREDICTION_PROBS   3
 
+#define GST_VP9_SUPERFRAME_MARKER  0x06
+#define GST_VP9_MAX_FRAMES_IN_SUPERFRAME 8
+
 typedef struct _GstVp9Parser               GstVp9Parser;
 typedef struct _GstVp9FrameHdr             GstVp9FrameHdr;
 typedef struct _GstVp9LoopFilter           GstVp9LoopFilter;
@@ -67,6 +70,7 @@ typedef struct _GstVp9QuantIndices         GstVp9QuantIndices;
 typedef struct _GstVp9Segmentation         GstVp9Segmentation;
 typedef struct _GstVp9SegmentationInfo     GstVp9SegmentationInfo;
 typedef struct _GstVp9SegmentationInfoData GstVp9SegmentationInfoData;
+typedef struct _GstVp9SuperframeInfo       GstVp9SuperframeInfo;
 
 /**
  * GstVp9ParseResult:
@@ -85,6 +89,23 @@ typedef enum
   GST_VP9_PARSER_ERROR,
 } GstVp9ParserResult;
 
+/**
+ * GstVp9FrameHdrParseDepth:
+ * @GST_VP9_FRAME_HDR_PARSE_DEPTH_FULL: parse the whole uncompressed header
+ * @GST_VP9_FRAME_HDR_PARSE_DEPTH_FRAME_SIZE: only parse the uncompressed
+ *  header up to the frame and display sizes
+ *
+ * How much of a frame header gst_vp9_parser_parse_frame_header_with_depth()
+ * parses.
+ *
+ * Since: 1.10
+ */
+typedef enum
+{
+  GST_VP9_FRAME_HDR_PARSE_DEPTH_FULL,
+  GST_VP9_FRAME_HDR_PARSE_DEPTH_FRAME_SIZE
+} GstVp9FrameHdrParseDepth;
+
 /**
  * GstVp9Profile: Bitstream profiles indicated by 2-3 bits in the uncompressed header
  * @GST_VP9_PROFILE_0: Profile 0, 8-bit 4:2:0 only.
@@ -420,6 +441,26 @@ struct _GstVp9FrameHdr
   guint32 frame_header_length_in_bytes;
 };
 
+/**
+ * GstVp9SuperframeInfo:
+ * @bytes_per_framesize: size in bytes of each frame size in the index
+ * @frames_in_superframe: number of frames in the superframe
+ * @frame_sizes: size in bytes of each frame, in decoding order
+ * @superframe_index_size: size in bytes of the superframe index, 0 if the
+ *   data is a single frame without index
+ *
+ * Frames contained in a superframe, as described by the index at its end.
+ *
+ * Since: 1.10
+ */
+struct _GstVp9SuperframeInfo
+{
+  guint32 bytes_per_framesize;
+  guint32 frames_in_superframe;
+  guint32 frame_sizes[GST_VP9_MAX_FRAMES_IN_SUPERFRAME];
+  guint32 superframe_index_size;
+};
+
 /**
  * GstVp9Segmentation:
  * @filter_level: loop filter level
@@ -486,6 +527,10 @@ GstVp9Parser *     gst_vp9_parser_new (void);
 
 GstVp9ParserResult gst_vp9_parser_parse_frame_header (GstVp9Parser* parser, GstVp9FrameHdr * frame_hdr, const guint8 * data, gsize size);
 
+GstVp9ParserResult gst_vp9_parser_parse_frame_header_with_depth (GstVp9Parser* parser, GstVp9FrameHdr * frame_hdr, const guint8 * data, gsize size, GstVp9FrameHdrParseDepth depth);
+
+GstVp9ParserResult gst_vp9_parser_parse_superframe_info (GstVp9Parser* parser, GstVp9SuperframeInfo * superframe_info, const guint8 * data, gsize size);
+
 void               gst_vp9_parser_free (GstVp9Parser * parser);
 
 G_END_DECLS
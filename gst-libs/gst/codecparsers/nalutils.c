@@ -77,6 +77,11 @@ nal_reader_init (NalReader * nr, const guint8 * data, guint size)
   nr->cache = 0xff;
 }
 
+/* Whether one of the bytes of @w is 0x03, see
+ * <http://graphics.stanford.edu/~seander/bithacks.html#ZeroInWord> */
+#define HAS_BYTE_03(w) \
+  ((((w) ^ 0x03030303) - 0x01010101) & ~((w) ^ 0x03030303) & 0x80808080)
+
 inline gboolean
 nal_reader_read (NalReader * nr, guint nbits)
 {
@@ -90,6 +95,22 @@ nal_reader_read (NalReader * nr, guint nbits)
     guint8 byte;
     gboolean check_three_byte;
 
+    /* Refill 4 bytes at once as long as they can't contain an emulation
+     * prevention byte, i.e. none of them is 0x03. The cache holds at most
+     * 64 bits on top of first_byte. */
+    if (nr->bits_in_cache <= 40 && nr->byte + 4 <= nr->size) {
+      guint32 word = GST_READ_UINT32_BE (nr->data + nr->byte);
+
+      if (!HAS_BYTE_03 (word)) {
+        nr->cache = (nr->cache << 32) | ((guint32) nr->first_byte << 24) |
+            (word >> 8);
+        nr->first_byte = word & 0xff;
+        nr->byte += 4;
+        nr->bits_in_cache += 32;
+        continue;
+      }
+    }
+
     check_three_byte = TRUE;
   next_byte:
     if (G_UNLIKELY (nr->byte >= nr->size))
@@ -164,25 +185,38 @@ nal_reader_get_epb_count (const NalReader * nr)
   return nr->n_epb;
 }
 
+/* Brings the next @nbits (1 to 64) bits of the cache down, without
+ * masking out the bits before them. The cache must hold them */
+static inline guint64
+nal_reader_get_cached_bits (const NalReader * nr, guint nbits)
+{
+  guint shift = nr->bits_in_cache - nbits;
+
+  if (shift < 8)
+    return (nr->first_byte >> shift) | (nr->cache << (8 - shift));
+  else
+    return nr->cache >> (shift - 8);
+}
+
 #define NAL_READER_READ_BITS(bits) \
 gboolean \
 nal_reader_get_bits_uint##bits (NalReader *nr, guint##bits *val, guint nbits) \
 { \
-  guint shift; \
-  \
   if (!nal_reader_read (nr, nbits)) \
     return FALSE; \
   \
-  /* bring the required bits down and truncate */ \
-  shift = nr->bits_in_cache - nbits; \
-  *val = nr->first_byte >> shift; \
+  if (G_UNLIKELY (nbits == 0)) { \
+    *val = 0; \
+    return TRUE; \
+  } \
   \
-  *val |= nr->cache << (8 - shift); \
+  /* bring the required bits down and truncate */ \
+  *val = nal_reader_get_cached_bits (nr, nbits); \
   /* mask out required bits */ \
   if (nbits < bits) \
     *val &= ((guint##bits)1 << nbits) - 1; \
   \
-  nr->bits_in_cache = shift; \
+  nr->bits_in_cache -= nbits; \
   \
   return TRUE; \
 } \
@@ -210,6 +244,30 @@ nal_reader_get_ue (NalReader * nr, guint32 * val)
   guint8 bit;
   guint32 value;
 
+  /* Count the leading zero bits 8 at a time while possible */
+  while (nal_reader_read (nr, 8)) {
+    guint8 bits = nal_reader_get_cached_bits (nr, 8);
+    guint zeros;
+
+    if (bits == 0) {
+      nr->bits_in_cache -= 8;
+      i += 8;
+      if (G_UNLIKELY (i > 32))
+        return FALSE;
+      continue;
+    }
+#if defined(__GNUC__)
+    zeros = __builtin_clz (bits) - (sizeof (guint) * 8 - 8);
+#else
+    zeros = 7 - g_bit_nth_msf (bits, -1);
+#endif
+    /* skip the zeros and the terminating 1 bit */
+    nr->bits_in_cache -= zeros + 1;
+    i += zeros;
+    goto prefix_done;
+  }
+
+  /* Close to the end of the data, go bit by bit */
   if (G_UNLIKELY (!nal_reader_get_bits_uint8 (nr, &bit, 1)))
     return FALSE;
 
@@ -219,6 +277,7 @@ nal_reader_get_ue (NalReader * nr, guint32 * val)
       return FALSE;
   }
 
+prefix_done:
   if (G_UNLIKELY (i > 32))
     return FALSE;
 
@@ -249,7 +308,8 @@ nal_reader_get_se (NalReader * nr, gint32 * val)
 gboolean
 nal_reader_is_byte_aligned (NalReader * nr)
 {
-  if (nr->bits_in_cache != 0)
+  /* bytes are always loaded whole in the cache */
+  if (nr->bits_in_cache % 8 != 0)
     return FALSE;
   return TRUE;
 }
@@ -297,13 +357,3 @@ nal_reader_has_more_data (NalReader * nr)
 
 /***********  end of nal parser ***************/
 
-inline gint
-scan_for_start_codes (const guint8 * data, guint size)
-{
-  GstByteReader br;
-  gst_byte_reader_init (&br, data, size);
-
-  /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc */
-  return gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
-      0, size);
-}
@@ -178,6 +178,3 @@ gboolean nal_reader_get_se (NalReader * nr, gint32 * val);
   CHECK_ALLOWED (tmp, min, max); \
   val = tmp; \
 }
-
-G_GNUC_INTERNAL
-gint scan_for_start_codes (const guint8 * data, guint size);
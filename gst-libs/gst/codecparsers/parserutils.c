@@ -21,6 +21,7 @@
 
 #include "parserutils.h"
 
+
 gboolean
 decode_vlc (GstBitReader * br, guint * res, const VLCTable * table,
     guint length)
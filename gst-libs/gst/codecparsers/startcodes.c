@@ -0,0 +1,55 @@
+/* Gstreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "startcodes.h"
+
+#include <string.h>
+
+/* Returns the offset of the first 0x000001 start code prefix followed by at
+ * least one byte in @data, or -1 if there is none. Shared by all the parsers
+ * using such start codes (H.264, H.265, MPEG-1/2, MPEG-4 part 2 and VC-1) */
+gint
+scan_for_start_codes (const guint8 * data, guint size)
+{
+  const guint8 *p, *end;
+
+  if (G_UNLIKELY (size < 4))
+    return -1;
+
+  /* Look for the 0x01 byte of the prefix with memchr(), which is
+   * vectorized by the C library, and only then check the two zero bytes
+   * before it. The last byte can't be part of a prefix since the start
+   * code must be followed by at least one byte. */
+  p = data + 2;
+  end = data + size - 1;
+
+  while (p < end) {
+    p = memchr (p, 0x01, end - p);
+    if (p == NULL)
+      break;
+
+    if (p[-1] == 0x00 && p[-2] == 0x00)
+      return p - data - 2;
+
+    /* As *p is not 0x00, the next 0x01 can't complete a prefix before
+     * p + 3 */
+    p += 3;
+  }
+
+  return -1;
+}
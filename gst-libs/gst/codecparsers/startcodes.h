@@ -0,0 +1,31 @@
+/* Gstreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __START_CODES_H__
+#define __START_CODES_H__
+
+#include <glib.h>
+
+/* Start code scanning, kept apart from parserutils.h and nalutils.h so
+ * that all the parsers can include it along with their bit reading
+ * macros */
+
+G_GNUC_INTERNAL gint
+scan_for_start_codes (const guint8 * data, guint size);
+
+#endif /* __START_CODES_H__ */
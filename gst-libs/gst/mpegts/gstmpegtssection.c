@@ -127,16 +127,57 @@ static const guint32 crc_tab[256] = {
   0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
 };
 
+/* Tables for the slicing-by-8 variant of the CRC computation.
+ * crc_tab_sliced[n][i] is the CRC contribution of byte i followed by
+ * n zero bytes, crc_tab_sliced[0] being crc_tab itself. */
+static guint32 crc_tab_sliced[8][256];
+
+static void
+_init_crc_tab_sliced (void)
+{
+  guint i, n;
+
+  for (i = 0; i < 256; i++) {
+    crc_tab_sliced[0][i] = crc_tab[i];
+    for (n = 1; n < 8; n++) {
+      guint32 prev = crc_tab_sliced[n - 1][i];
+      crc_tab_sliced[n][i] = (prev << 8) ^ crc_tab[prev >> 24];
+    }
+  }
+}
+
 /* _calc_crc32 relicensed to LGPL from fluendo ts demuxer */
 guint32
 _calc_crc32 (const guint8 * data, guint datalen)
 {
-  gint i;
+  static gsize tables_initialized = 0;
   guint32 crc = 0xffffffff;
 
-  for (i = 0; i < datalen; i++) {
-    crc = (crc << 8) ^ crc_tab[((crc >> 24) ^ *data++) & 0xff];
+  if (g_once_init_enter (&tables_initialized)) {
+    _init_crc_tab_sliced ();
+    g_once_init_leave (&tables_initialized, 1);
+  }
+
+  /* Process 8 bytes per iteration, each of them being looked up in its own
+   * table so that the lookups don't depend on each other */
+  while (datalen >= 8) {
+    guint32 hi = crc ^ GST_READ_UINT32_BE (data);
+    guint32 lo = GST_READ_UINT32_BE (data + 4);
+
+    crc = crc_tab_sliced[7][hi >> 24] ^
+        crc_tab_sliced[6][(hi >> 16) & 0xff] ^
+        crc_tab_sliced[5][(hi >> 8) & 0xff] ^
+        crc_tab_sliced[4][hi & 0xff] ^
+        crc_tab_sliced[3][lo >> 24] ^
+        crc_tab_sliced[2][(lo >> 16) & 0xff] ^
+        crc_tab_sliced[1][(lo >> 8) & 0xff] ^ crc_tab_sliced[0][lo & 0xff];
+    data += 8;
+    datalen -= 8;
   }
+
+  while (datalen--)
+    crc = (crc << 8) ^ crc_tab[((crc >> 24) ^ *data++) & 0xff];
+
   return crc;
 }
 
@@ -71,6 +71,9 @@ struct _GstVideoAggregatorPadPrivate
   /* caps used for conversion if needed */
   GstVideoInfo conversion_info;
   GstBuffer *converted_buffer;
+  /* pool of the converted buffers, of converted_size bytes */
+  GstBufferPool *converted_pool;
+  guint converted_size;
 
   GstClockTime start_time;
   GstClockTime end_time;
@@ -216,6 +219,64 @@ gst_video_aggregator_pad_set_info (GstVideoAggregatorPad * pad,
   return TRUE;
 }
 
+static void
+gst_video_aggregator_pad_free_converted_pool (GstVideoAggregatorPad * pad)
+{
+  if (pad->priv->converted_pool) {
+    gst_buffer_pool_set_active (pad->priv->converted_pool, FALSE);
+    gst_object_unref (pad->priv->converted_pool);
+    pad->priv->converted_pool = NULL;
+  }
+}
+
+/**
+ * gst_video_aggregator_pad_acquire_converted_buffer:
+ * @pad: a #GstVideoAggregatorPad
+ * @size: the size of the buffer, in bytes
+ *
+ * Acquires a buffer of @size bytes to convert the frames of @pad into, from a
+ * pool owned by @pad. The pool is made again when @size changes, and released
+ * when the aggregator stops or @pad is finalized. May be called from
+ * #GstVideoAggregatorPadClass.prepare_frame.
+ *
+ * Returns: (transfer full) (nullable): a new #GstBuffer, or %NULL on error
+ *
+ * Since: 1.10
+ */
+GstBuffer *
+gst_video_aggregator_pad_acquire_converted_buffer (GstVideoAggregatorPad * pad,
+    guint size)
+{
+  static GstAllocationParams params = { 0, 15, 0, 0, };
+  GstBuffer *buf = NULL;
+
+  if (pad->priv->converted_pool && pad->priv->converted_size != size)
+    gst_video_aggregator_pad_free_converted_pool (pad);
+
+  if (!pad->priv->converted_pool) {
+    GstBufferPool *pool = gst_buffer_pool_new ();
+    GstStructure *config = gst_buffer_pool_get_config (pool);
+
+    gst_buffer_pool_config_set_params (config, NULL, size, 0, 0);
+    gst_buffer_pool_config_set_allocator (config, NULL, &params);
+    if (!gst_buffer_pool_set_config (pool, config) ||
+        !gst_buffer_pool_set_active (pool, TRUE)) {
+      GST_WARNING_OBJECT (pad, "Could not activate pool of converted buffers");
+      gst_object_unref (pool);
+      return gst_buffer_new_allocate (NULL, size, &params);
+    }
+
+    pad->priv->converted_pool = pool;
+    pad->priv->converted_size = size;
+  }
+
+  if (gst_buffer_pool_acquire_buffer (pad->priv->converted_pool, &buf,
+          NULL) != GST_FLOW_OK)
+    return NULL;
+
+  return buf;
+}
+
 static void
 gst_videoaggregator_pad_finalize (GObject * o)
 {
@@ -225,6 +286,8 @@ gst_videoaggregator_pad_finalize (GObject * o)
     gst_video_converter_free (vaggpad->priv->convert);
   vaggpad->priv->convert = NULL;
 
+  gst_video_aggregator_pad_free_converted_pool (vaggpad);
+
   G_OBJECT_CLASS (gst_videoaggregator_pad_parent_class)->finalize (o);
 }
 
@@ -236,7 +299,6 @@ gst_video_aggregator_pad_prepare_frame (GstVideoAggregatorPad * pad,
   GstVideoFrame *converted_frame;
   GstBuffer *converted_buf = NULL;
   GstVideoFrame *frame;
-  static GstAllocationParams params = { 0, 15, 0, 0, };
 
   if (!pad->buffer)
     return TRUE;
@@ -258,12 +320,15 @@ gst_video_aggregator_pad_prepare_frame (GstVideoAggregatorPad * pad,
     converted_size = pad->priv->conversion_info.size;
     outsize = GST_VIDEO_INFO_SIZE (&vagg->info);
     converted_size = converted_size > outsize ? converted_size : outsize;
-    converted_buf = gst_buffer_new_allocate (NULL, converted_size, &params);
+    converted_buf =
+        gst_video_aggregator_pad_acquire_converted_buffer (pad, converted_size);
 
-    if (!gst_video_frame_map (converted_frame, &(pad->priv->conversion_info),
-            converted_buf, GST_MAP_READWRITE)) {
+    if (!converted_buf || !gst_video_frame_map (converted_frame,
+            &(pad->priv->conversion_info), converted_buf, GST_MAP_READWRITE)) {
       GST_WARNING_OBJECT (vagg, "Could not map converted frame");
 
+      if (converted_buf)
+        gst_buffer_unref (converted_buf);
       g_slice_free (GstVideoFrame, converted_frame);
       gst_video_frame_unmap (frame);
       g_slice_free (GstVideoFrame, frame);
@@ -428,6 +493,12 @@ struct _GstVideoAggregatorPrivate
   GstCaps *current_caps;
 
   gboolean live;
+
+  /* pads preparing their frames in parallel */
+  GThreadPool *prepare_pool;
+  GMutex prepare_lock;
+  GCond prepare_cond;
+  guint prepare_pending;
 };
 
 /* Can't use the G_DEFINE_TYPE macros because we need the
@@ -1037,6 +1108,7 @@ gst_videoaggregator_reset (GstVideoAggregator * vagg)
     gst_buffer_replace (&p->buffer, NULL);
     p->priv->start_time = -1;
     p->priv->end_time = -1;
+    gst_video_aggregator_pad_free_converted_pool (p);
 
     gst_video_info_init (&p->info);
   }
@@ -1275,6 +1347,88 @@ prepare_frames (GstVideoAggregator * vagg, GstVideoAggregatorPad * pad)
   return vaggpad_class->prepare_frame (pad, vagg);
 }
 
+static void
+prepare_frames_func (gpointer data, gpointer user_data)
+{
+  GstVideoAggregatorPad *pad = data;
+  GstVideoAggregator *vagg = user_data;
+
+  prepare_frames (vagg, pad);
+
+  g_mutex_lock (&vagg->priv->prepare_lock);
+  if (--vagg->priv->prepare_pending == 0)
+    g_cond_signal (&vagg->priv->prepare_cond);
+  g_mutex_unlock (&vagg->priv->prepare_lock);
+}
+
+static gboolean
+collect_pads_with_buffer (GstVideoAggregator * vagg,
+    GstVideoAggregatorPad * pad, GPtrArray * pads)
+{
+  if (pad->buffer != NULL)
+    g_ptr_array_add (pads, gst_object_ref (pad));
+
+  return TRUE;
+}
+
+static gboolean
+gst_videoaggregator_ensure_prepare_pool (GstVideoAggregator * vagg)
+{
+  guint n_threads;
+  GError *err = NULL;
+
+  if (vagg->priv->prepare_pool)
+    return TRUE;
+
+  /* the aggregating thread prepares frames too */
+  n_threads = g_get_num_processors ();
+  if (n_threads < 2)
+    return FALSE;
+
+  vagg->priv->prepare_pool = g_thread_pool_new (prepare_frames_func, vagg,
+      n_threads - 1, FALSE, &err);
+  if (!vagg->priv->prepare_pool) {
+    GST_WARNING_OBJECT (vagg, "Could not create thread pool, preparing the "
+        "frames serially: %s", err->message);
+    g_clear_error (&err);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Converts the frames of all the pads, concurrently if the pad class allows
+ * it, the aggregating thread taking the first pad */
+static void
+gst_videoaggregator_prepare_frames (GstVideoAggregator * vagg,
+    GstVideoAggregatorPadClass * vaggpad_class)
+{
+  GPtrArray *pads = g_ptr_array_new_with_free_func (gst_object_unref);
+  guint i;
+
+  gst_aggregator_iterate_sinkpads (GST_AGGREGATOR (vagg),
+      (GstAggregatorPadForeachFunc) collect_pads_with_buffer, pads);
+
+  if (vaggpad_class->prepare_frame_threadsafe && pads->len > 1 &&
+      gst_videoaggregator_ensure_prepare_pool (vagg)) {
+    vagg->priv->prepare_pending = pads->len - 1;
+    for (i = 1; i < pads->len; i++)
+      g_thread_pool_push (vagg->priv->prepare_pool, pads->pdata[i], NULL);
+
+    prepare_frames (vagg, pads->pdata[0]);
+
+    g_mutex_lock (&vagg->priv->prepare_lock);
+    while (vagg->priv->prepare_pending > 0)
+      g_cond_wait (&vagg->priv->prepare_cond, &vagg->priv->prepare_lock);
+    g_mutex_unlock (&vagg->priv->prepare_lock);
+  } else {
+    for (i = 0; i < pads->len; i++)
+      prepare_frames (vagg, pads->pdata[i]);
+  }
+
+  g_ptr_array_unref (pads);
+}
+
 static gboolean
 clean_pad (GstVideoAggregator * vagg, GstVideoAggregatorPad * pad)
 {
@@ -1318,8 +1472,8 @@ gst_videoaggregator_do_aggregate (GstVideoAggregator * vagg,
       (GstAggregatorPadForeachFunc) sync_pad_values, NULL);
 
   /* Convert all the frames the subclass has before aggregating */
-  gst_aggregator_iterate_sinkpads (GST_AGGREGATOR (vagg),
-      (GstAggregatorPadForeachFunc) prepare_frames, NULL);
+  if (vaggpad_class->prepare_frame)
+    gst_videoaggregator_prepare_frames (vagg, vaggpad_class);
 
   ret = vagg_klass->aggregate_frames (vagg, *outbuf);
 
@@ -2011,7 +2165,13 @@ gst_videoaggregator_finalize (GObject * o)
 {
   GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (o);
 
+  if (vagg->priv->prepare_pool)
+    g_thread_pool_free (vagg->priv->prepare_pool, FALSE, TRUE);
+  vagg->priv->prepare_pool = NULL;
+
   g_mutex_clear (&vagg->priv->lock);
+  g_mutex_clear (&vagg->priv->prepare_lock);
+  g_cond_clear (&vagg->priv->prepare_cond);
 
   G_OBJECT_CLASS (gst_videoaggregator_parent_class)->finalize (o);
 }
@@ -2178,6 +2338,8 @@ gst_videoaggregator_init (GstVideoAggregator * vagg,
   vagg->priv->current_caps = NULL;
 
   g_mutex_init (&vagg->priv->lock);
+  g_mutex_init (&vagg->priv->prepare_lock);
+  g_cond_init (&vagg->priv->prepare_cond);
 
   /* initialize variables */
   g_mutex_lock (&sink_caps_mutex);
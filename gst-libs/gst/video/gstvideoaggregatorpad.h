@@ -88,6 +88,10 @@ struct _GstVideoAggregatorPad
  * @prepare_frame: Prepare the frame from the pad buffer (if any)
  *                 and sets it to @aggregated_frame
  * @clean_frame:   clean the frame previously prepared in prepare_frame
+ * @prepare_frame_threadsafe: Whether @prepare_frame may be called for several
+ *                 pads at the same time, from different threads. Defaults to
+ *                 %FALSE, the frames of all the pads are then prepared one
+ *                 after the other from the aggregating thread. Since: 1.10
  */
 struct _GstVideoAggregatorPadClass
 {
@@ -103,10 +107,15 @@ struct _GstVideoAggregatorPadClass
   void               (*clean_frame)           (GstVideoAggregatorPad * pad,
                                                GstVideoAggregator    * videoaggregator);
 
-  gpointer          _gst_reserved[GST_PADDING_LARGE];
+  gboolean           prepare_frame_threadsafe;
+
+  gpointer          _gst_reserved[GST_PADDING_LARGE - 1];
 };
 
 GType gst_videoaggregator_pad_get_type (void);
 
+GstBuffer * gst_video_aggregator_pad_acquire_converted_buffer (GstVideoAggregatorPad * pad,
+                                                               guint                   size);
+
 G_END_DECLS
 #endif /* __GST_VIDEO_AGGREGATOR_PAD_H__ */
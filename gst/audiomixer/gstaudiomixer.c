@@ -80,6 +80,13 @@ GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 #define VOLUME_UNITY_INT32           134217728  /* internal int for unity 2^(32-5) */
 #define VOLUME_UNITY_INT32_BIT_SHIFT 27
 
+/* Output buffers up to this size stay in the L1 cache while the inputs are
+ * mixed to them one after the other, as the default 10 ms buffers (3840
+ * bytes in F32 stereo at 48 kHz). Larger ones are split in blocks of
+ * MIX_BLOCK_SIZE bytes all the inputs are mixed to in turn */
+#define MIX_BLOCK_THRESHOLD 32768
+#define MIX_BLOCK_SIZE 4096
+
 enum
 {
   PROP_PAD_0,
@@ -216,6 +223,9 @@ static gboolean
 gst_audiomixer_aggregate_one_buffer (GstAudioAggregator * aagg,
     GstAudioAggregatorPad * aaggpad, GstBuffer * inbuf, guint in_offset,
     GstBuffer * outbuf, guint out_offset, guint num_samples);
+static gboolean
+gst_audiomixer_aggregate_buffers (GstAudioAggregator * aagg,
+    GstAudioAggregatorInput * inputs, guint n_inputs, GstBuffer * outbuf);
 
 
 /* we can only accept caps that we and downstream can handle.
@@ -504,12 +514,28 @@ gst_audiomixer_class_init (GstAudioMixerClass * klass)
   agg_class->sink_event = GST_DEBUG_FUNCPTR (gst_audiomixer_sink_event);
 
   aagg_class->aggregate_one_buffer = gst_audiomixer_aggregate_one_buffer;
+  aagg_class->aggregate_buffers = gst_audiomixer_aggregate_buffers;
 }
 
 static void
 gst_audiomixer_init (GstAudioMixer * audiomixer)
 {
+  const gchar *env;
+
   audiomixer->filter_caps = NULL;
+  audiomixer->mix_inputs = g_array_new (FALSE, FALSE,
+      sizeof (GstAudioMixerInput));
+
+  audiomixer->mix_block_threshold = MIX_BLOCK_THRESHOLD;
+  audiomixer->mix_block_size = MIX_BLOCK_SIZE;
+
+  /* Block size in bytes to use for all output buffers, 0 to always mix the
+   * inputs one after the other. Used to measure the effect of the blocks */
+  env = g_getenv ("GST_AUDIOMIXER_MIX_BLOCK_SIZE");
+  if (env) {
+    audiomixer->mix_block_threshold = 0;
+    audiomixer->mix_block_size = g_ascii_strtoull (env, NULL, 10);
+  }
 }
 
 static void
@@ -518,6 +544,10 @@ gst_audiomixer_dispose (GObject * object)
   GstAudioMixer *audiomixer = GST_AUDIO_MIXER (object);
 
   gst_caps_replace (&audiomixer->filter_caps, NULL);
+  if (audiomixer->mix_inputs) {
+    g_array_free (audiomixer->mix_inputs, TRUE);
+    audiomixer->mix_inputs = NULL;
+  }
 
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
@@ -615,129 +645,238 @@ gst_audiomixer_release_pad (GstElement * element, GstPad * pad)
 }
 
 
-/* Called with object lock and pad object lock held */
-static gboolean
-gst_audiomixer_aggregate_one_buffer (GstAudioAggregator * aagg,
-    GstAudioAggregatorPad * aaggpad, GstBuffer * inbuf, guint in_offset,
-    GstBuffer * outbuf, guint out_offset, guint num_frames)
+/* The volume of a pad, in the representations of the mixing functions */
+typedef struct
 {
-  GstAudioMixerPad *pad = GST_AUDIO_MIXER_PAD (aaggpad);
-  GstMapInfo inmap;
-  GstMapInfo outmap;
-  gint bpf;
+  gdouble volume;
+  gint volume_i32;
+  gint volume_i16;
+  gint volume_i8;
+} GstAudioMixerVolume;
 
-  if (pad->mute || pad->volume < G_MINDOUBLE) {
-    GST_DEBUG_OBJECT (pad, "Skipping muted pad");
-    return FALSE;
-  }
-
-  bpf = GST_AUDIO_INFO_BPF (&aagg->info);
-
-  gst_buffer_map (outbuf, &outmap, GST_MAP_READWRITE);
-  gst_buffer_map (inbuf, &inmap, GST_MAP_READ);
-  GST_LOG_OBJECT (pad, "mixing %u bytes at offset %u from offset %u",
-      num_frames * bpf, out_offset * bpf, in_offset * bpf);
-
-  /* further buffers, need to add them */
-  if (pad->volume == 1.0) {
-    switch (aagg->info.finfo->format) {
+/* Adds @n_samples samples of @in to @out, at @volume */
+static void
+gst_audiomixer_mix_samples (GstAudioFormat format,
+    const GstAudioMixerVolume * volume, gpointer out, gconstpointer in,
+    guint n_samples)
+{
+  if (volume->volume == 1.0) {
+    switch (format) {
       case GST_AUDIO_FORMAT_U8:
-        audiomixer_orc_add_u8 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_u8 (out, (gpointer) in, n_samples);
         break;
       case GST_AUDIO_FORMAT_S8:
-        audiomixer_orc_add_s8 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_s8 (out, (gpointer) in, n_samples);
         break;
       case GST_AUDIO_FORMAT_U16:
-        audiomixer_orc_add_u16 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_u16 (out, (gpointer) in, n_samples);
         break;
       case GST_AUDIO_FORMAT_S16:
-        audiomixer_orc_add_s16 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_s16 (out, (gpointer) in, n_samples);
         break;
       case GST_AUDIO_FORMAT_U32:
-        audiomixer_orc_add_u32 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_u32 (out, (gpointer) in, n_samples);
         break;
       case GST_AUDIO_FORMAT_S32:
-        audiomixer_orc_add_s32 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_s32 (out, (gpointer) in, n_samples);
         break;
       case GST_AUDIO_FORMAT_F32:
-        audiomixer_orc_add_f32 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_f32 (out, (gpointer) in, n_samples);
         break;
       case GST_AUDIO_FORMAT_F64:
-        audiomixer_orc_add_f64 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_f64 (out, (gpointer) in, n_samples);
         break;
       default:
         g_assert_not_reached ();
         break;
     }
   } else {
-    switch (aagg->info.finfo->format) {
+    switch (format) {
       case GST_AUDIO_FORMAT_U8:
-        audiomixer_orc_add_volume_u8 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume_i8, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_u8 (out, (gpointer) in, volume->volume_i8,
+            n_samples);
         break;
       case GST_AUDIO_FORMAT_S8:
-        audiomixer_orc_add_volume_s8 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume_i8, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_s8 (out, (gpointer) in, volume->volume_i8,
+            n_samples);
         break;
       case GST_AUDIO_FORMAT_U16:
-        audiomixer_orc_add_volume_u16 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume_i16, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_u16 (out, (gpointer) in, volume->volume_i16,
+            n_samples);
         break;
       case GST_AUDIO_FORMAT_S16:
-        audiomixer_orc_add_volume_s16 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume_i16, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_s16 (out, (gpointer) in, volume->volume_i16,
+            n_samples);
         break;
       case GST_AUDIO_FORMAT_U32:
-        audiomixer_orc_add_volume_u32 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume_i32, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_u32 (out, (gpointer) in, volume->volume_i32,
+            n_samples);
         break;
       case GST_AUDIO_FORMAT_S32:
-        audiomixer_orc_add_volume_s32 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume_i32, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_s32 (out, (gpointer) in, volume->volume_i32,
+            n_samples);
         break;
       case GST_AUDIO_FORMAT_F32:
-        audiomixer_orc_add_volume_f32 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_f32 (out, (gpointer) in, volume->volume,
+            n_samples);
         break;
       case GST_AUDIO_FORMAT_F64:
-        audiomixer_orc_add_volume_f64 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_f64 (out, (gpointer) in, volume->volume,
+            n_samples);
         break;
       default:
         g_assert_not_reached ();
         break;
     }
   }
+}
+
+/* Reads the volume of @pad, returns FALSE if it is muted. Called with the pad
+ * object lock held */
+static gboolean
+gst_audiomixer_pad_get_volume (GstAudioMixerPad * pad,
+    GstAudioMixerVolume * volume)
+{
+  if (pad->mute || pad->volume < G_MINDOUBLE) {
+    GST_DEBUG_OBJECT (pad, "Skipping muted pad");
+    return FALSE;
+  }
+
+  volume->volume = pad->volume;
+  volume->volume_i32 = pad->volume_i32;
+  volume->volume_i16 = pad->volume_i16;
+  volume->volume_i8 = pad->volume_i8;
+
+  return TRUE;
+}
+
+/* Called with object lock and pad object lock held */
+static gboolean
+gst_audiomixer_aggregate_one_buffer (GstAudioAggregator * aagg,
+    GstAudioAggregatorPad * aaggpad, GstBuffer * inbuf, guint in_offset,
+    GstBuffer * outbuf, guint out_offset, guint num_frames)
+{
+  GstAudioMixerPad *pad = GST_AUDIO_MIXER_PAD (aaggpad);
+  GstAudioMixerVolume volume;
+  GstMapInfo inmap;
+  GstMapInfo outmap;
+  gint bpf;
+
+  if (!gst_audiomixer_pad_get_volume (pad, &volume))
+    return FALSE;
+
+  bpf = GST_AUDIO_INFO_BPF (&aagg->info);
+
+  gst_buffer_map (outbuf, &outmap, GST_MAP_READWRITE);
+  gst_buffer_map (inbuf, &inmap, GST_MAP_READ);
+  GST_LOG_OBJECT (pad, "mixing %u bytes at offset %u from offset %u",
+      num_frames * bpf, out_offset * bpf, in_offset * bpf);
+
+  gst_audiomixer_mix_samples (aagg->info.finfo->format, &volume,
+      outmap.data + out_offset * bpf, inmap.data + in_offset * bpf,
+      num_frames * aagg->info.channels);
+
   gst_buffer_unmap (inbuf, &inmap);
   gst_buffer_unmap (outbuf, &outmap);
 
   return TRUE;
 }
 
+struct _GstAudioMixerInput
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  const guint8 *data;
+  guint out_offset;
+  guint num_frames;
+  GstAudioMixerVolume volume;
+};
+
+/* Called with object lock held */
+static gboolean
+gst_audiomixer_aggregate_buffers (GstAudioAggregator * aagg,
+    GstAudioAggregatorInput * inputs, guint n_inputs, GstBuffer * outbuf)
+{
+  GstAudioFormat format = GST_AUDIO_INFO_FORMAT (&aagg->info);
+  gint bpf = GST_AUDIO_INFO_BPF (&aagg->info);
+  gint channels = GST_AUDIO_INFO_CHANNELS (&aagg->info);
+  GstAudioMixer *audiomixer = GST_AUDIO_MIXER (aagg);
+  GstAudioMixerInput *mix;
+  GstMapInfo outmap;
+  guint i, n_mix = 0, block_frames, start = G_MAXUINT, end = 0, pos, next;
+
+  /* only used from the aggregate function, reused for every buffer */
+  g_array_set_size (audiomixer->mix_inputs, n_inputs);
+  mix = (GstAudioMixerInput *) audiomixer->mix_inputs->data;
+
+  for (i = 0; i < n_inputs; i++) {
+    GstAudioMixerPad *pad = GST_AUDIO_MIXER_PAD (inputs[i].pad);
+    GstAudioMixerInput *m = &mix[n_mix];
+    gboolean audible;
+
+    GST_OBJECT_LOCK (pad);
+    audible = gst_audiomixer_pad_get_volume (pad, &m->volume);
+    GST_OBJECT_UNLOCK (pad);
+
+    if (!audible)
+      continue;
+
+    if (!gst_buffer_map (inputs[i].buffer, &m->map, GST_MAP_READ)) {
+      GST_WARNING_OBJECT (pad, "Could not map input buffer");
+      continue;
+    }
+
+    GST_LOG_OBJECT (pad, "mixing %u bytes at offset %u from offset %u",
+        inputs[i].num_frames * bpf, inputs[i].out_offset * bpf,
+        inputs[i].in_offset * bpf);
+
+    m->buffer = inputs[i].buffer;
+    m->data = m->map.data + inputs[i].in_offset * bpf;
+    m->out_offset = inputs[i].out_offset;
+    m->num_frames = inputs[i].num_frames;
+    start = MIN (start, m->out_offset);
+    end = MAX (end, m->out_offset + m->num_frames);
+    n_mix++;
+  }
+
+  if (n_mix == 0)
+    return FALSE;
+
+  gst_buffer_map (outbuf, &outmap, GST_MAP_READWRITE);
+
+  /* all the inputs are added to a block of the output buffer before the next
+   * one, so that it stays in the cache instead of being read and written
+   * back once per input. The samples are added in the same order as
+   * one input after the other, which gives the same output. Small output
+   * buffers are mixed in a single block */
+  if (audiomixer->mix_block_size > 0 &&
+      (end - start) * bpf > audiomixer->mix_block_threshold)
+    block_frames = MAX (audiomixer->mix_block_size / bpf, 1);
+  else
+    block_frames = end - start;
+  for (pos = start; pos < end; pos = next) {
+    next = MIN (pos + block_frames, end);
+
+    for (i = 0; i < n_mix; i++) {
+      GstAudioMixerInput *m = &mix[i];
+      guint from = MAX (pos, m->out_offset);
+      guint to = MIN (next, m->out_offset + m->num_frames);
+
+      if (from >= to)
+        continue;
+
+      gst_audiomixer_mix_samples (format, &m->volume, outmap.data + from * bpf,
+          m->data + (from - m->out_offset) * bpf, (to - from) * channels);
+    }
+  }
+
+  gst_buffer_unmap (outbuf, &outmap);
+  for (i = 0; i < n_mix; i++)
+    gst_buffer_unmap (mix[i].buffer, &mix[i].map);
+
+  return TRUE;
+}
+
 
 /* GstChildProxy implementation */
 static GObject *
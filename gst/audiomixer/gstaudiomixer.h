@@ -43,6 +43,8 @@ typedef struct _GstAudioMixerClass        GstAudioMixerClass;
 typedef struct _GstAudioMixerPad GstAudioMixerPad;
 typedef struct _GstAudioMixerPadClass GstAudioMixerPadClass;
 
+typedef struct _GstAudioMixerInput GstAudioMixerInput;
+
 /**
  * GstAudioMixer:
  *
@@ -53,6 +55,13 @@ struct _GstAudioMixer {
 
   /* target caps (set via property) */
   GstCaps *filter_caps;
+
+  /* output buffers larger than mix_block_threshold bytes are mixed in
+   * blocks of mix_block_size bytes */
+  guint mix_block_threshold;
+  guint mix_block_size;
+  /* GstAudioMixerInput array used by aggregate_buffers */
+  GArray *mix_inputs;
 };
 
 struct _GstAudioMixerClass {
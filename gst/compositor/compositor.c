@@ -378,7 +378,6 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
   GstVideoFrame *converted_frame;
   GstBuffer *converted_buf = NULL;
   GstVideoFrame *frame;
-  static GstAllocationParams params = { 0, 15, 0, 0, };
   gint width, height;
   gboolean frame_obscured = FALSE;
   GList *l;
@@ -547,12 +546,15 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
     converted_size = GST_VIDEO_INFO_SIZE (&cpad->conversion_info);
     outsize = GST_VIDEO_INFO_SIZE (&vagg->info);
     converted_size = converted_size > outsize ? converted_size : outsize;
-    converted_buf = gst_buffer_new_allocate (NULL, converted_size, &params);
+    converted_buf =
+        gst_video_aggregator_pad_acquire_converted_buffer (pad, converted_size);
 
-    if (!gst_video_frame_map (converted_frame, &(cpad->conversion_info),
-            converted_buf, GST_MAP_READWRITE)) {
+    if (!converted_buf || !gst_video_frame_map (converted_frame,
+            &(cpad->conversion_info), converted_buf, GST_MAP_READWRITE)) {
       GST_WARNING_OBJECT (vagg, "Could not map converted frame");
 
+      if (converted_buf)
+        gst_buffer_unref (converted_buf);
       g_slice_free (GstVideoFrame, converted_frame);
       gst_video_frame_unmap (frame);
       g_slice_free (GstVideoFrame, frame);
@@ -640,6 +642,9 @@ gst_compositor_pad_class_init (GstCompositorPadClass * klass)
       GST_DEBUG_FUNCPTR (gst_compositor_pad_prepare_frame);
   vaggpadclass->clean_frame =
       GST_DEBUG_FUNCPTR (gst_compositor_pad_clean_frame);
+  /* prepare_frame only touches the state of its own pad, and looks at the
+   * other pads with the object lock of the aggregator */
+  vaggpadclass->prepare_frame_threadsafe = TRUE;
 }
 
 static void
@@ -653,12 +658,21 @@ gst_compositor_pad_init (GstCompositorPad * compo_pad)
 
 /* GstCompositor */
 #define DEFAULT_BACKGROUND COMPOSITOR_BACKGROUND_CHECKER
+#define DEFAULT_N_THREADS 1
+#define DEFAULT_PARTIAL_UPDATES FALSE
 enum
 {
   PROP_0,
-  PROP_BACKGROUND
+  PROP_BACKGROUND,
+  PROP_N_THREADS,
+  PROP_PARTIAL_UPDATES,
+  PROP_STATS
 };
 
+/* Stripes start on multiples of this number of rows, so that the checker
+ * pattern and the subsampled chroma rows line up with the full frame */
+#define STRIPE_ALIGN 16
+
 #define GST_TYPE_COMPOSITOR_BACKGROUND (gst_compositor_background_get_type())
 static GType
 gst_compositor_background_get_type (void)
@@ -682,6 +696,23 @@ gst_compositor_background_get_type (void)
   return compositor_background_type;
 }
 
+static GstStructure *
+gst_compositor_create_stats (GstCompositor * self)
+{
+  GstStructure *s;
+
+  GST_OBJECT_LOCK (self);
+  s = gst_structure_new ("application/x-compositor-stats",
+      "frames", G_TYPE_UINT64, self->frames,
+      "total-pixels", G_TYPE_UINT64, self->total_pixels,
+      "recomposed-pixels", G_TYPE_UINT64, self->recomposed_pixels,
+      "recomposed-fraction", G_TYPE_DOUBLE, self->total_pixels ?
+      (gdouble) self->recomposed_pixels / self->total_pixels : 0.0, NULL);
+  GST_OBJECT_UNLOCK (self);
+
+  return s;
+}
+
 static void
 gst_compositor_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec)
@@ -692,6 +723,19 @@ gst_compositor_get_property (GObject * object,
     case PROP_BACKGROUND:
       g_value_set_enum (value, self->background);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->n_threads);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_PARTIAL_UPDATES:
+      GST_OBJECT_LOCK (self);
+      g_value_set_boolean (value, self->partial_updates);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_compositor_create_stats (self));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -708,6 +752,16 @@ gst_compositor_set_property (GObject * object,
     case PROP_BACKGROUND:
       self->background = g_value_get_enum (value);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (self);
+      self->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_PARTIAL_UPDATES:
+      GST_OBJECT_LOCK (self);
+      self->partial_updates = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -967,25 +1021,186 @@ _fixate_caps (GstVideoAggregator * vagg, GstCaps * caps)
   return ret;
 }
 
-static GstFlowReturn
-gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
+/* The areas covered by opaque inputs are shrunk, and the areas to update are
+ * grown, to multiples of these numbers of pixels, so that the background is
+ * only drawn in rectangles starting on the checker pattern, which repeats
+ * every 32 columns with the packed 4:2:2 formats, and on whole chroma
+ * samples */
+#define REGION_ALIGN_X 32
+#define REGION_ALIGN_Y STRIPE_ALIGN
+
+typedef struct
 {
-  GList *l;
-  GstCompositor *self = GST_COMPOSITOR (vagg);
+  GstVideoAggregatorPad *pad;
+  GstVideoFrame *frame;
+  /* position, rounded as the blend functions do */
+  gint xpos, ypos;
+  gdouble alpha;
+  /* the part of the output frame the input is drawn on */
+  GstVideoRectangle rect;
+  /* the aligned part of @rect hiding what is below, empty if the input is
+   * not opaque */
+  GstVideoRectangle covered;
+} CompositorInput;
+
+/* What an input of the cached frame was composited from */
+typedef struct
+{
+  /* both reffed, so that their pointers are not reused by other objects */
+  GstVideoAggregatorPad *pad;
+  GstBuffer *buffer;
+  gint xpos, ypos;
+  gdouble alpha;
+  guint zorder;
+  GstVideoRectangle rect;
+} CompositorInputState;
+
+/* The rows [y, y + height) of the output frame */
+typedef struct
+{
+  GstCompositor *self;
+  GstVideoFrame *outframe;
+  GstCompositorBackground background;
   BlendFunction composite;
-  GstVideoFrame out_frame, *outframe;
+  GArray *inputs;
+  gint y, height;
+  /* the cached frame to update, and the regions of it to recompose, NULL
+   * to recompose everything */
+  GstVideoFrame *cache;
+  GArray *regions;
+} CompositorStripe;
 
-  if (!gst_video_frame_map (&out_frame, &vagg->info, outbuf, GST_MAP_WRITE)) {
-    GST_WARNING_OBJECT (vagg, "Could not map output buffer");
-    return GST_FLOW_ERROR;
+static void
+gst_compositor_input_init (CompositorInput * input, GstVideoAggregatorPad * pad,
+    GstVideoInfo * out_info)
+{
+  GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
+  const GstVideoFormatInfo *finfo = out_info->finfo;
+  gint out_width = GST_VIDEO_INFO_WIDTH (out_info);
+  gint out_height = GST_VIDEO_INFO_HEIGHT (out_info);
+  gint x1, y1;
+
+  input->pad = pad;
+  input->frame = pad->aggregated_frame;
+  input->xpos = GST_ROUND_UP_N (cpad->xpos,
+      1 << GST_VIDEO_FORMAT_INFO_W_SUB (finfo, 1));
+  input->ypos = GST_ROUND_UP_N (cpad->ypos,
+      1 << GST_VIDEO_FORMAT_INFO_H_SUB (finfo, 1));
+  input->alpha = cpad->alpha;
+
+  input->rect = clamp_rectangle (input->xpos, input->ypos,
+      GST_VIDEO_FRAME_WIDTH (input->frame),
+      GST_VIDEO_FRAME_HEIGHT (input->frame), out_width, out_height);
+
+  /* opaque inputs are copied over what is below them, except on formats
+   * with alpha for which they are still blended */
+  memset (&input->covered, 0, sizeof (input->covered));
+  if (cpad->alpha != 1.0 || GST_VIDEO_INFO_HAS_ALPHA (&pad->info) ||
+      GST_VIDEO_INFO_HAS_ALPHA (out_info))
+    return;
+
+  x1 = input->rect.x + input->rect.w;
+  if (x1 < out_width)
+    x1 = GST_ROUND_DOWN_N (x1, REGION_ALIGN_X);
+  y1 = input->rect.y + input->rect.h;
+  if (y1 < out_height)
+    y1 = GST_ROUND_DOWN_N (y1, REGION_ALIGN_Y);
+
+  input->covered.x = GST_ROUND_UP_N (input->rect.x, REGION_ALIGN_X);
+  input->covered.y = GST_ROUND_UP_N (input->rect.y, REGION_ALIGN_Y);
+  input->covered.w = MAX (x1 - input->covered.x, 0);
+  input->covered.h = MAX (y1 - input->covered.y, 0);
+}
+
+/* Replaces the rectangles of @rects overlapping @hole by the up to four
+ * rectangles around @hole */
+static void
+gst_compositor_subtract_rectangle (GArray * rects,
+    const GstVideoRectangle * hole)
+{
+  guint i = 0;
+
+  if (hole->w == 0 || hole->h == 0)
+    return;
+
+  while (i < rects->len) {
+    GstVideoRectangle r = g_array_index (rects, GstVideoRectangle, i);
+    GstVideoRectangle piece;
+    gint x0, y0, x1, y1;
+
+    x0 = MAX (r.x, hole->x);
+    y0 = MAX (r.y, hole->y);
+    x1 = MIN (r.x + r.w, hole->x + hole->w);
+    y1 = MIN (r.y + r.h, hole->y + hole->h);
+    if (x0 >= x1 || y0 >= y1) {
+      i++;
+      continue;
+    }
+
+    /* the pieces don't overlap @hole and are checked again for nothing */
+    g_array_remove_index_fast (rects, i);
+
+    if (y0 > r.y) {
+      piece.x = r.x;
+      piece.y = r.y;
+      piece.w = r.w;
+      piece.h = y0 - r.y;
+      g_array_append_val (rects, piece);
+    }
+    if (y1 < r.y + r.h) {
+      piece.x = r.x;
+      piece.y = y1;
+      piece.w = r.w;
+      piece.h = r.y + r.h - y1;
+      g_array_append_val (rects, piece);
+    }
+    if (x0 > r.x) {
+      piece.x = r.x;
+      piece.y = y0;
+      piece.w = x0 - r.x;
+      piece.h = y1 - y0;
+      g_array_append_val (rects, piece);
+    }
+    if (x1 < r.x + r.w) {
+      piece.x = x1;
+      piece.y = y0;
+      piece.w = r.x + r.w - x1;
+      piece.h = y1 - y0;
+      g_array_append_val (rects, piece);
+    }
   }
+}
 
-  outframe = &out_frame;
-  /* default to blending */
-  composite = self->blend;
-  /* TODO: If the frames to be composited completely obscure the background,
-   * don't bother drawing the background at all. */
-  switch (self->background) {
+/* Makes @view a view of the rectangle @rect of @frame, which must start on
+ * whole chroma samples */
+static void
+gst_compositor_frame_view (GstVideoFrame * frame,
+    const GstVideoRectangle * rect, GstVideoFrame * view)
+{
+  const GstVideoFormatInfo *finfo = frame->info.finfo;
+  guint plane, comp;
+
+  *view = *frame;
+  GST_VIDEO_INFO_WIDTH (&view->info) = rect->w;
+  GST_VIDEO_INFO_HEIGHT (&view->info) = rect->h;
+
+  for (comp = GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); comp > 0; comp--) {
+    plane = GST_VIDEO_FORMAT_INFO_PLANE (finfo, comp - 1);
+    /* the components sharing a plane share the same subsampling, the first
+     * one gives the size of the pixels */
+    view->data[plane] = (guint8 *) frame->data[plane] +
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, comp - 1, rect->y) *
+        GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane) +
+        GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (finfo, comp - 1, rect->x) *
+        GST_VIDEO_FORMAT_INFO_PSTRIDE (finfo, comp - 1);
+  }
+}
+
+static void
+gst_compositor_fill_background (GstCompositor * self,
+    GstCompositorBackground background, GstVideoFrame * outframe)
+{
+  switch (background) {
     case COMPOSITOR_BACKGROUND_CHECKER:
       self->fill_checker (outframe);
       break;
@@ -1014,30 +1229,501 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
           pdata += plane_stride;
         }
       }
-
-      /* use overlay to keep background transparent */
-      composite = self->overlay;
       break;
     }
   }
+}
+
+/* Composites the part @region of the output frame, which must be within the
+ * rows of @stripe */
+static void
+gst_compositor_composite_region (CompositorStripe * stripe,
+    const GstVideoRectangle * region)
+{
+  GstVideoFrame view, src_view;
+  GArray *rects;
+  guint i, j, k;
+
+  rects = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+
+  /* the background is only drawn where no opaque input hides it */
+  g_array_append_val (rects, *region);
+  for (i = 0; i < stripe->inputs->len; i++)
+    gst_compositor_subtract_rectangle (rects,
+        &g_array_index (stripe->inputs, CompositorInput, i).covered);
+
+  for (k = 0; k < rects->len; k++) {
+    gst_compositor_frame_view (stripe->outframe,
+        &g_array_index (rects, GstVideoRectangle, k), &view);
+    gst_compositor_fill_background (stripe->self, stripe->background, &view);
+  }
+
+  /* and each input where no opaque input above hides it */
+  for (i = 0; i < stripe->inputs->len; i++) {
+    CompositorInput *input = &g_array_index (stripe->inputs, CompositorInput,
+        i);
+    GstVideoRectangle rect;
+
+    rect.x = MAX (input->rect.x, region->x);
+    rect.y = MAX (input->rect.y, region->y);
+    rect.w = MIN (input->rect.x + input->rect.w,
+        region->x + region->w) - rect.x;
+    rect.h = MIN (input->rect.y + input->rect.h,
+        region->y + region->h) - rect.y;
+    if (rect.w <= 0 || rect.h <= 0)
+      continue;
+
+    g_array_set_size (rects, 0);
+    g_array_append_val (rects, rect);
+    for (j = i + 1; j < stripe->inputs->len && rects->len > 0; j++)
+      gst_compositor_subtract_rectangle (rects,
+          &g_array_index (stripe->inputs, CompositorInput, j).covered);
+
+    for (k = 0; k < rects->len; k++) {
+      GstVideoRectangle r = g_array_index (rects, GstVideoRectangle, k);
+
+      /* only draw the visible part of the input, at its place */
+      rect = r;
+      rect.x -= input->xpos;
+      rect.y -= input->ypos;
+      gst_compositor_frame_view (input->frame, &rect, &src_view);
+      stripe->composite (&src_view, r.x, r.y, input->alpha,
+          stripe->outframe);
+    }
+  }
+
+  g_array_free (rects, TRUE);
+}
+
+static void
+gst_compositor_copy_region (GstVideoFrame * dest, GstVideoFrame * src,
+    const GstVideoRectangle * region)
+{
+  GstVideoFrame dest_view, src_view;
+
+  gst_compositor_frame_view (dest, region, &dest_view);
+  gst_compositor_frame_view (src, region, &src_view);
+  gst_video_frame_copy (&dest_view, &src_view);
+}
+
+static void
+gst_compositor_composite_stripe (CompositorStripe * stripe)
+{
+  GstVideoRectangle stripe_rect, region;
+  guint i;
+
+  stripe_rect.x = 0;
+  stripe_rect.y = stripe->y;
+  stripe_rect.w = GST_VIDEO_FRAME_WIDTH (stripe->outframe);
+  stripe_rect.h = stripe->height;
+
+  if (!stripe->regions) {
+    gst_compositor_composite_region (stripe, &stripe_rect);
+    if (stripe->cache)
+      gst_compositor_copy_region (stripe->cache, stripe->outframe,
+          &stripe_rect);
+    return;
+  }
+
+  /* start from the previous frame and only recompose what changed, keeping
+   * the cached frame up to date */
+  gst_compositor_copy_region (stripe->outframe, stripe->cache, &stripe_rect);
+
+  for (i = 0; i < stripe->regions->len; i++) {
+    region = g_array_index (stripe->regions, GstVideoRectangle, i);
+    region.h = MIN (region.y + region.h, stripe_rect.y + stripe_rect.h);
+    region.y = MAX (region.y, stripe_rect.y);
+    region.h -= region.y;
+    if (region.h <= 0)
+      continue;
+
+    gst_compositor_composite_region (stripe, &region);
+    gst_compositor_copy_region (stripe->cache, stripe->outframe, &region);
+  }
+}
+
+static void
+gst_compositor_input_state_clear (CompositorInputState * state)
+{
+  gst_object_unref (state->pad);
+  gst_buffer_replace (&state->buffer, NULL);
+}
+
+/* Must be called with the object lock */
+static void
+gst_compositor_clear_cache (GstCompositor * self)
+{
+  gst_buffer_replace (&self->cache, NULL);
+  if (self->cache_inputs)
+    g_array_free (self->cache_inputs, TRUE);
+  self->cache_inputs = NULL;
+}
+
+/* Adds @rect, grown to whole aligned regions, to @regions, merging the
+ * regions overlapping it so that no pixel is composited twice */
+static void
+gst_compositor_add_region (GArray * regions, const GstVideoRectangle * rect,
+    GstVideoInfo * info)
+{
+  GstVideoRectangle region;
+  gint x1, y1;
+  guint i = 0;
+
+  if (rect->w <= 0 || rect->h <= 0)
+    return;
+
+  region.x = GST_ROUND_DOWN_N (rect->x, REGION_ALIGN_X);
+  region.y = GST_ROUND_DOWN_N (rect->y, REGION_ALIGN_Y);
+  x1 = MIN (GST_ROUND_UP_N (rect->x + rect->w, REGION_ALIGN_X),
+      GST_VIDEO_INFO_WIDTH (info));
+  y1 = MIN (GST_ROUND_UP_N (rect->y + rect->h, REGION_ALIGN_Y),
+      GST_VIDEO_INFO_HEIGHT (info));
+
+  while (i < regions->len) {
+    GstVideoRectangle r = g_array_index (regions, GstVideoRectangle, i);
+
+    if (r.x >= x1 || r.y >= y1 || r.x + r.w <= region.x ||
+        r.y + r.h <= region.y) {
+      i++;
+      continue;
+    }
+
+    /* the bigger region may now overlap the regions already checked */
+    region.x = MIN (region.x, r.x);
+    region.y = MIN (region.y, r.y);
+    x1 = MAX (x1, r.x + r.w);
+    y1 = MAX (y1, r.y + r.h);
+    g_array_remove_index_fast (regions, i);
+    i = 0;
+  }
+
+  region.w = x1 - region.x;
+  region.h = y1 - region.y;
+  g_array_append_val (regions, region);
+}
+
+static gboolean
+gst_compositor_input_changed (CompositorInput * input,
+    CompositorInputState * state)
+{
+  return state->buffer != input->pad->buffer || state->xpos != input->xpos ||
+      state->ypos != input->ypos || state->alpha != input->alpha ||
+      state->zorder != input->pad->zorder || state->rect.x != input->rect.x ||
+      state->rect.y != input->rect.y || state->rect.w != input->rect.w ||
+      state->rect.h != input->rect.h;
+}
+
+/* Returns the regions of the output frame differing from the cached frame,
+ * or NULL if the whole frame has to be recomposed. Must be called with the
+ * object lock */
+static GArray *
+gst_compositor_find_changed_regions (GstCompositor * self, GstVideoInfo * info,
+    GstCompositorBackground background, GArray * inputs)
+{
+  GArray *regions;
+  gboolean *found;
+  guint i, j;
+  guint64 area = 0;
+
+  if (!self->cache_inputs || background != self->cache_background ||
+      !gst_video_info_is_equal (info, &self->cache_info))
+    return NULL;
+
+  regions = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+  found = g_new0 (gboolean, self->cache_inputs->len);
+
+  /* the inputs are stacked in the order of their zorder, a pad keeping its
+   * zorder stays at the same place relatively to the other inputs */
+  for (i = 0; i < inputs->len; i++) {
+    CompositorInput *input = &g_array_index (inputs, CompositorInput, i);
+    CompositorInputState *state = NULL;
+
+    for (j = 0; j < self->cache_inputs->len; j++) {
+      if (g_array_index (self->cache_inputs, CompositorInputState,
+              j).pad == input->pad) {
+        state = &g_array_index (self->cache_inputs, CompositorInputState, j);
+        found[j] = TRUE;
+        break;
+      }
+    }
+
+    if (!state) {
+      gst_compositor_add_region (regions, &input->rect, info);
+    } else if (gst_compositor_input_changed (input, state)) {
+      gst_compositor_add_region (regions, &state->rect, info);
+      gst_compositor_add_region (regions, &input->rect, info);
+    }
+  }
+
+  /* what the inputs which disappeared were drawn on */
+  for (j = 0; j < self->cache_inputs->len; j++) {
+    if (!found[j])
+      gst_compositor_add_region (regions,
+          &g_array_index (self->cache_inputs, CompositorInputState, j).rect,
+          info);
+  }
+  g_free (found);
+
+  for (i = 0; i < regions->len; i++) {
+    GstVideoRectangle *r = &g_array_index (regions, GstVideoRectangle, i);
+
+    area += (guint64) r->w * r->h;
+  }
+
+  /* copying the cached frame isn't worth it anymore */
+  if (area * 4 >= (guint64) GST_VIDEO_INFO_WIDTH (info) *
+      GST_VIDEO_INFO_HEIGHT (info) * 3) {
+    g_array_free (regions, TRUE);
+    return NULL;
+  }
+
+  return regions;
+}
+
+/* Remembers what the cached frame is composited from. Must be called with
+ * the object lock */
+static void
+gst_compositor_update_cache_inputs (GstCompositor * self, GstVideoInfo * info,
+    GstCompositorBackground background, GArray * inputs)
+{
+  guint i;
+
+  if (self->cache_inputs)
+    g_array_set_size (self->cache_inputs, 0);
+  else {
+    self->cache_inputs = g_array_new (FALSE, FALSE,
+        sizeof (CompositorInputState));
+    g_array_set_clear_func (self->cache_inputs,
+        (GDestroyNotify) gst_compositor_input_state_clear);
+  }
+
+  for (i = 0; i < inputs->len; i++) {
+    CompositorInput *input = &g_array_index (inputs, CompositorInput, i);
+    CompositorInputState state;
+
+    state.pad = gst_object_ref (input->pad);
+    state.buffer = gst_buffer_ref (input->pad->buffer);
+    state.xpos = input->xpos;
+    state.ypos = input->ypos;
+    state.alpha = input->alpha;
+    state.zorder = input->pad->zorder;
+    state.rect = input->rect;
+    g_array_append_val (self->cache_inputs, state);
+  }
+
+  self->cache_info = *info;
+  self->cache_background = background;
+}
+
+static void
+gst_compositor_stripe_func (gpointer data, gpointer user_data)
+{
+  CompositorStripe *stripe = data;
+  GstCompositor *self = user_data;
+
+  gst_compositor_composite_stripe (stripe);
+
+  g_mutex_lock (&self->stripes_lock);
+  if (--self->stripes_pending == 0)
+    g_cond_signal (&self->stripes_cond);
+  g_mutex_unlock (&self->stripes_lock);
+}
+
+/* Makes sure the pool can run @n_threads stripes along with the aggregator
+ * thread. Must be called with the object lock */
+static gboolean
+gst_compositor_ensure_stripe_pool (GstCompositor * self, guint n_threads)
+{
+  GError *err = NULL;
+
+  if (self->stripe_pool) {
+    if (g_thread_pool_get_max_threads (self->stripe_pool) != n_threads - 1)
+      g_thread_pool_set_max_threads (self->stripe_pool, n_threads - 1, NULL);
+    return TRUE;
+  }
+
+  self->stripe_pool = g_thread_pool_new (gst_compositor_stripe_func, self,
+      n_threads - 1, FALSE, &err);
+  if (!self->stripe_pool) {
+    GST_WARNING_OBJECT (self, "Could not create thread pool, compositing "
+        "serially: %s", err->message);
+    g_clear_error (&err);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
+{
+  GList *l;
+  GstCompositor *self = GST_COMPOSITOR (vagg);
+  GstCompositorBackground background = self->background;
+  BlendFunction composite;
+  GstVideoFrame out_frame, *outframe, cache_frame, *cache = NULL;
+  CompositorStripe *stripes;
+  GArray *inputs, *regions = NULL;
+  guint n_threads, n_stripes, i;
+  gint height, stripe_height;
+  guint64 n_pixels, n_recomposed;
+
+  if (!gst_video_frame_map (&out_frame, &vagg->info, outbuf, GST_MAP_WRITE)) {
+    GST_WARNING_OBJECT (vagg, "Could not map output buffer");
+    return GST_FLOW_ERROR;
+  }
+
+  outframe = &out_frame;
+  /* default to blending, use overlay to keep background transparent */
+  if (background == COMPOSITOR_BACKGROUND_TRANSPARENT)
+    composite = self->overlay;
+  else
+    composite = self->blend;
 
   GST_OBJECT_LOCK (vagg);
+  inputs = g_array_new (FALSE, FALSE, sizeof (CompositorInput));
   for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
     GstVideoAggregatorPad *pad = l->data;
-    GstCompositorPad *compo_pad = GST_COMPOSITOR_PAD (pad);
+    CompositorInput input;
 
     if (pad->aggregated_frame != NULL) {
-      composite (pad->aggregated_frame, compo_pad->xpos, compo_pad->ypos,
-          compo_pad->alpha, outframe);
+      gst_compositor_input_init (&input, pad, &vagg->info);
+      g_array_append_val (inputs, input);
+    }
+  }
+
+  n_pixels = (guint64) GST_VIDEO_INFO_WIDTH (&vagg->info) *
+      GST_VIDEO_INFO_HEIGHT (&vagg->info);
+  n_recomposed = n_pixels;
+
+  if (self->partial_updates) {
+    regions = gst_compositor_find_changed_regions (self, &vagg->info,
+        background, inputs);
+
+    if (!self->cache || !gst_video_info_is_equal (&vagg->info,
+            &self->cache_info)) {
+      gst_buffer_replace (&self->cache, NULL);
+      self->cache = gst_buffer_new_allocate (NULL,
+          GST_VIDEO_INFO_SIZE (&vagg->info), NULL);
+    }
+
+    if (gst_video_frame_map (&cache_frame, &vagg->info, self->cache,
+            GST_MAP_READWRITE)) {
+      cache = &cache_frame;
+      gst_compositor_update_cache_inputs (self, &vagg->info, background,
+          inputs);
+    } else {
+      GST_WARNING_OBJECT (self, "Could not map the cached frame");
+      gst_compositor_clear_cache (self);
+    }
+
+    if (!cache && regions) {
+      g_array_free (regions, TRUE);
+      regions = NULL;
+    }
+
+    if (regions) {
+      n_recomposed = 0;
+      for (i = 0; i < regions->len; i++) {
+        GstVideoRectangle *r = &g_array_index (regions, GstVideoRectangle, i);
+
+        n_recomposed += (guint64) r->w * r->h;
+      }
+      GST_LOG_OBJECT (self, "recomposing %u regions of %" G_GUINT64_FORMAT
+          " pixels", regions->len, n_recomposed);
     }
+  } else if (self->cache) {
+    gst_compositor_clear_cache (self);
+  }
+
+  self->frames++;
+  self->total_pixels += n_pixels;
+  self->recomposed_pixels += n_recomposed;
+
+  /* split the frame in at most one stripe per thread */
+  height = GST_VIDEO_FRAME_HEIGHT (outframe);
+  n_threads = self->n_threads ? self->n_threads : g_get_num_processors ();
+  stripe_height = GST_ROUND_UP_N ((height + n_threads - 1) / n_threads,
+      STRIPE_ALIGN);
+  n_stripes = MAX ((height + stripe_height - 1) / stripe_height, 1);
+
+  stripes = g_new (CompositorStripe, n_stripes);
+  for (i = 0; i < n_stripes; i++) {
+    stripes[i].self = self;
+    stripes[i].outframe = outframe;
+    stripes[i].background = background;
+    stripes[i].composite = composite;
+    stripes[i].inputs = inputs;
+    stripes[i].y = i * stripe_height;
+    stripes[i].height = MIN (stripe_height, height - stripes[i].y);
+    stripes[i].cache = cache;
+    stripes[i].regions = regions;
+  }
+
+  if (n_stripes > 1 && gst_compositor_ensure_stripe_pool (self, n_stripes)) {
+    GST_LOG_OBJECT (self, "compositing %u stripes of %d rows", n_stripes,
+        stripe_height);
+
+    self->stripes_pending = n_stripes - 1;
+    for (i = 1; i < n_stripes; i++)
+      g_thread_pool_push (self->stripe_pool, &stripes[i], NULL);
+
+    gst_compositor_composite_stripe (&stripes[0]);
+
+    g_mutex_lock (&self->stripes_lock);
+    while (self->stripes_pending > 0)
+      g_cond_wait (&self->stripes_cond, &self->stripes_lock);
+    g_mutex_unlock (&self->stripes_lock);
+  } else {
+    for (i = 0; i < n_stripes; i++)
+      gst_compositor_composite_stripe (&stripes[i]);
   }
   GST_OBJECT_UNLOCK (vagg);
 
+  if (cache)
+    gst_video_frame_unmap (cache);
+  if (regions)
+    g_array_free (regions, TRUE);
+  g_free (stripes);
+  g_array_free (inputs, TRUE);
+
   gst_video_frame_unmap (outframe);
 
   return GST_FLOW_OK;
 }
 
+static void
+gst_compositor_finalize (GObject * object)
+{
+  GstCompositor *self = GST_COMPOSITOR (object);
+
+  if (self->stripe_pool)
+    g_thread_pool_free (self->stripe_pool, FALSE, TRUE);
+  self->stripe_pool = NULL;
+
+  gst_compositor_clear_cache (self);
+
+  g_mutex_clear (&self->stripes_lock);
+  g_cond_clear (&self->stripes_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static gboolean
+gst_compositor_stop (GstAggregator * agg)
+{
+  GstCompositor *self = GST_COMPOSITOR (agg);
+
+  GST_OBJECT_LOCK (self);
+  gst_compositor_clear_cache (self);
+  self->frames = 0;
+  self->total_pixels = 0;
+  self->recomposed_pixels = 0;
+  GST_OBJECT_UNLOCK (self);
+
+  return GST_AGGREGATOR_CLASS (parent_class)->stop (agg);
+}
+
 static gboolean
 _sink_query (GstAggregator * agg, GstAggregatorPad * bpad, GstQuery * query)
 {
@@ -1092,9 +1778,11 @@ gst_compositor_class_init (GstCompositorClass * klass)
 
   gobject_class->get_property = gst_compositor_get_property;
   gobject_class->set_property = gst_compositor_set_property;
+  gobject_class->finalize = gst_compositor_finalize;
 
   agg_class->sinkpads_type = GST_TYPE_COMPOSITOR_PAD;
   agg_class->sink_query = _sink_query;
+  agg_class->stop = gst_compositor_stop;
   videoaggregator_class->fixate_caps = _fixate_caps;
   videoaggregator_class->aggregate_frames = gst_compositor_aggregate_frames;
 
@@ -1103,6 +1791,58 @@ gst_compositor_class_init (GstCompositorClass * klass)
           GST_TYPE_COMPOSITOR_BACKGROUND,
           DEFAULT_BACKGROUND, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstCompositor:n-threads:
+   *
+   * Number of threads compositing horizontal stripes of the output frames,
+   * 0 for the number of processors. The output doesn't depend on it.
+   *
+   * Since: 1.10
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads compositing stripes of the output frames "
+          "(0 = number of processors)", 0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstCompositor:partial-updates:
+   *
+   * Keep a copy of the previous output frame and only recompose the regions
+   * where an input changed: a new buffer, or a new position, size, alpha or
+   * zorder. This saves the composition of the inputs which don't change
+   * often, at the cost of copying the output frame.
+   *
+   * Since: 1.10
+   */
+  g_object_class_install_property (gobject_class, PROP_PARTIAL_UPDATES,
+      g_param_spec_boolean ("partial-updates", "Partial updates",
+          "Only recompose the regions of the output frames where an input "
+          "changed", DEFAULT_PARTIAL_UPDATES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstCompositor:stats:
+   *
+   * Statistics since the element started, in a #GstStructure named
+   * application/x-compositor-stats with these fields:
+   *
+   * "frames": #guint64, the number of output frames composited
+   *
+   * "total-pixels": #guint64, the number of pixels of these frames
+   *
+   * "recomposed-pixels": #guint64, the number of these pixels recomposed,
+   * the others having been copied from the previous frame
+   *
+   * "recomposed-fraction": #gdouble, the fraction of the pixels recomposed
+   *
+   * Since: 1.10
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Statistics about the composition of the output frames",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &src_factory);
   gst_element_class_add_static_pad_template (gstelement_class, &sink_factory);
 
@@ -1116,6 +1856,10 @@ static void
 gst_compositor_init (GstCompositor * self)
 {
   self->background = DEFAULT_BACKGROUND;
+  self->n_threads = DEFAULT_N_THREADS;
+  self->partial_updates = DEFAULT_PARTIAL_UPDATES;
+  g_mutex_init (&self->stripes_lock);
+  g_cond_init (&self->stripes_cond);
   /* initialize variables */
 }
 
@@ -73,6 +73,25 @@ struct _GstCompositor
   BlendFunction blend, overlay;
   FillCheckerFunction fill_checker;
   FillColorFunction fill_color;
+
+  /* stripes of the output frame composited in parallel */
+  guint n_threads;
+  GThreadPool *stripe_pool;
+  GMutex stripes_lock;
+  GCond stripes_cond;
+  guint stripes_pending;
+
+  /* previous output frame, only recomposed where its inputs changed */
+  gboolean partial_updates;
+  GstBuffer *cache;
+  GstVideoInfo cache_info;
+  GstCompositorBackground cache_background;
+  GArray *cache_inputs;
+
+  /* statistics */
+  guint64 frames;
+  guint64 total_pixels;
+  guint64 recomposed_pixels;
 };
 
 struct _GstCompositorClass
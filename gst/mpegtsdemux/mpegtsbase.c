@@ -242,12 +242,28 @@ mpegts_base_init (MpegTSBase * base)
   mpegts_base_reset (base);
 }
 
+static void
+mpegts_base_free_index (MpegTSBase * base)
+{
+  MpegTSIndex *index;
+
+  GST_OBJECT_LOCK (base);
+  index = base->index;
+  base->index = NULL;
+  GST_OBJECT_UNLOCK (base);
+
+  /* Outside of the lock, this waits for the indexing thread */
+  if (index)
+    mpegts_index_free (index);
+}
+
 static void
 mpegts_base_dispose (GObject * object)
 {
   MpegTSBase *base = GST_MPEGTS_BASE (object);
 
   if (!base->disposed) {
+    mpegts_base_free_index (base);
     g_object_unref (base->packetizer);
     base->disposed = TRUE;
     g_free (base->known_psi);
@@ -1125,15 +1141,55 @@ mpegts_base_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
   return res;
 }
 
+static inline GstFlowReturn
+mpegts_base_handle_packet (MpegTSBase * base, MpegTSBaseClass * klass,
+    MpegTSPacketizerPacket * packet)
+{
+  GstFlowReturn res = GST_FLOW_OK;
+
+  if (klass->inspect_packet)
+    klass->inspect_packet (base, packet);
+
+  /* If it's a known PES, push it */
+  if (MPEGTS_BIT_IS_SET (base->is_pes, packet->pid)) {
+    /* push the packet downstream */
+    if (base->push_data)
+      res = klass->push (base, packet, NULL);
+  } else if (packet->payload
+      && MPEGTS_BIT_IS_SET (base->known_psi, packet->pid)) {
+    /* base PSI data */
+    GList *others, *tmp;
+    GstMpegtsSection *section;
+
+    section =
+        mpegts_packetizer_push_section (base->packetizer, packet, &others);
+    if (section)
+      mpegts_base_handle_psi (base, section);
+    if (G_UNLIKELY (others)) {
+      for (tmp = others; tmp; tmp = tmp->next)
+        mpegts_base_handle_psi (base, (GstMpegtsSection *) tmp->data);
+      g_list_free (others);
+    }
+
+    /* we need to push section packet downstream */
+    if (base->push_section)
+      res = klass->push (base, packet, section);
+
+  } else if (packet->payload && packet->pid != 0x1fff)
+    GST_LOG ("PID 0x%04x Saw packet on a pid we don't handle", packet->pid);
+
+  return res;
+}
+
 static GstFlowReturn
 mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
   GstFlowReturn res = GST_FLOW_OK;
   MpegTSBase *base;
-  MpegTSPacketizerPacketReturn pret;
   MpegTSPacketizer2 *packetizer;
-  MpegTSPacketizerPacket packet;
+  MpegTSPacketizerBatch batch;
   MpegTSBaseClass *klass;
+  guint i;
 
   base = GST_MPEGTS_BASE (parent);
   klass = GST_MPEGTS_BASE_GET_CLASS (base);
@@ -1163,50 +1219,25 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   mpegts_packetizer_push (base->packetizer, buf);
 
   while (res == GST_FLOW_OK) {
-    pret = mpegts_packetizer_next_packet (base->packetizer, &packet);
-
     /* If we don't have enough data, return */
-    if (G_UNLIKELY (pret == PACKET_NEED_MORE))
+    if (G_UNLIKELY (mpegts_packetizer_next_batch (packetizer,
+                &batch) == PACKET_NEED_MORE))
       break;
 
-    if (G_UNLIKELY (pret == PACKET_BAD)) {
-      /* bad header, skip the packet */
-      GST_DEBUG_OBJECT (base, "bad packet, skipping");
-      goto next;
-    }
+    for (i = 0; i < batch.n_packets && res == GST_FLOW_OK; i++) {
+      /* The offset is past the packet being handled, as for single
+       * packets, for the PTS/offset conversions done while handling it */
+      packetizer->offset = batch.packets[i].offset + packetizer->packet_size;
+      res = mpegts_base_handle_packet (base, klass, &batch.packets[i]);
 
-    if (klass->inspect_packet)
-      klass->inspect_packet (base, &packet);
-
-    /* If it's a known PES, push it */
-    if (MPEGTS_BIT_IS_SET (base->is_pes, packet.pid)) {
-      /* push the packet downstream */
-      if (base->push_data)
-        res = klass->push (base, &packet, NULL);
-    } else if (packet.payload
-        && MPEGTS_BIT_IS_SET (base->known_psi, packet.pid)) {
-      /* base PSI data */
-      GList *others, *tmp;
-      GstMpegtsSection *section;
-
-      section = mpegts_packetizer_push_section (packetizer, &packet, &others);
-      if (section)
-        mpegts_base_handle_psi (base, section);
-      if (G_UNLIKELY (others)) {
-        for (tmp = others; tmp; tmp = tmp->next)
-          mpegts_base_handle_psi (base, (GstMpegtsSection *) tmp->data);
-        g_list_free (others);
+      /* The packetizer was flushed, the remaining packets are gone */
+      if (G_UNLIKELY (packetizer->map_data != batch.map_data)) {
+        i++;
+        break;
       }
+    }
 
-      /* we need to push section packet downstream */
-      if (base->push_section)
-        res = klass->push (base, &packet, section);
-
-    } else if (packet.payload && packet.pid != 0x1fff)
-      GST_LOG ("PID 0x%04x Saw packet on a pid we don't handle", packet.pid);
-
-  next:
-    mpegts_packetizer_clear_packet (base->packetizer, &packet);
+    mpegts_packetizer_clear_batch (packetizer, &batch, i);
   }
 
   if (klass->input_done) {
@@ -1489,6 +1520,11 @@ mpegts_base_handle_seek_event (MpegTSBase * base, GstPad * pad,
 
     /* ref for it to be reused later */
     gst_pad_push_event (base->sinkpad, gst_event_ref (flush_event));
+    /* Pulling works again, let the indexing continue */
+    GST_OBJECT_LOCK (base);
+    if (base->index)
+      mpegts_index_resume (base->index);
+    GST_OBJECT_UNLOCK (base);
     /* And actually flush our pending data but allow to preserve some info
      * to perform the seek */
     mpegts_base_flush (base, FALSE);
@@ -1577,8 +1613,10 @@ mpegts_base_sink_activate_mode (GstPad * pad, GstObject * parent,
         res =
             gst_pad_start_task (pad, (GstTaskFunction) mpegts_base_loop, base,
             NULL);
-      } else
+      } else {
         res = gst_pad_stop_task (pad);
+        mpegts_base_free_index (base);
+      }
       break;
     default:
       res = FALSE;
@@ -32,6 +32,7 @@
 
 #include <gst/gst.h>
 #include "mpegtspacketizer.h"
+#include "mpegtsindex.h"
 
 G_BEGIN_DECLS
 
@@ -158,6 +159,11 @@ struct _MpegTSBase {
   /* Whether to push data and/or sections to subclasses */
   gboolean push_data;
   gboolean push_section;
+
+  /* PCR index of the whole file (pull mode only, created by subclasses).
+   * Protected by the object lock, it is only freed once the streaming
+   * task is stopped */
+  MpegTSIndex *index;
 };
 
 struct _MpegTSBaseClass {
@@ -0,0 +1,871 @@
+/*
+ * mpegtsindex.c : PCR/offset index of MPEG transport stream files
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gst/base/gstbytereader.h>
+#include <gst/base/gstbytewriter.h>
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth265parser.h>
+#include <gst/codecparsers/gstmpegvideoparser.h>
+
+#include "mpegtsindex.h"
+#include "mpegtspacketizer.h"
+#include "gstmpegdefs.h"
+
+GST_DEBUG_CATEGORY_STATIC (mpegts_index_debug);
+#define GST_CAT_DEFAULT mpegts_index_debug
+
+/* Minimum interval between two index entries (units: 1/27MHz) */
+#define INDEX_INTERVAL (100 * PCR_MSECOND)
+
+/* PCR jumps bigger than this are considered as discontinuities */
+#define PCR_DISCONT_THRESHOLD (PCR_SECOND)
+
+/* maximal PCR value (33 bits base * 300 + 9 bits extension) */
+#define PCR_WRAP (((guint64) 1 << 33) * 300)
+
+/* Amount of PES payload looked at to detect keyframes */
+#define KEYFRAME_SCAN_SIZE 1024
+
+/* Maximum distance between a PTS and the current PCR for the PTS to be
+ * considered valid (units: 1/27MHz) */
+#define PTS_MAX_DISTANCE (10 * PCR_SECOND)
+
+/* Number of packets pulled at once by the indexing thread */
+#define INDEX_CHUNK_PACKETS 4096
+
+#define CACHE_MAGIC GST_MAKE_FOURCC ('T', 'S', 'I', 'X')
+#define CACHE_VERSION 3
+#define CACHE_HEADER_SIZE 40
+
+struct _MpegTSIndex
+{
+  GstPad *sinkpad;
+
+  guint16 pcr_pid;
+  guint16 packet_size;
+  guint64 start_offset;
+
+  /* Sidecar file (NULL if not cached) and key of the indexed file */
+  gchar *cache_file;
+  guint64 file_size;
+  guint64 file_mtime;
+
+  GThread *thread;
+  volatile gint stopping;
+  volatile gint complete;
+
+  /* The indexing thread waits on @cond while the pad is flushing, until
+   * mpegts_index_resume() increments @resume_cookie */
+  GMutex lock;
+  GCond cond;
+  guint resume_cookie;
+
+  /* Only accessed by the indexing thread until complete is set */
+  GArray *entries;
+  guint64 first_pcr, prev_pcr, pcr;
+  gboolean have_pcr;
+  MpegTSIndexEntry last;
+
+  /* Video stream in which keyframes are looked for (0 if none) */
+  guint16 video_pid;
+  guint8 video_stream_type;
+  GstH264NalParser *h264parser;
+  GstH265Parser *h265parser;
+
+  /* Keyframe positions, with the time of their PTS */
+  GArray *keyframes;
+
+  /* Start of the PES packet being scanned */
+  gboolean scanning;
+  MpegTSIndexEntry pes_start;
+  guint8 scan_data[KEYFRAME_SCAN_SIZE];
+  guint scan_size;
+};
+
+static inline guint64
+mpegts_index_compute_pcr (const guint8 * data)
+{
+  guint32 pcr1;
+  guint16 pcr2;
+  guint64 pcr, pcr_ext;
+
+  pcr1 = GST_READ_UINT32_BE (data);
+  pcr2 = GST_READ_UINT16_BE (data + 4);
+  pcr = ((guint64) pcr1) << 1;
+  pcr |= (pcr2 & 0x8000) >> 15;
+  pcr_ext = (pcr2 & 0x01ff);
+  return pcr * 300 + pcr_ext % 300;
+}
+
+static void
+mpegts_index_add_pcr (MpegTSIndex * index, guint64 offset, guint64 pcr)
+{
+  MpegTSIndexEntry *entry;
+  guint64 delta;
+
+  if (G_UNLIKELY (!index->have_pcr)) {
+    index->have_pcr = TRUE;
+    index->first_pcr = index->prev_pcr = pcr;
+    index->pcr = 0;
+  }
+
+  if (pcr >= index->prev_pcr)
+    delta = pcr - index->prev_pcr;
+  else
+    delta = pcr + PCR_WRAP - index->prev_pcr;
+
+  /* Keep the timeline continuous over PCR resets */
+  if (G_UNLIKELY (delta > PCR_DISCONT_THRESHOLD)) {
+    GST_DEBUG ("PCR discontinuity at offset %" G_GUINT64_FORMAT, offset);
+    delta = 0;
+  }
+
+  index->prev_pcr = pcr;
+  index->pcr += delta;
+
+  index->last.offset = offset;
+  index->last.pcr = index->pcr;
+
+  if (index->entries->len) {
+    entry = &g_array_index (index->entries, MpegTSIndexEntry,
+        index->entries->len - 1);
+    if (index->pcr < entry->pcr + INDEX_INTERVAL)
+      return;
+  }
+
+  g_array_append_val (index->entries, index->last);
+}
+
+static gboolean
+mpegts_index_is_keyframe_h264 (MpegTSIndex * index, const guint8 * data,
+    gsize size)
+{
+  GstH264NalUnit nalu;
+  GstH264ParserResult res;
+  guint offset = 0;
+
+  do {
+    res = gst_h264_parser_identify_nalu (index->h264parser, data, offset,
+        size, &nalu);
+    if (res != GST_H264_PARSER_OK && res != GST_H264_PARSER_NO_NAL_END)
+      break;
+
+    /* Only IDR pictures are random access points. The SPS and PPS
+     * broadcasters repeat before them are skipped like any other NAL, as
+     * they are repeated before other pictures too */
+    if (nalu.type == GST_H264_NAL_SLICE_IDR)
+      return TRUE;
+    /* Any other slice means the frame is not a keyframe */
+    if (nalu.type >= GST_H264_NAL_SLICE && nalu.type <= GST_H264_NAL_SLICE_DPC)
+      return FALSE;
+
+    offset = nalu.offset + nalu.size;
+  } while (res == GST_H264_PARSER_OK);
+
+  return FALSE;
+}
+
+static gboolean
+mpegts_index_is_keyframe_h265 (MpegTSIndex * index, const guint8 * data,
+    gsize size)
+{
+  GstH265NalUnit nalu;
+  GstH265ParserResult res;
+  guint offset = 0;
+
+  do {
+    res = gst_h265_parser_identify_nalu (index->h265parser, data, offset,
+        size, &nalu);
+    if (res != GST_H265_PARSER_OK && res != GST_H265_PARSER_NO_NAL_END)
+      break;
+
+    /* Only IRAP pictures, the parameter sets before them are skipped */
+    if (nalu.type >= GST_H265_NAL_SLICE_BLA_W_LP &&
+        nalu.type <= RESERVED_IRAP_NAL_TYPE_MAX)
+      return TRUE;
+    if (nalu.type < GST_H265_NAL_SLICE_BLA_W_LP)
+      return FALSE;
+
+    offset = nalu.offset + nalu.size;
+  } while (res == GST_H265_PARSER_OK);
+
+  return FALSE;
+}
+
+static gboolean
+mpegts_index_is_keyframe_mpeg_video (const guint8 * data, gsize size)
+{
+  GstMpegVideoPacket packet;
+  guint offset = 0;
+
+  while (gst_mpeg_video_parse (&packet, data, size, offset)) {
+    switch (packet.type) {
+      case GST_MPEG_VIDEO_PACKET_SEQUENCE:
+      case GST_MPEG_VIDEO_PACKET_GOP:
+        return TRUE;
+      case GST_MPEG_VIDEO_PACKET_PICTURE:
+        /* picture_coding_type follows the 10 bits temporal reference */
+        if (packet.offset + 2 > size)
+          return FALSE;
+        return ((data[packet.offset + 1] >> 3) & 0x7) ==
+            GST_MPEG_VIDEO_PICTURE_TYPE_I;
+      default:
+        break;
+    }
+    if (packet.size < 0)
+      break;
+    offset = packet.offset + packet.size;
+  }
+
+  return FALSE;
+}
+
+static void
+mpegts_index_add_keyframe (MpegTSIndex * index)
+{
+  MpegTSIndexEntry *entry;
+
+  /* Only keep one keyframe per PES start */
+  if (index->keyframes->len) {
+    entry = &g_array_index (index->keyframes, MpegTSIndexEntry,
+        index->keyframes->len - 1);
+    if (entry->offset == index->pes_start.offset)
+      return;
+  }
+
+  GST_LOG ("Keyframe at offset %" G_GUINT64_FORMAT " time %" GST_TIME_FORMAT,
+      index->pes_start.offset,
+      GST_TIME_ARGS (PCRTIME_TO_GSTTIME (index->pes_start.pcr)));
+  g_array_append_val (index->keyframes, index->pes_start);
+}
+
+/* Looks for a keyframe in the beginning of the current PES payload */
+static void
+mpegts_index_finish_scan (MpegTSIndex * index)
+{
+  gboolean keyframe = FALSE;
+
+  index->scanning = FALSE;
+
+  switch (index->video_stream_type) {
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_H264:
+      keyframe = mpegts_index_is_keyframe_h264 (index, index->scan_data,
+          index->scan_size);
+      break;
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_HEVC:
+      keyframe = mpegts_index_is_keyframe_h265 (index, index->scan_data,
+          index->scan_size);
+      break;
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG1:
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG2:
+      keyframe = mpegts_index_is_keyframe_mpeg_video (index->scan_data,
+          index->scan_size);
+      break;
+    default:
+      break;
+  }
+
+  if (keyframe)
+    mpegts_index_add_keyframe (index);
+}
+
+static void
+mpegts_index_append_scan_data (MpegTSIndex * index, const guint8 * data,
+    const guint8 * end)
+{
+  guint size;
+
+  if (data >= end)
+    return;
+
+  size = MIN (end - data, KEYFRAME_SCAN_SIZE - index->scan_size);
+  memcpy (index->scan_data + index->scan_size, data, size);
+  index->scan_size += size;
+
+  if (index->scan_size == KEYFRAME_SCAN_SIZE)
+    mpegts_index_finish_scan (index);
+}
+
+/* Converts a 33 bits PTS to a time on the index timeline, using the
+ * last PCR as reference */
+static guint64
+mpegts_index_pts_to_time (MpegTSIndex * index, guint64 pts)
+{
+  guint64 diff;
+
+  pts *= 300;
+
+  diff = (pts + PCR_WRAP - index->prev_pcr) % PCR_WRAP;
+  if (diff < PTS_MAX_DISTANCE)
+    return index->pcr + diff;
+
+  diff = (index->prev_pcr + PCR_WRAP - pts) % PCR_WRAP;
+  if (diff < PTS_MAX_DISTANCE)
+    return index->pcr - MIN (diff, index->pcr);
+
+  return index->pcr;
+}
+
+/* Handles a packet of the video stream. @payload points after the
+ * adaptation field */
+static void
+mpegts_index_handle_video (MpegTSIndex * index, guint64 offset,
+    const guint8 * packet, const guint8 * payload, const guint8 * end)
+{
+  const guint8 *data;
+  guint64 pts;
+
+  if (!(packet[1] & 0x40)) {
+    if (index->scanning)
+      mpegts_index_append_scan_data (index, payload, end);
+    return;
+  }
+
+  /* New PES packet */
+  if (index->scanning)
+    mpegts_index_finish_scan (index);
+
+  if (!index->have_pcr)
+    return;
+
+  index->pes_start.offset = offset;
+  index->pes_start.pcr = index->pcr;
+  index->scan_size = 0;
+
+  /* PES header with PTS */
+  if (end - payload >= 14 && GST_READ_UINT24_BE (payload) == 0x000001 &&
+      (payload[7] & 0x80)) {
+    data = payload + 9;
+    pts = ((guint64) (data[0] & 0x0e)) << 29;
+    pts |= GST_READ_UINT16_BE (data + 1) >> 1 << 15;
+    pts |= GST_READ_UINT16_BE (data + 3) >> 1;
+    index->pes_start.pcr = mpegts_index_pts_to_time (index, pts);
+  }
+
+  /* random_access_indicator */
+  if ((packet[3] & 0x20) && packet[4] > 0 &&
+      (packet[5] & MPEGTS_AFC_RANDOM_ACCES_FLAGS)) {
+    mpegts_index_add_keyframe (index);
+    return;
+  }
+
+  if (end - payload < 9 || GST_READ_UINT24_BE (payload) != 0x000001)
+    return;
+
+  index->scanning = TRUE;
+  mpegts_index_append_scan_data (index, payload + 9 + payload[8], end);
+}
+
+/* Scans @size bytes of packets located at @offset. Returns the number of
+ * bytes consumed (only complete packets are consumed) */
+static gsize
+mpegts_index_scan (MpegTSIndex * index, guint64 offset, const guint8 * data,
+    gsize size)
+{
+  const guint8 *packet;
+  gsize sync_offset, i = 0;
+  guint16 pid;
+
+  /* M2TS packets don't start with the sync byte, all other variants do */
+  sync_offset = index->packet_size == MPEGTS_M2TS_PACKETSIZE ? 4 : 0;
+
+  while (i + index->packet_size <= size) {
+    packet = data + i + sync_offset;
+
+    if (G_UNLIKELY (packet[0] != PACKET_SYNC_BYTE)) {
+      const guint8 *next;
+
+      /* Go to the next sync byte. Move forward relatively to the current
+       * packet, @next can be less than @sync_offset bytes from @data */
+      next = memchr (packet + 1, PACKET_SYNC_BYTE,
+          size - (i + sync_offset + 1));
+      if (!next)
+        return size;
+      i += next - packet;
+      continue;
+    }
+
+    pid = GST_READ_UINT16_BE (packet + 1) & 0x1FFF;
+
+    /* Adaptation field with the PCR flag set */
+    if (pid == index->pcr_pid && (packet[3] & 0x20) && packet[4] >= 7 &&
+        (packet[5] & MPEGTS_AFC_PCR_FLAG))
+      mpegts_index_add_pcr (index, offset + i,
+          mpegts_index_compute_pcr (packet + 6));
+
+    if (pid == index->video_pid && (packet[3] & 0x10)) {
+      const guint8 *payload = packet + 4;
+
+      if (packet[3] & 0x20)
+        payload += packet[4] + 1;
+      mpegts_index_handle_video (index, offset + i, packet, payload,
+          packet + MPEGTS_NORMAL_PACKETSIZE);
+    }
+
+    i += index->packet_size;
+  }
+
+  return i;
+}
+
+static gboolean
+mpegts_index_load (MpegTSIndex * index)
+{
+  GstByteReader br;
+  gchar *contents = NULL;
+  gsize length;
+  guint32 magic, version, n_entries, n_keyframes, i;
+  guint64 file_size, file_mtime, start_offset;
+  guint16 pcr_pid, packet_size;
+  gboolean res = FALSE;
+
+  if (!g_file_get_contents (index->cache_file, &contents, &length, NULL))
+    return FALSE;
+
+  gst_byte_reader_init (&br, (guint8 *) contents, length);
+
+  if (!gst_byte_reader_get_uint32_be (&br, &magic) || magic != CACHE_MAGIC ||
+      !gst_byte_reader_get_uint32_be (&br, &version) ||
+      version != CACHE_VERSION ||
+      !gst_byte_reader_get_uint64_be (&br, &file_size) ||
+      !gst_byte_reader_get_uint64_be (&br, &file_mtime) ||
+      !gst_byte_reader_get_uint64_be (&br, &start_offset) ||
+      !gst_byte_reader_get_uint16_be (&br, &pcr_pid) ||
+      !gst_byte_reader_get_uint16_be (&br, &packet_size) ||
+      !gst_byte_reader_get_uint32_be (&br, &n_entries))
+    goto done;
+
+  if (file_size != index->file_size || file_mtime != index->file_mtime ||
+      start_offset != index->start_offset || pcr_pid != index->pcr_pid ||
+      packet_size != index->packet_size) {
+    GST_DEBUG ("Outdated index %s", index->cache_file);
+    goto done;
+  }
+
+  if (n_entries == 0 ||
+      gst_byte_reader_get_remaining (&br) < (n_entries + 1) * 16 + 4)
+    goto done;
+
+  g_array_set_size (index->entries, n_entries);
+  for (i = 0; i < n_entries; i++) {
+    MpegTSIndexEntry *entry =
+        &g_array_index (index->entries, MpegTSIndexEntry, i);
+    entry->offset = gst_byte_reader_get_uint64_be_unchecked (&br);
+    entry->pcr = gst_byte_reader_get_uint64_be_unchecked (&br);
+  }
+  index->last.offset = gst_byte_reader_get_uint64_be_unchecked (&br);
+  index->last.pcr = gst_byte_reader_get_uint64_be_unchecked (&br);
+
+  n_keyframes = gst_byte_reader_get_uint32_be_unchecked (&br);
+  if (gst_byte_reader_get_remaining (&br) != n_keyframes * 16)
+    goto done;
+
+  g_array_set_size (index->keyframes, n_keyframes);
+  for (i = 0; i < n_keyframes; i++) {
+    MpegTSIndexEntry *entry =
+        &g_array_index (index->keyframes, MpegTSIndexEntry, i);
+    entry->offset = gst_byte_reader_get_uint64_be_unchecked (&br);
+    entry->pcr = gst_byte_reader_get_uint64_be_unchecked (&br);
+  }
+
+  GST_INFO ("Loaded %u entries and %u keyframes from %s", n_entries,
+      n_keyframes, index->cache_file);
+  res = TRUE;
+
+done:
+  if (!res) {
+    g_array_set_size (index->entries, 0);
+    g_array_set_size (index->keyframes, 0);
+  }
+  g_free (contents);
+
+  return res;
+}
+
+static void
+mpegts_index_save (MpegTSIndex * index)
+{
+  GstByteWriter bw;
+  GError *err = NULL;
+  guint8 *data;
+  gchar *dir;
+  guint i, size;
+
+  size = CACHE_HEADER_SIZE + (index->entries->len + 1) * 16 + 4 +
+      index->keyframes->len * 16;
+  gst_byte_writer_init_with_size (&bw, size, TRUE);
+
+  gst_byte_writer_put_uint32_be (&bw, CACHE_MAGIC);
+  gst_byte_writer_put_uint32_be (&bw, CACHE_VERSION);
+  gst_byte_writer_put_uint64_be (&bw, index->file_size);
+  gst_byte_writer_put_uint64_be (&bw, index->file_mtime);
+  gst_byte_writer_put_uint64_be (&bw, index->start_offset);
+  gst_byte_writer_put_uint16_be (&bw, index->pcr_pid);
+  gst_byte_writer_put_uint16_be (&bw, index->packet_size);
+  gst_byte_writer_put_uint32_be (&bw, index->entries->len);
+  for (i = 0; i < index->entries->len; i++) {
+    MpegTSIndexEntry *entry =
+        &g_array_index (index->entries, MpegTSIndexEntry, i);
+    gst_byte_writer_put_uint64_be (&bw, entry->offset);
+    gst_byte_writer_put_uint64_be (&bw, entry->pcr);
+  }
+  gst_byte_writer_put_uint64_be (&bw, index->last.offset);
+  gst_byte_writer_put_uint64_be (&bw, index->last.pcr);
+  gst_byte_writer_put_uint32_be (&bw, index->keyframes->len);
+  for (i = 0; i < index->keyframes->len; i++) {
+    MpegTSIndexEntry *entry =
+        &g_array_index (index->keyframes, MpegTSIndexEntry, i);
+    gst_byte_writer_put_uint64_be (&bw, entry->offset);
+    gst_byte_writer_put_uint64_be (&bw, entry->pcr);
+  }
+
+  dir = g_path_get_dirname (index->cache_file);
+  g_mkdir_with_parents (dir, 0755);
+  g_free (dir);
+
+  size = gst_byte_writer_get_size (&bw);
+  data = gst_byte_writer_reset_and_get_data (&bw);
+
+  if (!g_file_set_contents (index->cache_file, (const gchar *) data, size,
+          &err)) {
+    GST_WARNING ("Failed to save index: %s", err->message);
+    g_clear_error (&err);
+  } else {
+    GST_INFO ("Saved %u entries and %u keyframes to %s", index->entries->len,
+        index->keyframes->len, index->cache_file);
+  }
+
+  g_free (data);
+}
+
+static gpointer
+mpegts_index_thread (MpegTSIndex * index)
+{
+  GstFlowReturn ret;
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint64 offset = index->start_offset;
+  gsize consumed;
+  guint cookie;
+
+  GST_DEBUG ("Indexing PCR PID 0x%04x from offset %" G_GUINT64_FORMAT,
+      index->pcr_pid, offset);
+
+  while (!g_atomic_int_get (&index->stopping)) {
+    g_mutex_lock (&index->lock);
+    cookie = index->resume_cookie;
+    g_mutex_unlock (&index->lock);
+
+    buf = NULL;
+    ret = gst_pad_pull_range (index->sinkpad, offset,
+        INDEX_CHUNK_PACKETS * index->packet_size, &buf);
+
+    /* The streaming thread is seeking, wait until it is done */
+    if (ret == GST_FLOW_FLUSHING) {
+      GST_DEBUG ("Flushing, pausing indexing at offset %" G_GUINT64_FORMAT,
+          offset);
+      g_mutex_lock (&index->lock);
+      while (!g_atomic_int_get (&index->stopping)
+          && cookie == index->resume_cookie)
+        g_cond_wait (&index->cond, &index->lock);
+      g_mutex_unlock (&index->lock);
+      continue;
+    }
+    if (ret == GST_FLOW_EOS)
+      break;
+    if (ret != GST_FLOW_OK) {
+      GST_WARNING ("Indexing stopped: %s", gst_flow_get_name (ret));
+      return NULL;
+    }
+
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    consumed = mpegts_index_scan (index, offset, map.data, map.size);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+
+    if (consumed == 0)
+      break;
+    offset += consumed;
+  }
+
+  if (g_atomic_int_get (&index->stopping) || index->entries->len == 0)
+    return NULL;
+
+  if (index->scanning)
+    mpegts_index_finish_scan (index);
+
+  GST_INFO ("Indexing done, %u entries, %u keyframes, duration %"
+      GST_TIME_FORMAT, index->entries->len, index->keyframes->len,
+      GST_TIME_ARGS (PCRTIME_TO_GSTTIME (index->last.pcr)));
+
+  if (index->cache_file)
+    mpegts_index_save (index);
+
+  g_atomic_int_set (&index->complete, TRUE);
+
+  return NULL;
+}
+
+/* Figures out the sidecar file used for the file upstream of @index, if
+ * it is a local file */
+static void
+mpegts_index_setup_cache (MpegTSIndex * index, const gchar * cache_dir)
+{
+  GStatBuf st;
+  GstQuery *query;
+  gchar *uri = NULL, *filename = NULL, *name;
+
+  query = gst_query_new_uri ();
+  if (gst_pad_peer_query (index->sinkpad, query))
+    gst_query_parse_uri (query, &uri);
+  gst_query_unref (query);
+
+  if (uri)
+    filename = g_filename_from_uri (uri, NULL, NULL);
+  g_free (uri);
+
+  if (filename && g_stat (filename, &st) == 0) {
+    index->file_size = st.st_size;
+    index->file_mtime = st.st_mtime;
+
+    name = g_compute_checksum_for_string (G_CHECKSUM_SHA1, filename, -1);
+    index->cache_file = g_strconcat (cache_dir, G_DIR_SEPARATOR_S, name,
+        ".tsidx", NULL);
+    g_free (name);
+  } else {
+    GST_DEBUG ("Upstream is not a local file, not caching index");
+  }
+
+  g_free (filename);
+}
+
+MpegTSIndex *
+mpegts_index_new (GstPad * sinkpad, guint16 pcr_pid, guint16 packet_size,
+    guint64 start_offset, const gchar * cache_dir)
+{
+  MpegTSIndex *index;
+
+  index = g_slice_new0 (MpegTSIndex);
+  index->sinkpad = gst_object_ref (sinkpad);
+  index->pcr_pid = pcr_pid;
+  index->packet_size = packet_size;
+  index->start_offset = start_offset;
+  index->entries = g_array_new (FALSE, FALSE, sizeof (MpegTSIndexEntry));
+  index->keyframes = g_array_new (FALSE, FALSE, sizeof (MpegTSIndexEntry));
+  g_mutex_init (&index->lock);
+  g_cond_init (&index->cond);
+
+  if (cache_dir)
+    mpegts_index_setup_cache (index, cache_dir);
+
+  return index;
+}
+
+/* Also record the keyframes of the video stream @pid. Must be called
+ * before mpegts_index_start() */
+void
+mpegts_index_set_video_stream (MpegTSIndex * index, guint16 pid,
+    guint8 stream_type)
+{
+  g_return_if_fail (index->thread == NULL);
+
+  switch (stream_type) {
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_H264:
+      if (!index->h264parser)
+        index->h264parser = gst_h264_nal_parser_new ();
+      break;
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_HEVC:
+      if (!index->h265parser)
+        index->h265parser = gst_h265_parser_new ();
+      break;
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG1:
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG2:
+      break;
+    default:
+      GST_DEBUG ("Can't detect keyframes of stream type 0x%02x", stream_type);
+      return;
+  }
+
+  index->video_pid = pid;
+  index->video_stream_type = stream_type;
+}
+
+/* Loads the index from its sidecar file, or starts building it */
+void
+mpegts_index_start (MpegTSIndex * index)
+{
+  g_return_if_fail (index->thread == NULL);
+
+  if (index->cache_file && mpegts_index_load (index)) {
+    g_atomic_int_set (&index->complete, TRUE);
+    return;
+  }
+
+  index->thread = g_thread_new ("tsdemux-index",
+      (GThreadFunc) mpegts_index_thread, index);
+}
+
+/* Wakes up the indexing thread if it was paused because the pad was
+ * flushing. Must be called once the pad stopped flushing */
+void
+mpegts_index_resume (MpegTSIndex * index)
+{
+  g_mutex_lock (&index->lock);
+  index->resume_cookie++;
+  g_cond_signal (&index->cond);
+  g_mutex_unlock (&index->lock);
+}
+
+void
+mpegts_index_free (MpegTSIndex * index)
+{
+  if (index->thread) {
+    g_mutex_lock (&index->lock);
+    g_atomic_int_set (&index->stopping, TRUE);
+    g_cond_signal (&index->cond);
+    g_mutex_unlock (&index->lock);
+    g_thread_join (index->thread);
+  }
+
+  if (index->h264parser)
+    gst_h264_nal_parser_free (index->h264parser);
+  if (index->h265parser)
+    gst_h265_parser_free (index->h265parser);
+
+  g_array_free (index->entries, TRUE);
+  g_array_free (index->keyframes, TRUE);
+  g_free (index->cache_file);
+  gst_object_unref (index->sinkpad);
+  g_mutex_clear (&index->lock);
+  g_cond_clear (&index->cond);
+  g_slice_free (MpegTSIndex, index);
+}
+
+gboolean
+mpegts_index_is_complete (MpegTSIndex * index)
+{
+  return g_atomic_int_get (&index->complete);
+}
+
+guint16
+mpegts_index_get_pcr_pid (MpegTSIndex * index)
+{
+  return index->pcr_pid;
+}
+
+/* Returns the offset corresponding to @ts (time since the first PCR), or -1
+ * if the index is not complete yet */
+guint64
+mpegts_index_ts_to_offset (MpegTSIndex * index, GstClockTime ts)
+{
+  MpegTSIndexEntry *entries, *prev, *next;
+  guint64 querypcr;
+  guint low, high, mid;
+
+  if (!mpegts_index_is_complete (index))
+    return -1;
+
+  querypcr = GSTTIME_TO_PCRTIME (ts);
+  entries = (MpegTSIndexEntry *) index->entries->data;
+
+  /* Find the last entry before querypcr */
+  low = 0;
+  high = index->entries->len;
+  while (high - low > 1) {
+    mid = low + (high - low) / 2;
+    if (entries[mid].pcr <= querypcr)
+      low = mid;
+    else
+      high = mid;
+  }
+
+  prev = &entries[low];
+  if (low + 1 < index->entries->len)
+    next = &entries[low + 1];
+  else
+    next = &index->last;
+
+  if (querypcr <= prev->pcr || next->pcr <= prev->pcr)
+    return prev->offset;
+  if (querypcr >= next->pcr)
+    return next->offset;
+
+  /* Interpolate between the two neighbouring entries */
+  return prev->offset + gst_util_uint64_scale (querypcr - prev->pcr,
+      next->offset - prev->offset, next->pcr - prev->pcr);
+}
+
+/* Returns the offset of the last keyframe whose PTS is before @ts (time
+ * since the first PCR) and stores its time in @keyframe_ts, or returns -1
+ * if no keyframe is known */
+guint64
+mpegts_index_find_keyframe (MpegTSIndex * index, GstClockTime ts,
+    GstClockTime * keyframe_ts)
+{
+  MpegTSIndexEntry *keyframes;
+  guint64 querypcr;
+  guint low, high, mid;
+
+  if (!mpegts_index_is_complete (index) || index->keyframes->len == 0)
+    return -1;
+
+  querypcr = GSTTIME_TO_PCRTIME (ts);
+  keyframes = (MpegTSIndexEntry *) index->keyframes->data;
+
+  /* Keyframes are sorted by offset, which gives an increasing time except
+   * around discontinuities */
+  low = 0;
+  high = index->keyframes->len;
+  while (high - low > 1) {
+    mid = low + (high - low) / 2;
+    if (keyframes[mid].pcr <= querypcr)
+      low = mid;
+    else
+      high = mid;
+  }
+
+  if (keyframe_ts)
+    *keyframe_ts = PCRTIME_TO_GSTTIME (keyframes[low].pcr);
+
+  return keyframes[low].offset;
+}
+
+GstClockTime
+mpegts_index_get_duration (MpegTSIndex * index)
+{
+  if (!mpegts_index_is_complete (index))
+    return GST_CLOCK_TIME_NONE;
+
+  return PCRTIME_TO_GSTTIME (index->last.pcr);
+}
+
+void
+init_mpegts_index (void)
+{
+  GST_DEBUG_CATEGORY_INIT (mpegts_index_debug, "mpegtsindex", 0,
+      "MPEG transport stream index");
+}
@@ -0,0 +1,74 @@
+/*
+ * mpegtsindex.h : PCR/offset index of MPEG transport stream files
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __MPEGTS_INDEX_H__
+#define __MPEGTS_INDEX_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* MpegTSIndexEntry: Position of a PCR in the file */
+typedef struct
+{
+  /* Offset of the packet carrying the PCR (units: bytes) */
+  guint64 offset;
+  /* Time since the first PCR of the file, taking into account
+   * wraparounds and discontinuities (units: 1/27MHz) */
+  guint64 pcr;
+} MpegTSIndexEntry;
+
+/* MpegTSIndex: Index of the PCR positions of a whole file.
+ *
+ * It is built in a separate thread by pulling the file from
+ * @start_offset to the end once. The position of the keyframes of one
+ * video stream (H.264, H.265 or MPEG-1/2) can also be recorded, based on
+ * the random_access_indicator and on the first bytes of each PES packet.
+ *
+ * The index can be cached in a sidecar file keyed by the size and
+ * modification time of the indexed file.
+ *
+ * The index can only be used once complete (see mpegts_index_is_complete).
+ *
+ * The indexing thread pauses while the pad is flushing, the owner has to
+ * call mpegts_index_resume() once the flush is over.
+ */
+typedef struct _MpegTSIndex MpegTSIndex;
+
+G_GNUC_INTERNAL MpegTSIndex *mpegts_index_new (GstPad * sinkpad,
+    guint16 pcr_pid, guint16 packet_size, guint64 start_offset,
+    const gchar * cache_dir);
+G_GNUC_INTERNAL void mpegts_index_set_video_stream (MpegTSIndex * index,
+    guint16 pid, guint8 stream_type);
+G_GNUC_INTERNAL void mpegts_index_start (MpegTSIndex * index);
+G_GNUC_INTERNAL void mpegts_index_resume (MpegTSIndex * index);
+G_GNUC_INTERNAL void mpegts_index_free (MpegTSIndex * index);
+
+G_GNUC_INTERNAL gboolean mpegts_index_is_complete (MpegTSIndex * index);
+G_GNUC_INTERNAL guint16 mpegts_index_get_pcr_pid (MpegTSIndex * index);
+G_GNUC_INTERNAL guint64 mpegts_index_ts_to_offset (MpegTSIndex * index,
+    GstClockTime ts);
+G_GNUC_INTERNAL guint64 mpegts_index_find_keyframe (MpegTSIndex * index,
+    GstClockTime ts, GstClockTime * keyframe_ts);
+G_GNUC_INTERNAL GstClockTime mpegts_index_get_duration (MpegTSIndex * index);
+
+G_GNUC_INTERNAL void init_mpegts_index (void);
+
+G_END_DECLS
+#endif /* __MPEGTS_INDEX_H__ */
@@ -50,6 +50,7 @@ G_DEFINE_TYPE_EXTENDED (MpegTSPacketizer2, mpegts_packetizer, G_TYPE_OBJECT, 0,
 
 static void mpegts_packetizer_dispose (GObject * object);
 static void mpegts_packetizer_finalize (GObject * object);
+static void mpegts_packetizer_unmap (MpegTSPacketizer2 * packetizer);
 static GstClockTime calculate_skew (MpegTSPacketizer2 * packetizer,
     MpegTSPCR * pcr, guint64 pcrtime, GstClockTime time);
 static void _close_current_group (MpegTSPCR * pcrtable);
@@ -59,7 +60,6 @@ static void record_pcr (MpegTSPacketizer2 * packetizer, MpegTSPCR * pcrtable,
 #define CONTINUITY_UNSET 255
 #define VERSION_NUMBER_UNSET 255
 #define TABLE_ID_UNSET 0xFF
-#define PACKET_SYNC_BYTE 0x47
 
 static inline MpegTSPCR *
 get_pcr_table (MpegTSPacketizer2 * packetizer, guint16 pid)
@@ -261,6 +261,8 @@ mpegts_packetizer_init (MpegTSPacketizer2 * packetizer)
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
   packetizer->need_sync = FALSE;
+  packetizer->zero_copy = FALSE;
+  packetizer->map_buffer = NULL;
 
   memset (packetizer->pcrtablelut, 0xff, 0x2000);
   memset (packetizer->observations, 0x0, sizeof (packetizer->observations));
@@ -289,6 +291,7 @@ mpegts_packetizer_dispose (GObject * object)
       g_free (packetizer->streams);
     }
 
+    mpegts_packetizer_unmap (packetizer);
     gst_adapter_clear (packetizer->adapter);
     g_object_unref (packetizer->adapter);
     g_mutex_clear (&packetizer->group_lock);
@@ -570,13 +573,11 @@ mpegts_packetizer_clear (MpegTSPacketizer2 * packetizer)
     memset (packetizer->streams, 0, 8192 * sizeof (MpegTSPacketizerStream *));
   }
 
+  mpegts_packetizer_unmap (packetizer);
   gst_adapter_clear (packetizer->adapter);
   packetizer->offset = 0;
   packetizer->empty = TRUE;
   packetizer->need_sync = FALSE;
-  packetizer->map_data = NULL;
-  packetizer->map_size = 0;
-  packetizer->map_offset = 0;
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
 
   /* Close current PCR group */
@@ -604,14 +605,12 @@ mpegts_packetizer_flush (MpegTSPacketizer2 * packetizer, gboolean hard)
       }
     }
   }
+  mpegts_packetizer_unmap (packetizer);
   gst_adapter_clear (packetizer->adapter);
 
   packetizer->offset = 0;
   packetizer->empty = TRUE;
   packetizer->need_sync = FALSE;
-  packetizer->map_data = NULL;
-  packetizer->map_size = 0;
-  packetizer->map_offset = 0;
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
 
   /* Close current PCR group */
@@ -669,17 +668,63 @@ mpegts_packetizer_push (MpegTSPacketizer2 * packetizer, GstBuffer * buffer)
     packetizer->last_in_time = GST_BUFFER_TIMESTAMP (buffer);
 }
 
+static void
+mpegts_packetizer_unmap (MpegTSPacketizer2 * packetizer)
+{
+  if (packetizer->map_buffer) {
+    gst_buffer_unmap (packetizer->map_buffer, &packetizer->map_info);
+    gst_buffer_unref (packetizer->map_buffer);
+    packetizer->map_buffer = NULL;
+  }
+
+  packetizer->map_data = NULL;
+  packetizer->map_size = 0;
+  packetizer->map_offset = 0;
+}
+
 static void
 mpegts_packetizer_flush_bytes (MpegTSPacketizer2 * packetizer, gsize size)
 {
+  mpegts_packetizer_unmap (packetizer);
+
   if (size > 0) {
     GST_LOG ("flushing %" G_GSIZE_FORMAT " bytes from adapter", size);
     gst_adapter_flush (packetizer->adapter, size);
   }
+}
 
-  packetizer->map_data = NULL;
-  packetizer->map_size = 0;
+/* Maps the buffer at the head of the adapter without merging it with the
+ * following ones. Only returns TRUE if at least @size bytes are available
+ * in that buffer */
+static gboolean
+mpegts_packetizer_map_head_buffer (MpegTSPacketizer2 * packetizer, gsize size)
+{
+  gsize available;
+
+  available = gst_adapter_available_fast (packetizer->adapter);
+  if (available < size)
+    return FALSE;
+
+  packetizer->map_buffer =
+      gst_adapter_get_buffer (packetizer->adapter, available);
+  if (!packetizer->map_buffer)
+    return FALSE;
+
+  if (!gst_buffer_map (packetizer->map_buffer, &packetizer->map_info,
+          GST_MAP_READ)) {
+    gst_buffer_unref (packetizer->map_buffer);
+    packetizer->map_buffer = NULL;
+    return FALSE;
+  }
+
+  packetizer->map_data = packetizer->map_info.data;
+  packetizer->map_size = packetizer->map_info.size;
   packetizer->map_offset = 0;
+
+  GST_LOG ("mapped %" G_GSIZE_FORMAT " bytes from adapter head buffer",
+      packetizer->map_size);
+
+  return TRUE;
 }
 
 static gboolean
@@ -696,6 +741,18 @@ mpegts_packetizer_map (MpegTSPacketizer2 * packetizer, gsize size)
   if (available < size)
     return FALSE;
 
+  /* In zero-copy mode, packets are taken from the head buffer whenever it
+   * contains a whole packet. Only packets straddling two buffers get
+   * assembled by the adapter, and we then only map that packet so that
+   * the next one is taken from the following buffer again. Bigger
+   * requests (sync/packet size discovery) are handled as usual */
+  if (packetizer->zero_copy && packetizer->packet_size
+      && size <= packetizer->packet_size) {
+    if (mpegts_packetizer_map_head_buffer (packetizer, size))
+      return TRUE;
+    available = size;
+  }
+
   packetizer->map_data =
       (guint8 *) gst_adapter_map (packetizer->adapter, available);
   if (!packetizer->map_data)
@@ -709,11 +766,28 @@ mpegts_packetizer_map (MpegTSPacketizer2 * packetizer, gsize size)
   return TRUE;
 }
 
+/* Returns the offset of the first sync byte found in data[from..to[, or @to
+ * if there is none. memchr() is used since the C libraries provide optimized
+ * implementations of it, checking many bytes per iteration, which makes a
+ * big difference when resyncing on corrupted streams */
+static inline gsize
+mpegts_packetizer_find_sync_byte (const guint8 * data, gsize from, gsize to)
+{
+  const guint8 *found;
+
+  if (G_UNLIKELY (from >= to))
+    return to;
+
+  found = memchr (data + from, PACKET_SYNC_BYTE, to - from);
+
+  return found ? found - data : to;
+}
+
 static gboolean
 mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
 {
   guint8 *data;
-  gsize size, i, j;
+  gsize size, limit, i, j;
 
   static const guint psizes[] = {
     MPEGTS_NORMAL_PACKETSIZE,
@@ -728,10 +802,13 @@ mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
   size = packetizer->map_size - packetizer->map_offset;
   data = packetizer->map_data + packetizer->map_offset;
 
-  for (i = 0; i + 3 * MPEGTS_MAX_PACKETSIZE < size; i++) {
+  limit = size - 3 * MPEGTS_MAX_PACKETSIZE;
+
+  for (i = 0; i < limit; i++) {
     /* find a sync byte */
-    if (data[i] != PACKET_SYNC_BYTE)
-      continue;
+    i = mpegts_packetizer_find_sync_byte (data, i, limit);
+    if (i == limit)
+      break;
 
     /* check for 4 consecutive sync bytes with each possible packet size */
     for (j = 0; j < G_N_ELEMENTS (psizes); j++) {
@@ -771,7 +848,7 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
   gboolean found = FALSE;
   guint8 *data;
   guint packet_size;
-  gsize size, sync_offset, i;
+  gsize size, sync_offset, limit, i;
 
   packet_size = packetizer->packet_size;
 
@@ -786,9 +863,14 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
   else
     sync_offset = 0;
 
-  for (i = sync_offset; i + 2 * packet_size < size; i++) {
-    if (data[i] == PACKET_SYNC_BYTE &&
-        data[i + packet_size] == PACKET_SYNC_BYTE &&
+  limit = size - 2 * packet_size;
+
+  for (i = sync_offset; i < limit; i++) {
+    i = mpegts_packetizer_find_sync_byte (data, i, limit);
+    if (i == limit)
+      break;
+
+    if (data[i + packet_size] == PACKET_SYNC_BYTE &&
         data[i + 2 * packet_size] == PACKET_SYNC_BYTE) {
       found = TRUE;
       break;
@@ -882,6 +964,149 @@ mpegts_packetizer_clear_packet (MpegTSPacketizer2 * packetizer,
   }
 }
 
+/* Parses as many packets as possible (up to MPEGTS_PACKETIZER_BATCH_SIZE)
+ * from the currently mapped data in one pass, sparing the per-packet
+ * mapping and sync checks of mpegts_packetizer_next_packet(). Only the
+ * first packet of a batch can carry a PCR.
+ *
+ * The packets are only valid until mpegts_packetizer_clear_batch() is
+ * called. A batch might contain no valid packets at all if they were all
+ * bad, in which case it still needs to be cleared.
+ *
+ * The offset of the packetizer is not moved past the batch, the caller
+ * moves it past each packet it handles, as
+ * mpegts_packetizer_next_packet() does for single packets. */
+MpegTSPacketizerPacketReturn
+mpegts_packetizer_next_batch (MpegTSPacketizer2 * packetizer,
+    MpegTSPacketizerBatch * batch)
+{
+  MpegTSPacketizerPacket *packet;
+  guint8 *data, *packet_data;
+  guint packet_size;
+  gsize sync_offset, available;
+
+  batch->n_packets = 0;
+  batch->size = 0;
+
+  packet_size = packetizer->packet_size;
+  if (G_UNLIKELY (!packet_size)) {
+    if (!mpegts_try_discover_packet_size (packetizer))
+      return PACKET_NEED_MORE;
+    packet_size = packetizer->packet_size;
+  }
+
+  /* M2TS packets don't start with the sync byte, all other variants do */
+  if (packet_size == MPEGTS_M2TS_PACKETSIZE)
+    sync_offset = 4;
+  else
+    sync_offset = 0;
+
+  /* Make sure we start on a valid packet */
+  while (1) {
+    if (packetizer->need_sync) {
+      if (!mpegts_packetizer_sync (packetizer))
+        return PACKET_NEED_MORE;
+      packetizer->need_sync = FALSE;
+    }
+
+    if (!mpegts_packetizer_map (packetizer, packet_size))
+      return PACKET_NEED_MORE;
+
+    if (G_LIKELY (packetizer->map_data[packetizer->map_offset + sync_offset] ==
+            PACKET_SYNC_BYTE))
+      break;
+
+    GST_DEBUG ("lost sync");
+    packetizer->need_sync = TRUE;
+  }
+
+  batch->map_data = packetizer->map_data;
+  batch->offset = packetizer->offset;
+
+  data = packetizer->map_data + packetizer->map_offset;
+  available = packetizer->map_size - packetizer->map_offset;
+
+  while (batch->size + packet_size <= available &&
+      batch->n_packets < MPEGTS_PACKETIZER_BATCH_SIZE) {
+    packet_data = data + batch->size + sync_offset;
+
+    if (G_UNLIKELY (*packet_data != PACKET_SYNC_BYTE)) {
+      /* Resync once the packets of this batch have been handled */
+      GST_DEBUG ("lost sync");
+      packetizer->need_sync = TRUE;
+      break;
+    }
+
+    /* Parsing a PCR updates the skew and offset observations right away,
+     * while the packets are only handled once the batch is complete. A PCR
+     * therefore starts a new batch, so that the packets before it are
+     * handled with the clock state they would have had one at a time */
+    if (batch->size > 0 && PACKET_HAS_PCR (packet_data))
+      break;
+
+    packet = &batch->packets[batch->n_packets];
+    packet->data_start = packet_data;
+    packet->data_end = packet->data_start + 188;
+    packet->offset = batch->offset + batch->size;
+    batch->size += packet_size;
+
+    if (G_LIKELY (mpegts_packetizer_parse_packet (packetizer,
+                packet) == PACKET_OK))
+      batch->n_packets++;
+    else
+      GST_DEBUG ("bad packet at offset %" G_GUINT64_FORMAT, packet->offset);
+  }
+
+  GST_LOG ("parsed %u packets (%" G_GSIZE_FORMAT " bytes) at offset %"
+      G_GUINT64_FORMAT, batch->n_packets, batch->size, batch->offset);
+
+  return PACKET_OK;
+}
+
+/* Releases the first @n_handled packets of @batch. If not all packets were
+ * handled, the next batch will start at the first unhandled one */
+void
+mpegts_packetizer_clear_batch (MpegTSPacketizer2 * packetizer,
+    MpegTSPacketizerBatch * batch, guint n_handled)
+{
+  gsize size = batch->size;
+
+  /* The packetizer was flushed while handling the packets */
+  if (packetizer->map_data != batch->map_data)
+    return;
+
+  if (n_handled < batch->n_packets) {
+    size = batch->packets[n_handled].offset - batch->offset;
+    packetizer->need_sync = FALSE;
+  }
+  packetizer->offset = batch->offset + size;
+
+  packetizer->map_offset += size;
+  if (packetizer->map_size - packetizer->map_offset < packetizer->packet_size)
+    mpegts_packetizer_flush_bytes (packetizer, packetizer->map_offset);
+}
+
+/* Returns a buffer containing @size bytes starting at @data, which must be
+ * located within the current packet. If the packet was mapped from an
+ * upstream buffer (zero-copy mode) the returned buffer shares its memory,
+ * else the data is copied */
+GstBuffer *
+mpegts_packetizer_get_payload (MpegTSPacketizer2 * packetizer,
+    const guint8 * data, gsize size)
+{
+  GstBuffer *buffer;
+
+  if (packetizer->map_buffer && data >= packetizer->map_data &&
+      data + size <= packetizer->map_data + packetizer->map_size)
+    return gst_buffer_copy_region (packetizer->map_buffer,
+        GST_BUFFER_COPY_MEMORY, data - packetizer->map_data, size);
+
+  buffer = gst_buffer_new_allocate (NULL, size, NULL);
+  gst_buffer_fill (buffer, 0, data, size);
+
+  return buffer;
+}
+
 gboolean
 mpegts_packetizer_has_packets (MpegTSPacketizer2 * packetizer)
 {
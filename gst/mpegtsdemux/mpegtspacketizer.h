@@ -36,6 +36,8 @@
 #define MPEGTS_DVB_ASI_PACKETSIZE 204
 #define MPEGTS_ATSC_PACKETSIZE    208
 
+#define PACKET_SYNC_BYTE 0x47
+
 #define MPEGTS_MIN_PACKETSIZE MPEGTS_NORMAL_PACKETSIZE
 #define MPEGTS_MAX_PACKETSIZE MPEGTS_ATSC_PACKETSIZE
 
@@ -269,6 +271,13 @@ struct _MpegTSPacketizer2 {
   gsize map_size;
   gboolean need_sync;
 
+  /* Zero-copy mode: packets are mapped straight from the head buffer of
+   * the adapter whenever possible (map_buffer), so that payloads can be
+   * referenced instead of copied (see mpegts_packetizer_get_payload) */
+  gboolean zero_copy;
+  GstBuffer *map_buffer;
+  GstMapInfo map_info;
+
   /* Reference offset */
   guint64 refoffset;
 
@@ -294,6 +303,11 @@ struct _MpegTSPacketizer2Class {
 #define FLAGS_HAS_PAYLOAD(f) (f & 0x10)
 #define FLAGS_CONTINUITY_COUNTER(f) (f & 0x0f)
 
+/* Whether the packet starting with the sync byte at @d has a PCR, without
+ * parsing it */
+#define PACKET_HAS_PCR(d) (FLAGS_HAS_AFC ((d)[3]) && (d)[4] > 0 && \
+    ((d)[5] & MPEGTS_AFC_PCR_FLAG))
+
 typedef struct
 {
   gint16  pid;
@@ -310,6 +324,25 @@ typedef struct
   guint64 offset;
 } MpegTSPacketizerPacket;
 
+/* Maximum number of packets parsed at once by mpegts_packetizer_next_batch() */
+#define MPEGTS_PACKETIZER_BATCH_SIZE 64
+
+/* MpegTSPacketizerBatch: Packets parsed in one go from the mapped data */
+typedef struct
+{
+  /* The valid packets (bad packets are skipped) */
+  MpegTSPacketizerPacket packets[MPEGTS_PACKETIZER_BATCH_SIZE];
+  guint n_packets;
+
+  /* Upstream offset of the first packet and total size (units: bytes)
+   * of the data covered by the batch, including skipped packets */
+  guint64 offset;
+  gsize size;
+
+  /* Mapped data the packets point to */
+  guint8 *map_data;
+} MpegTSPacketizerBatch;
+
 typedef struct
 {
   guint8 table_id;
@@ -348,6 +381,13 @@ G_GNUC_INTERNAL MpegTSPacketizerPacketReturn
 mpegts_packetizer_process_next_packet(MpegTSPacketizer2 * packetizer);
 G_GNUC_INTERNAL void mpegts_packetizer_clear_packet (MpegTSPacketizer2 *packetizer,
 				     MpegTSPacketizerPacket *packet);
+G_GNUC_INTERNAL MpegTSPacketizerPacketReturn
+mpegts_packetizer_next_batch (MpegTSPacketizer2 *packetizer,
+			      MpegTSPacketizerBatch *batch);
+G_GNUC_INTERNAL void mpegts_packetizer_clear_batch (MpegTSPacketizer2 *packetizer,
+				     MpegTSPacketizerBatch *batch, guint n_handled);
+G_GNUC_INTERNAL GstBuffer *mpegts_packetizer_get_payload (MpegTSPacketizer2 *packetizer,
+  const guint8 *data, gsize size);
 G_GNUC_INTERNAL void mpegts_packetizer_remove_stream(MpegTSPacketizer2 *packetizer,
   gint16 pid);
 
@@ -74,6 +74,18 @@
 /* latency in nsecs */
 #define TS_LATENCY (700 * GST_MSECOND)
 
+/* The measured latency is the highest one over windows of LATENCY_WINDOW,
+ * and a LATENCY message is posted when it moves away from the reported
+ * latency by more than LATENCY_THRESHOLD */
+#define LATENCY_WINDOW (5 * GST_SECOND)
+#define LATENCY_THRESHOLD (20 * GST_MSECOND)
+
+#define DEFAULT_ZERO_COPY FALSE
+#define DEFAULT_LOW_LATENCY FALSE
+#define DEFAULT_LATENCY_MARGIN (100 * GST_MSECOND)
+#define DEFAULT_BUILD_INDEX FALSE
+#define DEFAULT_INDEX_CACHE_DIR NULL
+
 GST_DEBUG_CATEGORY_STATIC (ts_demux_debug);
 #define GST_CAT_DEFAULT ts_demux_debug
 
@@ -162,6 +174,15 @@ struct _TSDemuxStream
   /* Size of ->data */
   guint allocated_size;
 
+  /* Zero-copy mode: data being reconstructed, as buffers sharing the
+   * memory of the incoming packets (used instead of ->data) */
+  GstBufferList *fragments;
+
+  /* Pool of output buffers, used in zero-copy mode for the PES packets
+   * which need to be copied into one contiguous buffer */
+  GstBufferPool *pool;
+  guint pool_size;
+
   /* Current PTS/DTS for this stream (in running time) */
   GstClockTime pts;
   GstClockTime dts;
@@ -198,6 +219,10 @@ struct _TSDemuxStream
 
   GstClockTime seeked_pts, seeked_dts;
 
+  /* Whether the current PES packet is dropped because it is before the
+   * seek position. Only its first partial push carries a timestamp */
+  gboolean dropping_pes;
+
   GstTsDemuxKeyFrameScanFunction scan_function;
   TSDemuxH264ParsingInfos h264infos;
 };
@@ -273,6 +298,12 @@ enum
   PROP_0,
   PROP_PROGRAM_NUMBER,
   PROP_EMIT_STATS,
+  PROP_ZERO_COPY,
+  PROP_LOW_LATENCY,
+  PROP_LATENCY_MARGIN,
+  PROP_MEASURED_LATENCY,
+  PROP_BUILD_INDEX,
+  PROP_INDEX_CACHE_DIR,
   /* FILL ME */
 };
 
@@ -335,6 +366,8 @@ gst_ts_demux_dispose (GObject * object)
   GstTSDemux *demux = GST_TS_DEMUX_CAST (object);
 
   gst_flow_combiner_free (demux->flowcombiner);
+  g_free (demux->index_cache_dir);
+  demux->index_cache_dir = NULL;
 
   GST_CALL_PARENT (G_OBJECT_CLASS, dispose, (object));
 }
@@ -361,6 +394,97 @@ gst_ts_demux_class_init (GstTSDemuxClass * klass)
           "Emit messages for every pcr/opcr/pts/dts", FALSE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstTSDemux:zero-copy:
+   *
+   * Reconstruct PES packets without copying their payload. Each outgoing
+   * buffer is made of the memories of the incoming buffers holding the PES
+   * payload, as long as they fit in one buffer. Larger PES packets, and
+   * streams which need contiguous data (subtitles, private streams, ...),
+   * are copied into buffers from a per-stream buffer pool.
+   *
+   * Since: 1.10
+   */
+  g_object_class_install_property (gobject_class, PROP_ZERO_COPY,
+      g_param_spec_boolean ("zero-copy", "Zero copy",
+          "Push PES payloads as buffers referencing the input data "
+          "instead of copying them", DEFAULT_ZERO_COPY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstTSDemux:low-latency:
+   *
+   * Push the data of PES packets of unbounded size (usually video) as soon
+   * as it is received instead of waiting for the start of the next PES
+   * packet. Only the first buffer of each PES packet is timestamped.
+   *
+   * Since: 1.10
+   */
+  g_object_class_install_property (gobject_class, PROP_LOW_LATENCY,
+      g_param_spec_boolean ("low-latency", "Low latency",
+          "Push partial PES packets of unbounded size without waiting for "
+          "the next PES packet", DEFAULT_LOW_LATENCY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstTSDemux:latency-margin:
+   *
+   * Extra latency added to the measured latency when answering LATENCY
+   * queries with a live upstream.
+   *
+   * Since: 1.10
+   */
+  g_object_class_install_property (gobject_class, PROP_LATENCY_MARGIN,
+      g_param_spec_uint64 ("latency-margin", "Latency margin",
+          "Extra latency (in ns) added to the measured latency", 0,
+          G_MAXUINT64, DEFAULT_LATENCY_MARGIN,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstTSDemux:measured-latency:
+   *
+   * Highest latency observed over the last few seconds between the
+   * timestamp of the incoming data and the timestamp of the buffers being
+   * pushed out, with a live upstream. GST_CLOCK_TIME_NONE if nothing was
+   * measured yet.
+   *
+   * Since: 1.10
+   */
+  g_object_class_install_property (gobject_class, PROP_MEASURED_LATENCY,
+      g_param_spec_uint64 ("measured-latency", "Measured latency",
+          "Highest latency (in ns) measured on live streams", 0,
+          G_MAXUINT64, GST_CLOCK_TIME_NONE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstTSDemux:build-index:
+   *
+   * In pull mode, scan the whole file in a separate thread once the
+   * program is known and record the position of its PCRs. Seeks and
+   * duration queries use this index once complete instead of bisecting
+   * the file.
+   *
+   * Since: 1.10
+   */
+  g_object_class_install_property (gobject_class, PROP_BUILD_INDEX,
+      g_param_spec_boolean ("build-index", "Build index",
+          "Build a PCR index of the file in pull mode for faster seeking",
+          DEFAULT_BUILD_INDEX, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstTSDemux:index-cache-dir:
+   *
+   * Directory in which the index built with #GstTSDemux:build-index is
+   * saved, and from which it is loaded on the next run if the file did
+   * not change. No cache is used if %NULL.
+   *
+   * Since: 1.10
+   */
+  g_object_class_install_property (gobject_class, PROP_INDEX_CACHE_DIR,
+      g_param_spec_string ("index-cache-dir", "Index cache directory",
+          "Directory where file indexes are cached (NULL = no cache)",
+          DEFAULT_INDEX_CACHE_DIR, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   element_class = GST_ELEMENT_CLASS (klass);
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&video_template));
@@ -418,6 +542,13 @@ gst_ts_demux_reset (MpegTSBase * base)
   demux->group_id = G_MAXUINT;
 
   demux->last_seek_offset = -1;
+
+  GST_OBJECT_LOCK (demux);
+  demux->measured_latency = GST_CLOCK_TIME_NONE;
+  demux->reported_latency = GST_CLOCK_TIME_NONE;
+  GST_OBJECT_UNLOCK (demux);
+  demux->latency_window_start = GST_CLOCK_TIME_NONE;
+  demux->latency_window_max = 0;
 }
 
 static void
@@ -433,6 +564,11 @@ gst_ts_demux_init (GstTSDemux * demux)
   demux->flowcombiner = gst_flow_combiner_new ();
   demux->requested_program_number = -1;
   demux->program_number = -1;
+  demux->zero_copy = DEFAULT_ZERO_COPY;
+  demux->low_latency = DEFAULT_LOW_LATENCY;
+  demux->latency_margin = DEFAULT_LATENCY_MARGIN;
+  demux->build_index = DEFAULT_BUILD_INDEX;
+  demux->index_cache_dir = g_strdup (DEFAULT_INDEX_CACHE_DIR);
   gst_ts_demux_reset (base);
 }
 
@@ -452,6 +588,27 @@ gst_ts_demux_set_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       demux->emit_statistics = g_value_get_boolean (value);
       break;
+    case PROP_ZERO_COPY:
+      demux->zero_copy = g_value_get_boolean (value);
+      MPEG_TS_BASE_PACKETIZER (demux)->zero_copy = demux->zero_copy;
+      break;
+    case PROP_LOW_LATENCY:
+      demux->low_latency = g_value_get_boolean (value);
+      break;
+    case PROP_LATENCY_MARGIN:
+      GST_OBJECT_LOCK (demux);
+      demux->latency_margin = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_BUILD_INDEX:
+      demux->build_index = g_value_get_boolean (value);
+      break;
+    case PROP_INDEX_CACHE_DIR:
+      GST_OBJECT_LOCK (demux);
+      g_free (demux->index_cache_dir);
+      demux->index_cache_dir = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -470,6 +627,30 @@ gst_ts_demux_get_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       g_value_set_boolean (value, demux->emit_statistics);
       break;
+    case PROP_ZERO_COPY:
+      g_value_set_boolean (value, demux->zero_copy);
+      break;
+    case PROP_LOW_LATENCY:
+      g_value_set_boolean (value, demux->low_latency);
+      break;
+    case PROP_LATENCY_MARGIN:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_uint64 (value, demux->latency_margin);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_MEASURED_LATENCY:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_uint64 (value, demux->measured_latency);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_BUILD_INDEX:
+      g_value_set_boolean (value, demux->build_index);
+      break;
+    case PROP_INDEX_CACHE_DIR:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_string (value, demux->index_cache_dir);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -482,6 +663,17 @@ gst_ts_demux_get_duration (GstTSDemux * demux, GstClockTime * dur)
   gboolean res = FALSE;
   gint64 val;
 
+  /* Use the index if it was fully built */
+  GST_OBJECT_LOCK (demux);
+  if (base->index && mpegts_index_is_complete (base->index) &&
+      mpegts_index_get_pcr_pid (base->index) == demux->program->pcr_pid) {
+    *dur = mpegts_index_get_duration (base->index);
+    res = GST_CLOCK_TIME_IS_VALID (*dur);
+  }
+  GST_OBJECT_UNLOCK (demux);
+  if (res)
+    return TRUE;
+
   /* Get total size in bytes */
   if (gst_pad_peer_query_duration (base->sinkpad, GST_FORMAT_BYTES, &val)) {
     /* Convert it to duration */
@@ -529,20 +721,37 @@ gst_ts_demux_srcpad_query (GstPad * pad, GstObject * parent, GstQuery * query)
       GST_DEBUG ("query latency");
       res = gst_pad_peer_query (base->sinkpad, query);
       if (res) {
-        GstClockTime min_lat, max_lat;
+        GstClockTime min_lat, max_lat, latency;
         gboolean live;
 
-        /* According to H.222.0
-           Annex D.0.3 (System Time Clock recovery in the decoder)
-           and D.0.2 (Audio and video presentation synchronization)
-
-           We can end up with an interval of up to 700ms between valid
-           PTS/DTS. We therefore allow a latency of 700ms for that.
-         */
         gst_query_parse_latency (query, &live, &min_lat, &max_lat);
-        min_lat += TS_LATENCY;
+
+        GST_OBJECT_LOCK (demux);
+        base->upstream_live = live;
+        base->queried_latency = TRUE;
+        if (live && GST_CLOCK_TIME_IS_VALID (demux->measured_latency)) {
+          /* Use the latency we actually observed (see
+           * gst_ts_demux_update_latency()) */
+          latency = demux->measured_latency + demux->latency_margin;
+        } else {
+          /* According to H.222.0
+             Annex D.0.3 (System Time Clock recovery in the decoder)
+             and D.0.2 (Audio and video presentation synchronization)
+
+             We can end up with an interval of up to 700ms between valid
+             PTS/DTS. We therefore allow a latency of 700ms for that.
+           */
+          latency = TS_LATENCY;
+        }
+        demux->reported_latency = latency;
+        GST_OBJECT_UNLOCK (demux);
+
+        GST_DEBUG_OBJECT (demux, "Reporting latency of %" GST_TIME_FORMAT,
+            GST_TIME_ARGS (latency));
+
+        min_lat += latency;
         if (GST_CLOCK_TIME_IS_VALID (max_lat))
-          max_lat += TS_LATENCY;
+          max_lat += latency;
         gst_query_set_latency (query, live, min_lat, max_lat);
       }
       break;
@@ -691,8 +900,8 @@ scan_keyframe_h264 (TSDemuxStream * stream, const guint8 * data,
         if (h264infos->framedata.size)
           break;
 
-        res = gst_h264_parser_parse_slice_hdr (parser, &unit, &slice,
-            FALSE, FALSE);
+        res = gst_h264_parser_parse_slice_hdr_with_depth (parser, &unit,
+            &slice, GST_H264_SLICE_HDR_PARSE_DEPTH_AU_BOUNDARY);
 
         if (GST_H264_IS_I_SLICE (&slice) || GST_H264_IS_SI_SLICE (&slice)) {
           if (*(unit.data + unit.offset + 1) & 0x80) {
@@ -814,6 +1023,7 @@ gst_ts_demux_do_seek (MpegTSBase * base, GstEvent * event)
   GstSeekType start_type, stop_type;
   gint64 start, stop;
   guint64 start_offset;
+  gboolean on_keyframe = FALSE;
 
   gst_event_parse_seek (event, &rate, &format, &flags, &start_type, &start,
       &stop_type, &stop);
@@ -836,9 +1046,34 @@ gst_ts_demux_do_seek (MpegTSBase * base, GstEvent * event)
   GST_DEBUG_OBJECT (demux, "configuring seek");
 
   if (start_type != GST_SEEK_TYPE_NONE) {
-    start_offset =
-        mpegts_packetizer_ts_to_offset (base->packetizer, MAX (0,
-            start - SEEK_TIMESTAMP_OFFSET), demux->program->pcr_pid);
+    GST_OBJECT_LOCK (demux);
+    if (base->index && mpegts_index_is_complete (base->index) &&
+        mpegts_index_get_pcr_pid (base->index) == demux->program->pcr_pid) {
+      GstClockTime keyframe_ts;
+
+      /* Land directly on the keyframe preceding the requested position */
+      start_offset =
+          mpegts_index_find_keyframe (base->index, MAX (0, start),
+          &keyframe_ts);
+      if (start_offset != -1) {
+        GST_DEBUG_OBJECT (demux, "Using keyframe at %" GST_TIME_FORMAT
+            ", offset %" G_GUINT64_FORMAT, GST_TIME_ARGS (keyframe_ts),
+            start_offset);
+        on_keyframe = TRUE;
+      } else {
+        start_offset =
+            mpegts_index_ts_to_offset (base->index, MAX (0,
+                start - SEEK_TIMESTAMP_OFFSET));
+        GST_DEBUG_OBJECT (demux, "Using index, offset %" G_GUINT64_FORMAT,
+            start_offset);
+      }
+      GST_OBJECT_UNLOCK (demux);
+    } else {
+      GST_OBJECT_UNLOCK (demux);
+      start_offset =
+          mpegts_packetizer_ts_to_offset (base->packetizer, MAX (0,
+              start - SEEK_TIMESTAMP_OFFSET), demux->program->pcr_pid);
+    }
 
     if (G_UNLIKELY (start_offset == -1)) {
       GST_WARNING ("Couldn't convert start position to an offset");
@@ -879,7 +1114,7 @@ gst_ts_demux_do_seek (MpegTSBase * base, GstEvent * event)
   for (tmp = demux->program->stream_list; tmp; tmp = tmp->next) {
     TSDemuxStream *stream = tmp->data;
 
-    if (flags & GST_SEEK_FLAG_ACCURATE)
+    if ((flags & GST_SEEK_FLAG_ACCURATE) && !on_keyframe)
       stream->needs_keyframe = TRUE;
 
     stream->seeked_pts = GST_CLOCK_TIME_NONE;
@@ -1686,6 +1921,12 @@ gst_ts_demux_stream_removed (MpegTSBase * base, MpegTSBaseStream * bstream)
 
   gst_ts_demux_stream_flush (stream, GST_TS_DEMUX_CAST (base), TRUE);
 
+  if (stream->pool) {
+    gst_buffer_pool_set_active (stream->pool, FALSE);
+    gst_object_unref (stream->pool);
+    stream->pool = NULL;
+  }
+
   if (stream->taglist != NULL) {
     gst_tag_list_unref (stream->taglist);
     stream->taglist = NULL;
@@ -1719,7 +1960,12 @@ gst_ts_demux_stream_flush (TSDemuxStream * stream, GstTSDemux * tsdemux,
 
   g_free (stream->data);
   stream->data = NULL;
+  if (stream->fragments) {
+    gst_buffer_list_unref (stream->fragments);
+    stream->fragments = NULL;
+  }
   stream->state = PENDING_PACKET_EMPTY;
+  stream->dropping_pes = FALSE;
   stream->expected_size = 0;
   stream->allocated_size = 0;
   stream->current_size = 0;
@@ -1799,6 +2045,41 @@ gst_ts_demux_program_started (MpegTSBase * base, MpegTSBaseProgram * program)
     demux->program_number = program->program_number;
     demux->program = program;
 
+    /* Start indexing the file now that we know which PCR pid to follow */
+    if (base->mode != BASE_MODE_PUSHING && demux->build_index && !base->index) {
+      MpegTSIndex *index;
+      gchar *cache_dir;
+
+      GST_OBJECT_LOCK (demux);
+      cache_dir = g_strdup (demux->index_cache_dir);
+      GST_OBJECT_UNLOCK (demux);
+
+      index =
+          mpegts_index_new (base->sinkpad, program->pcr_pid, base->packetsize,
+          0, cache_dir);
+
+      /* Record the keyframes of the first video stream */
+      for (tmp = program->stream_list; tmp; tmp = tmp->next) {
+        MpegTSBaseStream *bstream = (MpegTSBaseStream *) tmp->data;
+
+        if (bstream->stream_type == GST_MPEGTS_STREAM_TYPE_VIDEO_H264 ||
+            bstream->stream_type == GST_MPEGTS_STREAM_TYPE_VIDEO_HEVC ||
+            bstream->stream_type == GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG1 ||
+            bstream->stream_type == GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG2) {
+          mpegts_index_set_video_stream (index, bstream->pid,
+              bstream->stream_type);
+          break;
+        }
+      }
+
+      mpegts_index_start (index);
+      g_free (cache_dir);
+
+      GST_OBJECT_LOCK (demux);
+      base->index = index;
+      GST_OBJECT_UNLOCK (demux);
+    }
+
     /* If this is not the initial program, we need to calculate
      * a new segment */
     if (demux->segment_event) {
@@ -2063,6 +2344,8 @@ gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
 
   GST_MEMDUMP ("Header buffer", data, MIN (length, 32));
 
+  stream->dropping_pes = FALSE;
+
   parseres = mpegts_parse_pes_header (data, length, &header);
   if (G_UNLIKELY (parseres == PES_PARSING_NEED_MORE))
     goto discont;
@@ -2112,6 +2395,18 @@ gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
   data += header.header_size;
   length -= header.header_size;
 
+  if (demux->zero_copy) {
+    g_assert (stream->fragments == NULL);
+    stream->fragments = gst_buffer_list_new ();
+    if (length)
+      gst_buffer_list_add (stream->fragments,
+          mpegts_packetizer_get_payload (MPEG_TS_BASE_PACKETIZER (demux), data,
+              length));
+    stream->current_size = length;
+    stream->state = PENDING_PACKET_BUFFER;
+    return;
+  }
+
   /* Create the output buffer */
   if (stream->expected_size)
     stream->allocated_size = MAX (stream->expected_size, length);
@@ -2184,6 +2479,23 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
     case PENDING_PACKET_BUFFER:
     {
       GST_LOG ("BUFFER: appending data");
+      if (G_UNLIKELY (stream->data == NULL && stream->fragments == NULL)) {
+        /* Continuation of a partially pushed PES packet */
+        if (demux->zero_copy) {
+          stream->fragments = gst_buffer_list_new ();
+        } else {
+          stream->allocated_size = MAX (8192, size);
+          stream->data = g_malloc (stream->allocated_size);
+        }
+      }
+      if (stream->fragments) {
+        if (size)
+          gst_buffer_list_add (stream->fragments,
+              mpegts_packetizer_get_payload (MPEG_TS_BASE_PACKETIZER (demux),
+                  data, size));
+        stream->current_size += size;
+        break;
+      }
       if (G_UNLIKELY (stream->current_size + size > stream->allocated_size)) {
         GST_LOG ("resizing buffer");
         do {
@@ -2202,6 +2514,10 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
         g_free (stream->data);
         stream->data = NULL;
       }
+      if (G_UNLIKELY (stream->fragments)) {
+        gst_buffer_list_unref (stream->fragments);
+        stream->fragments = NULL;
+      }
       stream->continuity_counter = CONTINUITY_UNSET;
       break;
     }
@@ -2458,6 +2774,183 @@ error:
   }
 }
 
+/* Measures the latency introduced by the PES reconstruction, i.e. the
+ * difference between the timestamp of the last incoming data and the
+ * timestamp of the buffer about to be pushed out. Increases are taken into
+ * account right away, decreases once a whole LATENCY_WINDOW stayed below.
+ * If it moves away from what was reported, a LATENCY message is posted so
+ * it gets queried again */
+static void
+gst_ts_demux_update_latency (GstTSDemux * demux, TSDemuxStream * stream)
+{
+  MpegTSBase *base = (MpegTSBase *) demux;
+  GstClockTime in_time, ts, latency, measured;
+  gboolean post = FALSE;
+
+  /* Timestamps are only in the same time domain as the incoming data
+   * when the clock skew is being tracked */
+  if (!base->upstream_live || !base->packetizer->calculate_skew)
+    return;
+
+  in_time = base->packetizer->last_in_time;
+  ts = GST_CLOCK_TIME_IS_VALID (stream->dts) ? stream->dts : stream->pts;
+  if (!GST_CLOCK_TIME_IS_VALID (in_time) || !GST_CLOCK_TIME_IS_VALID (ts) ||
+      in_time <= ts)
+    return;
+
+  latency = in_time - ts;
+
+  if (!GST_CLOCK_TIME_IS_VALID (demux->latency_window_start) ||
+      in_time < demux->latency_window_start) {
+    demux->latency_window_start = in_time;
+    demux->latency_window_max = 0;
+  }
+  demux->latency_window_max = MAX (demux->latency_window_max, latency);
+
+  GST_OBJECT_LOCK (demux);
+  measured = demux->measured_latency;
+  if (!GST_CLOCK_TIME_IS_VALID (measured) || latency > measured) {
+    measured = latency;
+  } else if (in_time - demux->latency_window_start >= LATENCY_WINDOW) {
+    measured = demux->latency_window_max;
+    demux->latency_window_start = in_time;
+    demux->latency_window_max = latency;
+  }
+
+  if (measured != demux->measured_latency) {
+    GST_DEBUG_OBJECT (stream->pad, "New measured latency %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (measured));
+    demux->measured_latency = measured;
+  }
+
+  /* Only post once until the next LATENCY query */
+  if (GST_CLOCK_TIME_IS_VALID (demux->reported_latency) &&
+      ABSDIFF (measured + demux->latency_margin,
+          demux->reported_latency) > LATENCY_THRESHOLD) {
+    demux->reported_latency = GST_CLOCK_TIME_NONE;
+    post = TRUE;
+  }
+  GST_OBJECT_UNLOCK (demux);
+
+  if (post)
+    gst_element_post_message (GST_ELEMENT_CAST (demux),
+        gst_message_new_latency (GST_OBJECT_CAST (demux)));
+}
+
+/* Returns a buffer of @size bytes from the stream pool. The pool is
+ * (re)created whenever a PES packet doesn't fit in its buffers */
+static GstBuffer *
+gst_ts_demux_stream_acquire_buffer (TSDemuxStream * stream, guint size)
+{
+  GstBuffer *buffer = NULL;
+
+  if (stream->pool && size > stream->pool_size) {
+    gst_buffer_pool_set_active (stream->pool, FALSE);
+    gst_object_unref (stream->pool);
+    stream->pool = NULL;
+  }
+
+  if (stream->pool == NULL) {
+    GstStructure *config;
+
+    stream->pool_size = MAX (4096, 1 << g_bit_storage (size - 1));
+    stream->pool = gst_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (stream->pool);
+    gst_buffer_pool_config_set_params (config, NULL, stream->pool_size, 0, 0);
+    if (!gst_buffer_pool_set_config (stream->pool, config) ||
+        !gst_buffer_pool_set_active (stream->pool, TRUE)) {
+      GST_WARNING_OBJECT (stream->pad, "Failed to set up buffer pool");
+      gst_object_unref (stream->pool);
+      stream->pool = NULL;
+      return gst_buffer_new_allocate (NULL, size, NULL);
+    }
+    GST_DEBUG_OBJECT (stream->pad, "Created pool of %u bytes buffers",
+        stream->pool_size);
+  }
+
+  if (gst_buffer_pool_acquire_buffer (stream->pool, &buffer,
+          NULL) != GST_FLOW_OK)
+    return gst_buffer_new_allocate (NULL, size, NULL);
+
+  gst_buffer_set_size (buffer, size);
+
+  return buffer;
+}
+
+static void
+gst_ts_demux_stream_copy_fragments (TSDemuxStream * stream, guint8 * data,
+    gsize size)
+{
+  guint i, n;
+  gsize offset = 0;
+
+  n = gst_buffer_list_length (stream->fragments);
+  for (i = 0; i < n; i++)
+    offset += gst_buffer_extract (gst_buffer_list_get (stream->fragments, i),
+        0, data + offset, size - offset);
+
+  gst_buffer_list_unref (stream->fragments);
+  stream->fragments = NULL;
+}
+
+/* Converts the fragments of a zero-copy PES packet into ->data, for
+ * the code paths which need to inspect/modify the whole packet */
+static void
+gst_ts_demux_stream_flatten_fragments (TSDemuxStream * stream)
+{
+  g_assert (stream->data == NULL);
+
+  GST_LOG_OBJECT (stream->pad, "Merging %u fragments",
+      gst_buffer_list_length (stream->fragments));
+
+  stream->allocated_size = MAX (stream->current_size, 1);
+  stream->data = g_malloc (stream->allocated_size);
+  gst_ts_demux_stream_copy_fragments (stream, stream->data,
+      stream->current_size);
+}
+
+/* Creates the outgoing buffer from the reconstructed PES packet. In
+ * zero-copy mode, the payloads of the TS packets become the memories of the
+ * buffer as long as they fit in one, and are copied into a buffer of the
+ * stream pool otherwise */
+static GstBuffer *
+gst_ts_demux_stream_take_output (TSDemuxStream * stream)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  guint i, n;
+
+  if (stream->fragments == NULL) {
+    buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+    stream->data = NULL;
+    return buffer;
+  }
+
+  n = gst_buffer_list_length (stream->fragments);
+  if (stream->sparse || n > gst_buffer_get_max_memory ()) {
+    /* Subtitles and metadata parsers expect contiguous data, and appending
+     * more memories than a buffer can hold would merge them over and over */
+    buffer = gst_ts_demux_stream_acquire_buffer (stream, stream->current_size);
+    gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+    gst_ts_demux_stream_copy_fragments (stream, map.data, map.size);
+    gst_buffer_unmap (buffer, &map);
+    return buffer;
+  }
+
+  if (n == 1) {
+    buffer = gst_buffer_ref (gst_buffer_list_get (stream->fragments, 0));
+  } else {
+    buffer = gst_buffer_new ();
+    for (i = 0; i < n; i++)
+      gst_buffer_copy_into (buffer, gst_buffer_list_get (stream->fragments, i),
+          GST_BUFFER_COPY_MEMORY, 0, -1);
+  }
+  gst_buffer_list_unref (stream->fragments);
+  stream->fragments = NULL;
+
+  return buffer;
+}
+
 static GstFlowReturn
 gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream)
 {
@@ -2470,7 +2963,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream)
       "stream:%p, pid:0x%04x stream_type:%d state:%d", stream, bs->pid,
       bs->stream_type, stream->state);
 
-  if (G_UNLIKELY (stream->data == NULL)) {
+  if (G_UNLIKELY (stream->data == NULL && stream->fragments == NULL)) {
     GST_LOG ("stream->data == NULL");
     goto beach;
   }
@@ -2491,6 +2984,12 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream)
     goto beach;
   }
 
+  /* Keyframe scanning and Opus parsing need the whole packet in ->data */
+  if (stream->fragments && (stream->needs_keyframe ||
+          (bs->stream_type == GST_MPEGTS_STREAM_TYPE_PRIVATE_PES_PACKETS &&
+              bs->registration_id == DRF_ID_OPUS)))
+    gst_ts_demux_stream_flatten_fragments (stream);
+
   if (stream->needs_keyframe) {
     MpegTSBase *base = (MpegTSBase *) demux;
 
@@ -2514,7 +3013,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream)
           buffer_list = NULL;
         }
       } else {
-        buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+        buffer = gst_ts_demux_stream_take_output (stream);
       }
 
       stream->seeked_pts = stream->pts;
@@ -2548,7 +3047,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream)
         buffer_list = NULL;
       }
     } else {
-      buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+      buffer = gst_ts_demux_stream_take_output (stream);
     }
 
     if (G_UNLIKELY (stream->pending_ts && !check_pending_buffers (demux))) {
@@ -2604,6 +3103,15 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream)
     stream->pending = NULL;
   }
 
+  if (stream->dropping_pes) {
+    GST_LOG_OBJECT (stream->pad, "Dropping the rest of a dropped PES packet");
+    if (buffer)
+      gst_buffer_unref (buffer);
+    if (buffer_list)
+      gst_buffer_list_unref (buffer_list);
+    goto beach;
+  }
+
   if ((GST_CLOCK_TIME_IS_VALID (stream->seeked_pts)
           && stream->pts < stream->seeked_pts) ||
       (GST_CLOCK_TIME_IS_VALID (stream->seeked_dts) &&
@@ -2614,6 +3122,8 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream)
         "(seeked PTS: %" GST_TIME_FORMAT " DTS: %" GST_TIME_FORMAT ")",
         GST_TIME_ARGS (stream->pts), GST_TIME_ARGS (stream->dts),
         GST_TIME_ARGS (stream->seeked_pts), GST_TIME_ARGS (stream->seeked_dts));
+    /* Until the next PES header */
+    stream->dropping_pes = TRUE;
     if (buffer)
       gst_buffer_unref (buffer);
     if (buffer_list)
@@ -2624,6 +3134,8 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream)
   GST_DEBUG_OBJECT (stream->pad, "stream->pts %" GST_TIME_FORMAT,
       GST_TIME_ARGS (stream->pts));
 
+  gst_ts_demux_update_latency (demux, stream);
+
   /* Decorate buffer or first buffer of the buffer list */
   if (buffer_list)
     buffer = gst_buffer_list_get (buffer_list, 0);
@@ -2688,12 +3200,64 @@ beach:
   GST_LOG ("Resetting to EMPTY, returning %s", gst_flow_get_name (res));
   stream->state = PENDING_PACKET_EMPTY;
   stream->data = NULL;
+  if (G_UNLIKELY (stream->fragments)) {
+    gst_buffer_list_unref (stream->fragments);
+    stream->fragments = NULL;
+  }
   stream->expected_size = 0;
   stream->current_size = 0;
 
   return res;
 }
 
+/* Whether the data gathered so far can be pushed out before the end of
+ * the PES packet is known (low-latency mode) */
+static gboolean
+gst_ts_demux_stream_can_push_partial (GstTSDemux * demux,
+    TSDemuxStream * stream)
+{
+  MpegTSBaseStream *bs = (MpegTSBaseStream *) stream;
+
+  if (!demux->low_latency || stream->expected_size != 0 ||
+      stream->state != PENDING_PACKET_BUFFER || stream->current_size == 0)
+    return FALSE;
+
+  /* Those need the complete PES packet */
+  if (stream->needs_keyframe || stream->pending_ts || stream->sparse)
+    return FALSE;
+  if (bs->stream_type == GST_MPEGTS_STREAM_TYPE_PRIVATE_PES_PACKETS &&
+      bs->registration_id == DRF_ID_OPUS)
+    return FALSE;
+
+  return TRUE;
+}
+
+/* Pushes the data of the current PES packet gathered so far, and keeps on
+ * gathering the rest of it */
+static GstFlowReturn
+gst_ts_demux_push_partial_data (GstTSDemux * demux, TSDemuxStream * stream)
+{
+  GstFlowReturn res;
+
+  GST_LOG_OBJECT (stream->pad, "Pushing %u bytes of partial PES packet",
+      stream->current_size);
+
+  res = gst_ts_demux_push_pending_data (demux, stream);
+
+  /* The following data belongs to the same PES packet. Its storage gets
+   * allocated in gst_ts_demux_queue_data() and it carries no timestamp.
+   * If pushing failed, the rest of the packet is discarded until the next
+   * PES header */
+  if (res == GST_FLOW_OK || res == GST_FLOW_NOT_LINKED)
+    stream->state = PENDING_PACKET_BUFFER;
+  else
+    stream->state = PENDING_PACKET_DISCONT;
+  stream->pts = GST_CLOCK_TIME_NONE;
+  stream->dts = GST_CLOCK_TIME_NONE;
+
+  return res;
+}
+
 static GstFlowReturn
 gst_ts_demux_handle_packet (GstTSDemux * demux, TSDemuxStream * stream,
     MpegTSPacketizerPacket * packet, GstMpegtsSection * section)
@@ -2718,6 +3282,8 @@ gst_ts_demux_handle_packet (GstTSDemux * demux, TSDemuxStream * stream,
     if (stream->expected_size && stream->current_size == stream->expected_size) {
       GST_LOG ("pushing complete packet");
       res = gst_ts_demux_push_pending_data (demux, stream);
+    } else if (gst_ts_demux_stream_can_push_partial (demux, stream)) {
+      res = gst_ts_demux_push_partial_data (demux, stream);
     }
   }
 
@@ -2749,6 +3315,12 @@ gst_ts_demux_flush (MpegTSBase * base, gboolean hard)
     /* For pull mode seeks the current segment needs to be preserved */
     demux->rate = 1.0;
     gst_segment_init (&demux->segment, GST_FORMAT_UNDEFINED);
+
+    GST_OBJECT_LOCK (demux);
+    demux->measured_latency = GST_CLOCK_TIME_NONE;
+    GST_OBJECT_UNLOCK (demux);
+    demux->latency_window_start = GST_CLOCK_TIME_NONE;
+    demux->latency_window_max = 0;
   }
 }
 
@@ -2798,6 +3370,7 @@ gst_ts_demux_plugin_init (GstPlugin * plugin)
   GST_DEBUG_CATEGORY_INIT (ts_demux_debug, "tsdemux", 0,
       "MPEG transport stream demuxer");
   init_pes_parser ();
+  init_mpegts_index ();
 
   return gst_element_register (plugin, "tsdemux",
       GST_RANK_PRIMARY, GST_TYPE_TS_DEMUX);
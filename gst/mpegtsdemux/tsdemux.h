@@ -62,8 +62,24 @@ struct _GstTSDemux
   gint requested_program_number; /* Required program number (ignore:-1) */
   guint program_number;
   gboolean emit_statistics;
+  gboolean zero_copy;
+  gboolean low_latency;
+  GstClockTime latency_margin;
+  gboolean build_index;
+  gchar *index_cache_dir;
+
+  /* Highest latency measured between the incoming data and the outgoing
+   * buffers, and latency (without upstream's) reported in the last
+   * LATENCY query. Also protected by the OBJECT_LOCK */
+  GstClockTime measured_latency;
+  GstClockTime reported_latency;
 
   /*< private >*/
+  /* Start (in incoming data time) and highest latency of the current
+   * latency measurement window */
+  GstClockTime latency_window_start;
+  GstClockTime latency_window_max;
+
   MpegTSBaseProgram *program;	/* Current program */
   MpegTSBaseProgram *previous_program; /* Previous program, to deactivate once
 					* the new program becomes active */
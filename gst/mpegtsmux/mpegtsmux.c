@@ -110,11 +110,17 @@ enum
   PROP_PAT_INTERVAL,
   PROP_PMT_INTERVAL,
   PROP_ALIGNMENT,
-  PROP_SI_INTERVAL
+  PROP_SI_INTERVAL,
+  PROP_BITRATE,
+  PROP_PCR_INTERVAL
 };
 
 #define MPEGTSMUX_DEFAULT_ALIGNMENT    -1
 #define MPEGTSMUX_DEFAULT_M2TS         FALSE
+#define MPEGTSMUX_DEFAULT_BITRATE      0
+
+/* Number of packets per output buffer when no alignment is requested */
+#define MPEGTSMUX_CHUNK_PACKETS        64
 
 static GstStaticPadTemplate mpegtsmux_sink_factory =
     GST_STATIC_PAD_TEMPLATE ("sink_%d",
@@ -173,6 +179,7 @@ static void release_buffer_cb (guint8 * data, void *user_data);
 static GstFlowReturn mpegtsmux_collect_packet (MpegTsMux * mux,
     GstBuffer * buf);
 static GstFlowReturn mpegtsmux_push_packets (MpegTsMux * mux, gboolean force);
+static void mpegtsmux_clear_output (MpegTsMux * mux);
 static gboolean new_packet_m2ts (MpegTsMux * mux, GstBuffer * buf,
     gint64 new_pcr);
 
@@ -298,6 +305,18 @@ mpegtsmux_class_init (MpegTsMuxClass * klass)
           "Set the interval (in ticks of the 90kHz clock) for writing out the Service"
           "Information tables", 1, G_MAXUINT, TSMUX_DEFAULT_SI_INTERVAL,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_BITRATE,
+      g_param_spec_uint64 ("bitrate", "Bitrate (in bits per second)",
+          "Set the target bitrate, will insert null packets as padding "
+          "(0 = variable bitrate)", 0, G_MAXUINT64, MPEGTSMUX_DEFAULT_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_PCR_INTERVAL,
+      g_param_spec_uint ("pcr-interval", "PCR interval",
+          "Set the interval (in ticks of the 90kHz clock) for writing PCR",
+          1, G_MAXUINT, TSMUX_DEFAULT_PCR_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -322,13 +341,14 @@ mpegtsmux_init (MpegTsMux * mux)
       GST_DEBUG_FUNCPTR (mpegtsmux_clip_inc_running_time), mux);
 
   mux->adapter = gst_adapter_new ();
-  mux->out_adapter = gst_adapter_new ();
 
   /* properties */
   mux->m2ts_mode = MPEGTSMUX_DEFAULT_M2TS;
   mux->pat_interval = TSMUX_DEFAULT_PAT_INTERVAL;
   mux->pmt_interval = TSMUX_DEFAULT_PMT_INTERVAL;
   mux->si_interval = TSMUX_DEFAULT_SI_INTERVAL;
+  mux->pcr_interval = TSMUX_DEFAULT_PCR_INTERVAL;
+  mux->bitrate = MPEGTSMUX_DEFAULT_BITRATE;
   mux->prog_map = NULL;
   mux->alignment = MPEGTSMUX_DEFAULT_ALIGNMENT;
 
@@ -391,8 +411,7 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
 #endif
   if (mux->adapter)
     gst_adapter_clear (mux->adapter);
-  if (mux->out_adapter)
-    gst_adapter_clear (mux->out_adapter);
+  mpegtsmux_clear_output (mux);
 
   if (mux->tsmux) {
     tsmux_free (mux->tsmux);
@@ -408,7 +427,6 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
     gst_buffer_unref (buf);
 
   gst_event_replace (&mux->force_key_unit_event, NULL);
-  gst_buffer_replace (&mux->out_buffer, NULL);
 
   if (mux->collect) {
     GST_COLLECT_PADS_STREAM_LOCK (mux->collect);
@@ -421,6 +439,8 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
     mux->tsmux = tsmux_new ();
     tsmux_set_write_func (mux->tsmux, new_packet_cb, mux);
     tsmux_set_alloc_func (mux->tsmux, alloc_packet_cb, mux);
+    tsmux_set_pcr_interval (mux->tsmux, mux->pcr_interval);
+    tsmux_set_bitrate (mux->tsmux, mux->bitrate);
   }
 }
 
@@ -435,10 +455,6 @@ mpegtsmux_dispose (GObject * object)
     g_object_unref (mux->adapter);
     mux->adapter = NULL;
   }
-  if (mux->out_adapter) {
-    g_object_unref (mux->out_adapter);
-    mux->out_adapter = NULL;
-  }
   if (mux->collect) {
     gst_object_unref (mux->collect);
     mux->collect = NULL;
@@ -501,6 +517,16 @@ gst_mpegtsmux_set_property (GObject * object, guint prop_id,
       mux->si_interval = g_value_get_uint (value);
       tsmux_set_si_interval (mux->tsmux, mux->si_interval);
       break;
+    case PROP_BITRATE:
+      mux->bitrate = g_value_get_uint64 (value);
+      if (mux->tsmux)
+        tsmux_set_bitrate (mux->tsmux, mux->bitrate);
+      break;
+    case PROP_PCR_INTERVAL:
+      mux->pcr_interval = g_value_get_uint (value);
+      if (mux->tsmux)
+        tsmux_set_pcr_interval (mux->tsmux, mux->pcr_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -532,6 +558,12 @@ gst_mpegtsmux_get_property (GObject * object, guint prop_id,
     case PROP_SI_INTERVAL:
       g_value_set_uint (value, mux->si_interval);
       break;
+    case PROP_BITRATE:
+      g_value_set_uint64 (value, mux->bitrate);
+      break;
+    case PROP_PCR_INTERVAL:
+      g_value_set_uint (value, mux->pcr_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1454,7 +1486,8 @@ new_packet_common_init (MpegTsMux * mux, GstBuffer * buf, guint8 * data,
         hbuf = gst_buffer_new_and_alloc (len);
         gst_buffer_fill (hbuf, 0, data, len);
       } else {
-        hbuf = gst_buffer_copy (buf);
+        /* the packet memory is part of an output chunk */
+        hbuf = gst_buffer_copy_deep (buf);
       }
       GST_LOG_OBJECT (mux,
           "Collecting packet with pid 0x%04x into streamheaders", pid);
@@ -1481,68 +1514,132 @@ new_packet_common_init (MpegTsMux * mux, GstBuffer * buf, guint8 * data,
   }
 }
 
-static GstFlowReturn
-mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
+/* Returns the size of the packets written out, and the number of packets
+ * each output buffer must contain (0 if any) */
+static gint
+mpegtsmux_get_alignment (MpegTsMux * mux, gint * align)
 {
-  GstBufferList *buffer_list;
-  gint align = mux->alignment;
-  gint av, packet_size;
+  *align = mux->alignment;
 
   if (mux->m2ts_mode) {
-    packet_size = M2TS_PACKET_LENGTH;
-    if (align < 0)
-      align = 32;
+    if (*align < 0)
+      *align = 32;
+    return M2TS_PACKET_LENGTH;
   } else {
-    packet_size = NORMAL_TS_PACKET_LENGTH;
-    if (align < 0)
-      align = 0;
+    if (*align < 0)
+      *align = 0;
+    return NORMAL_TS_PACKET_LENGTH;
+  }
+}
+
+static void
+mpegtsmux_clear_output (MpegTsMux * mux)
+{
+  if (mux->out_buffer) {
+    gst_buffer_unmap (mux->out_buffer, &mux->out_map);
+    gst_buffer_unref (mux->out_buffer);
+    mux->out_buffer = NULL;
+  }
+  if (mux->out_list) {
+    gst_buffer_list_unref (mux->out_list);
+    mux->out_list = NULL;
   }
+  if (mux->out_pool) {
+    gst_buffer_pool_set_active (mux->out_pool, FALSE);
+    gst_object_unref (mux->out_pool);
+    mux->out_pool = NULL;
+  }
+  mux->out_chunk_size = 0;
+}
 
-  av = gst_adapter_available (mux->out_adapter);
-  GST_LOG_OBJECT (mux, "align %d, av %d", align, av);
+/* Gets a new chunk from the pool to copy packets into */
+static gboolean
+mpegtsmux_start_chunk (MpegTsMux * mux, guint chunk_size)
+{
+  GstFlowReturn ret;
 
-  if (av == 0)
-    return GST_FLOW_OK;
+  if (G_UNLIKELY (mux->out_chunk_size != chunk_size)) {
+    GstStructure *config;
 
-  /* no alignment, just push all available data */
-  if (align == 0) {
-    buffer_list = gst_adapter_take_buffer_list (mux->out_adapter, av);
-    return gst_pad_push_list (mux->srcpad, buffer_list);
+    if (mux->out_pool) {
+      gst_buffer_pool_set_active (mux->out_pool, FALSE);
+      gst_object_unref (mux->out_pool);
+    }
+
+    GST_DEBUG_OBJECT (mux, "using output buffers of %u bytes", chunk_size);
+    mux->out_pool = gst_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (mux->out_pool);
+    gst_buffer_pool_config_set_params (config, NULL, chunk_size, 0, 0);
+    if (!gst_buffer_pool_set_config (mux->out_pool, config) ||
+        !gst_buffer_pool_set_active (mux->out_pool, TRUE)) {
+      gst_object_unref (mux->out_pool);
+      mux->out_pool = NULL;
+      mux->out_chunk_size = 0;
+      return FALSE;
+    }
+    mux->out_chunk_size = chunk_size;
   }
 
-  align *= packet_size;
+  ret = gst_buffer_pool_acquire_buffer (mux->out_pool, &mux->out_buffer, NULL);
+  if (G_UNLIKELY (ret != GST_FLOW_OK))
+    return FALSE;
 
-  if (!force && align > av)
-    return GST_FLOW_OK;
+  gst_buffer_map (mux->out_buffer, &mux->out_map, GST_MAP_WRITE);
+  mux->out_offset = 0;
 
-  buffer_list = gst_buffer_list_new_sized ((av / align) + 1);
+  return TRUE;
+}
 
-  GST_LOG_OBJECT (mux, "aligning to %d bytes", align);
-  while (align <= av) {
-    gst_buffer_list_add (buffer_list,
-        gst_adapter_take_buffer (mux->out_adapter, align));
-    av -= align;
-  }
+/* Queues the current chunk for output */
+static void
+mpegtsmux_finish_chunk (MpegTsMux * mux)
+{
+  GstBuffer *buf = mux->out_buffer;
+
+  if (!buf)
+    return;
+
+  gst_buffer_unmap (buf, &mux->out_map);
+  gst_buffer_set_size (buf, mux->out_offset);
+  mux->out_buffer = NULL;
+
+  if (!mux->out_list)
+    mux->out_list = gst_buffer_list_new ();
+  gst_buffer_list_add (mux->out_list, buf);
+}
+
+static GstFlowReturn
+mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
+{
+  GstBufferList *buffer_list;
+  gint align, packet_size;
+
+  packet_size = mpegtsmux_get_alignment (mux, &align);
+
+  GST_LOG_OBJECT (mux, "align %d, pending %" G_GSIZE_FORMAT, align,
+      mux->out_buffer ? mux->out_offset : 0);
 
-  if (av > 0 && force) {
-    GstBuffer *buf;
-    guint8 *data;
+  /* no alignment, just push all available data */
+  if (align == 0)
+    mpegtsmux_finish_chunk (mux);
+
+  if (mux->out_buffer && force) {
+    guint8 *data, *end;
     guint32 header;
     gint dummy;
-    GstMapInfo map;
-
-    GST_LOG_OBJECT (mux, "handling %d leftover bytes", av);
-    buf = gst_buffer_new_and_alloc (align);
-    gst_buffer_map (buf, &map, GST_MAP_READ);
-    data = map.data;
 
-    gst_adapter_copy (mux->out_adapter, data, 0, av);
-    gst_adapter_clear (mux->out_adapter);
+    GST_LOG_OBJECT (mux, "handling %" G_GSIZE_FORMAT " leftover bytes",
+        mux->out_offset);
 
-    data += av;
-    header = GST_READ_UINT32_BE (data - packet_size);
+    data = mux->out_map.data + mux->out_offset;
+    end = mux->out_map.data + mux->out_chunk_size;
+    /* the m2ts header of the null packets follows the one of the last
+     * packet, if there is one in this chunk */
+    header = 0;
+    if (packet_size > NORMAL_TS_PACKET_LENGTH && mux->out_offset >= packet_size)
+      header = GST_READ_UINT32_BE (data - packet_size);
 
-    dummy = (map.size - av) / packet_size;
+    dummy = (end - data) / packet_size;
     GST_LOG_OBJECT (mux, "adding %d null packets", dummy);
 
     for (; dummy > 0; dummy--) {
@@ -1566,19 +1663,92 @@ mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
       data += packet_size;
     }
 
-    gst_buffer_unmap (buf, &map);
-    gst_buffer_list_add (buffer_list, buf);
+    mux->out_offset = data - mux->out_map.data;
+    mpegtsmux_finish_chunk (mux);
   }
 
+  if (!mux->out_list)
+    return GST_FLOW_OK;
+
+  buffer_list = mux->out_list;
+  mux->out_list = NULL;
+
   return gst_pad_push_list (mux->srcpad, buffer_list);
 }
 
+/* Makes sure there is an output chunk to write packets into */
+static gboolean
+mpegtsmux_ensure_chunk (MpegTsMux * mux)
+{
+  gint align, packet_size;
+  guint n_packets;
+
+  if (mux->out_buffer)
+    return TRUE;
+
+  packet_size = mpegtsmux_get_alignment (mux, &align);
+  n_packets = align > 0 ? align : MPEGTSMUX_CHUNK_PACKETS;
+
+  return mpegtsmux_start_chunk (mux, n_packets * packet_size);
+}
+
+/* Adds the packet in @buf to the current output chunk. Packets written by
+ * TsMux straight into the chunk (see alloc_packet_cb) are already in place,
+ * the others are copied */
 static GstFlowReturn
 mpegtsmux_collect_packet (MpegTsMux * mux, GstBuffer * buf)
 {
-  GST_LOG_OBJECT (mux, "collecting packet size %" G_GSIZE_FORMAT,
-      gst_buffer_get_size (buf));
-  gst_adapter_push (mux->out_adapter, buf);
+  gint align, packet_size;
+  gboolean delta, header, in_place = FALSE;
+  GstMapInfo map;
+  gsize size;
+
+  size = gst_buffer_get_size (buf);
+  GST_LOG_OBJECT (mux, "collecting packet size %" G_GSIZE_FORMAT, size);
+
+  packet_size = mpegtsmux_get_alignment (mux, &align);
+  delta = GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+  header = GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_HEADER);
+
+  if (mux->out_buffer && gst_buffer_map (buf, &map, GST_MAP_READ)) {
+    in_place = (map.data == mux->out_map.data + mux->out_offset);
+    gst_buffer_unmap (buf, &map);
+  }
+
+  /* Without alignment, key units and headers start a new buffer so that
+   * the flags of the output buffers stay meaningful. A packet written at
+   * the end of the finished chunk is still readable from there, the chunk
+   * is only pushed later, and gets copied into the new one */
+  if (mux->out_buffer && mux->out_offset > 0 && align == 0 && (!delta ||
+          header != GST_BUFFER_FLAG_IS_SET (mux->out_buffer,
+              GST_BUFFER_FLAG_HEADER))) {
+    mpegtsmux_finish_chunk (mux);
+    in_place = FALSE;
+  }
+
+  if (!mpegtsmux_ensure_chunk (mux)) {
+    GST_ELEMENT_ERROR (mux, RESOURCE, FAILED, (NULL),
+        ("Failed to allocate output buffer"));
+    gst_buffer_unref (buf);
+    return GST_FLOW_ERROR;
+  }
+
+  if (mux->out_offset == 0) {
+    GST_BUFFER_PTS (mux->out_buffer) = GST_BUFFER_PTS (buf);
+    if (delta)
+      GST_BUFFER_FLAG_SET (mux->out_buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    if (header)
+      GST_BUFFER_FLAG_SET (mux->out_buffer, GST_BUFFER_FLAG_HEADER);
+  }
+
+  g_assert (mux->out_offset + size <= mux->out_map.size);
+  if (!in_place)
+    gst_buffer_extract (buf, 0, mux->out_map.data + mux->out_offset, size);
+  mux->out_offset += size;
+  gst_buffer_unref (buf);
+
+  if (mux->out_offset + packet_size > mux->out_chunk_size)
+    mpegtsmux_finish_chunk (mux);
 
   return GST_FLOW_OK;
 }
@@ -1714,7 +1884,8 @@ new_packet_cb (GstBuffer * buf, void *user_data, gint64 new_pcr)
     gst_buffer_set_size (buf, NORMAL_TS_PACKET_LENGTH + offset);
   }
 
-  gst_buffer_map (buf, &map, GST_MAP_READWRITE);
+  /* Non M2TS packets are only read from here on */
+  gst_buffer_map (buf, &map, offset ? GST_MAP_READWRITE : GST_MAP_READ);
 
   if (offset) {
     /* there should be a better way to do this */
@@ -1744,8 +1915,24 @@ alloc_packet_cb (GstBuffer ** _buf, void *user_data)
   GstBuffer *buf;
   gint offset = 0;
 
-  if (mux->m2ts_mode == TRUE)
-    offset = 4;
+  /* Let TsMux write the packet straight into the current output chunk,
+   * new_packet_cb is called before the next packet is allocated. The M2TS
+   * code holds on to packets until the next PCR though, and needs room for
+   * the 4 bytes timestamp header */
+  if (mux->m2ts_mode == FALSE) {
+    if (G_LIKELY (mpegtsmux_ensure_chunk (mux))) {
+      g_assert (mux->out_offset + NORMAL_TS_PACKET_LENGTH <=
+          mux->out_map.size);
+      *_buf = gst_buffer_new_wrapped_full (0,
+          mux->out_map.data + mux->out_offset, NORMAL_TS_PACKET_LENGTH, 0,
+          NORMAL_TS_PACKET_LENGTH, NULL, NULL);
+    } else {
+      *_buf = gst_buffer_new_and_alloc (NORMAL_TS_PACKET_LENGTH);
+    }
+    return;
+  }
+
+  offset = 4;
 
   buf = gst_buffer_new_and_alloc (NORMAL_TS_PACKET_LENGTH + offset);
   gst_buffer_set_size (buf, NORMAL_TS_PACKET_LENGTH);
@@ -139,6 +139,8 @@ struct MpegTsMux {
   guint pmt_interval;
   gint alignment;
   guint si_interval;
+  guint pcr_interval;
+  guint64 bitrate;
 
   /* state */
   gboolean first;
@@ -160,9 +162,15 @@ struct MpegTsMux {
   gint64 pcr_rate_den;
   GstAdapter *adapter;
 
-  /* output buffer aggregation */
-  GstAdapter *out_adapter;
+  /* output buffer aggregation: packets are written into out_buffer,
+   * acquired from out_pool, and full chunks are queued in out_list until
+   * pushed */
+  GstBufferPool *out_pool;
+  guint out_chunk_size;
   GstBuffer *out_buffer;
+  GstMapInfo out_map;
+  gsize out_offset;
+  GstBufferList *out_list;
 
 #if 0
   /* SPN/PTS index handling */
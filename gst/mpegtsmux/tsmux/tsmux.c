@@ -106,8 +106,8 @@
  * 1/8 second atm */
 #define TSMUX_PCR_OFFSET (TSMUX_CLOCK_FREQ / 8)
 
-/* Times per second to write PCR */
-#define TSMUX_DEFAULT_PCR_FREQ (25)
+/* PID of the null packets used for stuffing */
+#define TSMUX_NULL_PACKET_PID 0x1FFF
 
 /* Base for all written PCR and DTS/PTS,
  * so we have some slack to go backwards */
@@ -115,10 +115,19 @@
 
 static gboolean tsmux_write_pat (TsMux * mux);
 static gboolean tsmux_write_pmt (TsMux * mux, TsMuxProgram * program);
+static void
+tsmux_section_clear_packets (TsMuxSection * section)
+{
+  g_free (section->packets);
+  section->packets = NULL;
+  section->n_packets = 0;
+}
+
 static void
 tsmux_section_free (TsMuxSection * section)
 {
   gst_mpegts_section_unref (section->section);
+  tsmux_section_clear_packets (section);
   g_slice_free (TsMuxSection, section);
 }
 
@@ -150,6 +159,9 @@ tsmux_new (void)
   mux->last_si_ts = G_MININT64;
   mux->si_interval = TSMUX_DEFAULT_SI_INTERVAL;
 
+  mux->pcr_interval = TSMUX_DEFAULT_PCR_INTERVAL;
+  mux->first_pcr = -1;
+
   mux->si_sections = g_hash_table_new_full (g_direct_hash, g_direct_equal,
       NULL, (GDestroyNotify) tsmux_section_free);
 
@@ -260,6 +272,73 @@ tsmux_get_si_interval (TsMux * mux)
   return mux->si_interval;
 }
 
+/**
+ * tsmux_set_pcr_interval:
+ * @mux: a #TsMux
+ * @freq: a new PCR interval
+ *
+ * Set the interval (in cycles of the 90kHz clock) for writing out the PCR.
+ */
+void
+tsmux_set_pcr_interval (TsMux * mux, guint freq)
+{
+  g_return_if_fail (mux != NULL);
+
+  mux->pcr_interval = freq;
+}
+
+/**
+ * tsmux_get_pcr_interval:
+ * @mux: a #TsMux
+ *
+ * Get the configured PCR interval. See also tsmux_set_pcr_interval().
+ *
+ * Returns: the configured PCR interval
+ */
+guint
+tsmux_get_pcr_interval (TsMux * mux)
+{
+  g_return_val_if_fail (mux != NULL, 0);
+
+  return mux->pcr_interval;
+}
+
+/**
+ * tsmux_set_bitrate:
+ * @mux: a #TsMux
+ * @bitrate: the output bitrate in bits per second, or 0
+ *
+ * Set a constant bitrate for the transport stream. Packets are then
+ * scheduled on a clock derived from the amount of data written, gaps
+ * are filled with null packets and the PCR is computed from the byte
+ * position of the packet it is written into.
+ *
+ * A @bitrate of 0 (the default) produces a variable bitrate stream.
+ */
+void
+tsmux_set_bitrate (TsMux * mux, guint64 bitrate)
+{
+  g_return_if_fail (mux != NULL);
+
+  mux->bitrate = bitrate;
+}
+
+/**
+ * tsmux_get_bitrate:
+ * @mux: a #TsMux
+ *
+ * Get the configured bitrate. See also tsmux_set_bitrate().
+ *
+ * Returns: the configured bitrate
+ */
+guint64
+tsmux_get_bitrate (TsMux * mux)
+{
+  g_return_val_if_fail (mux != NULL, 0);
+
+  return mux->bitrate;
+}
+
 /**
  * tsmux_add_mpegts_si_section:
  * @mux: a #TsMux
@@ -311,6 +390,7 @@ tsmux_free (TsMux * mux)
   /* Free PAT section */
   if (mux->pat.section)
     gst_mpegts_section_unref (mux->pat.section);
+  tsmux_section_clear_packets (&mux->pat);
 
   /* Free all programs */
   for (cur = mux->programs; cur; cur = cur->next) {
@@ -578,13 +658,17 @@ tsmux_get_buffer (TsMux * mux, GstBuffer ** buf)
   if (!*buf)
     return FALSE;
 
+  /* the packet is written in place, the buffer must be ours */
   g_assert (gst_buffer_get_size (*buf) == TSMUX_PACKET_LENGTH);
+  g_assert (gst_buffer_is_writable (*buf));
   return TRUE;
 }
 
 static gboolean
 tsmux_packet_out (TsMux * mux, GstBuffer * buf, gint64 pcr)
 {
+  mux->n_bytes += TSMUX_PACKET_LENGTH;
+
   if (G_UNLIKELY (mux->write_func == NULL)) {
     if (buf)
       gst_buffer_unref (buf);
@@ -841,24 +925,16 @@ tsmux_write_ts_header (guint8 * buf, TsMuxPacketInfo * pi,
   return TRUE;
 }
 
+/* Splits @section into TS packets, stored in section->packets */
 static gboolean
-tsmux_section_write_packet (GstMpegtsSectionType * type,
-    TsMuxSection * section, TsMux * mux)
+tsmux_section_packetize (TsMuxSection * section)
 {
-  GstBuffer *section_buffer;
-  GstBuffer *packet_buffer = NULL;
-  GstMemory *mem;
-  guint8 *packet;
-  guint8 *data;
+  guint8 *data, *packet;
   gsize data_size = 0;
   gsize payload_written;
   guint len = 0, offset = 0, payload_len = 0;
-
-  g_return_val_if_fail (section != NULL, FALSE);
-  g_return_val_if_fail (mux != NULL, FALSE);
-
-  /* Mark the start of new PES unit */
-  section->pi.packet_start_unit_indicator = TRUE;
+  guint8 packet_count;
+  guint n_packets;
 
   data = gst_mpegts_section_packetize (section->section, &data_size);
 
@@ -867,79 +943,96 @@ tsmux_section_write_packet (GstMpegtsSectionType * type,
     return FALSE;
   }
 
-  /* Mark payload data size */
-  section->pi.stream_avail = data_size;
-  payload_written = 0;
+  /* One byte for the pointer field in the first packet */
+  n_packets = (data_size + 1 + TSMUX_PAYLOAD_LENGTH - 1) / TSMUX_PAYLOAD_LENGTH;
+  section->packets = g_malloc (n_packets * TSMUX_PACKET_LENGTH);
+  section->n_packets = 0;
 
-  /* Wrap section data in a buffer without free function.
-     The data will be freed when the GstMpegtsSection is destroyed. */
-  section_buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
-      data, data_size, 0, data_size, NULL, NULL);
+  /* The continuity counter is set when writing out the packets */
+  packet_count = section->pi.packet_count;
 
-  TS_DEBUG ("Section buffer with size %" G_GSIZE_FORMAT " created",
-      gst_buffer_get_size (section_buffer));
+  /* Mark the start of new PES unit */
+  section->pi.packet_start_unit_indicator = TRUE;
+  /* Mark payload data size, plus the pointer byte */
+  section->pi.stream_avail = data_size + 1;
+  payload_written = 0;
 
   while (section->pi.stream_avail > 0) {
+    g_assert (section->n_packets < n_packets);
+    packet = section->packets + section->n_packets * TSMUX_PACKET_LENGTH;
 
-    packet = g_malloc (TSMUX_PACKET_LENGTH);
+    if (!tsmux_write_ts_header (packet, &section->pi, &len, &offset))
+      goto fail;
 
     if (section->pi.packet_start_unit_indicator) {
-      /* Wee need room for a pointer byte */
-      section->pi.stream_avail++;
-
-      if (!tsmux_write_ts_header (packet, &section->pi, &len, &offset))
-        goto fail;
-
       /* Write the pointer byte */
       packet[offset++] = 0x00;
       payload_len = len - 1;
-
     } else {
-      if (!tsmux_write_ts_header (packet, &section->pi, &len, &offset))
-        goto fail;
       payload_len = len;
     }
 
-    /* Wrap the TS header and adaption field in a GstMemory */
-    mem = gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
-        packet, TSMUX_PACKET_LENGTH, 0, offset, packet, g_free);
+    TS_DEBUG ("Creating packet at offset %" G_GSIZE_FORMAT
+        " with length %u", payload_written, payload_len);
 
-    TS_DEBUG ("Creating packet buffer at offset "
-        "%" G_GSIZE_FORMAT " with length %u", payload_written, payload_len);
+    memcpy (packet + offset, data + payload_written, payload_len);
 
-    packet_buffer = gst_buffer_copy_region (section_buffer, GST_BUFFER_COPY_ALL,
-        payload_written, payload_len);
-
-    /* Prepend the header to the section data */
-    gst_buffer_prepend_memory (packet_buffer, mem);
-
-    TS_DEBUG ("Writing %d bytes to section. %d bytes remaining",
-        len, section->pi.stream_avail - len);
-
-    /* Push the packet without PCR */
-    if (G_UNLIKELY (!tsmux_packet_out (mux, packet_buffer, -1))) {
-      /* Buffer given away */
-      packet_buffer = NULL;
-      goto fail;
-    }
-
-    packet_buffer = NULL;
+    section->n_packets++;
     section->pi.stream_avail -= len;
     payload_written += payload_len;
     section->pi.packet_start_unit_indicator = FALSE;
   }
 
-  gst_buffer_unref (section_buffer);
+  section->pi.packet_count = packet_count;
+
+  TS_DEBUG ("Section with size %" G_GSIZE_FORMAT " split in %u packets",
+      data_size, section->n_packets);
 
   return TRUE;
 
 fail:
-  g_free (packet);
-  if (section_buffer)
-    gst_buffer_unref (section_buffer);
+  section->pi.packet_count = packet_count;
+  tsmux_section_clear_packets (section);
   return FALSE;
 }
 
+static gboolean
+tsmux_section_write_packet (GstMpegtsSectionType * type,
+    TsMuxSection * section, TsMux * mux)
+{
+  GstBuffer *packet_buffer;
+  GstMapInfo map;
+  guint i;
+
+  g_return_val_if_fail (section != NULL, FALSE);
+  g_return_val_if_fail (mux != NULL, FALSE);
+
+  if (!section->packets && !tsmux_section_packetize (section))
+    return FALSE;
+
+  for (i = 0; i < section->n_packets; i++) {
+    if (!tsmux_get_buffer (mux, &packet_buffer))
+      return FALSE;
+
+    if (!gst_buffer_map (packet_buffer, &map, GST_MAP_WRITE)) {
+      gst_buffer_unref (packet_buffer);
+      return FALSE;
+    }
+    memcpy (map.data, section->packets + i * TSMUX_PACKET_LENGTH,
+        TSMUX_PACKET_LENGTH);
+    /* Update the continuity counter, all packets have a payload */
+    map.data[3] = (map.data[3] & 0xf0) | (section->pi.packet_count & 0x0f);
+    section->pi.packet_count++;
+    gst_buffer_unmap (packet_buffer, &map);
+
+    /* Push the packet without PCR */
+    if (G_UNLIKELY (!tsmux_packet_out (mux, packet_buffer, -1)))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
 static gboolean
 tsmux_write_si (TsMux * mux)
 {
@@ -952,6 +1045,129 @@ tsmux_write_si (TsMux * mux)
 
 }
 
+/* Returns the PCR of the next packet in constant bitrate mode, derived
+ * from the number of bytes written out so far */
+static gint64
+tsmux_get_byte_pcr (TsMux * mux)
+{
+  return mux->first_pcr + gst_util_uint64_scale (mux->n_bytes * 8,
+      TSMUX_SYS_CLOCK_FREQ, mux->bitrate);
+}
+
+static gboolean
+tsmux_write_null_packet (TsMux * mux)
+{
+  GstBuffer *buf = NULL;
+  GstMapInfo map;
+
+  if (!tsmux_get_buffer (mux, &buf))
+    return FALSE;
+
+  if (!gst_buffer_map (buf, &map, GST_MAP_WRITE)) {
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+  map.data[0] = TSMUX_SYNC_BYTE;
+  GST_WRITE_UINT16_BE (map.data + 1, TSMUX_NULL_PACKET_PID);
+  /* payload only, continuity counter undefined */
+  map.data[3] = 0x10;
+  memset (map.data + TSMUX_HEADER_LENGTH, 0xff, TSMUX_PAYLOAD_LENGTH);
+  gst_buffer_unmap (buf, &map);
+
+  return tsmux_packet_out (mux, buf, -1);
+}
+
+/* Writes a packet only carrying the PCR of @stream, without payload */
+static gboolean
+tsmux_write_pcr_packet (TsMux * mux, TsMuxStream * stream, gint64 pcr)
+{
+  TsMuxPacketInfo pi = stream->pi;
+  GstBuffer *buf = NULL;
+  GstMapInfo map;
+  guint payload_len, payload_offs;
+
+  pi.packet_start_unit_indicator = FALSE;
+  pi.flags = TSMUX_PACKET_FLAG_ADAPTATION | TSMUX_PACKET_FLAG_WRITE_PCR;
+  pi.pcr = pcr;
+  pi.stream_avail = 0;
+  pi.private_data_len = 0;
+
+  if (!tsmux_get_buffer (mux, &buf))
+    return FALSE;
+
+  if (!gst_buffer_map (buf, &map, GST_MAP_WRITE)) {
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+  if (!tsmux_write_ts_header (map.data, &pi, &payload_len, &payload_offs)) {
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+  gst_buffer_unmap (buf, &map);
+
+  stream->last_pcr = pcr;
+
+  return tsmux_packet_out (mux, buf, pcr);
+}
+
+/* In constant bitrate mode, fills the gap until the time data of @stream
+ * is scheduled for with null packets, and PCR packets for the programs
+ * whose PCR is due */
+static gboolean
+tsmux_pad_stream (TsMux * mux, TsMuxStream * stream)
+{
+  gint64 ts, send_pcr, cur_pcr;
+  gboolean is_pcr;
+  GList *cur;
+
+  ts = stream->last_dts != G_MININT64 ? stream->last_dts : stream->last_pts;
+  if (ts == G_MININT64)
+    return TRUE;
+
+  /* Data is sent out a fixed delay before its decoding time, which bounds
+   * the amount of data buffered in the decoder */
+  send_pcr = (ts + CLOCK_BASE - TSMUX_PCR_OFFSET) *
+      (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
+
+  if (G_UNLIKELY (mux->first_pcr == -1)) {
+    mux->first_pcr = send_pcr;
+    mux->n_bytes = 0;
+  }
+
+  cur_pcr = tsmux_get_byte_pcr (mux);
+
+  if (cur_pcr > (ts + CLOCK_BASE) * (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ)) {
+    TS_DEBUG ("Stream 0x%04x is late by %" G_GINT64_FORMAT " ticks, bitrate "
+        "too low", stream->pi.pid, cur_pcr / 300 - (ts + CLOCK_BASE));
+  }
+
+  while (cur_pcr < send_pcr) {
+    is_pcr = FALSE;
+
+    for (cur = mux->programs; cur; cur = cur->next) {
+      TsMuxProgram *program = (TsMuxProgram *) cur->data;
+      TsMuxStream *pcr_stream = program->pcr_stream;
+
+      if (pcr_stream && (pcr_stream->last_pcr == -1 ||
+              cur_pcr - pcr_stream->last_pcr >=
+              mux->pcr_interval * (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ))) {
+        if (!tsmux_write_pcr_packet (mux, pcr_stream, cur_pcr))
+          return FALSE;
+        is_pcr = TRUE;
+        break;
+      }
+    }
+
+    if (!is_pcr && !tsmux_write_null_packet (mux))
+      return FALSE;
+
+    cur_pcr = tsmux_get_byte_pcr (mux);
+  }
+
+  return TRUE;
+}
+
 /**
  * tsmux_write_stream_packet:
  * @mux: a #TsMux
@@ -974,11 +1190,15 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
   g_return_val_if_fail (mux != NULL, FALSE);
   g_return_val_if_fail (stream != NULL, FALSE);
 
+  if (mux->bitrate && !tsmux_pad_stream (mux, stream))
+    return FALSE;
+
   if (tsmux_stream_is_pcr (stream)) {
     gint64 cur_pts = tsmux_stream_get_pts (stream);
     gboolean write_pat;
     gboolean write_si;
     GList *cur;
+    guint n;
 
     cur_pcr = 0;
     if (cur_pts != G_MININT64) {
@@ -994,10 +1214,14 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
           (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
     }
 
+    /* The PCR follows the byte position at constant bitrate */
+    if (mux->bitrate && mux->first_pcr != -1)
+      cur_pcr = tsmux_get_byte_pcr (mux);
+
     /* Need to decide whether to write a new PCR in this packet */
     if (stream->last_pcr == -1 ||
         (cur_pcr - stream->last_pcr >
-            (TSMUX_SYS_CLOCK_FREQ / TSMUX_DEFAULT_PCR_FREQ))) {
+            mux->pcr_interval * (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ))) {
 
       stream->pi.flags |=
           TSMUX_PACKET_FLAG_ADAPTATION | TSMUX_PACKET_FLAG_WRITE_PCR;
@@ -1036,7 +1260,7 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
     }
 
     /* check if we need to rewrite any of the current pmts */
-    for (cur = mux->programs; cur; cur = cur->next) {
+    for (cur = mux->programs, n = 0; cur; cur = cur->next, n++) {
       TsMuxProgram *program = (TsMuxProgram *) cur->data;
       gboolean write_pmt;
 
@@ -1048,7 +1272,13 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
         write_pmt = FALSE;
 
       if (write_pmt) {
-        program->last_pmt_ts = cur_pts;
+        /* Spread the PMTs of the programs over their interval instead of
+         * writing them all in a row every time */
+        if (program->last_pmt_ts == G_MININT64 && cur_pts != G_MININT64)
+          program->last_pmt_ts = cur_pts -
+              (gint64) program->pmt_interval * n / mux->nb_programs;
+        else
+          program->last_pmt_ts = cur_pts;
         if (!tsmux_write_pmt (mux, program))
           return FALSE;
       }
@@ -1065,11 +1295,21 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
   }
   pi->stream_avail = tsmux_stream_bytes_avail (stream);
 
+  /* Tables might have been written before this packet */
+  if (mux->bitrate && cur_pcr != -1 && mux->first_pcr != -1) {
+    cur_pcr = tsmux_get_byte_pcr (mux);
+    stream->pi.pcr = cur_pcr;
+    stream->last_pcr = cur_pcr;
+  }
+
   /* obtain buffer */
   if (!tsmux_get_buffer (mux, &buf))
     return FALSE;
 
-  gst_buffer_map (buf, &map, GST_MAP_READ);
+  if (!gst_buffer_map (buf, &map, GST_MAP_WRITE)) {
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
 
   if (!tsmux_write_ts_header (map.data, pi, &payload_len, &payload_offs))
     goto fail;
@@ -1091,8 +1331,7 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
 fail:
   {
     gst_buffer_unmap (buf, &map);
-    if (buf)
-      gst_buffer_unref (buf);
+    gst_buffer_unref (buf);
     return FALSE;
   }
 }
@@ -1112,6 +1351,7 @@ tsmux_program_free (TsMuxProgram * program)
   /* Free PMT section */
   if (program->pmt.section)
     gst_mpegts_section_unref (program->pmt.section);
+  tsmux_section_clear_packets (&program->pmt);
 
   g_array_free (program->streams, TRUE);
   g_slice_free (TsMuxProgram, program);
@@ -1148,6 +1388,7 @@ tsmux_write_pat (TsMux * mux)
 
     if (mux->pat.section)
       gst_mpegts_section_unref (mux->pat.section);
+    tsmux_section_clear_packets (&mux->pat);
 
     mux->pat.section = gst_mpegts_section_from_pat (pat, mux->transport_id);
 
@@ -1229,6 +1470,7 @@ tsmux_write_pmt (TsMux * mux, TsMuxProgram * program)
 
     if (program->pmt.section)
       gst_mpegts_section_unref (program->pmt.section);
+    tsmux_section_clear_packets (&program->pmt);
 
     program->pmt.section = gst_mpegts_section_from_pmt (pmt, program->pmt_pid);
     program->pmt.section->version_number = program->pmt_version++;
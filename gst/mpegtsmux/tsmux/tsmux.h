@@ -106,6 +106,11 @@ typedef void (*TsMuxAllocFunc) (GstBuffer ** buf, void *user_data);
 struct TsMuxSection {
   TsMuxPacketInfo pi;
   GstMpegtsSection *section;
+
+  /* TS packets of the section, built once and written out again until the
+   * section changes (only the continuity counter is updated) */
+  guint8 *packets;
+  guint n_packets;
 };
 
 /* Information for the streams associated with one program */
@@ -169,6 +174,16 @@ struct TsMux {
   /* last time SIT written in MPEG PTS clock time */
   gint64   last_si_ts;
 
+  /* interval between PCRs in MPEG PTS clock time */
+  guint    pcr_interval;
+
+  /* constant output bitrate in bits per second (0 = variable) */
+  guint64  bitrate;
+  /* number of bytes written out so far, and PCR of the first one, used
+   * to derive the PCR from the byte position in constant bitrate mode */
+  guint64  n_bytes;
+  gint64   first_pcr;
+
   /* callback to write finished packet */
   TsMuxWriteFunc write_func;
   void *write_func_data;
@@ -200,6 +215,10 @@ guint 		tsmux_get_pmt_interval   	(TsMuxProgram *program);
 /* SI table management */
 void            tsmux_set_si_interval           (TsMux *mux, guint interval);
 guint           tsmux_get_si_interval           (TsMux *mux);
+void            tsmux_set_pcr_interval          (TsMux *mux, guint interval);
+guint           tsmux_get_pcr_interval          (TsMux *mux);
+void            tsmux_set_bitrate               (TsMux *mux, guint64 bitrate);
+guint64         tsmux_get_bitrate               (TsMux *mux);
 gboolean        tsmux_add_mpegts_si_section     (TsMux * mux, GstMpegtsSection * section);
 
 /* stream management */
@@ -0,0 +1,118 @@
+/*
+ * gopindex.c : picture type index of the GOPs seen by a video parser
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gopindex.h"
+
+void
+gop_index_init (GopIndex * index)
+{
+  index->timestamp = GST_CLOCK_TIME_NONE;
+  index->picture_types = NULL;
+  index->offsets = NULL;
+}
+
+/* frees the pictures of the current GOP */
+void
+gop_index_clear (GopIndex * index)
+{
+  if (index->picture_types)
+    g_string_free (index->picture_types, TRUE);
+  if (index->offsets)
+    g_array_free (index->offsets, TRUE);
+  gop_index_init (index);
+}
+
+/* posts the pictures of the current GOP, if any */
+void
+gop_index_flush (GopIndex * index, GstElement * parse)
+{
+  GstStructure *s;
+  GValue offsets = G_VALUE_INIT;
+  GValue v = G_VALUE_INIT;
+  guint i;
+
+  if (index->offsets == NULL || index->offsets->len == 0)
+    return;
+
+  g_value_init (&offsets, GST_TYPE_ARRAY);
+  g_value_init (&v, G_TYPE_UINT64);
+  for (i = 0; i < index->offsets->len; i++) {
+    g_value_set_uint64 (&v, g_array_index (index->offsets, guint64, i));
+    gst_value_array_append_value (&offsets, &v);
+  }
+  g_value_unset (&v);
+
+  GST_LOG_OBJECT (parse, "GOP at %" GST_TIME_FORMAT ": %s",
+      GST_TIME_ARGS (index->timestamp), index->picture_types->str);
+
+  s = gst_structure_new ("gop-index",
+      "timestamp", G_TYPE_UINT64, index->timestamp,
+      "picture-types", G_TYPE_STRING, index->picture_types->str, NULL);
+  gst_structure_take_value (s, "offsets", &offsets);
+
+  gst_element_post_message (parse,
+      gst_message_new_element (GST_OBJECT_CAST (parse), s));
+
+  index->timestamp = GST_CLOCK_TIME_NONE;
+  g_string_truncate (index->picture_types, 0);
+  g_array_set_size (index->offsets, 0);
+}
+
+void
+gop_index_add_picture (GopIndex * index, GstElement * parse,
+    gchar picture_type, guint64 offset, GstClockTime timestamp)
+{
+  if (index->offsets == NULL) {
+    index->picture_types = g_string_sized_new (64);
+    index->offsets = g_array_sized_new (FALSE, FALSE, sizeof (guint64), 64);
+  }
+
+  if (picture_type == 'I')
+    gop_index_flush (index, parse);
+
+  if (index->offsets->len == 0)
+    index->timestamp = timestamp;
+
+  g_string_append_c (index->picture_types, picture_type);
+  g_array_append_val (index->offsets, offset);
+}
+
+GstPadProbeReturn
+gop_index_src_event_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer index)
+{
+  GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_EOS:
+      gop_index_flush (index, GST_PAD_PARENT (pad));
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      gop_index_clear (index);
+      break;
+    default:
+      break;
+  }
+
+  return GST_PAD_PROBE_OK;
+}
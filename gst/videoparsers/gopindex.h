@@ -0,0 +1,60 @@
+/*
+ * gopindex.h : picture type index of the GOPs seen by a video parser
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GOP_INDEX_H__
+#define __GOP_INDEX_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* GopIndex: pictures of the current GOP, posted as a "gop-index" element
+ * message once the next intra picture or the end of the stream is reached.
+ * gop_index_src_event_probe must be installed on the source pad of the
+ * parser to post the last GOP before EOS, and to drop the pictures of the
+ * current GOP on flushes.
+ *
+ * The message structure has the fields:
+ *   "timestamp" G_TYPE_UINT64: timestamp of the first picture of the GOP
+ *   "picture-types" G_TYPE_STRING: one character per picture in stream
+ *     order, 'I', 'P', 'B', or 'S' for MPEG-4 sprite and VC-1 skipped
+ *     pictures
+ *   "offsets" GST_TYPE_ARRAY of G_TYPE_UINT64: input byte offset of each
+ *     picture
+ */
+typedef struct
+{
+  GstClockTime timestamp;
+  GString *picture_types;
+  GArray *offsets;
+} GopIndex;
+
+G_GNUC_INTERNAL void gop_index_init (GopIndex * index);
+G_GNUC_INTERNAL void gop_index_clear (GopIndex * index);
+
+G_GNUC_INTERNAL void gop_index_add_picture (GopIndex * index,
+    GstElement * parse, gchar picture_type, guint64 offset,
+    GstClockTime timestamp);
+G_GNUC_INTERNAL void gop_index_flush (GopIndex * index, GstElement * parse);
+
+G_GNUC_INTERNAL GstPadProbeReturn gop_index_src_event_probe (GstPad * pad,
+    GstPadProbeInfo * info, gpointer index);
+
+G_END_DECLS
+#endif /* __GOP_INDEX_H__ */
@@ -30,6 +30,7 @@
 #include <gst/pbutils/pbutils.h>
 #include <gst/video/video.h>
 #include "gsth264parse.h"
+#include "paramsets.h"
 
 #include <string.h>
 
@@ -183,6 +184,7 @@ gst_h264_parse_reset_frame (GstH264Parse * h264parse)
 
   /* done parsing; reset state */
   h264parse->current_off = -1;
+  h264parse->scan_off = 0;
 
   h264parse->picture_start = FALSE;
   h264parse->update_caps = FALSE;
@@ -192,6 +194,7 @@ gst_h264_parse_reset_frame (GstH264Parse * h264parse)
   h264parse->header = FALSE;
   h264parse->frame_start = FALSE;
   gst_adapter_clear (h264parse->frame_out);
+  h264parse->frame_out_mems = 0;
 }
 
 static void
@@ -410,31 +413,59 @@ gst_h264_parse_negotiate (GstH264Parse * h264parse, gint in_format,
       align == GST_H264_PARSE_ALIGN_AU;
 }
 
+/* wraps @size bytes of @buffer starting at @offset in a nal of @format,
+ * without copying them. When @buffer already has the right prefix before
+ * @offset, as when the input and output formats are the same, the nal is
+ * a single region of @buffer. Otherwise the prefix goes in a separate
+ * memory and the payload is shared with @buffer */
 static GstBuffer *
-gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format, guint8 * data,
-    guint size)
+gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format,
+    GstBuffer * buffer, guint offset, guint size)
 {
+  static const guint8 start_code[4] = { 0x00, 0x00, 0x00, 0x01 };
+  guint8 prefix[4];
+  guint prefix_size;
   GstBuffer *buf;
+  GstMemory *mem;
   guint nl = h264parse->nal_length_size;
-  guint32 tmp;
 
   GST_DEBUG_OBJECT (h264parse, "nal length %d", size);
 
-  buf = gst_buffer_new_allocate (NULL, 4 + size, NULL);
   if (format == GST_H264_PARSE_FORMAT_AVC
       || format == GST_H264_PARSE_FORMAT_AVC3) {
-    tmp = GUINT32_TO_BE (size << (32 - 8 * nl));
+    guint32 tmp = GUINT32_TO_BE (size << (32 - 8 * nl));
+
+    memcpy (prefix, &tmp, nl);
+    prefix_size = nl;
   } else {
-    /* HACK: nl should always be 4 here, otherwise this won't work. 
-     * There are legit cases where nl in avc stream is 2, but byte-stream
+    /* There are legit cases where nl in avc stream is 2, but byte-stream
      * SC is still always 4 bytes. */
-    nl = 4;
-    tmp = GUINT32_TO_BE (1);
+    memcpy (prefix, start_code, sizeof (start_code));
+    prefix_size = sizeof (start_code);
   }
 
-  gst_buffer_fill (buf, 0, &tmp, sizeof (guint32));
-  gst_buffer_fill (buf, nl, data, size);
-  gst_buffer_set_size (buf, size + nl);
+  if (offset >= prefix_size && gst_buffer_memcmp (buffer,
+          offset - prefix_size, prefix, prefix_size) == 0)
+    return gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY,
+        offset - prefix_size, size + prefix_size);
+
+  if (prefix_size == sizeof (start_code) &&
+      memcmp (prefix, start_code, prefix_size) == 0) {
+    /* shared by all the byte-stream nals */
+    mem = gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+        (gpointer) start_code, sizeof (start_code), 0, sizeof (start_code),
+        NULL, NULL);
+  } else {
+    GstMapInfo map;
+
+    mem = gst_allocator_alloc (NULL, prefix_size, NULL);
+    gst_memory_map (mem, &map, GST_MAP_WRITE);
+    memcpy (map.data, prefix, prefix_size);
+    gst_memory_unmap (mem, &map);
+  }
+
+  buf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY, offset, size);
+  gst_buffer_prepend_memory (buf, mem);
 
   return buf;
 }
@@ -473,6 +504,47 @@ gst_h264_parser_store_nal (GstH264Parse * h264parse, guint id,
     gst_buffer_unref (store[id]);
 
   store[id] = buf;
+
+  if (naltype == GST_H264_NAL_PPS)
+    h264parse->pps_nals_stale[id] = FALSE;
+}
+
+/* returns the id of @nalu if it is a SPS or PPS identical to the one
+ * stored with the same id, or -1. Only the id is read from @nalu */
+static gint
+gst_h264_parse_find_stored_nal (GstH264Parse * h264parse,
+    GstH264NalUnitType naltype, GstH264NalUnit * nalu)
+{
+  guint8 data[16];
+  GstBitReader br;
+  GstBuffer *stored;
+  guint id;
+
+  gst_bit_reader_init (&br, data,
+      param_sets_unescape_payload (nalu->data + nalu->offset +
+          nalu->header_bytes, nalu->size - nalu->header_bytes, data,
+          sizeof (data)));
+
+  if (naltype == GST_H264_NAL_SPS) {
+    /* seq_parameter_set_id follows profile_idc, the constraint flags and
+     * level_idc */
+    if (!gst_bit_reader_skip (&br, 24) || !param_sets_read_ue (&br, &id)
+        || id >= GST_H264_MAX_SPS_COUNT)
+      return -1;
+    stored = h264parse->sps_nals[id];
+  } else if (naltype == GST_H264_NAL_PPS) {
+    if (!param_sets_read_ue (&br, &id) || id >= GST_H264_MAX_PPS_COUNT)
+      return -1;
+    stored = h264parse->pps_nals[id];
+  } else
+    return -1;
+
+  if (stored && gst_buffer_get_size (stored) == nalu->size &&
+      gst_buffer_memcmp (stored, 0, nalu->data + nalu->offset,
+          nalu->size) == 0)
+    return id;
+
+  return -1;
 }
 
 #ifndef GST_DISABLE_GST_DEBUG
@@ -691,15 +763,19 @@ gst_h264_parse_process_sei (GstH264Parse * h264parse, GstH264NalUnit * nalu)
   g_array_free (messages, TRUE);
 }
 
-/* caller guarantees 2 bytes of nal payload */
+/* caller guarantees 2 bytes of nal payload,
+ * @buffer is the buffer whose mapped data @nalu refers to */
 static gboolean
-gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
+gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu,
+    GstBuffer * buffer)
 {
   guint nal_type;
   GstH264PPS pps = { 0, };
   GstH264SPS sps = { 0, };
   GstH264NalParser *nalparser = h264parse->nalparser;
   GstH264ParserResult pres;
+  gboolean repeated = FALSE;
+  gint id;
 
   /* nothing to do for broken input */
   if (G_UNLIKELY (nalu->size < 2)) {
@@ -723,7 +799,18 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
     case GST_H264_NAL_SPS:
       /* reset state, everything else is obsolete */
       h264parse->state = 0;
-      pres = gst_h264_parser_parse_sps (nalparser, nalu, &sps, TRUE);
+
+      /* SPS repeated unchanged in-band don't need to be parsed again, and
+       * can't change the caps */
+      id = gst_h264_parse_find_stored_nal (h264parse, nal_type, nalu);
+      if (id >= 0 && nalparser->sps[id].valid) {
+        GST_LOG_OBJECT (h264parse, "SPS %d repeated", id);
+        nalparser->last_sps = &nalparser->sps[id];
+        repeated = TRUE;
+        pres = GST_H264_PARSER_OK;
+      } else {
+        pres = gst_h264_parser_parse_sps (nalparser, nalu, &sps, TRUE);
+      }
 
     process_sps:
       /* arranged for a fallback sps.id, so use that one and only warn */
@@ -732,8 +819,13 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
         return FALSE;
       }
 
-      GST_DEBUG_OBJECT (h264parse, "triggering src caps check");
-      h264parse->update_caps = TRUE;
+      if (!repeated) {
+        GST_DEBUG_OBJECT (h264parse, "triggering src caps check");
+        h264parse->update_caps = TRUE;
+        /* the stored PPS might refer to this SPS */
+        for (id = 0; id < GST_H264_MAX_PPS_COUNT; id++)
+          h264parse->pps_nals_stale[id] = TRUE;
+      }
       h264parse->have_sps = TRUE;
       if (h264parse->push_codec && h264parse->have_pps) {
         /* SPS and PPS found in stream before the first pre_push_frame, no need
@@ -744,7 +836,8 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
         h264parse->have_pps = FALSE;
       }
 
-      gst_h264_parser_store_nal (h264parse, sps.id, nal_type, nalu);
+      if (!repeated)
+        gst_h264_parser_store_nal (h264parse, sps.id, nal_type, nalu);
       gst_h264_sps_clear (&sps);
       h264parse->state |= GST_H264_PARSE_STATE_GOT_SPS;
       h264parse->header |= TRUE;
@@ -755,16 +848,23 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
       if (!GST_H264_PARSE_STATE_VALID (h264parse, GST_H264_PARSE_STATE_GOT_SPS))
         return FALSE;
 
-      pres = gst_h264_parser_parse_pps (nalparser, nalu, &pps);
-      /* arranged for a fallback pps.id, so use that one and only warn */
-      if (pres != GST_H264_PARSER_OK) {
-        GST_WARNING_OBJECT (h264parse, "failed to parse PPS:");
-        if (pres != GST_H264_PARSER_BROKEN_LINK)
-          return FALSE;
+      id = gst_h264_parse_find_stored_nal (h264parse, nal_type, nalu);
+      if (id >= 0 && !h264parse->pps_nals_stale[id] &&
+          nalparser->pps[id].valid) {
+        GST_LOG_OBJECT (h264parse, "PPS %d repeated", id);
+        repeated = TRUE;
+      } else {
+        pres = gst_h264_parser_parse_pps (nalparser, nalu, &pps);
+        /* arranged for a fallback pps.id, so use that one and only warn */
+        if (pres != GST_H264_PARSER_OK) {
+          GST_WARNING_OBJECT (h264parse, "failed to parse PPS:");
+          if (pres != GST_H264_PARSER_BROKEN_LINK)
+            return FALSE;
+        }
       }
 
       /* parameters might have changed, force caps check */
-      if (!h264parse->have_pps) {
+      if (!repeated && !h264parse->have_pps) {
         GST_DEBUG_OBJECT (h264parse, "triggering src caps check");
         h264parse->update_caps = TRUE;
       }
@@ -778,7 +878,8 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
         h264parse->have_pps = FALSE;
       }
 
-      gst_h264_parser_store_nal (h264parse, pps.id, nal_type, nalu);
+      if (!repeated)
+        gst_h264_parser_store_nal (h264parse, pps.id, nal_type, nalu);
       gst_h264_pps_clear (&pps);
       h264parse->state |= GST_H264_PARSE_STATE_GOT_PPS;
       h264parse->header |= TRUE;
@@ -826,8 +927,8 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
       {
         GstH264SliceHdr slice;
 
-        pres = gst_h264_parser_parse_slice_hdr (nalparser, nalu, &slice,
-            FALSE, FALSE);
+        pres = gst_h264_parser_parse_slice_hdr_with_depth (nalparser, nalu,
+            &slice, GST_H264_SLICE_HDR_PARSE_DEPTH_AU_BOUNDARY);
         GST_DEBUG_OBJECT (h264parse,
             "parse result %d, first MB: %u, slice type: %u",
             pres, slice.first_mb_in_slice, slice.type);
@@ -880,13 +981,15 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
   }
 
   /* if AVC output needed, collect properly prefixed nal in adapter,
-   * and use that to replace outgoing buffer data later on */
+   * and use that to replace outgoing buffer data later on.
+   * The nal data itself is not copied but shared with the input buffer */
   if (h264parse->transform) {
     GstBuffer *buf;
 
     GST_LOG_OBJECT (h264parse, "collecting NAL in AVC frame");
     buf = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
-        nalu->data + nalu->offset, nalu->size);
+        buffer, nalu->offset, nalu->size);
+    h264parse->frame_out_mems += gst_buffer_n_memory (buf);
     gst_adapter_push (h264parse->frame_out, buf);
   }
   return TRUE;
@@ -979,7 +1082,7 @@ gst_h264_parse_handle_frame_packetized (GstBaseParse * parse,
     GST_DEBUG_OBJECT (h264parse, "AVC nal offset %d", nalu.offset + nalu.size);
 
     /* either way, have a look at it */
-    gst_h264_parse_process_nal (h264parse, &nalu);
+    gst_h264_parse_process_nal (h264parse, &nalu, buffer);
 
     /* dispatch per NALU if needed */
     if (h264parse->split_packetized) {
@@ -1047,6 +1150,7 @@ gst_h264_parse_handle_frame (GstBaseParse * parse,
   guint8 *data;
   gsize size;
   gint current_off = 0;
+  gint scan_off;
   gboolean drain, nonext;
   GstH264NalParser *nalparser = h264parse->nalparser;
   GstH264NalUnit nalu;
@@ -1116,7 +1220,27 @@ gst_h264_parse_handle_frame (GstBaseParse * parse,
     }
   }
 
+  scan_off = h264parse->scan_off;
+  h264parse->scan_off = 0;
+
   while (TRUE) {
+    /* The end of the NAL at current_off was already looked for up to
+     * scan_off, only look at the new data (and at the last 3 bytes, in
+     * case a start code got split) instead of scanning the whole NAL again */
+    if (scan_off > current_off + 6 && !drain) {
+      GstByteReader br;
+
+      gst_byte_reader_init (&br, data, size);
+      if (gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
+              scan_off - 3, size - scan_off + 3) == -1) {
+        GST_LOG_OBJECT (h264parse, "still no end for nal at offset %d",
+            current_off);
+        h264parse->scan_off = size;
+        goto more;
+      }
+    }
+    scan_off = 0;
+
     pres =
         gst_h264_parser_identify_nalu (nalparser, data, current_off, size,
         &nalu);
@@ -1140,7 +1264,8 @@ gst_h264_parse_handle_frame (GstBaseParse * parse,
             goto broken;
           break;
         }
-        /* otherwise need more */
+        /* otherwise need more, and remember how far we looked */
+        h264parse->scan_off = size;
         goto more;
       case GST_H264_PARSER_BROKEN_LINK:
         GST_ELEMENT_ERROR (h264parse, STREAM, FORMAT,
@@ -1197,7 +1322,7 @@ gst_h264_parse_handle_frame (GstBaseParse * parse,
       }
     }
 
-    if (!gst_h264_parse_process_nal (h264parse, &nalu)) {
+    if (!gst_h264_parse_process_nal (h264parse, &nalu, buffer)) {
       GST_WARNING_OBJECT (h264parse,
           "broken/invalid nal Type: %d %s, Size: %u will be dropped",
           nalu.type, _nal_name (nalu.type), nalu.size);
@@ -1239,6 +1364,7 @@ out:
 
 skip:
   GST_DEBUG_OBJECT (h264parse, "skipping %d", *skipsize);
+  h264parse->scan_off = 0;
   /* If we are collecting access units, we need to preserve the initial
    * config headers (SPS, PPS et al.) and only reset the frame if another
    * slice NAL was received. This means that broken pictures are discarded */
@@ -2074,7 +2200,14 @@ gst_h264_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
   if (av) {
     GstBuffer *buf;
 
-    buf = gst_adapter_take_buffer (h264parse->frame_out, av);
+    /* avoid merging the collected NALs into a single memory, unless they
+     * don't fit in the memories of one buffer: they are then copied once
+     * rather than merged over and over */
+    if (h264parse->frame_out_mems > gst_buffer_get_max_memory ())
+      buf = gst_adapter_take_buffer (h264parse->frame_out, av);
+    else
+      buf = gst_adapter_take_buffer_fast (h264parse->frame_out, av);
+    h264parse->frame_out_mems = 0;
     gst_buffer_copy_into (buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
     gst_buffer_replace (&frame->out_buffer, buf);
     gst_buffer_unref (buf);
@@ -2083,18 +2216,65 @@ gst_h264_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
   return GST_FLOW_OK;
 }
 
+/* wraps all the stored parameter sets in nals of the output format, copied
+ * together in a single memory. Returns NULL if there is none */
+static GstBuffer *
+gst_h264_parse_wrap_codec_nals (GstH264Parse * h264parse)
+{
+  GstBuffer *nals[GST_H264_MAX_SPS_COUNT + GST_H264_MAX_PPS_COUNT];
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint i, n = 0, prefix_size;
+  gsize size = 0, offset = 0;
+  gboolean packetized;
+
+  for (i = 0; i < GST_H264_MAX_SPS_COUNT; i++) {
+    if (h264parse->sps_nals[i])
+      nals[n++] = h264parse->sps_nals[i];
+  }
+  for (i = 0; i < GST_H264_MAX_PPS_COUNT; i++) {
+    if (h264parse->pps_nals[i])
+      nals[n++] = h264parse->pps_nals[i];
+  }
+
+  if (n == 0)
+    return NULL;
+
+  packetized = h264parse->format == GST_H264_PARSE_FORMAT_AVC ||
+      h264parse->format == GST_H264_PARSE_FORMAT_AVC3;
+  prefix_size = packetized ? h264parse->nal_length_size : 4;
+
+  for (i = 0; i < n; i++)
+    size += prefix_size + gst_buffer_get_size (nals[i]);
+
+  buf = gst_buffer_new_allocate (NULL, size, NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (i = 0; i < n; i++) {
+    gsize nal_size = gst_buffer_get_size (nals[i]);
+    /* length prefix, or 4 bytes start code */
+    guint32 tmp = GUINT32_TO_BE ((guint32) (packetized ? nal_size : 1) <<
+        (32 - 8 * prefix_size));
+
+    GST_DEBUG_OBJECT (h264parse, "inserting nal of size %" G_GSIZE_FORMAT,
+        nal_size);
+    memcpy (map.data + offset, &tmp, prefix_size);
+    offset += prefix_size;
+    gst_buffer_extract (nals[i], 0, map.data + offset, nal_size);
+    offset += nal_size;
+  }
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
 /* sends a codec NAL downstream, decorating and transforming as needed.
  * No ownership is taken of @nal */
 static GstFlowReturn
 gst_h264_parse_push_codec_buffer (GstH264Parse * h264parse,
     GstBuffer * nal, GstClockTime ts)
 {
-  GstMapInfo map;
-
-  gst_buffer_map (nal, &map, GST_MAP_READ);
   nal = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
-      map.data, map.size);
-  gst_buffer_unmap (nal, &map);
+      nal, 0, gst_buffer_get_size (nal));
 
   GST_BUFFER_TIMESTAMP (nal) = ts;
   GST_BUFFER_DURATION (nal) = 0;
@@ -2300,54 +2480,21 @@ gst_h264_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
             }
           }
         } else {
-          /* insert config NALs into AU */
-          GstByteWriter bw;
-          GstBuffer *new_buf;
-          const gboolean bs = h264parse->format == GST_H264_PARSE_FORMAT_BYTE;
-          const gint nls = 4 - h264parse->nal_length_size;
-          gboolean ok;
-
-          gst_byte_writer_init_with_size (&bw, gst_buffer_get_size (buffer),
-              FALSE);
-          ok = gst_byte_writer_put_buffer (&bw, buffer, 0, h264parse->idr_pos);
-          GST_DEBUG_OBJECT (h264parse, "- inserting SPS/PPS");
-          for (i = 0; i < GST_H264_MAX_SPS_COUNT; i++) {
-            if ((codec_nal = h264parse->sps_nals[i])) {
-              gsize nal_size = gst_buffer_get_size (codec_nal);
-              GST_DEBUG_OBJECT (h264parse, "inserting SPS nal");
-              if (bs) {
-                ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-              } else {
-                ok &= gst_byte_writer_put_uint32_be (&bw,
-                    (nal_size << (nls * 8)));
-                ok &= gst_byte_writer_set_pos (&bw,
-                    gst_byte_writer_get_pos (&bw) - nls);
-              }
+          /* insert config NALs into AU, gathered in a single memory. The
+           * AU data itself is not copied but shared with the new buffer */
+          GstBuffer *new_buf, *codec_nals;
 
-              ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
-              h264parse->last_report = new_ts;
-            }
-          }
-          for (i = 0; i < GST_H264_MAX_PPS_COUNT; i++) {
-            if ((codec_nal = h264parse->pps_nals[i])) {
-              gsize nal_size = gst_buffer_get_size (codec_nal);
-              GST_DEBUG_OBJECT (h264parse, "inserting PPS nal");
-              if (bs) {
-                ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-              } else {
-                ok &= gst_byte_writer_put_uint32_be (&bw,
-                    (nal_size << (nls * 8)));
-                ok &= gst_byte_writer_set_pos (&bw,
-                    gst_byte_writer_get_pos (&bw) - nls);
-              }
-              ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
-              h264parse->last_report = new_ts;
-            }
+          new_buf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY, 0,
+              h264parse->idr_pos);
+          GST_DEBUG_OBJECT (h264parse, "- inserting SPS/PPS");
+          codec_nals = gst_h264_parse_wrap_codec_nals (h264parse);
+          if (codec_nals) {
+            new_buf = gst_buffer_append (new_buf, codec_nals);
+            h264parse->last_report = new_ts;
           }
-          ok &=
-              gst_byte_writer_put_buffer (&bw, buffer, h264parse->idr_pos, -1);
-          /* collect result and push */
-          new_buf = gst_byte_writer_reset_and_get_buffer (&bw);
+          new_buf = gst_buffer_append (new_buf,
+              gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY,
+                  h264parse->idr_pos, -1));
           gst_buffer_copy_into (new_buf, buffer, GST_BUFFER_COPY_METADATA, 0,
               -1);
           /* should already be keyframe/IDR, but it may not have been,
@@ -2355,10 +2502,6 @@ gst_h264_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
           GST_BUFFER_FLAG_UNSET (new_buf, GST_BUFFER_FLAG_DELTA_UNIT);
           gst_buffer_replace (&frame->out_buffer, new_buf);
           gst_buffer_unref (new_buf);
-          /* some result checking seems to make some compilers happy */
-          if (G_UNLIKELY (!ok)) {
-            GST_ERROR_OBJECT (h264parse, "failed to insert SPS/PPS");
-          }
         }
       }
       /* we pushed whatever we had */
@@ -2526,7 +2669,7 @@ gst_h264_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
         goto avcc_too_small;
       }
 
-      gst_h264_parse_process_nal (h264parse, &nalu);
+      gst_h264_parse_process_nal (h264parse, &nalu, codec_data);
       off = nalu.offset + nalu.size;
     }
 
@@ -2541,7 +2684,7 @@ gst_h264_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
         goto avcc_too_small;
       }
 
-      gst_h264_parse_process_nal (h264parse, &nalu);
+      gst_h264_parse_process_nal (h264parse, &nalu, codec_data);
       off = nalu.offset + nalu.size;
     }
 
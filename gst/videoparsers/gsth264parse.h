@@ -74,6 +74,9 @@ struct _GstH264Parse
   guint align;
   guint format;
   gint current_off;
+  /* Offset up to which the end of the NAL starting at current_off
+   * was already looked for */
+  gint scan_off;
   /* True if input format and alignment match negotiated output */
   gboolean can_passthrough;
 
@@ -89,6 +92,9 @@ struct _GstH264Parse
   /* collected SPS and PPS NALUs */
   GstBuffer *sps_nals[GST_H264_MAX_SPS_COUNT];
   GstBuffer *pps_nals[GST_H264_MAX_PPS_COUNT];
+  /* stored PPS which were parsed before the last SPS change, and so
+   * need to be parsed again even if repeated unchanged */
+  gboolean pps_nals_stale[GST_H264_MAX_PPS_COUNT];
 
   /* Infos we need to keep track of */
   guint32 sei_cpb_removal_delay;
@@ -111,6 +117,8 @@ struct _GstH264Parse
   gint idr_pos, sei_pos;
   gboolean update_caps;
   GstAdapter *frame_out;
+  /* number of memories of the NALs collected in frame_out */
+  guint frame_out_mems;
   gboolean keyframe;
   gboolean header;
   gboolean frame_start;
@@ -26,6 +26,7 @@
 #include <gst/pbutils/pbutils.h>
 #include <gst/video/video.h>
 #include "gsth265parse.h"
+#include "paramsets.h"
 
 #include <string.h>
 
@@ -160,6 +161,7 @@ gst_h265_parse_reset_frame (GstH265Parse * h265parse)
 
   /* done parsing; reset state */
   h265parse->current_off = -1;
+  h265parse->scan_off = 0;
 
   h265parse->picture_start = FALSE;
   h265parse->update_caps = FALSE;
@@ -168,6 +170,7 @@ gst_h265_parse_reset_frame (GstH265Parse * h265parse)
   h265parse->keyframe = FALSE;
   h265parse->header = FALSE;
   gst_adapter_clear (h265parse->frame_out);
+  h265parse->frame_out_mems = 0;
 }
 
 static void
@@ -360,31 +363,59 @@ gst_h265_parse_negotiate (GstH265Parse * h265parse, gint in_format,
   h265parse->transform = (in_format != h265parse->format);
 }
 
+/* wraps @size bytes of @buffer starting at @offset in a nal of @format,
+ * without copying them. When @buffer already has the right prefix before
+ * @offset, as when the input and output formats are the same, the nal is
+ * a single region of @buffer. Otherwise the prefix goes in a separate
+ * memory and the payload is shared with @buffer */
 static GstBuffer *
-gst_h265_parse_wrap_nal (GstH265Parse * h265parse, guint format, guint8 * data,
-    guint size)
+gst_h265_parse_wrap_nal (GstH265Parse * h265parse, guint format,
+    GstBuffer * buffer, guint offset, guint size)
 {
+  static const guint8 start_code[4] = { 0x00, 0x00, 0x00, 0x01 };
+  guint8 prefix[4];
+  guint prefix_size;
   GstBuffer *buf;
+  GstMemory *mem;
   guint nl = h265parse->nal_length_size;
-  guint32 tmp;
 
   GST_DEBUG_OBJECT (h265parse, "nal length %d", size);
 
-  buf = gst_buffer_new_allocate (NULL, 4 + size, NULL);
   if (format == GST_H265_PARSE_FORMAT_HVC1
       || format == GST_H265_PARSE_FORMAT_HEV1) {
-    tmp = GUINT32_TO_BE (size << (32 - 8 * nl));
+    guint32 tmp = GUINT32_TO_BE (size << (32 - 8 * nl));
+
+    memcpy (prefix, &tmp, nl);
+    prefix_size = nl;
   } else {
-    /* HACK: nl should always be 4 here, otherwise this won't work.
-     * There are legit cases where nl in hevc stream is 2, but byte-stream
+    /* There are legit cases where nl in hevc stream is 2, but byte-stream
      * SC is still always 4 bytes. */
-    nl = 4;
-    tmp = GUINT32_TO_BE (1);
+    memcpy (prefix, start_code, sizeof (start_code));
+    prefix_size = sizeof (start_code);
+  }
+
+  if (offset >= prefix_size && gst_buffer_memcmp (buffer,
+          offset - prefix_size, prefix, prefix_size) == 0)
+    return gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY,
+        offset - prefix_size, size + prefix_size);
+
+  if (prefix_size == sizeof (start_code) &&
+      memcmp (prefix, start_code, prefix_size) == 0) {
+    /* shared by all the byte-stream nals */
+    mem = gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+        (gpointer) start_code, sizeof (start_code), 0, sizeof (start_code),
+        NULL, NULL);
+  } else {
+    GstMapInfo map;
+
+    mem = gst_allocator_alloc (NULL, prefix_size, NULL);
+    gst_memory_map (mem, &map, GST_MAP_WRITE);
+    memcpy (map.data, prefix, prefix_size);
+    gst_memory_unmap (mem, &map);
   }
 
-  gst_buffer_fill (buf, 0, &tmp, sizeof (guint32));
-  gst_buffer_fill (buf, nl, data, size);
-  gst_buffer_set_size (buf, size + nl);
+  buf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY, offset, size);
+  gst_buffer_prepend_memory (buf, mem);
 
   return buf;
 }
@@ -427,6 +458,61 @@ gst_h265_parser_store_nal (GstH265Parse * h265parse, guint id,
     gst_buffer_unref (store[id]);
 
   store[id] = buf;
+
+  if (naltype == GST_H265_NAL_SPS)
+    h265parse->sps_nals_stale[id] = FALSE;
+  else if (naltype == GST_H265_NAL_PPS)
+    h265parse->pps_nals_stale[id] = FALSE;
+}
+
+/* returns the id of @nalu if it is a VPS, SPS or PPS identical to the one
+ * stored with the same id, or -1. Only the id is read from @nalu */
+static gint
+gst_h265_parse_find_stored_nal (GstH265Parse * h265parse,
+    GstH265NalUnitType naltype, GstH265NalUnit * nalu)
+{
+  guint8 data[128];
+  GstBitReader br;
+  GstBuffer *stored;
+  guint8 max_sub_layers_minus1;
+  guint id;
+
+  gst_bit_reader_init (&br, data,
+      param_sets_unescape_payload (nalu->data + nalu->offset +
+          nalu->header_bytes, nalu->size - nalu->header_bytes, data,
+          sizeof (data)));
+
+  if (naltype == GST_H265_NAL_VPS) {
+    if (!gst_bit_reader_get_bits_uint32 (&br, &id, 4))
+      return -1;
+    stored = h265parse->vps_nals[id];
+  } else if (naltype == GST_H265_NAL_SPS) {
+    /* sps_seq_parameter_set_id follows the VPS id, the sub-layers info and
+     * the profile_tier_level() */
+    if (!gst_bit_reader_skip (&br, 4) ||
+        !gst_bit_reader_get_bits_uint8 (&br, &max_sub_layers_minus1, 3) ||
+        max_sub_layers_minus1 > 6 || !gst_bit_reader_skip (&br, 1) ||
+        !param_sets_skip_h265_profile_tier_level (&br, max_sub_layers_minus1)
+        || !param_sets_read_ue (&br, &id) || id >= GST_H265_MAX_SPS_COUNT)
+      return -1;
+    if (h265parse->sps_nals_stale[id])
+      return -1;
+    stored = h265parse->sps_nals[id];
+  } else if (naltype == GST_H265_NAL_PPS) {
+    if (!param_sets_read_ue (&br, &id) || id >= GST_H265_MAX_PPS_COUNT)
+      return -1;
+    if (h265parse->pps_nals_stale[id])
+      return -1;
+    stored = h265parse->pps_nals[id];
+  } else
+    return -1;
+
+  if (stored && gst_buffer_get_size (stored) == nalu->size &&
+      gst_buffer_memcmp (stored, 0, nalu->data + nalu->offset,
+          nalu->size) == 0)
+    return id;
+
+  return -1;
 }
 
 #ifndef GST_DISABLE_GST_DEBUG
@@ -483,9 +569,11 @@ _nal_name (GstH265NalUnitType nal_type)
 }
 #endif
 
-/* caller guarantees 2 bytes of nal payload */
+/* caller guarantees 2 bytes of nal payload,
+ * @buffer is the buffer whose mapped data @nalu refers to */
 static void
-gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
+gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu,
+    GstBuffer * buffer)
 {
   GstH265PPS pps = { 0, };
   GstH265SPS sps = { 0, };
@@ -494,6 +582,8 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
   guint nal_type;
   GstH265Parser *nalparser = h265parse->nalparser;
   GstH265ParserResult pres = GST_H265_PARSER_ERROR;
+  gboolean repeated = FALSE;
+  gint id;
 
   /* nothing to do for broken input */
   if (G_UNLIKELY (nalu->size < 2)) {
@@ -510,12 +600,29 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
     case GST_H265_NAL_VPS:
       /* It is not mandatory to have VPS in the stream. But it might
        * be needed for other extensions like svc */
-      pres = gst_h265_parser_parse_vps (nalparser, nalu, &vps);
-      if (pres != GST_H265_PARSER_OK)
-        GST_WARNING_OBJECT (h265parse, "failed to parse VPS");
+      /* parameter sets repeated unchanged in-band don't need to be parsed
+       * again, and can't change the caps */
+      id = gst_h265_parse_find_stored_nal (h265parse, nal_type, nalu);
+      if (id >= 0 && nalparser->vps[id].valid) {
+        GST_LOG_OBJECT (h265parse, "VPS %d repeated", id);
+        nalparser->last_vps = &nalparser->vps[id];
+        repeated = TRUE;
+      } else {
+        pres = gst_h265_parser_parse_vps (nalparser, nalu, &vps);
+        if (pres != GST_H265_PARSER_OK)
+          GST_WARNING_OBJECT (h265parse, "failed to parse VPS");
 
-      GST_DEBUG_OBJECT (h265parse, "triggering src caps check");
-      h265parse->update_caps = TRUE;
+        GST_DEBUG_OBJECT (h265parse, "triggering src caps check");
+        h265parse->update_caps = TRUE;
+        /* the stored SPS parsed against this VPS need to be parsed again */
+        if (pres == GST_H265_PARSER_OK) {
+          for (id = 0; id < GST_H265_MAX_SPS_COUNT; id++) {
+            if (nalparser->sps[id].valid &&
+                nalparser->sps[id].vps == &nalparser->vps[vps.id])
+              h265parse->sps_nals_stale[id] = TRUE;
+          }
+        }
+      }
       h265parse->have_vps = TRUE;
       if (h265parse->push_codec && h265parse->have_pps) {
         /* VPS/SPS/PPS found in stream before the first pre_push_frame, no need
@@ -527,19 +634,29 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
         h265parse->have_pps = FALSE;
       }
 
-      gst_h265_parser_store_nal (h265parse, vps.id, nal_type, nalu);
+      if (!repeated)
+        gst_h265_parser_store_nal (h265parse, vps.id, nal_type, nalu);
       h265parse->header |= TRUE;
       break;
     case GST_H265_NAL_SPS:
-      pres = gst_h265_parser_parse_sps (nalparser, nalu, &sps, TRUE);
-
+      id = gst_h265_parse_find_stored_nal (h265parse, nal_type, nalu);
+      if (id >= 0 && nalparser->sps[id].valid) {
+        GST_LOG_OBJECT (h265parse, "SPS %d repeated", id);
+        nalparser->last_sps = &nalparser->sps[id];
+        repeated = TRUE;
+      } else {
+        pres = gst_h265_parser_parse_sps (nalparser, nalu, &sps, TRUE);
 
-      /* arranged for a fallback sps.id, so use that one and only warn */
-      if (pres != GST_H265_PARSER_OK)
-        GST_WARNING_OBJECT (h265parse, "failed to parse SPS:");
+        /* arranged for a fallback sps.id, so use that one and only warn */
+        if (pres != GST_H265_PARSER_OK)
+          GST_WARNING_OBJECT (h265parse, "failed to parse SPS:");
 
-      GST_DEBUG_OBJECT (h265parse, "triggering src caps check");
-      h265parse->update_caps = TRUE;
+        GST_DEBUG_OBJECT (h265parse, "triggering src caps check");
+        h265parse->update_caps = TRUE;
+        /* the stored PPS might refer to this SPS */
+        for (id = 0; id < GST_H265_MAX_PPS_COUNT; id++)
+          h265parse->pps_nals_stale[id] = TRUE;
+      }
       h265parse->have_sps = TRUE;
       if (h265parse->push_codec && h265parse->have_pps) {
         /* SPS and PPS found in stream before the first pre_push_frame, no need
@@ -550,19 +667,26 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
         h265parse->have_pps = FALSE;
       }
 
-      gst_h265_parser_store_nal (h265parse, sps.id, nal_type, nalu);
+      if (!repeated)
+        gst_h265_parser_store_nal (h265parse, sps.id, nal_type, nalu);
       h265parse->header |= TRUE;
       break;
     case GST_H265_NAL_PPS:
-      pres = gst_h265_parser_parse_pps (nalparser, nalu, &pps);
-
+      id = gst_h265_parse_find_stored_nal (h265parse, nal_type, nalu);
+      if (id >= 0 && nalparser->pps[id].valid) {
+        GST_LOG_OBJECT (h265parse, "PPS %d repeated", id);
+        nalparser->last_pps = &nalparser->pps[id];
+        repeated = TRUE;
+      } else {
+        pres = gst_h265_parser_parse_pps (nalparser, nalu, &pps);
 
-      /* arranged for a fallback pps.id, so use that one and only warn */
-      if (pres != GST_H265_PARSER_OK)
-        GST_WARNING_OBJECT (h265parse, "failed to parse PPS:");
+        /* arranged for a fallback pps.id, so use that one and only warn */
+        if (pres != GST_H265_PARSER_OK)
+          GST_WARNING_OBJECT (h265parse, "failed to parse PPS:");
+      }
 
       /* parameters might have changed, force caps check */
-      if (!h265parse->have_pps) {
+      if (!repeated && !h265parse->have_pps) {
         GST_DEBUG_OBJECT (h265parse, "triggering src caps check");
         h265parse->update_caps = TRUE;
       }
@@ -576,7 +700,8 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
         h265parse->have_pps = FALSE;
       }
 
-      gst_h265_parser_store_nal (h265parse, pps.id, nal_type, nalu);
+      if (!repeated)
+        gst_h265_parser_store_nal (h265parse, pps.id, nal_type, nalu);
       h265parse->header |= TRUE;
       break;
     case GST_H265_NAL_PREFIX_SEI:
@@ -612,7 +737,8 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
     {
       GstH265SliceHdr slice;
 
-      pres = gst_h265_parser_parse_slice_hdr (nalparser, nalu, &slice);
+      pres = gst_h265_parser_parse_slice_hdr_with_depth (nalparser, nalu,
+          &slice, GST_H265_SLICE_HDR_PARSE_DEPTH_AU_BOUNDARY);
 
       if (pres == GST_H265_PARSER_OK) {
         if (GST_H265_IS_I_SLICE (&slice))
@@ -659,13 +785,15 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
   }
 
   /* if HEVC output needed, collect properly prefixed nal in adapter,
-   * and use that to replace outgoing buffer data later on */
+   * and use that to replace outgoing buffer data later on.
+   * The nal data itself is not copied but shared with the input buffer */
   if (h265parse->transform) {
     GstBuffer *buf;
 
     GST_LOG_OBJECT (h265parse, "collecting NAL in HEVC frame");
     buf = gst_h265_parse_wrap_nal (h265parse, h265parse->format,
-        nalu->data + nalu->offset, nalu->size);
+        buffer, nalu->offset, nalu->size);
+    h265parse->frame_out_mems += gst_buffer_n_memory (buf);
     gst_adapter_push (h265parse->frame_out, buf);
   }
 }
@@ -756,7 +884,7 @@ gst_h265_parse_handle_frame_packetized (GstBaseParse * parse,
     GST_DEBUG_OBJECT (h265parse, "HEVC nal offset %d", nalu.offset + nalu.size);
 
     /* either way, have a look at it */
-    gst_h265_parse_process_nal (h265parse, &nalu);
+    gst_h265_parse_process_nal (h265parse, &nalu, buffer);
 
     /* dispatch per NALU if needed */
     if (h265parse->split_packetized) {
@@ -825,6 +953,7 @@ gst_h265_parse_handle_frame (GstBaseParse * parse,
   guint8 *data;
   gsize size;
   gint current_off = 0;
+  gint scan_off;
   gboolean drain, nonext;
   GstH265Parser *nalparser = h265parse->nalparser;
   GstH265NalUnit nalu;
@@ -888,7 +1017,27 @@ gst_h265_parse_handle_frame (GstBaseParse * parse,
     }
   }
 
+  scan_off = h265parse->scan_off;
+  h265parse->scan_off = 0;
+
   while (TRUE) {
+    /* The end of the NAL at current_off was already looked for up to
+     * scan_off, only look at the new data (and at the last 3 bytes, in
+     * case a start code got split) instead of scanning the whole NAL again */
+    if (scan_off > current_off + 6 && !drain) {
+      GstByteReader br;
+
+      gst_byte_reader_init (&br, data, size);
+      if (gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
+              scan_off - 3, size - scan_off + 3) == -1) {
+        GST_LOG_OBJECT (h265parse, "still no end for nal at offset %d",
+            current_off);
+        h265parse->scan_off = size;
+        goto more;
+      }
+    }
+    scan_off = 0;
+
     pres =
         gst_h265_parser_identify_nalu (nalparser, data, current_off, size,
         &nalu);
@@ -912,7 +1061,8 @@ gst_h265_parse_handle_frame (GstBaseParse * parse,
             goto broken;
           break;
         }
-        /* otherwise need more */
+        /* otherwise need more, and remember how far we looked */
+        h265parse->scan_off = size;
         goto more;
       case GST_H265_PARSER_BROKEN_LINK:
         GST_ELEMENT_ERROR (h265parse, STREAM, FORMAT,
@@ -972,7 +1122,7 @@ gst_h265_parse_handle_frame (GstBaseParse * parse,
         nalu.type == GST_H265_NAL_SPS ||
         nalu.type == GST_H265_NAL_PPS ||
         (h265parse->have_sps && h265parse->have_pps)) {
-      gst_h265_parse_process_nal (h265parse, &nalu);
+      gst_h265_parse_process_nal (h265parse, &nalu, buffer);
     } else {
       GST_WARNING_OBJECT (h265parse,
           "no SPS/PPS yet, nal Type: %d %s, Size: %u will be dropped",
@@ -1649,7 +1799,14 @@ gst_h265_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
   if (av) {
     GstBuffer *buf;
 
-    buf = gst_adapter_take_buffer (h265parse->frame_out, av);
+    /* avoid merging the collected NALs into a single memory, unless they
+     * don't fit in the memories of one buffer: they are then copied once
+     * rather than merged over and over */
+    if (h265parse->frame_out_mems > gst_buffer_get_max_memory ())
+      buf = gst_adapter_take_buffer (h265parse->frame_out, av);
+    else
+      buf = gst_adapter_take_buffer_fast (h265parse->frame_out, av);
+    h265parse->frame_out_mems = 0;
     gst_buffer_copy_into (buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
     gst_buffer_replace (&frame->out_buffer, buf);
     gst_buffer_unref (buf);
@@ -1658,18 +1815,70 @@ gst_h265_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
   return GST_FLOW_OK;
 }
 
+/* wraps all the stored parameter sets in nals of the output format, copied
+ * together in a single memory. Returns NULL if there is none */
+static GstBuffer *
+gst_h265_parse_wrap_codec_nals (GstH265Parse * h265parse)
+{
+  GstBuffer *nals[GST_H265_MAX_VPS_COUNT + GST_H265_MAX_SPS_COUNT +
+      GST_H265_MAX_PPS_COUNT];
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint i, n = 0, prefix_size;
+  gsize size = 0, offset = 0;
+  gboolean packetized;
+
+  for (i = 0; i < GST_H265_MAX_VPS_COUNT; i++) {
+    if (h265parse->vps_nals[i])
+      nals[n++] = h265parse->vps_nals[i];
+  }
+  for (i = 0; i < GST_H265_MAX_SPS_COUNT; i++) {
+    if (h265parse->sps_nals[i])
+      nals[n++] = h265parse->sps_nals[i];
+  }
+  for (i = 0; i < GST_H265_MAX_PPS_COUNT; i++) {
+    if (h265parse->pps_nals[i])
+      nals[n++] = h265parse->pps_nals[i];
+  }
+
+  if (n == 0)
+    return NULL;
+
+  packetized = h265parse->format == GST_H265_PARSE_FORMAT_HVC1 ||
+      h265parse->format == GST_H265_PARSE_FORMAT_HEV1;
+  prefix_size = packetized ? h265parse->nal_length_size : 4;
+
+  for (i = 0; i < n; i++)
+    size += prefix_size + gst_buffer_get_size (nals[i]);
+
+  buf = gst_buffer_new_allocate (NULL, size, NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (i = 0; i < n; i++) {
+    gsize nal_size = gst_buffer_get_size (nals[i]);
+    /* length prefix, or 4 bytes start code */
+    guint32 tmp = GUINT32_TO_BE ((guint32) (packetized ? nal_size : 1) <<
+        (32 - 8 * prefix_size));
+
+    GST_DEBUG_OBJECT (h265parse, "inserting nal of size %" G_GSIZE_FORMAT,
+        nal_size);
+    memcpy (map.data + offset, &tmp, prefix_size);
+    offset += prefix_size;
+    gst_buffer_extract (nals[i], 0, map.data + offset, nal_size);
+    offset += nal_size;
+  }
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
 /* sends a codec NAL downstream, decorating and transforming as needed.
  * No ownership is taken of @nal */
 static GstFlowReturn
 gst_h265_parse_push_codec_buffer (GstH265Parse * h265parse, GstBuffer * nal,
     GstClockTime ts)
 {
-  GstMapInfo map;
-
-  gst_buffer_map (nal, &map, GST_MAP_READ);
   nal = gst_h265_parse_wrap_nal (h265parse, h265parse->format,
-      map.data, map.size);
-  gst_buffer_unmap (nal, &map);
+      nal, 0, gst_buffer_get_size (nal));
 
   GST_BUFFER_TIMESTAMP (nal) = ts;
   GST_BUFFER_DURATION (nal) = 0;
@@ -1887,71 +2096,21 @@ gst_h265_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
             }
           }
         } else {
-          /* insert config NALs into AU */
-          GstByteWriter bw;
-          GstBuffer *new_buf;
-          const gboolean bs = h265parse->format == GST_H265_PARSE_FORMAT_BYTE;
-          const gint nls = 4 - h265parse->nal_length_size;
-          gboolean ok;
-
-          gst_byte_writer_init_with_size (&bw, gst_buffer_get_size (buffer),
-              FALSE);
-          ok = gst_byte_writer_put_buffer (&bw, buffer, 0, h265parse->idr_pos);
+          /* insert config NALs into AU, gathered in a single memory. The
+           * AU data itself is not copied but shared with the new buffer */
+          GstBuffer *new_buf, *codec_nals;
+
+          new_buf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY, 0,
+              h265parse->idr_pos);
           GST_DEBUG_OBJECT (h265parse, "- inserting VPS/SPS/PPS");
-          for (i = 0; i < GST_H265_MAX_VPS_COUNT; i++) {
-            if ((codec_nal = h265parse->vps_nals[i])) {
-              gsize nal_size = gst_buffer_get_size (codec_nal);
-              GST_DEBUG_OBJECT (h265parse, "inserting VPS nal");
-              if (bs) {
-                ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-              } else {
-                ok &= gst_byte_writer_put_uint32_be (&bw,
-                    (nal_size << (nls * 8)));
-                ok &= gst_byte_writer_set_pos (&bw,
-                    gst_byte_writer_get_pos (&bw) - nls);
-              }
-
-              ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
-              h265parse->last_report = new_ts;
-            }
-          }
-          for (i = 0; i < GST_H265_MAX_SPS_COUNT; i++) {
-            if ((codec_nal = h265parse->sps_nals[i])) {
-              gsize nal_size = gst_buffer_get_size (codec_nal);
-              GST_DEBUG_OBJECT (h265parse, "inserting SPS nal");
-              if (bs) {
-                ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-              } else {
-                ok &= gst_byte_writer_put_uint32_be (&bw,
-                    (nal_size << (nls * 8)));
-                ok &= gst_byte_writer_set_pos (&bw,
-                    gst_byte_writer_get_pos (&bw) - nls);
-              }
-
-              ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
-              h265parse->last_report = new_ts;
-            }
-          }
-          for (i = 0; i < GST_H265_MAX_PPS_COUNT; i++) {
-            if ((codec_nal = h265parse->pps_nals[i])) {
-              gsize nal_size = gst_buffer_get_size (codec_nal);
-              GST_DEBUG_OBJECT (h265parse, "inserting PPS nal");
-              if (bs) {
-                ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-              } else {
-                ok &= gst_byte_writer_put_uint32_be (&bw,
-                    (nal_size << (nls * 8)));
-                ok &= gst_byte_writer_set_pos (&bw,
-                    gst_byte_writer_get_pos (&bw) - nls);
-              }
-              ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
-              h265parse->last_report = new_ts;
-            }
+          codec_nals = gst_h265_parse_wrap_codec_nals (h265parse);
+          if (codec_nals) {
+            new_buf = gst_buffer_append (new_buf, codec_nals);
+            h265parse->last_report = new_ts;
           }
-          ok &=
-              gst_byte_writer_put_buffer (&bw, buffer, h265parse->idr_pos, -1);
-          /* collect result and push */
-          new_buf = gst_byte_writer_reset_and_get_buffer (&bw);
+          new_buf = gst_buffer_append (new_buf,
+              gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY,
+                  h265parse->idr_pos, -1));
           gst_buffer_copy_into (new_buf, buffer, GST_BUFFER_COPY_METADATA, 0,
               -1);
           /* should already be keyframe/IDR, but it may not have been,
@@ -1959,10 +2118,6 @@ gst_h265_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
           GST_BUFFER_FLAG_UNSET (new_buf, GST_BUFFER_FLAG_DELTA_UNIT);
           gst_buffer_replace (&frame->out_buffer, new_buf);
           gst_buffer_unref (new_buf);
-          /* some result checking seems to make some compilers happy */
-          if (G_UNLIKELY (!ok)) {
-            GST_ERROR_OBJECT (h265parse, "failed to insert SPS/PPS");
-          }
         }
       }
       /* we pushed whatever we had */
@@ -2054,7 +2209,7 @@ gst_h265_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
           goto hvcc_too_small;
         }
 
-        gst_h265_parse_process_nal (h265parse, &nalu);
+        gst_h265_parse_process_nal (h265parse, &nalu, codec_data);
         off = nalu.offset + nalu.size;
       }
     }
@@ -66,6 +66,9 @@ struct _GstH265Parse
   guint align;
   guint format;
   gint current_off;
+  /* Offset up to which the end of the NAL starting at current_off
+   * was already looked for */
+  gint scan_off;
 
   GstClockTime last_report;
   gboolean push_codec;
@@ -77,11 +80,18 @@ struct _GstH265Parse
   GstBuffer *vps_nals[GST_H265_MAX_VPS_COUNT];
   GstBuffer *sps_nals[GST_H265_MAX_SPS_COUNT];
   GstBuffer *pps_nals[GST_H265_MAX_PPS_COUNT];
+  /* stored SPS and PPS which were parsed before a change of the VPS or SPS
+   * they refer to, and so need to be parsed again even if repeated
+   * unchanged */
+  gboolean sps_nals_stale[GST_H265_MAX_SPS_COUNT];
+  gboolean pps_nals_stale[GST_H265_MAX_PPS_COUNT];
 
   /* frame parsing */
   gint idr_pos, sei_pos;
   gboolean update_caps;
   GstAdapter *frame_out;
+  /* number of memories of the NALs collected in frame_out */
+  guint frame_out_mems;
   gboolean keyframe;
   gboolean header;
   /* AU state */
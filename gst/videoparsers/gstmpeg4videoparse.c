@@ -61,12 +61,14 @@ static GstStaticPadTemplate sink_template =
 /* Properties */
 #define DEFAULT_PROP_DROP TRUE
 #define DEFAULT_CONFIG_INTERVAL (0)
+#define DEFAULT_GOP_INDEX FALSE
 
 enum
 {
   PROP_0,
   PROP_DROP,
-  PROP_CONFIG_INTERVAL
+  PROP_CONFIG_INTERVAL,
+  PROP_GOP_INDEX
 };
 
 #define gst_mpeg4vparse_parent_class parent_class
@@ -105,6 +107,9 @@ gst_mpeg4vparse_set_property (GObject * object, guint property_id,
     case PROP_CONFIG_INTERVAL:
       parse->interval = g_value_get_uint (value);
       break;
+    case PROP_GOP_INDEX:
+      parse->post_gop_index = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
   }
@@ -123,6 +128,9 @@ gst_mpeg4vparse_get_property (GObject * object, guint property_id,
     case PROP_CONFIG_INTERVAL:
       g_value_set_uint (value, parse->interval);
       break;
+    case PROP_GOP_INDEX:
+      g_value_set_boolean (value, parse->post_gop_index);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
   }
@@ -154,6 +162,20 @@ gst_mpeg4vparse_class_init (GstMpeg4VParseClass * klass)
           0, 3600, DEFAULT_CONFIG_INTERVAL,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstMpeg4VParse:gop-index:
+   *
+   * Post a "gop-index" element message with the type and input byte offset
+   * of the pictures of each GOP.
+   *
+   * Since: 1.10
+   */
+  g_object_class_install_property (gobject_class, PROP_GOP_INDEX,
+      g_param_spec_boolean ("gop-index", "GOP index",
+          "Post the picture types and byte offsets of each GOP in an "
+          "element message", DEFAULT_GOP_INDEX,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (element_class, &src_template);
   gst_element_class_add_static_pad_template (element_class, &sink_template);
 
@@ -182,6 +204,12 @@ gst_mpeg4vparse_init (GstMpeg4VParse * parse)
 {
   parse->interval = DEFAULT_CONFIG_INTERVAL;
   parse->last_report = GST_CLOCK_TIME_NONE;
+  parse->post_gop_index = DEFAULT_GOP_INDEX;
+  gop_index_init (&parse->gop_index);
+
+  gst_pad_add_probe (GST_BASE_PARSE_SRC_PAD (parse),
+      GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, gop_index_src_event_probe,
+      &parse->gop_index, NULL);
 
   gst_base_parse_set_pts_interpolation (GST_BASE_PARSE (parse), FALSE);
   GST_PAD_SET_ACCEPT_INTERSECT (GST_BASE_PARSE_SINK_PAD (parse));
@@ -198,6 +226,7 @@ gst_mpeg4vparse_reset_frame (GstMpeg4VParse * mp4vparse)
   mp4vparse->config_found = FALSE;
   mp4vparse->vol_offset = -1;
   mp4vparse->vo_offset = -1;
+  mp4vparse->picture_type = 0;
 }
 
 static void
@@ -213,6 +242,7 @@ gst_mpeg4vparse_reset (GstMpeg4VParse * mp4vparse)
 
   gst_buffer_replace (&mp4vparse->config, NULL);
   memset (&mp4vparse->vol, 0, sizeof (mp4vparse->vol));
+  gop_index_clear (&mp4vparse->gop_index);
 }
 
 static gboolean
@@ -306,6 +336,24 @@ gst_mpeg4vparse_process_config (GstMpeg4VParse * mp4vparse,
   return TRUE;
 }
 
+/* sets the type of the VOP found at vop_offset */
+static void
+gst_mpeg4vparse_process_vop_type (GstMpeg4VParse * mp4vparse,
+    const guint8 * data, gsize size)
+{
+  if (G_LIKELY (size > mp4vparse->vop_offset + 1)) {
+    GstMpeg4VideoObjectCodingType coding_type =
+        data[mp4vparse->vop_offset + 1] >> 6 & 0x3;
+
+    mp4vparse->intra_frame = (coding_type == GST_MPEG4_I_VOP);
+    mp4vparse->picture_type = "IPBS"[coding_type];
+  } else {
+    GST_WARNING_OBJECT (mp4vparse, "no data following VOP startcode");
+    mp4vparse->intra_frame = FALSE;
+    mp4vparse->picture_type = 0;
+  }
+}
+
 /* caller guarantees at least start code in @buf at @off */
 static gboolean
 gst_mpeg4vparse_process_sc (GstMpeg4VParse * mp4vparse, GstMpeg4Packet * packet,
@@ -318,13 +366,7 @@ gst_mpeg4vparse_process_sc (GstMpeg4VParse * mp4vparse, GstMpeg4Packet * packet,
    * except for final VOS end sequence code included in last VOP-frame */
   if (mp4vparse->vop_offset >= 0 &&
       packet->type != GST_MPEG4_VISUAL_OBJ_SEQ_END) {
-    if (G_LIKELY (size > mp4vparse->vop_offset + 1)) {
-      mp4vparse->intra_frame =
-          ((packet->data[mp4vparse->vop_offset + 1] >> 6 & 0x3) == 0);
-    } else {
-      GST_WARNING_OBJECT (mp4vparse, "no data following VOP startcode");
-      mp4vparse->intra_frame = FALSE;
-    }
+    gst_mpeg4vparse_process_vop_type (mp4vparse, packet->data, size);
     GST_LOG_OBJECT (mp4vparse, "ending frame of size %d, is intra %d",
         packet->offset - 3, mp4vparse->intra_frame);
     return TRUE;
@@ -502,6 +544,9 @@ next:
       if (GST_BASE_PARSE_DRAINING (parse)) {
         framesize = size;
         ret = TRUE;
+        /* no start code ends the last VOP */
+        if (mp4vparse->vop_offset >= 0)
+          gst_mpeg4vparse_process_vop_type (mp4vparse, data, size);
       } else {
         /* resume scan where we left it */
         mp4vparse->last_sc = size - 3;
@@ -744,6 +789,10 @@ gst_mpeg4vparse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
     mp4vparse->sent_codec_tag = TRUE;
   }
 
+  if (mp4vparse->post_gop_index && mp4vparse->picture_type)
+    gop_index_add_picture (&mp4vparse->gop_index, GST_ELEMENT_CAST (parse),
+        mp4vparse->picture_type, frame->offset, GST_BUFFER_TIMESTAMP (buffer));
+
   if ((event = check_pending_key_unit_event (mp4vparse->force_key_unit_event,
               &parse->segment, GST_BUFFER_TIMESTAMP (buffer),
               GST_BUFFER_FLAGS (buffer), mp4vparse->pending_key_unit_ts))) {
@@ -25,6 +25,8 @@
 
 #include <gst/codecparsers/gstmpeg4parser.h>
 
+#include "gopindex.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_MPEG4VIDEO_PARSE            (gst_mpeg4vparse_get_type())
@@ -53,6 +55,8 @@ struct _GstMpeg4VParse {
   gboolean vo_found;
   gboolean config_found;
   gboolean intra_frame;
+  /* I, P, B or S for the current VOP, 0 if unknown */
+  gchar picture_type;
   gboolean update_caps;
   gboolean sent_codec_tag;
 
@@ -72,6 +76,9 @@ struct _GstMpeg4VParse {
   guint interval;
   GstClockTime pending_key_unit_ts;
   GstEvent *force_key_unit_event;
+  gboolean post_gop_index;
+
+  GopIndex gop_index;
 };
 
 struct _GstMpeg4VParseClass {
@@ -184,10 +184,22 @@ static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
         "header-format=(string) {none, asf, sequence-layer}"));
 
 
+#define DEFAULT_GOP_INDEX FALSE
+
+enum
+{
+  PROP_0,
+  PROP_GOP_INDEX
+};
+
 #define parent_class gst_vc1_parse_parent_class
 G_DEFINE_TYPE (GstVC1Parse, gst_vc1_parse, GST_TYPE_BASE_PARSE);
 
 static void gst_vc1_parse_finalize (GObject * object);
+static void gst_vc1_parse_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_vc1_parse_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 
 static gboolean gst_vc1_parse_start (GstBaseParse * parse);
 static gboolean gst_vc1_parse_stop (GstBaseParse * parse);
@@ -221,6 +233,22 @@ gst_vc1_parse_class_init (GstVC1ParseClass * klass)
   GST_DEBUG_CATEGORY_INIT (vc1_parse_debug, "vc1parse", 0, "vc1 parser");
 
   gobject_class->finalize = gst_vc1_parse_finalize;
+  gobject_class->set_property = gst_vc1_parse_set_property;
+  gobject_class->get_property = gst_vc1_parse_get_property;
+
+  /**
+   * GstVC1Parse:gop-index:
+   *
+   * Post a "gop-index" element message with the type and input byte offset
+   * of the pictures of each GOP.
+   *
+   * Since: 1.10
+   */
+  g_object_class_install_property (gobject_class, PROP_GOP_INDEX,
+      g_param_spec_boolean ("gop-index", "GOP index",
+          "Post the picture types and byte offsets of each GOP in an "
+          "element message", DEFAULT_GOP_INDEX,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_add_static_pad_template (element_class, &srctemplate);
   gst_element_class_add_static_pad_template (element_class, &sinktemplate);
@@ -248,9 +276,48 @@ gst_vc1_parse_init (GstVC1Parse * vc1parse)
   gst_base_parse_set_syncable (GST_BASE_PARSE (vc1parse), TRUE);
   gst_base_parse_set_has_timing_info (GST_BASE_PARSE (vc1parse), FALSE);
 
+  vc1parse->post_gop_index = DEFAULT_GOP_INDEX;
+  gop_index_init (&vc1parse->gop_index);
+
   gst_vc1_parse_reset (vc1parse);
   GST_PAD_SET_ACCEPT_INTERSECT (GST_BASE_PARSE_SINK_PAD (vc1parse));
   GST_PAD_SET_ACCEPT_TEMPLATE (GST_BASE_PARSE_SINK_PAD (vc1parse));
+
+  gst_pad_add_probe (GST_BASE_PARSE_SRC_PAD (vc1parse),
+      GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, gop_index_src_event_probe,
+      &vc1parse->gop_index, NULL);
+}
+
+static void
+gst_vc1_parse_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstVC1Parse *vc1parse = GST_VC1_PARSE (object);
+
+  switch (prop_id) {
+    case PROP_GOP_INDEX:
+      vc1parse->post_gop_index = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_vc1_parse_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstVC1Parse *vc1parse = GST_VC1_PARSE (object);
+
+  switch (prop_id) {
+    case PROP_GOP_INDEX:
+      g_value_set_boolean (value, vc1parse->post_gop_index);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
 }
 
 static void
@@ -289,6 +356,8 @@ gst_vc1_parse_reset (GstVC1Parse * vc1parse)
 
   vc1parse->seq_layer_sent = FALSE;
   vc1parse->frame_layer_first_frame_sent = FALSE;
+
+  gop_index_clear (&vc1parse->gop_index);
 }
 
 static gboolean
@@ -1078,6 +1147,44 @@ calculate_mb_size (GstVC1SeqHdr * seqhdr, guint width, guint height)
   seqhdr->mb_stride = seqhdr->mb_width + 1;
 }
 
+static gchar
+gst_vc1_parse_picture_type (GstVC1PictureType ptype)
+{
+  switch (ptype) {
+    case GST_VC1_PICTURE_TYPE_I:
+      return 'I';
+    case GST_VC1_PICTURE_TYPE_P:
+      return 'P';
+    case GST_VC1_PICTURE_TYPE_B:
+    case GST_VC1_PICTURE_TYPE_BI:
+      return 'B';
+    case GST_VC1_PICTURE_TYPE_SKIPPED:
+      return 'S';
+    default:
+      return 0;
+  }
+}
+
+/* parses the header of the simple/main profile frame at @data */
+static GstVC1ParserResult
+gst_vc1_parse_simple_main_frame_header (GstVC1Parse * vc1parse,
+    const guint8 * data, gsize size, GstVC1FrameHdr * frame_hdr)
+{
+  GstVC1SeqHdr seq_hdr;
+
+  if (!vc1parse->seq_hdr_buffer) {
+    /* Build seq_hdr from sequence-layer to be able to parse frame */
+    seq_hdr.profile = vc1parse->profile;
+    seq_hdr.struct_c = vc1parse->seq_layer.struct_c;
+    calculate_mb_size (&seq_hdr, vc1parse->seq_layer.struct_a.horiz_size,
+        vc1parse->seq_layer.struct_a.vert_size);
+  } else {
+    seq_hdr = vc1parse->seq_hdr;
+  }
+
+  return gst_vc1_parse_frame_header (data, size, frame_hdr, &seq_hdr, NULL);
+}
+
 static gboolean
 gst_vc1_parse_handle_bdu (GstVC1Parse * vc1parse, GstVC1StartCode startcode,
     GstBuffer * buffer, guint offset, guint size)
@@ -1102,6 +1209,16 @@ gst_vc1_parse_handle_bdu (GstVC1Parse * vc1parse, GstVC1StartCode startcode,
       break;
     case GST_VC1_FRAME:
       /* TODO: Check if keyframe */
+      if (vc1parse->post_gop_index && vc1parse->entrypoint_buffer) {
+        GstVC1FrameHdr frame_hdr;
+        GstMapInfo minfo;
+
+        gst_buffer_map (buffer, &minfo, GST_MAP_READ);
+        if (gst_vc1_parse_frame_header (minfo.data + offset, size,
+                &frame_hdr, &vc1parse->seq_hdr, NULL) == GST_VC1_PARSER_OK)
+          vc1parse->picture_type = gst_vc1_parse_picture_type (frame_hdr.ptype);
+        gst_buffer_unmap (buffer, &minfo);
+      }
       break;
     default:
       break;
@@ -1170,6 +1287,7 @@ gst_vc1_parse_handle_frame (GstBaseParse * parse, GstBaseParseFrame * frame,
   memset (&minfo, 0, sizeof (minfo));
 
   *skipsize = 0;
+  vc1parse->picture_type = 0;
 
   if (vc1parse->renegotiate
       || gst_pad_check_reconfigure (GST_BASE_PARSE_SRC_PAD (parse))) {
@@ -1383,31 +1501,30 @@ gst_vc1_parse_handle_frame (GstBaseParse * parse, GstBaseParseFrame * frame,
       } else {
         /* Must be a frame or a frame + field */
         /* TODO: Check if keyframe */
+        if (vc1parse->post_gop_index && vc1parse->entrypoint_buffer) {
+          GstVC1FrameHdr frame_hdr;
+
+          if (gst_vc1_parse_frame_header (data, size, &frame_hdr,
+                  &vc1parse->seq_hdr, NULL) == GST_VC1_PARSER_OK)
+            vc1parse->picture_type =
+                gst_vc1_parse_picture_type (frame_hdr.ptype);
+        }
       }
     } else {
       /* In simple/main, we basically have a raw frame, so parse it */
       GstVC1ParserResult pres;
       GstVC1FrameHdr frame_hdr;
-      GstVC1SeqHdr seq_hdr;
 
-      if (!vc1parse->seq_hdr_buffer) {
-        /* Build seq_hdr from sequence-layer to be able to parse frame */
-        seq_hdr.profile = vc1parse->profile;
-        seq_hdr.struct_c = vc1parse->seq_layer.struct_c;
-        calculate_mb_size (&seq_hdr, vc1parse->seq_layer.struct_a.horiz_size,
-            vc1parse->seq_layer.struct_a.vert_size);
-      } else {
-        seq_hdr = vc1parse->seq_hdr;
-      }
-
-      pres = gst_vc1_parse_frame_header (data, size, &frame_hdr,
-          &seq_hdr, NULL);
+      pres = gst_vc1_parse_simple_main_frame_header (vc1parse, data, size,
+          &frame_hdr);
       if (pres != GST_VC1_PARSER_OK) {
         GST_ERROR_OBJECT (vc1parse, "Invalid VC1 frame header");
         ret = GST_FLOW_ERROR;
         goto done;
       }
 
+      vc1parse->picture_type = gst_vc1_parse_picture_type (frame_hdr.ptype);
+
       if (frame_hdr.ptype == GST_VC1_PICTURE_TYPE_I)
         GST_BUFFER_FLAG_UNSET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
       else
@@ -1486,6 +1603,12 @@ gst_vc1_parse_handle_frame (GstBaseParse * parse, GstBaseParseFrame * frame,
         ret = GST_FLOW_ERROR;
         goto done;
       }
+    } else if (vc1parse->post_gop_index) {
+      GstVC1FrameHdr frame_hdr;
+
+      if (gst_vc1_parse_simple_main_frame_header (vc1parse, data + 8,
+              size - 8, &frame_hdr) == GST_VC1_PARSER_OK)
+        vc1parse->picture_type = gst_vc1_parse_picture_type (frame_hdr.ptype);
     }
   }
 
@@ -1722,6 +1845,11 @@ gst_vc1_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
     vc1parse->sent_codec_tag = TRUE;
   }
 
+  if (vc1parse->post_gop_index && vc1parse->picture_type)
+    gop_index_add_picture (&vc1parse->gop_index, GST_ELEMENT_CAST (parse),
+        vc1parse->picture_type, frame->offset,
+        GST_BUFFER_TIMESTAMP (frame->buffer));
+
   /* Nothing to do here */
   if (vc1parse->input_stream_format == vc1parse->output_stream_format)
     return GST_FLOW_OK;
@@ -2254,6 +2382,19 @@ gst_vc1_parse_handle_entrypoint (GstVC1Parse * vc1parse,
   vc1parse->entrypoint_buffer =
       gst_buffer_copy_region (buf, GST_BUFFER_COPY_ALL, offset, size);
 
+  /* needed to parse the frame headers, always kept up to date in case the
+   * GOP index gets enabled later on */
+  if (vc1parse->seq_hdr_buffer) {
+    GstMapInfo minfo;
+
+    gst_buffer_map (buf, &minfo, GST_MAP_READ);
+    if (gst_vc1_parse_entry_point_header (minfo.data + offset, size,
+            &vc1parse->seq_hdr.advanced.entrypoint, &vc1parse->seq_hdr)
+        != GST_VC1_PARSER_OK)
+      GST_WARNING_OBJECT (vc1parse, "Failed to parse entrypoint header");
+    gst_buffer_unmap (buf, &minfo);
+  }
+
   return TRUE;
 }
 
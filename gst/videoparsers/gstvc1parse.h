@@ -25,6 +25,8 @@
 #include <gst/base/gstbaseparse.h>
 #include <gst/codecparsers/gstvc1parser.h>
 
+#include "gopindex.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_VC1_PARSE \
@@ -107,6 +109,8 @@ struct _GstVC1Parse
    * valid if the GstBaseParseFrame has the
    * GST_BASE_PARSE_FRAME_FLAG_PARSING flag */
   GstVC1StartCode startcode;
+  /* I, P, B or S for the picture of the current frame, 0 if unknown */
+  gchar picture_type;
 
   /* TRUE if we have already sent the sequence-layer,
    * use for stream-format conversion */
@@ -115,6 +119,11 @@ struct _GstVC1Parse
   /* TRUE if we have already sent the frame-layer first frame,
    * use for stream-format conversion */
   gboolean frame_layer_first_frame_sent;
+
+  /* properties */
+  gboolean post_gop_index;
+
+  GopIndex gop_index;
 };
 
 struct _GstVC1ParseClass
@@ -0,0 +1,573 @@
+/* GStreamer VP9 Parser
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:element-vp9parse
+ *
+ * Parses VP9 frames, as output by demuxers, one frame or superframe per
+ * buffer. Key frames are flagged and the frame size, profile, chroma format
+ * and bit depth are put in the output caps.
+ *
+ * With alignment=frame on the output caps, superframes are split into the
+ * frames they contain. The frames are pushed without copying their data,
+ * the frames which are not shown being flagged as decode only, and the
+ * superframe index is dropped.
+ *
+ * Only the beginning of the frame headers is parsed, up to the frame size.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 filesrc location=video.webm ! matroskademux ! vp9parse ! video/x-vp9,alignment=frame ! fakesink
+ * ]|
+ * </refsect2>
+ *
+ * Since: 1.10
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstvp9parse.h"
+
+GST_DEBUG_CATEGORY (vp9_parse_debug);
+#define GST_CAT_DEFAULT vp9_parse_debug
+
+/* the frame header parser doesn't check the size of the data it reads,
+ * shorter frames are padded to this size before being parsed */
+#define GST_VP9_PARSE_MIN_HEADER_SIZE 32
+
+enum
+{
+  GST_VP9_PARSE_ALIGN_NONE = 0,
+  GST_VP9_PARSE_ALIGN_SUPER_FRAME,
+  GST_VP9_PARSE_ALIGN_FRAME
+};
+
+static GstStaticPadTemplate srctemplate =
+GST_STATIC_PAD_TEMPLATE ("src", GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-vp9, parsed = (boolean) true, "
+        "alignment = (string) { super-frame, frame }")
+    );
+
+static GstStaticPadTemplate sinktemplate =
+GST_STATIC_PAD_TEMPLATE ("sink", GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-vp9")
+    );
+
+#define parent_class gst_vp9_parse_parent_class
+G_DEFINE_TYPE (GstVp9Parse, gst_vp9_parse, GST_TYPE_BASE_PARSE);
+
+static gboolean gst_vp9_parse_start (GstBaseParse * parse);
+static gboolean gst_vp9_parse_stop (GstBaseParse * parse);
+static gboolean gst_vp9_parse_set_caps (GstBaseParse * parse, GstCaps * caps);
+static GstCaps *gst_vp9_parse_get_caps (GstBaseParse * parse,
+    GstCaps * filter);
+static gboolean gst_vp9_parse_event (GstBaseParse * parse, GstEvent * event);
+static GstFlowReturn gst_vp9_parse_handle_frame (GstBaseParse * parse,
+    GstBaseParseFrame * frame, gint * skipsize);
+
+static void
+gst_vp9_parse_class_init (GstVp9ParseClass * klass)
+{
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+  GstBaseParseClass *parse_class = GST_BASE_PARSE_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (vp9_parse_debug, "vp9parse", 0, "vp9 parser");
+
+  gst_element_class_add_static_pad_template (gstelement_class, &srctemplate);
+  gst_element_class_add_static_pad_template (gstelement_class, &sinktemplate);
+  gst_element_class_set_static_metadata (gstelement_class, "VP9 parser",
+      "Codec/Parser/Converter/Video",
+      "Parses VP9 streams", "GStreamer maintainers");
+
+  /* Override BaseParse vfuncs */
+  parse_class->start = GST_DEBUG_FUNCPTR (gst_vp9_parse_start);
+  parse_class->stop = GST_DEBUG_FUNCPTR (gst_vp9_parse_stop);
+  parse_class->set_sink_caps = GST_DEBUG_FUNCPTR (gst_vp9_parse_set_caps);
+  parse_class->get_sink_caps = GST_DEBUG_FUNCPTR (gst_vp9_parse_get_caps);
+  parse_class->sink_event = GST_DEBUG_FUNCPTR (gst_vp9_parse_event);
+  parse_class->handle_frame = GST_DEBUG_FUNCPTR (gst_vp9_parse_handle_frame);
+}
+
+static void
+gst_vp9_parse_init (GstVp9Parse * vp9parse)
+{
+  /* the timestamps of the superframes are given to the frames they contain,
+   * don't interpolate them */
+  gst_base_parse_set_pts_interpolation (GST_BASE_PARSE (vp9parse), FALSE);
+  gst_base_parse_set_infer_ts (GST_BASE_PARSE (vp9parse), FALSE);
+
+  GST_PAD_SET_ACCEPT_INTERSECT (GST_BASE_PARSE_SINK_PAD (vp9parse));
+  GST_PAD_SET_ACCEPT_TEMPLATE (GST_BASE_PARSE_SINK_PAD (vp9parse));
+}
+
+static void
+gst_vp9_parse_reset_superframe (GstVp9Parse * vp9parse)
+{
+  memset (&vp9parse->superframe, 0, sizeof (vp9parse->superframe));
+  vp9parse->current_frame = 0;
+  vp9parse->superframe_pts = GST_CLOCK_TIME_NONE;
+  vp9parse->superframe_dts = GST_CLOCK_TIME_NONE;
+}
+
+static void
+gst_vp9_parse_reset (GstVp9Parse * vp9parse)
+{
+  vp9parse->width = 0;
+  vp9parse->height = 0;
+  vp9parse->profile = GST_VP9_PROFILE_UNDEFINED;
+  vp9parse->bit_depth = 0;
+  vp9parse->subsampling_x = -1;
+  vp9parse->subsampling_y = -1;
+  vp9parse->fps_num = 0;
+  vp9parse->fps_den = 0;
+  vp9parse->par_num = 0;
+  vp9parse->par_den = 0;
+  vp9parse->update_caps = TRUE;
+
+  gst_vp9_parse_reset_superframe (vp9parse);
+}
+
+static gboolean
+gst_vp9_parse_start (GstBaseParse * parse)
+{
+  GstVp9Parse *vp9parse = GST_VP9_PARSE (parse);
+
+  GST_DEBUG_OBJECT (vp9parse, "start");
+
+  vp9parse->parser = gst_vp9_parser_new ();
+  vp9parse->align = GST_VP9_PARSE_ALIGN_NONE;
+  gst_vp9_parse_reset (vp9parse);
+
+  gst_base_parse_set_min_frame_size (parse, 1);
+
+  return TRUE;
+}
+
+static gboolean
+gst_vp9_parse_stop (GstBaseParse * parse)
+{
+  GstVp9Parse *vp9parse = GST_VP9_PARSE (parse);
+
+  GST_DEBUG_OBJECT (vp9parse, "stop");
+
+  gst_vp9_parser_free (vp9parse->parser);
+  vp9parse->parser = NULL;
+
+  return TRUE;
+}
+
+static const gchar *
+gst_vp9_parse_get_align_string (guint align)
+{
+  switch (align) {
+    case GST_VP9_PARSE_ALIGN_SUPER_FRAME:
+      return "super-frame";
+    case GST_VP9_PARSE_ALIGN_FRAME:
+      return "frame";
+    default:
+      return "none";
+  }
+}
+
+static guint
+gst_vp9_parse_align_from_caps (GstCaps * caps)
+{
+  const gchar *str;
+
+  if (!caps || gst_caps_get_size (caps) == 0)
+    return GST_VP9_PARSE_ALIGN_NONE;
+
+  str = gst_structure_get_string (gst_caps_get_structure (caps, 0),
+      "alignment");
+  if (g_strcmp0 (str, "super-frame") == 0)
+    return GST_VP9_PARSE_ALIGN_SUPER_FRAME;
+  else if (g_strcmp0 (str, "frame") == 0)
+    return GST_VP9_PARSE_ALIGN_FRAME;
+
+  return GST_VP9_PARSE_ALIGN_NONE;
+}
+
+/* check downstream caps to configure alignment */
+static void
+gst_vp9_parse_negotiate (GstVp9Parse * vp9parse)
+{
+  GstCaps *caps;
+  guint align = GST_VP9_PARSE_ALIGN_NONE;
+
+  caps = gst_pad_get_allowed_caps (GST_BASE_PARSE_SRC_PAD (vp9parse));
+  GST_DEBUG_OBJECT (vp9parse, "allowed caps: %" GST_PTR_FORMAT, caps);
+
+  /* concentrate on leading structure, since decodebin parser
+   * capsfilter always includes parser template caps */
+  if (caps && !gst_caps_is_empty (caps)) {
+    caps = gst_caps_truncate (caps);
+    /* fixate to avoid ambiguity with lists when parsing */
+    caps = gst_caps_fixate (caps);
+    align = gst_vp9_parse_align_from_caps (caps);
+  }
+
+  if (caps)
+    gst_caps_unref (caps);
+
+  /* default */
+  if (!align)
+    align = GST_VP9_PARSE_ALIGN_SUPER_FRAME;
+
+  GST_DEBUG_OBJECT (vp9parse, "selected alignment %s",
+      gst_vp9_parse_get_align_string (align));
+
+  if (align != vp9parse->align) {
+    vp9parse->align = align;
+    vp9parse->update_caps = TRUE;
+  }
+}
+
+static const gchar *
+gst_vp9_parse_get_chroma_format (GstVp9Parse * vp9parse)
+{
+  if (vp9parse->subsampling_x == 1 && vp9parse->subsampling_y == 1)
+    return "4:2:0";
+  else if (vp9parse->subsampling_x == 1 && vp9parse->subsampling_y == 0)
+    return "4:2:2";
+  else if (vp9parse->subsampling_x == 0 && vp9parse->subsampling_y == 1)
+    return "4:4:0";
+  else if (vp9parse->subsampling_x == 0 && vp9parse->subsampling_y == 0)
+    return "4:4:4";
+
+  return NULL;
+}
+
+static void
+gst_vp9_parse_update_src_caps (GstVp9Parse * vp9parse)
+{
+  GstCaps *sink_caps, *src_caps, *caps;
+  GstStructure *s = NULL;
+  const gchar *chroma_format;
+
+  if (G_LIKELY (!vp9parse->update_caps) &&
+      gst_pad_has_current_caps (GST_BASE_PARSE_SRC_PAD (vp9parse)))
+    return;
+
+  /* carry over input caps as much as possible; override with our own stuff */
+  sink_caps = gst_pad_get_current_caps (GST_BASE_PARSE_SINK_PAD (vp9parse));
+  if (sink_caps) {
+    caps = gst_caps_copy (sink_caps);
+    s = gst_caps_get_structure (sink_caps, 0);
+  } else {
+    caps = gst_caps_new_empty_simple ("video/x-vp9");
+  }
+
+  if (vp9parse->width > 0 && vp9parse->height > 0)
+    gst_caps_set_simple (caps, "width", G_TYPE_INT, vp9parse->width,
+        "height", G_TYPE_INT, vp9parse->height, NULL);
+
+  if (vp9parse->profile < GST_VP9_PROFILE_UNDEFINED) {
+    gchar *profile = g_strdup_printf ("%u", vp9parse->profile);
+
+    gst_caps_set_simple (caps, "profile", G_TYPE_STRING, profile, NULL);
+    g_free (profile);
+  }
+
+  chroma_format = gst_vp9_parse_get_chroma_format (vp9parse);
+  if (chroma_format)
+    gst_caps_set_simple (caps, "chroma-format", G_TYPE_STRING, chroma_format,
+        NULL);
+
+  if (vp9parse->bit_depth > 0)
+    gst_caps_set_simple (caps, "bit-depth-luma", G_TYPE_UINT,
+        vp9parse->bit_depth, "bit-depth-chroma", G_TYPE_UINT,
+        vp9parse->bit_depth, NULL);
+
+  if (vp9parse->par_num > 0 && vp9parse->par_den > 0 &&
+      (!s || !gst_structure_has_field (s, "pixel-aspect-ratio")))
+    gst_caps_set_simple (caps, "pixel-aspect-ratio", GST_TYPE_FRACTION,
+        vp9parse->par_num, vp9parse->par_den, NULL);
+
+  gst_caps_set_simple (caps, "parsed", G_TYPE_BOOLEAN, TRUE,
+      "alignment", G_TYPE_STRING,
+      gst_vp9_parse_get_align_string (vp9parse->align), NULL);
+
+  src_caps = gst_pad_get_current_caps (GST_BASE_PARSE_SRC_PAD (vp9parse));
+  if (!(src_caps && gst_caps_is_strictly_equal (src_caps, caps))) {
+    GST_DEBUG_OBJECT (vp9parse, "setting caps %" GST_PTR_FORMAT, caps);
+    gst_pad_set_caps (GST_BASE_PARSE_SRC_PAD (vp9parse), caps);
+  }
+
+  if (src_caps)
+    gst_caps_unref (src_caps);
+  if (sink_caps)
+    gst_caps_unref (sink_caps);
+  gst_caps_unref (caps);
+
+  vp9parse->update_caps = FALSE;
+}
+
+/* Parses the header of the frame of @size bytes at @data, up to the frame
+ * size, and updates the stream info with the key frames and intra-only
+ * frames. Returns FALSE if the header is invalid */
+static gboolean
+gst_vp9_parse_parse_frame_header (GstVp9Parse * vp9parse, const guint8 * data,
+    gsize size, gboolean * keyframe, gboolean * shown)
+{
+  GstVp9Parser *parser = vp9parse->parser;
+  GstVp9FrameHdr frame_hdr;
+  guint8 padded[GST_VP9_PARSE_MIN_HEADER_SIZE] = { 0, };
+
+  *keyframe = FALSE;
+  *shown = TRUE;
+
+  if (size < GST_VP9_PARSE_MIN_HEADER_SIZE) {
+    memcpy (padded, data, size);
+    data = padded;
+    size = sizeof (padded);
+  }
+
+  if (gst_vp9_parser_parse_frame_header_with_depth (parser, &frame_hdr, data,
+          size, GST_VP9_FRAME_HDR_PARSE_DEPTH_FRAME_SIZE) !=
+      GST_VP9_PARSER_OK) {
+    GST_WARNING_OBJECT (vp9parse, "failed to parse frame header");
+    return FALSE;
+  }
+
+  /* frame_type is not set for those */
+  if (frame_hdr.show_existing_frame)
+    return TRUE;
+
+  *keyframe = frame_hdr.frame_type == GST_VP9_KEY_FRAME;
+  *shown = frame_hdr.show_frame;
+
+  if (!*keyframe && !frame_hdr.intra_only)
+    return TRUE;
+
+  if (vp9parse->width != frame_hdr.width ||
+      vp9parse->height != frame_hdr.height ||
+      vp9parse->profile != frame_hdr.profile ||
+      vp9parse->bit_depth != parser->bit_depth ||
+      vp9parse->subsampling_x != parser->subsampling_x ||
+      vp9parse->subsampling_y != parser->subsampling_y) {
+    GST_INFO_OBJECT (vp9parse, "profile %u, %ux%u, %u bits, subsampling "
+        "%d/%d", frame_hdr.profile, frame_hdr.width, frame_hdr.height,
+        parser->bit_depth, parser->subsampling_x, parser->subsampling_y);
+
+    vp9parse->width = frame_hdr.width;
+    vp9parse->height = frame_hdr.height;
+    vp9parse->profile = frame_hdr.profile;
+    vp9parse->bit_depth = parser->bit_depth;
+    vp9parse->subsampling_x = parser->subsampling_x;
+    vp9parse->subsampling_y = parser->subsampling_y;
+    vp9parse->update_caps = TRUE;
+  }
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_vp9_parse_handle_frame (GstBaseParse * parse,
+    GstBaseParseFrame * frame, gint * skipsize)
+{
+  GstVp9Parse *vp9parse = GST_VP9_PARSE (parse);
+  GstVp9SuperframeInfo *superframe = &vp9parse->superframe;
+  GstBuffer *buffer = frame->buffer;
+  GstMapInfo map;
+  gboolean keyframe, shown;
+  gsize size;
+
+  if (G_UNLIKELY (vp9parse->align == GST_VP9_PARSE_ALIGN_NONE))
+    gst_vp9_parse_negotiate (vp9parse);
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+
+  if (vp9parse->current_frame == 0) {
+    if (gst_vp9_parser_parse_superframe_info (vp9parse->parser, superframe,
+            map.data, map.size) != GST_VP9_PARSER_OK) {
+      /* pass it as a single frame, the decoder will deal with it */
+      GST_WARNING_OBJECT (vp9parse, "invalid superframe index");
+      memset (superframe, 0, sizeof (*superframe));
+      superframe->frames_in_superframe = 1;
+      superframe->frame_sizes[0] = map.size;
+    }
+
+    vp9parse->superframe_pts = GST_BUFFER_PTS (buffer);
+    vp9parse->superframe_dts = GST_BUFFER_DTS (buffer);
+  }
+
+  if (vp9parse->align == GST_VP9_PARSE_ALIGN_FRAME) {
+    if (vp9parse->current_frame == superframe->frames_in_superframe) {
+      /* all the frames were pushed, only the index is left */
+      GST_LOG_OBJECT (vp9parse, "dropping superframe index");
+      size = MIN (superframe->superframe_index_size, map.size);
+      frame->flags |= GST_BASE_PARSE_FRAME_FLAG_DROP;
+      gst_vp9_parse_reset_superframe (vp9parse);
+      goto done;
+    }
+
+    size = superframe->frame_sizes[vp9parse->current_frame];
+    if (G_UNLIKELY (size > map.size)) {
+      GST_WARNING_OBJECT (vp9parse, "lost track of superframe, "
+          "%" G_GSIZE_FORMAT " bytes expected, %" G_GSIZE_FORMAT " available",
+          size, map.size);
+      size = map.size;
+      gst_vp9_parse_reset_superframe (vp9parse);
+    } else if (++vp9parse->current_frame == superframe->frames_in_superframe
+        && superframe->superframe_index_size == 0) {
+      vp9parse->current_frame = 0;
+    }
+
+    gst_vp9_parse_parse_frame_header (vp9parse, map.data, size, &keyframe,
+        &shown);
+
+    /* the superframe shows at most one frame, which gets its timestamp */
+    GST_BUFFER_DTS (buffer) = vp9parse->superframe_dts;
+    if (shown) {
+      GST_BUFFER_PTS (buffer) = vp9parse->superframe_pts;
+      GST_BUFFER_FLAG_UNSET (buffer, GST_BUFFER_FLAG_DECODE_ONLY);
+    } else {
+      GST_BUFFER_PTS (buffer) = GST_CLOCK_TIME_NONE;
+      GST_BUFFER_DURATION (buffer) = 0;
+      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DECODE_ONLY);
+    }
+  } else {
+    gboolean frame_keyframe;
+    gsize offset = 0;
+    guint i;
+
+    /* the frame headers are parsed anyway, to keep track of the sizes of
+     * the reference frames */
+    keyframe = FALSE;
+    for (i = 0; i < superframe->frames_in_superframe; i++) {
+      gst_vp9_parse_parse_frame_header (vp9parse, map.data + offset,
+          superframe->frame_sizes[i], &frame_keyframe, &shown);
+      if (i == 0)
+        keyframe = frame_keyframe;
+      offset += superframe->frame_sizes[i];
+    }
+
+    size = map.size;
+    vp9parse->current_frame = 0;
+  }
+
+  if (keyframe)
+    GST_BUFFER_FLAG_UNSET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+  else
+    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  gst_vp9_parse_update_src_caps (vp9parse);
+
+done:
+  gst_buffer_unmap (buffer, &map);
+
+  return gst_base_parse_finish_frame (parse, frame, size);
+}
+
+static gboolean
+gst_vp9_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
+{
+  GstVp9Parse *vp9parse = GST_VP9_PARSE (parse);
+  GstStructure *s = gst_caps_get_structure (caps, 0);
+
+  /* accept upstream info if provided */
+  gst_structure_get_fraction (s, "framerate", &vp9parse->fps_num,
+      &vp9parse->fps_den);
+  gst_structure_get_fraction (s, "pixel-aspect-ratio", &vp9parse->par_num,
+      &vp9parse->par_den);
+
+  if (vp9parse->fps_num > 0 && vp9parse->fps_den > 0)
+    gst_base_parse_set_frame_rate (parse, vp9parse->fps_num,
+        vp9parse->fps_den, 0, 0);
+
+  /* negotiate with downstream, sets ->align */
+  gst_vp9_parse_negotiate (vp9parse);
+  vp9parse->update_caps = TRUE;
+
+  return TRUE;
+}
+
+static void
+remove_fields (GstCaps * caps)
+{
+  guint i, n;
+
+  n = gst_caps_get_size (caps);
+  for (i = 0; i < n; i++) {
+    GstStructure *s = gst_caps_get_structure (caps, i);
+
+    gst_structure_remove_field (s, "alignment");
+    gst_structure_remove_field (s, "parsed");
+  }
+}
+
+static GstCaps *
+gst_vp9_parse_get_caps (GstBaseParse * parse, GstCaps * filter)
+{
+  GstCaps *peercaps, *templ;
+  GstCaps *res;
+
+  templ = gst_pad_get_pad_template_caps (GST_BASE_PARSE_SINK_PAD (parse));
+  if (filter) {
+    GstCaps *fcopy = gst_caps_copy (filter);
+    /* Remove the fields we convert */
+    remove_fields (fcopy);
+    peercaps = gst_pad_peer_query_caps (GST_BASE_PARSE_SRC_PAD (parse), fcopy);
+    gst_caps_unref (fcopy);
+  } else
+    peercaps = gst_pad_peer_query_caps (GST_BASE_PARSE_SRC_PAD (parse), NULL);
+
+  if (peercaps) {
+    peercaps = gst_caps_make_writable (peercaps);
+    remove_fields (peercaps);
+
+    res = gst_caps_intersect_full (peercaps, templ, GST_CAPS_INTERSECT_FIRST);
+    gst_caps_unref (peercaps);
+    gst_caps_unref (templ);
+  } else {
+    res = templ;
+  }
+
+  if (filter) {
+    GstCaps *tmp = gst_caps_intersect_full (res, filter,
+        GST_CAPS_INTERSECT_FIRST);
+    gst_caps_unref (res);
+    res = tmp;
+  }
+
+  return res;
+}
+
+static gboolean
+gst_vp9_parse_event (GstBaseParse * parse, GstEvent * event)
+{
+  GstVp9Parse *vp9parse = GST_VP9_PARSE (parse);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_STOP:
+      /* the rest of the superframe was flushed */
+      gst_vp9_parse_reset_superframe (vp9parse);
+      break;
+    default:
+      break;
+  }
+
+  return GST_BASE_PARSE_CLASS (parent_class)->sink_event (parse, event);
+}
@@ -0,0 +1,102 @@
+/*
+ * paramsets.c : reading the ids of H.264 and H.265 parameter sets
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "paramsets.h"
+
+/* copies the start of the @size bytes of payload at @data, without their
+ * emulation prevention bytes, to @dest. Returns the number of bytes
+ * copied */
+guint
+param_sets_unescape_payload (const guint8 * data, guint size, guint8 * dest,
+    guint max_size)
+{
+  const guint8 *end = data + size;
+  guint n = 0, zeros = 0;
+
+  for (; data < end && n < max_size; data++) {
+    if (zeros >= 2 && *data == 0x03) {
+      zeros = 0;
+      continue;
+    }
+    zeros = *data ? 0 : zeros + 1;
+    dest[n++] = *data;
+  }
+
+  return n;
+}
+
+/* reads an unsigned exp-Golomb code */
+gboolean
+param_sets_read_ue (GstBitReader * br, guint * value)
+{
+  guint leading = 0, bits;
+  guint8 bit;
+
+  for (;;) {
+    if (!gst_bit_reader_get_bits_uint8 (br, &bit, 1))
+      return FALSE;
+    if (bit)
+      break;
+    if (++leading > 31)
+      return FALSE;
+  }
+
+  if (!gst_bit_reader_get_bits_uint32 (br, &bits, leading))
+    return FALSE;
+
+  *value = (1U << leading) - 1 + bits;
+  return TRUE;
+}
+
+/* skips the profile_tier_level() of a H.265 SPS, with its sub-layers */
+gboolean
+param_sets_skip_h265_profile_tier_level (GstBitReader * br,
+    guint max_sub_layers_minus1)
+{
+  guint8 flags[7];
+  guint i;
+
+  g_return_val_if_fail (max_sub_layers_minus1 <= G_N_ELEMENTS (flags), FALSE);
+
+  /* general profile, tier and level */
+  if (!gst_bit_reader_skip (br, 96))
+    return FALSE;
+
+  for (i = 0; i < max_sub_layers_minus1; i++) {
+    if (!gst_bit_reader_get_bits_uint8 (br, &flags[i], 2))
+      return FALSE;
+  }
+  if (max_sub_layers_minus1 > 0 &&
+      !gst_bit_reader_skip (br, 2 * (8 - max_sub_layers_minus1)))
+    return FALSE;
+
+  /* sub_layer_profile_present_flag and sub_layer_level_present_flag */
+  for (i = 0; i < max_sub_layers_minus1; i++) {
+    if ((flags[i] & 0x2) && !gst_bit_reader_skip (br, 88))
+      return FALSE;
+    if ((flags[i] & 0x1) && !gst_bit_reader_skip (br, 8))
+      return FALSE;
+  }
+
+  return TRUE;
+}
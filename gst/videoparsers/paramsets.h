@@ -0,0 +1,43 @@
+/*
+ * paramsets.h : reading the ids of H.264 and H.265 parameter sets
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __PARAM_SETS_H__
+#define __PARAM_SETS_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbitreader.h>
+
+G_BEGIN_DECLS
+
+/* Helpers to read the id at the start of a parameter set without parsing
+ * all of it, to find out whether it repeats one the parser already has.
+ * The payload is first copied without its emulation prevention bytes with
+ * param_sets_unescape_payload, then read with a GstBitReader. */
+
+G_GNUC_INTERNAL guint param_sets_unescape_payload (const guint8 * data,
+    guint size, guint8 * dest, guint max_size);
+
+G_GNUC_INTERNAL gboolean param_sets_read_ue (GstBitReader * br,
+    guint * value);
+
+G_GNUC_INTERNAL gboolean param_sets_skip_h265_profile_tier_level (
+    GstBitReader * br, guint max_sub_layers_minus1);
+
+G_END_DECLS
+#endif /* __PARAM_SETS_H__ */
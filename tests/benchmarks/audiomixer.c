@@ -0,0 +1,314 @@
+/*
+ * audiomixer.c - Throughput of the audiomixer against its number of inputs
+ *
+ * Mixes inputs playing square waves, as in an audio conference, for each
+ * number of inputs and each sample format:
+ *
+ *   audiomixer --inputs 2,8,32,128 --formats F32,S16 --duration 60
+ *
+ * The audiomixer plugin must be in the plugin path, e.g. when run from the
+ * build tree:
+ *
+ *   GST_PLUGIN_PATH=$(top_builddir)/gst/audiomixer ./audiomixer
+ *
+ * For each configuration, the pipeline runs --iterations times and the
+ * fastest run is reported as JSON, in seconds of audio mixed per second and
+ * in input samples mixed per second. The sources run in their own threads
+ * but their cost is part of the measure, the square wave is cheap to make.
+ *
+ * Each configuration is also run with GST_AUDIOMIXER_MIX_BLOCK_SIZE=0, which
+ * mixes one input after the other into the whole output buffer, as a
+ * baseline. --output-buffer-duration sets the duration of the output and
+ * input buffers, 10 ms by default as in the audiomixer, which only splits
+ * buffers above 32 kB (e.g. 100 ms in F32 stereo at 48 kHz) in blocks.
+ * --mix-block-size forces a block size for all the buffers instead:
+ *
+ *   audiomixer --output-buffer-duration 100 --mix-block-size 1024
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <gst/gst.h>
+
+typedef struct
+{
+  gint rate, channels;
+  gint duration;
+  gint buffer_duration;
+  gint mix_block_size;
+  gdouble volume;
+} Config;
+
+/* Gives the native endianness to the formats with more than 8 bits */
+static gchar *
+native_format (const gchar * format)
+{
+  gsize len = strlen (format);
+
+  if (len < 2 || g_str_has_suffix (format, "8") ||
+      g_str_has_suffix (format, "LE") || g_str_has_suffix (format, "BE"))
+    return g_strdup (format);
+
+  return g_strconcat (format, G_BYTE_ORDER == G_LITTLE_ENDIAN ? "LE" : "BE",
+      NULL);
+}
+
+static gchar *
+make_pipeline_description (const Config * config, const gchar * format,
+    gint n_inputs)
+{
+  GString *desc = g_string_new (NULL);
+  gchar volume[G_ASCII_DTOSTR_BUF_SIZE];
+  /* the inputs have the duration of the output buffers */
+  gint samples_per_buffer = MAX (config->rate * config->buffer_duration / 1000,
+      1);
+  gint n_buffers = config->duration * 1000 / config->buffer_duration;
+  gint i;
+
+  g_ascii_dtostr (volume, sizeof (volume), config->volume);
+
+  g_string_append_printf (desc, "audiomixer name=mix "
+      "output-buffer-duration=%" G_GUINT64_FORMAT,
+      (guint64) config->buffer_duration * GST_MSECOND);
+  for (i = 0; i < n_inputs; i++)
+    g_string_append_printf (desc, " sink_%d::volume=%s", i, volume);
+  g_string_append_printf (desc, " ! audio/x-raw,format=%s,rate=%d,"
+      "channels=%d ! fakesink sync=false", format, config->rate,
+      config->channels);
+
+  for (i = 0; i < n_inputs; i++) {
+    g_string_append_printf (desc, " audiotestsrc num-buffers=%d "
+        "samplesperbuffer=%d wave=square volume=0.01 freq=%d ! "
+        "audio/x-raw,format=%s,rate=%d,channels=%d ! mix.", n_buffers,
+        samples_per_buffer, 200 + 10 * i, format, config->rate,
+        config->channels);
+  }
+
+  return g_string_free (desc, FALSE);
+}
+
+/* Returns the time taken to mix all the samples, in microseconds, or -1 on
+ * error */
+static gint64
+run_pipeline (const gchar * description)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  GError *err = NULL;
+  gint64 start_time, elapsed = -1;
+
+  pipeline = gst_parse_launch (description, &err);
+  if (!pipeline) {
+    g_printerr ("could not create pipeline: %s\n", err->message);
+    g_error_free (err);
+    return -1;
+  }
+
+  start_time = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+    elapsed = g_get_monotonic_time () - start_time;
+  } else {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("pipeline error: %s\n", err->message);
+    g_error_free (err);
+  }
+
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+/* JSON numbers must not depend on the locale */
+static void
+print_json_double (gdouble value)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  g_print ("%s", g_ascii_formatd (buf, sizeof (buf), "%.3f", value));
+}
+
+/* Returns the fastest of @iterations runs, in microseconds, or -1 on
+ * error */
+static gint64
+run_iterations (const gchar * description, gint iterations)
+{
+  gint64 best_time = G_MAXINT64, elapsed;
+  gint i;
+
+  for (i = 0; i < iterations; i++) {
+    elapsed = run_pipeline (description);
+    if (elapsed < 0)
+      return -1;
+    best_time = MIN (best_time, elapsed);
+  }
+
+  return best_time;
+}
+
+static void
+print_result (const Config * config, const gchar * format, gint n_inputs,
+    gint64 best_time, gint64 baseline_time, gint iterations, gboolean last)
+{
+  gdouble seconds = MAX (best_time, 1) / (gdouble) G_USEC_PER_SEC;
+  gdouble baseline_seconds = MAX (baseline_time, 1) / (gdouble) G_USEC_PER_SEC;
+
+  g_print ("    {\n");
+  g_print ("      \"inputs\": %d,\n", n_inputs);
+  g_print ("      \"format\": \"%s\",\n", format);
+  g_print ("      \"rate\": %d,\n", config->rate);
+  g_print ("      \"channels\": %d,\n", config->channels);
+  g_print ("      \"volume\": ");
+  print_json_double (config->volume);
+  g_print (",\n      \"duration\": %d,\n", config->duration);
+  g_print ("      \"buffer_duration_ms\": %d,\n", config->buffer_duration);
+  g_print ("      \"mix_block_size\": %d,\n", config->mix_block_size);
+  g_print ("      \"iterations\": %d,\n", iterations);
+  g_print ("      \"best_seconds\": ");
+  print_json_double (seconds);
+  g_print (",\n      \"realtime_factor\": ");
+  print_json_double (config->duration / seconds);
+  g_print (",\n      \"samples_per_s\": ");
+  print_json_double ((gdouble) n_inputs * config->duration * config->rate *
+      config->channels / seconds);
+  g_print (",\n      \"baseline_seconds\": ");
+  print_json_double (baseline_seconds);
+  g_print (",\n      \"speedup\": ");
+  print_json_double (baseline_seconds / seconds);
+  g_print ("\n    }%s\n", last ? "" : ",");
+}
+
+gint
+main (gint argc, gchar ** argv)
+{
+  gchar *formats = NULL, *inputs = NULL;
+  Config config = { 48000, 2, 60, 10, -1, 1.0 };
+  gint iterations = 3;
+  GOptionEntry options[] = {
+    {"inputs", 'i', 0, G_OPTION_ARG_STRING, &inputs,
+        "Comma separated numbers of inputs to measure (default: 2,8,32,128)",
+        "N,..."},
+    {"formats", 'f', 0, G_OPTION_ARG_STRING, &formats,
+        "Comma separated sample formats to measure (default: F32,S16)",
+        "FORMAT,..."},
+    {"rate", 'r', 0, G_OPTION_ARG_INT, &config.rate,
+        "Sample rate (default: 48000)", "RATE"},
+    {"channels", 'c', 0, G_OPTION_ARG_INT, &config.channels,
+        "Number of channels (default: 2)", "N"},
+    {"duration", 'd', 0, G_OPTION_ARG_INT, &config.duration,
+        "Seconds of audio to mix (default: 60)", "SECONDS"},
+    {"output-buffer-duration", 'b', 0, G_OPTION_ARG_INT,
+        &config.buffer_duration,
+        "Duration of the buffers, in milliseconds (default: 10)", "MS"},
+    {"mix-block-size", 'm', 0, G_OPTION_ARG_INT, &config.mix_block_size,
+        "Size of the mixing blocks for all buffers, in bytes (default: "
+          "the audiomixer default)", "BYTES"},
+    {"volume", 'v', 0, G_OPTION_ARG_DOUBLE, &config.volume,
+        "Volume of the inputs in the mixer (default: 1.0)", "VOLUME"},
+    {"iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+        "Number of runs for each configuration (default: 3)", "N"},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  gchar *block_size = NULL;
+  gchar **n_inputs, **format_names;
+  guint i, j;
+  gint ret = 0;
+
+  ctx = g_option_context_new ("- measure the throughput of the audiomixer "
+      "against its number of inputs");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_option_context_free (ctx);
+    g_error_free (err);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (config.rate < 100 || config.channels < 1 || config.duration < 1 ||
+      config.buffer_duration < 1 || iterations < 1) {
+    g_printerr ("invalid sample rate, number of channels, duration, buffer "
+        "duration or iterations\n");
+    return 1;
+  }
+
+  /* read by the audiomixer when it is created */
+  if (config.mix_block_size >= 0)
+    block_size = g_strdup_printf ("%d", config.mix_block_size);
+
+  n_inputs = g_strsplit (inputs ? inputs : "2,8,32,128", ",", -1);
+  format_names = g_strsplit (formats ? formats : "F32,S16", ",", -1);
+
+  g_print ("{\n  \"benchmarks\": [\n");
+  for (i = 0; format_names[i] && ret == 0; i++) {
+    gchar *format = native_format (format_names[i]);
+
+    for (j = 0; n_inputs[j]; j++) {
+      gint inputs_value = atoi (n_inputs[j]);
+      gchar *desc;
+      gint64 best_time, baseline_time;
+
+      if (inputs_value < 1) {
+        g_printerr ("invalid number of inputs: %s\n", n_inputs[j]);
+        ret = 1;
+        break;
+      }
+
+      desc = make_pipeline_description (&config, format, inputs_value);
+      g_setenv ("GST_AUDIOMIXER_MIX_BLOCK_SIZE", "0", TRUE);
+      baseline_time = run_iterations (desc, iterations);
+      if (block_size)
+        g_setenv ("GST_AUDIOMIXER_MIX_BLOCK_SIZE", block_size, TRUE);
+      else
+        g_unsetenv ("GST_AUDIOMIXER_MIX_BLOCK_SIZE");
+      best_time = run_iterations (desc, iterations);
+      g_free (desc);
+
+      if (best_time < 0 || baseline_time < 0) {
+        ret = 1;
+        break;
+      }
+
+      print_result (&config, format, inputs_value, best_time, baseline_time,
+          iterations, format_names[i + 1] == NULL && n_inputs[j + 1] == NULL);
+    }
+    g_free (format);
+  }
+  g_print ("  ]\n}\n");
+
+  g_free (block_size);
+  g_strfreev (format_names);
+  g_strfreev (n_inputs);
+  g_free (formats);
+  g_free (inputs);
+
+  return ret;
+}
@@ -0,0 +1,966 @@
+/*
+ * codecparsers-common.c - Parser entry points and synthetic streams shared
+ * by the codec parsers benchmark and fuzzing harness
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth265parser.h>
+#include <gst/codecparsers/gstvp9parser.h>
+#include <gst/codecparsers/gstmpegvideoparser.h>
+#include <gst/codecparsers/gstjpegparser.h>
+
+#include "codecparsers-common.h"
+
+/* The synthetic streams look like a 1080p stream at about 16 Mbit/s: GOPs
+ * of one I picture followed by P pictures, the I pictures being four
+ * times as large as the P ones */
+#define WIDTH 1920
+#define HEIGHT 1080
+#define GOP_LENGTH 30
+#define I_PICTURE_SIZE (256 * 1024)
+#define P_PICTURE_SIZE (64 * 1024)
+#define SLICES_PER_PICTURE 4
+#define JPEG_RESTART_SPACING 4096
+
+/* the streams must not change from one run to the other */
+#define RANDOM_SEED 0x67737470
+
+/*** Parsing ***/
+
+static void
+parse_h264 (const guint8 * data, gsize size, CodecParserStats * stats)
+{
+  GstH264NalParser *parser = gst_h264_nal_parser_new ();
+  GstH264ParserResult res;
+  GstH264NalUnit nalu;
+  GstH264SliceHdr slice;
+  GArray *messages;
+  guint offset = 0;
+
+  /* offsets are 32 bits in the parser API */
+  size = MIN (size, G_MAXUINT32);
+
+  while (offset < size) {
+    res = gst_h264_parser_identify_nalu (parser, data, offset, size, &nalu);
+    if (res == GST_H264_PARSER_BROKEN_DATA) {
+      /* resume after the start code */
+      stats->errors++;
+      offset = nalu.offset;
+      continue;
+    }
+    if (res != GST_H264_PARSER_OK && res != GST_H264_PARSER_NO_NAL_END)
+      break;
+
+    stats->units++;
+
+    switch (nalu.type) {
+      case GST_H264_NAL_SLICE:
+      case GST_H264_NAL_SLICE_DPA:
+      case GST_H264_NAL_SLICE_IDR:
+        res = gst_h264_parser_parse_slice_hdr (parser, &nalu, &slice, TRUE,
+            TRUE);
+        break;
+      case GST_H264_NAL_SEI:
+        res = gst_h264_parser_parse_sei (parser, &nalu, &messages);
+        g_array_free (messages, TRUE);
+        break;
+      default:
+        res = gst_h264_parser_parse_nal (parser, &nalu);
+        break;
+    }
+    if (res != GST_H264_PARSER_OK)
+      stats->errors++;
+
+    offset = nalu.offset + nalu.size;
+  }
+
+  gst_h264_nal_parser_free (parser);
+}
+
+static void
+parse_h265 (const guint8 * data, gsize size, CodecParserStats * stats)
+{
+  GstH265Parser *parser = gst_h265_parser_new ();
+  GstH265ParserResult res;
+  GstH265NalUnit nalu;
+  GstH265SliceHdr slice;
+  GArray *messages;
+  guint offset = 0;
+
+  /* offsets are 32 bits in the parser API */
+  size = MIN (size, G_MAXUINT32);
+
+  while (offset < size) {
+    res = gst_h265_parser_identify_nalu (parser, data, offset, size, &nalu);
+    if (res == GST_H265_PARSER_BROKEN_DATA) {
+      /* resume after the start code */
+      stats->errors++;
+      offset = nalu.offset;
+      continue;
+    }
+    if (res != GST_H265_PARSER_OK && res != GST_H265_PARSER_NO_NAL_END)
+      break;
+
+    stats->units++;
+
+    if (nalu.type <= GST_H265_NAL_SLICE_RASL_R ||
+        (nalu.type >= GST_H265_NAL_SLICE_BLA_W_LP &&
+            nalu.type <= GST_H265_NAL_SLICE_CRA_NUT)) {
+      res = gst_h265_parser_parse_slice_hdr (parser, &nalu, &slice);
+      if (res == GST_H265_PARSER_OK)
+        gst_h265_slice_hdr_free (&slice);
+    } else if (nalu.type == GST_H265_NAL_PREFIX_SEI ||
+        nalu.type == GST_H265_NAL_SUFFIX_SEI) {
+      res = gst_h265_parser_parse_sei (parser, &nalu, &messages);
+      g_array_free (messages, TRUE);
+    } else {
+      res = gst_h265_parser_parse_nal (parser, &nalu);
+    }
+    if (res != GST_H265_PARSER_OK)
+      stats->errors++;
+
+    offset = nalu.offset + nalu.size;
+  }
+
+  gst_h265_parser_free (parser);
+}
+
+#define IVF_FILE_HEADER_SIZE 32
+#define IVF_FRAME_HEADER_SIZE 12
+
+static void
+parse_vp9 (const guint8 * data, gsize size, CodecParserStats * stats)
+{
+  GstVp9Parser *parser;
+  GstVp9FrameHdr frame_hdr;
+  gsize offset, frame_size;
+
+  if (size < IVF_FILE_HEADER_SIZE || memcmp (data, "DKIF", 4) != 0) {
+    stats->errors++;
+    return;
+  }
+
+  parser = gst_vp9_parser_new ();
+
+  offset = MAX (GST_READ_UINT16_LE (data + 6), IVF_FILE_HEADER_SIZE);
+  while (offset + IVF_FRAME_HEADER_SIZE <= size) {
+    frame_size = GST_READ_UINT32_LE (data + offset);
+    offset += IVF_FRAME_HEADER_SIZE;
+
+    /* parse what there is of a truncated last frame */
+    if (frame_size > size - offset) {
+      frame_size = size - offset;
+      stats->errors++;
+    }
+
+    stats->units++;
+    if (gst_vp9_parser_parse_frame_header (parser, &frame_hdr, data + offset,
+            frame_size) != GST_VP9_PARSER_OK)
+      stats->errors++;
+
+    offset += frame_size;
+  }
+
+  gst_vp9_parser_free (parser);
+}
+
+static void
+parse_mpeg_video (const guint8 * data, gsize size, CodecParserStats * stats)
+{
+  GstMpegVideoPacket packet;
+  GstMpegVideoSequenceHdr seqhdr;
+  GstMpegVideoSequenceExt seqext;
+  GstMpegVideoPictureHdr pichdr;
+  GstMpegVideoPictureExt picext;
+  GstMpegVideoGop gop;
+  GstMpegVideoSliceHdr slice;
+  gboolean have_seqhdr = FALSE, ok;
+  guint offset = 0;
+
+  /* offsets are 32 bits in the parser API */
+  size = MIN (size, G_MAXUINT32);
+
+  while (gst_mpeg_video_parse (&packet, data, size, offset)) {
+    stats->units++;
+
+    if (packet.size < 0)
+      packet.size = size - packet.offset;
+
+    switch (packet.type) {
+      case GST_MPEG_VIDEO_PACKET_PICTURE:
+        ok = gst_mpeg_video_packet_parse_picture_header (&packet, &pichdr);
+        break;
+      case GST_MPEG_VIDEO_PACKET_SEQUENCE:
+        ok = gst_mpeg_video_packet_parse_sequence_header (&packet, &seqhdr);
+        have_seqhdr |= ok;
+        break;
+      case GST_MPEG_VIDEO_PACKET_GOP:
+        ok = gst_mpeg_video_packet_parse_gop (&packet, &gop);
+        break;
+      case GST_MPEG_VIDEO_PACKET_EXTENSION:
+        if (packet.size < 1) {
+          ok = FALSE;
+          break;
+        }
+        switch (packet.data[packet.offset] >> 4) {
+          case GST_MPEG_VIDEO_PACKET_EXT_SEQUENCE:
+            ok = gst_mpeg_video_packet_parse_sequence_extension (&packet,
+                &seqext);
+            break;
+          case GST_MPEG_VIDEO_PACKET_EXT_PICTURE:
+            ok = gst_mpeg_video_packet_parse_picture_extension (&packet,
+                &picext);
+            break;
+          default:
+            ok = TRUE;
+            break;
+        }
+        break;
+      default:
+        if (GST_MPEG_VIDEO_PACKET_IS_SLICE (packet.type) && have_seqhdr)
+          ok = gst_mpeg_video_packet_parse_slice_header (&packet, &slice,
+              &seqhdr, NULL);
+        else
+          ok = TRUE;
+        break;
+    }
+    if (!ok)
+      stats->errors++;
+
+    /* the next start code is searched from the end of this one */
+    offset = packet.offset;
+  }
+}
+
+static void
+parse_jpeg (const guint8 * data, gsize size, CodecParserStats * stats)
+{
+  GstJpegSegment segment;
+  GstJpegFrameHdr frame_hdr;
+  GstJpegScanHdr scan_hdr;
+  GstJpegHuffmanTables huf_tables;
+  GstJpegQuantTables quant_tables;
+  guint restart_interval;
+  gboolean ok;
+  guint offset = 0;
+
+  /* offsets are 32 bits in the parser API */
+  size = MIN (size, G_MAXUINT32);
+
+  while (gst_jpeg_parse (&segment, data, size, offset)) {
+    stats->units++;
+
+    /* the segment headers must be complete to be parsed */
+    if (segment.size > 0 && segment.offset + segment.size <= size) {
+      switch (segment.marker) {
+        case GST_JPEG_MARKER_SOF0:
+        case GST_JPEG_MARKER_SOF1:
+        case GST_JPEG_MARKER_SOF2:
+        case GST_JPEG_MARKER_SOF3:
+        case GST_JPEG_MARKER_SOF5:
+        case GST_JPEG_MARKER_SOF6:
+        case GST_JPEG_MARKER_SOF7:
+        case GST_JPEG_MARKER_SOF9:
+        case GST_JPEG_MARKER_SOF10:
+        case GST_JPEG_MARKER_SOF11:
+        case GST_JPEG_MARKER_SOF13:
+        case GST_JPEG_MARKER_SOF14:
+        case GST_JPEG_MARKER_SOF15:
+          ok = gst_jpeg_segment_parse_frame_header (&segment, &frame_hdr);
+          break;
+        case GST_JPEG_MARKER_SOS:
+          ok = gst_jpeg_segment_parse_scan_header (&segment, &scan_hdr);
+          break;
+        case GST_JPEG_MARKER_DHT:
+          ok = gst_jpeg_segment_parse_huffman_table (&segment, &huf_tables);
+          break;
+        case GST_JPEG_MARKER_DQT:
+          ok = gst_jpeg_segment_parse_quantization_table (&segment,
+              &quant_tables);
+          break;
+        case GST_JPEG_MARKER_DRI:
+          ok = gst_jpeg_segment_parse_restart_interval (&segment,
+              &restart_interval);
+          break;
+        default:
+          ok = TRUE;
+          break;
+      }
+      offset = segment.offset + segment.size;
+    } else {
+      ok = segment.size == 0;
+      offset = segment.offset;
+    }
+    if (!ok)
+      stats->errors++;
+  }
+}
+
+/*** Synthetic streams ***/
+
+typedef struct
+{
+  GByteArray *array;
+  guint8 byte;
+  guint n_bits;
+} BitWriter;
+
+static void
+bit_writer_init (BitWriter * bw)
+{
+  bw->array = g_byte_array_new ();
+  bw->byte = 0;
+  bw->n_bits = 0;
+}
+
+static void
+bit_writer_put_bits (BitWriter * bw, guint32 value, guint n_bits)
+{
+  while (n_bits--) {
+    bw->byte = (bw->byte << 1) | ((value >> n_bits) & 1);
+    if (++bw->n_bits == 8) {
+      g_byte_array_append (bw->array, &bw->byte, 1);
+      bw->byte = 0;
+      bw->n_bits = 0;
+    }
+  }
+}
+
+static void
+bit_writer_put_ue (BitWriter * bw, guint32 value)
+{
+  guint n_bits = g_bit_storage (value + 1);
+
+  bit_writer_put_bits (bw, 0, n_bits - 1);
+  bit_writer_put_bits (bw, value + 1, n_bits);
+}
+
+static void
+bit_writer_put_se (BitWriter * bw, gint32 value)
+{
+  bit_writer_put_ue (bw, value > 0 ? 2 * value - 1 : -2 * value);
+}
+
+/* pads with @bit up to the next byte boundary */
+static void
+bit_writer_align (BitWriter * bw, guint bit)
+{
+  while (bw->n_bits)
+    bit_writer_put_bits (bw, bit, 1);
+}
+
+/* rbsp_trailing_bits() */
+static void
+bit_writer_put_trailing_bits (BitWriter * bw)
+{
+  bit_writer_put_bits (bw, 1, 1);
+  bit_writer_align (bw, 0);
+}
+
+static GByteArray *
+bit_writer_get_array (BitWriter * bw)
+{
+  g_assert (bw->n_bits == 0);
+  return bw->array;
+}
+
+static void
+append_random (GByteArray * array, GRand * rand, gsize size)
+{
+  guint8 *data;
+  guint32 value = 0;
+  gsize i;
+
+  g_byte_array_set_size (array, array->len + size);
+  data = array->data + array->len - size;
+  for (i = 0; i < size; i++) {
+    if (i % 4 == 0)
+      value = g_rand_int (rand);
+    data[i] = value >> (8 * (i % 4));
+  }
+}
+
+/* Appends a NAL unit with a 4 bytes start code, inserting the emulation
+ * prevention bytes in @rbsp. The last byte of @rbsp must not be 0. */
+static void
+append_nal (GByteArray * stream, const guint8 * header, guint header_size,
+    GByteArray * rbsp)
+{
+  static const guint8 start_code[] = { 0x00, 0x00, 0x00, 0x01 };
+  static const guint8 emulation_prevention = 0x03;
+  guint i, zeros = 0;
+
+  g_byte_array_append (stream, start_code, sizeof (start_code));
+  g_byte_array_append (stream, header, header_size);
+
+  for (i = 0; i < rbsp->len; i++) {
+    if (zeros >= 2 && rbsp->data[i] <= 0x03) {
+      g_byte_array_append (stream, &emulation_prevention, 1);
+      zeros = 0;
+    }
+    zeros = rbsp->data[i] ? 0 : zeros + 1;
+    g_byte_array_append (stream, &rbsp->data[i], 1);
+  }
+
+  g_byte_array_free (rbsp, TRUE);
+}
+
+/* Completes a slice header with random slice data */
+static GByteArray *
+finish_slice (BitWriter * bw, GRand * rand, gsize size)
+{
+  GByteArray *rbsp = bit_writer_get_array (bw);
+
+  if (size > rbsp->len + 1)
+    append_random (rbsp, rand, size - rbsp->len - 1);
+  g_byte_array_append (rbsp, (const guint8 *) "\x80", 1);
+
+  return rbsp;
+}
+
+static GByteArray *
+generate_h264 (gsize min_size)
+{
+  static const guint8 sps_header = 0x67, pps_header = 0x68;
+  static const guint8 idr_header = 0x65, p_header = 0x41;
+  const guint mbs = (WIDTH / 16) * ((HEIGHT + 15) / 16);
+  GByteArray *stream = g_byte_array_new ();
+  GRand *rand = g_rand_new_with_seed (RANDOM_SEED);
+  BitWriter bw;
+  guint frame, slice;
+  gboolean idr;
+
+  for (frame = 0; stream->len < min_size; frame++) {
+    idr = frame % GOP_LENGTH == 0;
+
+    if (idr) {
+      /* SPS: Main profile, POC type 0, cropped from 1088 lines */
+      bit_writer_init (&bw);
+      bit_writer_put_bits (&bw, 77, 8);
+      bit_writer_put_bits (&bw, 0x40, 8);
+      bit_writer_put_bits (&bw, 40, 8);
+      bit_writer_put_ue (&bw, 0);       /* seq_parameter_set_id */
+      bit_writer_put_ue (&bw, 0);       /* log2_max_frame_num_minus4 */
+      bit_writer_put_ue (&bw, 0);       /* pic_order_cnt_type */
+      bit_writer_put_ue (&bw, 0);       /* log2_max_pic_order_cnt_lsb_minus4 */
+      bit_writer_put_ue (&bw, 1);       /* max_num_ref_frames */
+      bit_writer_put_bits (&bw, 0, 1);
+      bit_writer_put_ue (&bw, WIDTH / 16 - 1);
+      bit_writer_put_ue (&bw, (HEIGHT + 15) / 16 - 1);
+      bit_writer_put_bits (&bw, 1, 1);  /* frame_mbs_only_flag */
+      bit_writer_put_bits (&bw, 1, 1);  /* direct_8x8_inference_flag */
+      bit_writer_put_bits (&bw, 1, 1);  /* frame_cropping_flag */
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_ue (&bw, ((HEIGHT + 15) / 16 * 16 - HEIGHT) / 2);
+      bit_writer_put_bits (&bw, 0, 1);  /* vui_parameters_present_flag */
+      bit_writer_put_trailing_bits (&bw);
+      append_nal (stream, &sps_header, 1, bit_writer_get_array (&bw));
+
+      /* PPS: CABAC, deblocking control */
+      bit_writer_init (&bw);
+      bit_writer_put_ue (&bw, 0);       /* pic_parameter_set_id */
+      bit_writer_put_ue (&bw, 0);       /* seq_parameter_set_id */
+      bit_writer_put_bits (&bw, 1, 1);  /* entropy_coding_mode_flag */
+      bit_writer_put_bits (&bw, 0, 1);
+      bit_writer_put_ue (&bw, 0);       /* num_slice_groups_minus1 */
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_bits (&bw, 0, 3);  /* weighted_pred/bipred */
+      bit_writer_put_se (&bw, 0);       /* pic_init_qp_minus26 */
+      bit_writer_put_se (&bw, 0);
+      bit_writer_put_se (&bw, 0);
+      bit_writer_put_bits (&bw, 1, 1);  /* deblocking_filter_control_present */
+      bit_writer_put_bits (&bw, 0, 2);
+      bit_writer_put_trailing_bits (&bw);
+      append_nal (stream, &pps_header, 1, bit_writer_get_array (&bw));
+    }
+
+    for (slice = 0; slice < SLICES_PER_PICTURE; slice++) {
+      bit_writer_init (&bw);
+      bit_writer_put_ue (&bw, slice * mbs / SLICES_PER_PICTURE);
+      bit_writer_put_ue (&bw, idr ? 7 : 5);     /* all I or all P */
+      bit_writer_put_ue (&bw, 0);       /* pic_parameter_set_id */
+      bit_writer_put_bits (&bw, frame % GOP_LENGTH % 16, 4);
+      if (idr)
+        bit_writer_put_ue (&bw, frame / GOP_LENGTH % 2);
+      bit_writer_put_bits (&bw, frame * 2 % 16, 4);
+      if (!idr) {
+        bit_writer_put_bits (&bw, 0, 1);        /* num_ref_idx_override */
+        bit_writer_put_bits (&bw, 0, 1);        /* ref_pic_list_mod_l0 */
+      }
+      /* dec_ref_pic_marking () */
+      bit_writer_put_bits (&bw, 0, idr ? 2 : 1);
+      if (!idr)
+        bit_writer_put_ue (&bw, 0);     /* cabac_init_idc */
+      bit_writer_put_se (&bw, 0);       /* slice_qp_delta */
+      bit_writer_put_ue (&bw, 0);       /* disable_deblocking_filter_idc */
+      bit_writer_put_se (&bw, 0);
+      bit_writer_put_se (&bw, 0);
+      bit_writer_align (&bw, 1);        /* cabac_alignment_one_bit */
+
+      append_nal (stream, idr ? &idr_header : &p_header, 1,
+          finish_slice (&bw, rand,
+              (idr ? I_PICTURE_SIZE : P_PICTURE_SIZE) / SLICES_PER_PICTURE));
+    }
+  }
+
+  g_rand_free (rand);
+  return stream;
+}
+
+/* general_profile_space to general_level_idc, Main profile level 4 */
+static void
+put_h265_profile_tier_level (BitWriter * bw)
+{
+  bit_writer_put_bits (bw, 0, 3);
+  bit_writer_put_bits (bw, GST_H265_PROFILE_MAIN, 5);
+  bit_writer_put_bits (bw, 0x60000000, 32);
+  bit_writer_put_bits (bw, 0x9, 4);     /* progressive, frame only */
+  bit_writer_put_bits (bw, 0, 32);
+  bit_writer_put_bits (bw, 0, 12);
+  bit_writer_put_bits (bw, 120, 8);
+}
+
+static GByteArray *
+generate_h265 (gsize min_size)
+{
+  static const guint8 vps_header[] = { 0x40, 0x01 };
+  static const guint8 sps_header[] = { 0x42, 0x01 };
+  static const guint8 pps_header[] = { 0x44, 0x01 };
+  static const guint8 idr_header[] = { 0x26, 0x01 };
+  static const guint8 trail_header[] = { 0x02, 0x01 };
+  /* 64x64 CTBs */
+  const guint ctbs = ((WIDTH + 63) / 64) * ((HEIGHT + 63) / 64);
+  GByteArray *stream = g_byte_array_new ();
+  GRand *rand = g_rand_new_with_seed (RANDOM_SEED);
+  BitWriter bw;
+  guint frame, slice;
+  gboolean idr;
+
+  for (frame = 0; stream->len < min_size; frame++) {
+    idr = frame % GOP_LENGTH == 0;
+
+    if (idr) {
+      bit_writer_init (&bw);
+      bit_writer_put_bits (&bw, 0, 4);  /* vps_video_parameter_set_id */
+      bit_writer_put_bits (&bw, 3, 2);
+      bit_writer_put_bits (&bw, 0, 6);  /* vps_max_layers_minus1 */
+      bit_writer_put_bits (&bw, 0, 3);  /* vps_max_sub_layers_minus1 */
+      bit_writer_put_bits (&bw, 1, 1);
+      bit_writer_put_bits (&bw, 0xffff, 16);
+      put_h265_profile_tier_level (&bw);
+      bit_writer_put_bits (&bw, 1, 1);  /* sub_layer_ordering_info_present */
+      bit_writer_put_ue (&bw, 1);
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_bits (&bw, 0, 6);  /* vps_max_layer_id */
+      bit_writer_put_ue (&bw, 0);       /* vps_num_layer_sets_minus1 */
+      bit_writer_put_bits (&bw, 0, 2);  /* no timing info nor extension */
+      bit_writer_put_trailing_bits (&bw);
+      append_nal (stream, vps_header, 2, bit_writer_get_array (&bw));
+
+      bit_writer_init (&bw);
+      bit_writer_put_bits (&bw, 0, 4);  /* sps_video_parameter_set_id */
+      bit_writer_put_bits (&bw, 0, 3);  /* sps_max_sub_layers_minus1 */
+      bit_writer_put_bits (&bw, 1, 1);
+      put_h265_profile_tier_level (&bw);
+      bit_writer_put_ue (&bw, 0);       /* sps_seq_parameter_set_id */
+      bit_writer_put_ue (&bw, 1);       /* chroma_format_idc */
+      bit_writer_put_ue (&bw, WIDTH);
+      bit_writer_put_ue (&bw, (HEIGHT + 7) / 8 * 8);
+      bit_writer_put_bits (&bw, 1, 1);  /* conformance_window_flag */
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_ue (&bw, ((HEIGHT + 7) / 8 * 8 - HEIGHT) / 2);
+      bit_writer_put_ue (&bw, 0);       /* bit_depth_luma_minus8 */
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_ue (&bw, 4);       /* log2_max_pic_order_cnt_lsb_minus4 */
+      bit_writer_put_bits (&bw, 1, 1);  /* sub_layer_ordering_info_present */
+      bit_writer_put_ue (&bw, 1);
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_ue (&bw, 0);       /* 8x8 to 64x64 coding blocks */
+      bit_writer_put_ue (&bw, 3);
+      bit_writer_put_ue (&bw, 0);       /* 4x4 to 32x32 transform blocks */
+      bit_writer_put_ue (&bw, 3);
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_bits (&bw, 0, 4);  /* no scaling list, AMP, SAO, PCM */
+      /* one short term RPS referencing the previous picture */
+      bit_writer_put_ue (&bw, 1);
+      bit_writer_put_ue (&bw, 1);       /* num_negative_pics */
+      bit_writer_put_ue (&bw, 0);       /* num_positive_pics */
+      bit_writer_put_ue (&bw, 0);       /* delta_poc_s0_minus1 */
+      bit_writer_put_bits (&bw, 1, 1);  /* used_by_curr_pic_s0_flag */
+      bit_writer_put_bits (&bw, 0, 5);  /* no LT refs, TMVP, SIS, VUI, ext */
+      bit_writer_put_trailing_bits (&bw);
+      append_nal (stream, sps_header, 2, bit_writer_get_array (&bw));
+
+      bit_writer_init (&bw);
+      bit_writer_put_ue (&bw, 0);       /* pps_pic_parameter_set_id */
+      bit_writer_put_ue (&bw, 0);       /* pps_seq_parameter_set_id */
+      bit_writer_put_bits (&bw, 0, 7);
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_ue (&bw, 0);
+      bit_writer_put_se (&bw, 0);       /* init_qp_minus26 */
+      bit_writer_put_bits (&bw, 0, 3);
+      bit_writer_put_se (&bw, 0);
+      bit_writer_put_se (&bw, 0);
+      bit_writer_put_bits (&bw, 0, 10);
+      bit_writer_put_ue (&bw, 0);       /* log2_parallel_merge_level_minus2 */
+      bit_writer_put_bits (&bw, 0, 2);
+      bit_writer_put_trailing_bits (&bw);
+      append_nal (stream, pps_header, 2, bit_writer_get_array (&bw));
+    }
+
+    for (slice = 0; slice < SLICES_PER_PICTURE; slice++) {
+      bit_writer_init (&bw);
+      bit_writer_put_bits (&bw, slice == 0, 1);
+      if (idr)
+        bit_writer_put_bits (&bw, 0, 1);        /* no_output_of_prior_pics */
+      bit_writer_put_ue (&bw, 0);       /* slice_pic_parameter_set_id */
+      if (slice > 0)
+        bit_writer_put_bits (&bw, slice * ctbs / SLICES_PER_PICTURE,
+            g_bit_storage (ctbs - 1));
+      bit_writer_put_ue (&bw, idr ? GST_H265_I_SLICE : GST_H265_P_SLICE);
+      if (!idr) {
+        bit_writer_put_bits (&bw, frame % GOP_LENGTH, 8);
+        bit_writer_put_bits (&bw, 1, 1);        /* short_term_ref_pic_set_sps */
+        bit_writer_put_bits (&bw, 0, 1);        /* num_ref_idx_override */
+        bit_writer_put_ue (&bw, 0);     /* five_minus_max_num_merge_cand */
+      }
+      bit_writer_put_se (&bw, 0);       /* slice_qp_delta */
+      bit_writer_put_trailing_bits (&bw);       /* byte_alignment () */
+
+      append_nal (stream, idr ? idr_header : trail_header, 2,
+          finish_slice (&bw, rand,
+              (idr ? I_PICTURE_SIZE : P_PICTURE_SIZE) / SLICES_PER_PICTURE));
+    }
+  }
+
+  g_rand_free (rand);
+  return stream;
+}
+
+static GByteArray *
+generate_vp9 (gsize min_size)
+{
+  GByteArray *stream = g_byte_array_new ();
+  GRand *rand = g_rand_new_with_seed (RANDOM_SEED);
+  guint8 header[IVF_FILE_HEADER_SIZE] = "DKIF";
+  guint8 frame_header[IVF_FRAME_HEADER_SIZE] = { 0, };
+  GByteArray *frame_data;
+  BitWriter bw;
+  guint frame, n_frames_pos;
+  gboolean key;
+
+  GST_WRITE_UINT16_LE (header + 6, IVF_FILE_HEADER_SIZE);
+  memcpy (header + 8, "VP90", 4);
+  GST_WRITE_UINT16_LE (header + 12, WIDTH);
+  GST_WRITE_UINT16_LE (header + 14, HEIGHT);
+  GST_WRITE_UINT32_LE (header + 16, 30);
+  GST_WRITE_UINT32_LE (header + 20, 1);
+  n_frames_pos = 24;
+  g_byte_array_append (stream, header, sizeof (header));
+
+  for (frame = 0; stream->len < min_size; frame++) {
+    key = frame % GOP_LENGTH == 0;
+
+    bit_writer_init (&bw);
+    bit_writer_put_bits (&bw, GST_VP9_FRAME_MARKER, 2);
+    bit_writer_put_bits (&bw, 0, 2);    /* profile 0 */
+    bit_writer_put_bits (&bw, 0, 1);    /* show_existing_frame */
+    bit_writer_put_bits (&bw, key ? GST_VP9_KEY_FRAME : GST_VP9_INTER_FRAME,
+        1);
+    bit_writer_put_bits (&bw, 1, 1);    /* show_frame */
+    bit_writer_put_bits (&bw, 0, 1);    /* error_resilient_mode */
+    if (key) {
+      bit_writer_put_bits (&bw, GST_VP9_SYNC_CODE, 24);
+      bit_writer_put_bits (&bw, GST_VP9_CS_BT_601, 3);
+      bit_writer_put_bits (&bw, GST_VP9_CR_LIMITED, 1);
+      bit_writer_put_bits (&bw, WIDTH - 1, 16);
+      bit_writer_put_bits (&bw, HEIGHT - 1, 16);
+    } else {
+      bit_writer_put_bits (&bw, 0, 2);  /* reset_frame_context */
+      bit_writer_put_bits (&bw, 0x01, 8);       /* refresh_frame_flags */
+      bit_writer_put_bits (&bw, 0x0, 4);        /* LAST, GOLDEN and ALTREF */
+      bit_writer_put_bits (&bw, 0x2, 4);
+      bit_writer_put_bits (&bw, 0x4, 4);
+      bit_writer_put_bits (&bw, 1, 1);  /* size from LAST */
+    }
+    bit_writer_put_bits (&bw, 0, 1);    /* display size */
+    if (!key) {
+      bit_writer_put_bits (&bw, 1, 1);  /* allow_high_precision_mv */
+      bit_writer_put_bits (&bw, 1, 1);  /* switchable interpolation filter */
+    }
+    bit_writer_put_bits (&bw, 1, 1);    /* refresh_frame_context */
+    bit_writer_put_bits (&bw, 1, 1);    /* frame_parallel_decoding_mode */
+    bit_writer_put_bits (&bw, 0, 2);    /* frame_context_idx */
+    bit_writer_put_bits (&bw, 10, 6);   /* loop filter level */
+    bit_writer_put_bits (&bw, 0, 3);
+    bit_writer_put_bits (&bw, 0, 1);
+    bit_writer_put_bits (&bw, 60, 8);   /* base_q_idx */
+    bit_writer_put_bits (&bw, 0, 3);
+    bit_writer_put_bits (&bw, 0, 1);    /* segmentation_enabled */
+    bit_writer_put_bits (&bw, 0, 2);    /* one tile */
+    bit_writer_put_bits (&bw, 512, 16); /* header_size_in_bytes */
+    bit_writer_align (&bw, 0);
+
+    frame_data = bit_writer_get_array (&bw);
+    append_random (frame_data, rand,
+        (key ? I_PICTURE_SIZE : P_PICTURE_SIZE) - frame_data->len);
+
+    GST_WRITE_UINT32_LE (frame_header, frame_data->len);
+    GST_WRITE_UINT64_LE (frame_header + 4, frame);
+    g_byte_array_append (stream, frame_header, sizeof (frame_header));
+    g_byte_array_append (stream, frame_data->data, frame_data->len);
+    g_byte_array_free (frame_data, TRUE);
+  }
+
+  GST_WRITE_UINT32_LE (stream->data + n_frames_pos, frame);
+
+  g_rand_free (rand);
+  return stream;
+}
+
+static void
+append_start_code (GByteArray * stream, guint8 type)
+{
+  const guint8 start_code[] = { 0x00, 0x00, 0x01, type };
+
+  g_byte_array_append (stream, start_code, sizeof (start_code));
+}
+
+static void
+append_bits (GByteArray * stream, BitWriter * bw)
+{
+  GByteArray *array;
+
+  bit_writer_align (bw, 0);
+  array = bit_writer_get_array (bw);
+  g_byte_array_append (stream, array->data, array->len);
+  g_byte_array_free (array, TRUE);
+}
+
+/* random bytes which can't emulate a start code */
+static void
+append_random_no_zero (GByteArray * stream, GRand * rand, gsize size)
+{
+  guint len = stream->len;
+  gsize i;
+
+  append_random (stream, rand, size);
+  for (i = len; i < stream->len; i++)
+    if (!stream->data[i])
+      stream->data[i] = 0x80;
+}
+
+static GByteArray *
+generate_mpeg_video (gsize min_size)
+{
+  const guint mb_rows = (HEIGHT + 15) / 16;
+  GByteArray *stream = g_byte_array_new ();
+  GRand *rand = g_rand_new_with_seed (RANDOM_SEED);
+  BitWriter bw;
+  guint frame, row;
+  gboolean intra;
+
+  for (frame = 0; stream->len < min_size; frame++) {
+    intra = frame % GOP_LENGTH == 0;
+
+    if (intra) {
+      append_start_code (stream, GST_MPEG_VIDEO_PACKET_SEQUENCE);
+      bit_writer_init (&bw);
+      bit_writer_put_bits (&bw, WIDTH, 12);
+      bit_writer_put_bits (&bw, mb_rows * 16, 12);
+      bit_writer_put_bits (&bw, 3, 4);  /* 16:9 */
+      bit_writer_put_bits (&bw, 4, 4);  /* 29.97 fps */
+      bit_writer_put_bits (&bw, 16000000 / 400, 18);
+      bit_writer_put_bits (&bw, 1, 1);
+      bit_writer_put_bits (&bw, 112, 10);       /* vbv_buffer_size_value */
+      bit_writer_put_bits (&bw, 0, 3);  /* no quantiser matrices */
+      append_bits (stream, &bw);
+
+      append_start_code (stream, GST_MPEG_VIDEO_PACKET_EXTENSION);
+      bit_writer_init (&bw);
+      bit_writer_put_bits (&bw, GST_MPEG_VIDEO_PACKET_EXT_SEQUENCE, 4);
+      bit_writer_put_bits (&bw, 0x44, 8);       /* main profile, high level */
+      bit_writer_put_bits (&bw, 1, 1);  /* progressive_sequence */
+      bit_writer_put_bits (&bw, 1, 2);  /* 4:2:0 */
+      bit_writer_put_bits (&bw, 0, 16);
+      bit_writer_put_bits (&bw, 1, 1);
+      bit_writer_put_bits (&bw, 0, 16);
+      append_bits (stream, &bw);
+
+      append_start_code (stream, GST_MPEG_VIDEO_PACKET_GOP);
+      bit_writer_init (&bw);
+      bit_writer_put_bits (&bw, 0, 12); /* drop frame, hours and minutes */
+      bit_writer_put_bits (&bw, 1, 1);
+      bit_writer_put_bits (&bw, frame / 30 % 60, 6);
+      bit_writer_put_bits (&bw, frame % 30, 6);
+      bit_writer_put_bits (&bw, 1, 1);  /* closed_gop */
+      bit_writer_put_bits (&bw, 0, 1);
+      append_bits (stream, &bw);
+    }
+
+    append_start_code (stream, GST_MPEG_VIDEO_PACKET_PICTURE);
+    bit_writer_init (&bw);
+    bit_writer_put_bits (&bw, frame % GOP_LENGTH, 10);
+    bit_writer_put_bits (&bw, intra ? GST_MPEG_VIDEO_PICTURE_TYPE_I :
+        GST_MPEG_VIDEO_PICTURE_TYPE_P, 3);
+    bit_writer_put_bits (&bw, 0xffff, 16);      /* vbv_delay */
+    if (!intra)
+      bit_writer_put_bits (&bw, 0x7, 4);        /* full_pel, forward_f_code */
+    bit_writer_put_bits (&bw, 0, 1);
+    append_bits (stream, &bw);
+
+    append_start_code (stream, GST_MPEG_VIDEO_PACKET_EXTENSION);
+    bit_writer_init (&bw);
+    bit_writer_put_bits (&bw, GST_MPEG_VIDEO_PACKET_EXT_PICTURE, 4);
+    bit_writer_put_bits (&bw, intra ? 0xffff : 0x22ff, 16);     /* f_codes */
+    bit_writer_put_bits (&bw, 0, 2);    /* intra_dc_precision */
+    bit_writer_put_bits (&bw, GST_MPEG_VIDEO_PICTURE_STRUCTURE_FRAME, 2);
+    bit_writer_put_bits (&bw, 0x106, 10);       /* progressive frame */
+    append_bits (stream, &bw);
+
+    for (row = 0; row < mb_rows; row++) {
+      append_start_code (stream, GST_MPEG_VIDEO_PACKET_SLICE_MIN + row);
+      bit_writer_init (&bw);
+      bit_writer_put_bits (&bw, 8, 5); /* quantiser_scale_code */
+      bit_writer_put_bits (&bw, 0, 1);
+      bit_writer_put_bits (&bw, 1, 1);  /* macroblock_address_increment */
+      append_bits (stream, &bw);
+      append_random_no_zero (stream, rand,
+          (intra ? I_PICTURE_SIZE : P_PICTURE_SIZE) / mb_rows);
+    }
+  }
+
+  g_rand_free (rand);
+  return stream;
+}
+
+static void
+append_jpeg_segment (GByteArray * stream, guint8 marker, const guint8 * data,
+    guint16 size)
+{
+  guint8 header[] = { 0xff, marker, (size + 2) >> 8, (size + 2) & 0xff };
+
+  g_byte_array_append (stream, header, data ? 4 : 2);
+  if (data)
+    g_byte_array_append (stream, data, size);
+}
+
+static GByteArray *
+generate_jpeg (gsize min_size)
+{
+  static const guint8 app0[] = {
+    'J', 'F', 'I', 'F', 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01,
+    0x00, 0x00
+  };
+  static const guint8 sof0[] = {
+    0x08, HEIGHT >> 8, HEIGHT & 0xff, WIDTH >> 8, WIDTH & 0xff,
+    0x03, 0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11, 0x01
+  };
+  static const guint8 dri[] = { 0x00, 0x78 };
+  static const guint8 sos[] = {
+    0x03, 0x01, 0x00, 0x02, 0x11, 0x03, 0x11, 0x00, 0x3f, 0x00
+  };
+  /* the code lengths of the luminance DC table of the specification */
+  static const guint8 huf_bits[16] = {
+    0x00, 0x01, 0x05, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01
+  };
+  GByteArray *stream = g_byte_array_new ();
+  GByteArray *entropy = g_byte_array_new ();
+  GRand *rand = g_rand_new_with_seed (RANDOM_SEED);
+  guint8 dqt[1 + 64], dht[4 * (1 + 16 + 12)], rst[2] = { 0xff, 0 };
+  guint i, j, n_restarts;
+
+  for (j = 0; j < 64; j++)
+    dqt[1 + j] = 16 + j;
+  for (i = 0; i < 4; i++) {
+    guint8 *table = dht + i * (1 + 16 + 12);
+
+    /* DC 0 and 1 then AC 0 and 1 */
+    table[0] = ((i / 2) << 4) | (i % 2);
+    memcpy (table + 1, huf_bits, 16);
+    for (j = 0; j < 12; j++)
+      table[17 + j] = j;
+  }
+
+  while (stream->len < min_size) {
+    append_jpeg_segment (stream, GST_JPEG_MARKER_SOI, NULL, 0);
+    append_jpeg_segment (stream, GST_JPEG_MARKER_APP0, app0, sizeof (app0));
+    dqt[0] = 0;
+    append_jpeg_segment (stream, GST_JPEG_MARKER_DQT, dqt, sizeof (dqt));
+    dqt[0] = 1;
+    append_jpeg_segment (stream, GST_JPEG_MARKER_DQT, dqt, sizeof (dqt));
+    append_jpeg_segment (stream, GST_JPEG_MARKER_SOF0, sof0, sizeof (sof0));
+    append_jpeg_segment (stream, GST_JPEG_MARKER_DHT, dht, sizeof (dht));
+    append_jpeg_segment (stream, GST_JPEG_MARKER_DRI, dri, sizeof (dri));
+    append_jpeg_segment (stream, GST_JPEG_MARKER_SOS, sos, sizeof (sos));
+
+    /* entropy coded data, with stuffed 0xff bytes and restart markers */
+    n_restarts = I_PICTURE_SIZE / JPEG_RESTART_SPACING;
+    for (i = 0; i < n_restarts; i++) {
+      g_byte_array_set_size (entropy, 0);
+      append_random (entropy, rand, JPEG_RESTART_SPACING);
+      for (j = 0; j < entropy->len; j++) {
+        g_byte_array_append (stream, &entropy->data[j], 1);
+        if (entropy->data[j] == 0xff)
+          g_byte_array_append (stream, (const guint8 *) "", 1);
+      }
+      if (i + 1 < n_restarts) {
+        rst[1] = GST_JPEG_MARKER_RST0 + i % 8;
+        g_byte_array_append (stream, rst, 2);
+      }
+    }
+
+    append_jpeg_segment (stream, GST_JPEG_MARKER_EOI, NULL, 0);
+  }
+
+  g_byte_array_free (entropy, TRUE);
+  g_rand_free (rand);
+  return stream;
+}
+
+const CodecParser codec_parsers[] = {
+  {"h264", "nal", parse_h264, generate_h264},
+  {"h265", "nal", parse_h265, generate_h265},
+  {"vp9", "frame", parse_vp9, generate_vp9},
+  {"mpegvideo", "packet", parse_mpeg_video, generate_mpeg_video},
+  {"jpeg", "segment", parse_jpeg, generate_jpeg}
+};
+
+const guint n_codec_parsers = G_N_ELEMENTS (codec_parsers);
+
+const CodecParser *
+codec_parser_find (const gchar * name)
+{
+  guint i;
+
+  for (i = 0; i < n_codec_parsers; i++)
+    if (g_str_equal (codec_parsers[i].name, name))
+      return &codec_parsers[i];
+
+  return NULL;
+}
@@ -0,0 +1,62 @@
+/*
+ * codecparsers-common.h - Parser entry points and synthetic streams shared
+ * by the codec parsers benchmark and fuzzing harness
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __CODECPARSERS_COMMON_H__
+#define __CODECPARSERS_COMMON_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* CodecParserStats: What one parse of a stream found */
+typedef struct
+{
+  /* Number of NAL units, start code packets, frames or segments */
+  guint64 units;
+  /* Number of units the parser rejected */
+  guint64 errors;
+} CodecParserStats;
+
+/* CodecParser: Entry point of one of the codec parsers
+ *
+ * @parse walks a whole stream with a new parser instance, parsing the
+ * headers of every unit, and adds what it found to @stats. It must cope
+ * with any input, as it is also the entry point of the fuzzing harness.
+ *
+ * @generate returns a deterministic synthetic stream of at least
+ * @min_size bytes, made of valid headers and random payloads.
+ *
+ * Streams are elementary streams, except for VP9 which is in IVF.
+ */
+typedef struct
+{
+  const gchar *name;
+  const gchar *unit;
+  void (*parse) (const guint8 * data, gsize size, CodecParserStats * stats);
+  GByteArray *(*generate) (gsize min_size);
+} CodecParser;
+
+extern const CodecParser codec_parsers[];
+extern const guint n_codec_parsers;
+
+const CodecParser *codec_parser_find (const gchar * name);
+
+G_END_DECLS
+#endif /* __CODECPARSERS_COMMON_H__ */
@@ -0,0 +1,59 @@
+/*
+ * codecparsers-fuzz.c - libFuzzer harness for the codec parsers
+ *
+ * The first byte of each input selects the parser, the rest is the stream
+ * handed to the same entry points as the codecparsers benchmark. It is not
+ * built by default, build it with a compiler supporting libFuzzer:
+ *
+ *   make codecparsers-fuzz CC=clang \
+ *       CFLAGS="-g -O1 -fsanitize=fuzzer-no-link,address" \
+ *       LDFLAGS="-fsanitize=fuzzer,address"
+ *
+ * The synthetic streams of the benchmark make a good seed corpus, see
+ * --dump-corpus of the codecparsers benchmark.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/gst.h>
+
+#include "codecparsers-common.h"
+
+int LLVMFuzzerInitialize (int *argc, char ***argv);
+int LLVMFuzzerTestOneInput (const guint8 * data, size_t size);
+
+int
+LLVMFuzzerInitialize (int *argc, char ***argv)
+{
+  /* the parsers log through their debug categories */
+  gst_init (NULL, NULL);
+
+  return 0;
+}
+
+int
+LLVMFuzzerTestOneInput (const guint8 * data, size_t size)
+{
+  CodecParserStats stats = { 0, };
+
+  if (size < 1)
+    return 0;
+
+  codec_parsers[data[0] % n_codec_parsers].parse (data + 1, size - 1,
+      &stats);
+
+  return 0;
+}
@@ -0,0 +1,280 @@
+/*
+ * codecparsers.c - Throughput of the codec parsers
+ *
+ * Measures how fast the H.264, H.265, VP9, MPEG-1/2 video and JPEG
+ * parsers of the codecparsers library walk through streams, parsing the
+ * headers of every unit. Each parser runs on a synthetic stream and on
+ * the files given with --file, and the results are printed as JSON:
+ *
+ *   codecparsers --file h264:foo.h264 --file vp9:bar.ivf > results.json
+ *
+ * For each stream, the stream is parsed --iterations times and the fastest
+ * run is reported, in MB/s (10^6 bytes per second) and units per second.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/gst.h>
+
+#include "codecparsers-common.h"
+
+/* small enough for the fuzzer to mutate efficiently, large enough to hold
+ * the headers and a few pictures */
+#define CORPUS_ENTRY_SIZE (64 * 1024)
+
+typedef struct
+{
+  const CodecParser *parser;
+  const gchar *input;
+  gsize size;
+  CodecParserStats stats;
+  gint64 best_time;
+} Result;
+
+static void
+run_benchmark (Result * result, const guint8 * data, gint iterations)
+{
+  gint64 start_time, elapsed;
+  gint i;
+
+  result->best_time = G_MAXINT64;
+
+  for (i = 0; i < iterations; i++) {
+    memset (&result->stats, 0, sizeof (result->stats));
+
+    start_time = g_get_monotonic_time ();
+    result->parser->parse (data, result->size, &result->stats);
+    elapsed = g_get_monotonic_time () - start_time;
+
+    result->best_time = MIN (result->best_time, elapsed);
+  }
+}
+
+/* Writes the beginning of @stream, prefixed with the byte selecting @parser
+ * in the fuzzing harness */
+static gboolean
+dump_corpus_entry (const gchar * dir, const CodecParser * parser,
+    GByteArray * stream, GError ** err)
+{
+  guint8 *entry;
+  gsize size = MIN (stream->len, CORPUS_ENTRY_SIZE);
+  gchar *basename, *filename;
+  gboolean ret;
+
+  entry = g_malloc (size + 1);
+  entry[0] = parser - codec_parsers;
+  memcpy (entry + 1, stream->data, size);
+
+  basename = g_strdup_printf ("%s-synthetic", parser->name);
+  filename = g_build_filename (dir, basename, NULL);
+  ret = g_file_set_contents (filename, (const gchar *) entry, size + 1, err);
+
+  g_free (filename);
+  g_free (basename);
+  g_free (entry);
+
+  return ret;
+}
+
+static gboolean
+parser_selected (const CodecParser * parser, gchar ** names)
+{
+  guint i;
+
+  if (!names)
+    return TRUE;
+
+  for (i = 0; names[i]; i++)
+    if (g_str_equal (names[i], parser->name))
+      return TRUE;
+
+  return FALSE;
+}
+
+static void
+print_json_string (const gchar * str)
+{
+  const gchar *p;
+
+  g_print ("\"");
+  for (p = str; *p; p++) {
+    if (*p == '"' || *p == '\\')
+      g_print ("\\%c", *p);
+    else if ((guchar) * p < 0x20)
+      g_print ("\\u%04x", (guchar) * p);
+    else
+      g_print ("%c", *p);
+  }
+  g_print ("\"");
+}
+
+/* JSON numbers must not depend on the locale */
+static void
+print_json_double (gdouble value)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  g_print ("%s", g_ascii_formatd (buf, sizeof (buf), "%.3f", value));
+}
+
+static void
+print_result (const Result * result, gint iterations, gboolean last)
+{
+  /* don't divide by 0 on streams too small to be timed */
+  gdouble seconds = MAX (result->best_time, 1) / (gdouble) G_USEC_PER_SEC;
+
+  g_print ("    {\n");
+  g_print ("      \"parser\": \"%s\",\n", result->parser->name);
+  g_print ("      \"input\": ");
+  print_json_string (result->input);
+  g_print (",\n");
+  g_print ("      \"unit\": \"%s\",\n", result->parser->unit);
+  g_print ("      \"bytes\": %" G_GSIZE_FORMAT ",\n", result->size);
+  g_print ("      \"units\": %" G_GUINT64_FORMAT ",\n", result->stats.units);
+  g_print ("      \"errors\": %" G_GUINT64_FORMAT ",\n", result->stats.errors);
+  g_print ("      \"iterations\": %d,\n", iterations);
+  g_print ("      \"best_seconds\": ");
+  print_json_double (seconds);
+  g_print (",\n      \"mb_per_s\": ");
+  print_json_double (result->size / seconds / 1e6);
+  g_print (",\n      \"units_per_s\": ");
+  print_json_double (result->stats.units / seconds);
+  g_print ("\n    }%s\n", last ? "" : ",");
+}
+
+gint
+main (gint argc, gchar ** argv)
+{
+  gchar **files = NULL, **parser_names = NULL, *corpus_dir = NULL;
+  gint synthetic_size = 32, iterations = 5;
+  GOptionEntry options[] = {
+    {"file", 'f', 0, G_OPTION_ARG_FILENAME_ARRAY, &files,
+        "Also parse FILE with PARSER", "PARSER:FILE"},
+    {"parser", 'p', 0, G_OPTION_ARG_STRING_ARRAY, &parser_names,
+        "Only run PARSER (h264, h265, vp9, mpegvideo or jpeg)", "PARSER"},
+    {"size", 's', 0, G_OPTION_ARG_INT, &synthetic_size,
+        "Size of the synthetic streams in MB, 0 to skip them (default: 32)",
+        "N"},
+    {"iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+        "Number of runs of each stream (default: 5)", "N"},
+    {"dump-corpus", 0, 0, G_OPTION_ARG_FILENAME, &corpus_dir,
+        "Also write the synthetic streams as a seed corpus for "
+        "codecparsers-fuzz in DIR", "DIR"},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GArray *results;
+  GPtrArray *inputs;
+  const CodecParser *parser;
+  Result result;
+  gchar **split;
+  guint i, j;
+
+  ctx = g_option_context_new ("- measure the throughput of the codec parsers");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_option_context_free (ctx);
+    g_error_free (err);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (iterations < 1 || synthetic_size < 0) {
+    g_printerr ("invalid number of iterations or synthetic stream size\n");
+    return 1;
+  }
+
+  results = g_array_new (FALSE, TRUE, sizeof (Result));
+  /* keeps the file names alive until the results are printed */
+  inputs = g_ptr_array_new_with_free_func (g_free);
+
+  for (i = 0; synthetic_size > 0 && i < n_codec_parsers; i++) {
+    GByteArray *stream;
+
+    parser = &codec_parsers[i];
+    if (!parser_selected (parser, parser_names))
+      continue;
+
+    stream = parser->generate ((gsize) synthetic_size * 1000 * 1000);
+
+    if (corpus_dir && !dump_corpus_entry (corpus_dir, parser, stream, &err)) {
+      g_printerr ("%s\n", err->message);
+      g_clear_error (&err);
+    }
+
+    memset (&result, 0, sizeof (result));
+    result.parser = parser;
+    result.input = "synthetic";
+    result.size = stream->len;
+    run_benchmark (&result, stream->data, iterations);
+    g_array_append_val (results, result);
+
+    g_byte_array_free (stream, TRUE);
+  }
+
+  for (j = 0; files && files[j]; j++) {
+    gchar *data;
+    gsize size;
+
+    split = g_strsplit (files[j], ":", 2);
+    parser = split[1] ? codec_parser_find (split[0]) : NULL;
+    if (!parser)
+      g_printerr ("%s: expected PARSER:FILE, PARSER being h264, h265, vp9, "
+          "mpegvideo or jpeg\n", files[j]);
+    if (!parser || !parser_selected (parser, parser_names)) {
+      g_strfreev (split);
+      continue;
+    }
+
+    if (!g_file_get_contents (split[1], &data, &size, &err)) {
+      g_printerr ("%s\n", err->message);
+      g_clear_error (&err);
+      g_strfreev (split);
+      continue;
+    }
+
+    memset (&result, 0, sizeof (result));
+    result.parser = parser;
+    result.input = split[1];
+    result.size = size;
+    run_benchmark (&result, (const guint8 *) data, iterations);
+    g_array_append_val (results, result);
+
+    g_free (data);
+    g_ptr_array_add (inputs, split[1]);
+    g_free (split[0]);
+    g_free (split);
+  }
+
+  g_print ("{\n  \"benchmarks\": [\n");
+  for (i = 0; i < results->len; i++)
+    print_result (&g_array_index (results, Result, i), iterations,
+        i + 1 == results->len);
+  g_print ("  ]\n}\n");
+
+  g_ptr_array_unref (inputs);
+  g_array_free (results, TRUE);
+  g_strfreev (parser_names);
+  g_strfreev (files);
+  g_free (corpus_dir);
+
+  return 0;
+}
@@ -0,0 +1,238 @@
+/*
+ * compositor.c - Frame rate of the compositor against its number of threads
+ *
+ * Composites a grid of inputs into large output frames, as a video wall
+ * would, for each value of the n-threads property of the compositor:
+ *
+ *   compositor --inputs 16 --width 3840 --height 2160 --threads 1,2,4,8
+ *
+ * The compositor plugin must be in the plugin path, e.g. when run from the
+ * build tree:
+ *
+ *   GST_PLUGIN_PATH=$(top_builddir)/gst/compositor ./compositor
+ *
+ * For each number of threads, the pipeline runs --iterations times and the
+ * fastest run is reported as JSON, in output frames per second.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <stdlib.h>
+
+#include <gst/gst.h>
+
+typedef struct
+{
+  const gchar *format;
+  gint n_inputs;
+  gint width, height;
+  gint n_frames;
+  gdouble alpha;
+} Config;
+
+/* Tiles the inputs on a grid covering the output frame */
+static gchar *
+make_pipeline_description (const Config * config, guint n_threads)
+{
+  GString *desc = g_string_new (NULL);
+  gint cols, rows, tile_width, tile_height, i;
+
+  for (cols = 1; cols * cols < config->n_inputs; cols++);
+  rows = (config->n_inputs + cols - 1) / cols;
+  tile_width = GST_ROUND_UP_2 (config->width / cols);
+  tile_height = GST_ROUND_UP_2 (config->height / rows);
+
+  g_string_append_printf (desc, "compositor name=mix n-threads=%u "
+      "background=black", n_threads);
+  for (i = 0; i < config->n_inputs; i++) {
+    gchar alpha[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_ascii_dtostr (alpha, sizeof (alpha), config->alpha);
+    g_string_append_printf (desc, " sink_%d::xpos=%d sink_%d::ypos=%d "
+        "sink_%d::alpha=%s", i, (i % cols) * tile_width, i,
+        (i / cols) * tile_height, i, alpha);
+  }
+  g_string_append_printf (desc, " ! video/x-raw,format=%s,width=%d,height=%d "
+      "! fakesink sync=false", config->format, config->width, config->height);
+
+  for (i = 0; i < config->n_inputs; i++) {
+    g_string_append_printf (desc, " videotestsrc num-buffers=%d pattern=ball "
+        "! video/x-raw,format=%s,width=%d,height=%d,framerate=30/1 "
+        "! mix.sink_%d", config->n_frames, config->format, tile_width,
+        tile_height, i);
+  }
+
+  return g_string_free (desc, FALSE);
+}
+
+/* Returns the time taken to composite all the frames, in microseconds, or
+ * -1 on error */
+static gint64
+run_pipeline (const gchar * description)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  GError *err = NULL;
+  gint64 start_time, elapsed = -1;
+
+  pipeline = gst_parse_launch (description, &err);
+  if (!pipeline) {
+    g_printerr ("could not create pipeline: %s\n", err->message);
+    g_error_free (err);
+    return -1;
+  }
+
+  /* the time to preroll is part of the measure, it composites a frame */
+  start_time = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+    elapsed = g_get_monotonic_time () - start_time;
+  } else {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("pipeline error: %s\n", err->message);
+    g_error_free (err);
+  }
+
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+/* JSON numbers must not depend on the locale */
+static void
+print_json_double (gdouble value)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  g_print ("%s", g_ascii_formatd (buf, sizeof (buf), "%.3f", value));
+}
+
+static void
+print_result (const Config * config, guint n_threads, gint64 best_time,
+    gint iterations, gboolean last)
+{
+  gdouble seconds = MAX (best_time, 1) / (gdouble) G_USEC_PER_SEC;
+
+  g_print ("    {\n");
+  g_print ("      \"threads\": %u,\n", n_threads);
+  g_print ("      \"inputs\": %d,\n", config->n_inputs);
+  g_print ("      \"format\": \"%s\",\n", config->format);
+  g_print ("      \"width\": %d,\n", config->width);
+  g_print ("      \"height\": %d,\n", config->height);
+  g_print ("      \"alpha\": ");
+  print_json_double (config->alpha);
+  g_print (",\n      \"frames\": %d,\n", config->n_frames);
+  g_print ("      \"iterations\": %d,\n", iterations);
+  g_print ("      \"best_seconds\": ");
+  print_json_double (seconds);
+  g_print (",\n      \"fps\": ");
+  print_json_double (config->n_frames / seconds);
+  g_print ("\n    }%s\n", last ? "" : ",");
+}
+
+gint
+main (gint argc, gchar ** argv)
+{
+  gchar *format = NULL, *threads = NULL;
+  Config config = { NULL, 16, 3840, 2160, 100, 1.0 };
+  gint iterations = 3;
+  GOptionEntry options[] = {
+    {"inputs", 'i', 0, G_OPTION_ARG_INT, &config.n_inputs,
+        "Number of inputs (default: 16)", "N"},
+    {"width", 'W', 0, G_OPTION_ARG_INT, &config.width,
+        "Width of the output frames (default: 3840)", "WIDTH"},
+    {"height", 'H', 0, G_OPTION_ARG_INT, &config.height,
+        "Height of the output frames (default: 2160)", "HEIGHT"},
+    {"format", 'f', 0, G_OPTION_ARG_STRING, &format,
+        "Video format of the inputs and output (default: I420)", "FORMAT"},
+    {"alpha", 'a', 0, G_OPTION_ARG_DOUBLE, &config.alpha,
+        "Alpha of the inputs (default: 1.0)", "ALPHA"},
+    {"frames", 'n', 0, G_OPTION_ARG_INT, &config.n_frames,
+        "Number of frames to composite (default: 100)", "N"},
+    {"threads", 't', 0, G_OPTION_ARG_STRING, &threads,
+        "Comma separated numbers of threads to measure, 0 for the number "
+          "of processors (default: 1,2,4,8)", "N,..."},
+    {"iterations", 0, 0, G_OPTION_ARG_INT, &iterations,
+        "Number of runs for each number of threads (default: 3)", "N"},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  gchar **n_threads;
+  guint i;
+  gint j, ret = 0;
+
+  ctx = g_option_context_new ("- measure the frame rate of the compositor "
+      "against its number of threads");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_option_context_free (ctx);
+    g_error_free (err);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (config.n_inputs < 1 || config.width < 16 || config.height < 16 ||
+      config.n_frames < 1 || iterations < 1) {
+    g_printerr ("invalid number of inputs, frame size, number of frames or "
+        "iterations\n");
+    return 1;
+  }
+
+  config.format = format ? format : "I420";
+  n_threads = g_strsplit (threads ? threads : "1,2,4,8", ",", -1);
+
+  g_print ("{\n  \"benchmarks\": [\n");
+  for (i = 0; n_threads[i]; i++) {
+    guint threads_value = strtoul (n_threads[i], NULL, 10);
+    gchar *desc = make_pipeline_description (&config, threads_value);
+    gint64 best_time = G_MAXINT64, elapsed;
+
+    for (j = 0; j < iterations; j++) {
+      elapsed = run_pipeline (desc);
+      if (elapsed < 0)
+        break;
+      best_time = MIN (best_time, elapsed);
+    }
+    g_free (desc);
+
+    if (best_time == G_MAXINT64) {
+      ret = 1;
+      break;
+    }
+
+    print_result (&config, threads_value, best_time, iterations,
+        n_threads[i + 1] == NULL);
+  }
+  g_print ("  ]\n}\n");
+
+  g_strfreev (n_threads);
+  g_free (threads);
+  g_free (format);
+
+  return ret;
+}
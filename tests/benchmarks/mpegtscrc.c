@@ -0,0 +1,292 @@
+/*
+ * mpegtscrc.c - Throughput of the MPEG-TS section CRC32
+ *
+ * Checks the CRC of conditional access sections with the mpegts library,
+ * and with the table driven CRC it replaced, which processed one byte per
+ * table lookup:
+ *
+ *   mpegtscrc --sections 10000 --size 1024 --iterations 5
+ *
+ * The CRC is internal to the library, which computes it when parsing a
+ * section, before parsing its content. The timed sections have a wrong
+ * CRC, so that gst_mpegts_section_get_cat() stops right after the check,
+ * and both runs otherwise do the same work: copying each section and
+ * wrapping it in a #GstMpegtsSection. Both CRCs are first checked to
+ * accept the same sections with their correct CRC.
+ *
+ * For each CRC, the sections are checked --iterations times and the fastest
+ * run is reported as JSON, in MB/s (10^6 bytes per second) and sections per
+ * second, along with the speedup of the library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/gst.h>
+#include <gst/mpegts/mpegts.h>
+
+/* Sections are at most 4096 bytes (12 bits section_length + 3) */
+#define MAX_SECTION_SIZE 4096
+#define MIN_SECTION_SIZE 16
+
+typedef struct
+{
+  const gchar *name;
+  gboolean (*check_section) (GstMpegtsSection * section);
+} Crc;
+
+static guint32 reference_crc_tab[256];
+
+static void
+init_reference_crc_tab (void)
+{
+  guint i, j;
+
+  for (i = 0; i < 256; i++) {
+    guint32 crc = i << 24;
+
+    for (j = 0; j < 8; j++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+    reference_crc_tab[i] = crc;
+  }
+}
+
+static guint32
+reference_crc32 (const guint8 * data, guint datalen)
+{
+  guint32 crc = 0xffffffff;
+
+  while (datalen--)
+    crc = (crc << 8) ^ reference_crc_tab[((crc >> 24) ^ *data++) & 0xff];
+
+  return crc;
+}
+
+static gboolean
+reference_check_section (GstMpegtsSection * section)
+{
+  return reference_crc32 (section->data, section->section_length) == 0;
+}
+
+static gboolean
+library_check_section (GstMpegtsSection * section)
+{
+  GPtrArray *descriptors = gst_mpegts_section_get_cat (section);
+
+  if (descriptors == NULL)
+    return FALSE;
+
+  g_ptr_array_unref (descriptors);
+  return TRUE;
+}
+
+static const Crc crcs[] = {
+  {"byte-wise", reference_check_section},
+  {"mpegts", library_check_section}
+};
+
+/* A conditional access section of @size bytes, filled with descriptors
+ * of random content */
+static void
+generate_section (guint8 * data, guint size, GRand * rand)
+{
+  guint offset = 8, i;
+
+  data[0] = GST_MTS_TABLE_ID_CONDITIONAL_ACCESS;
+  /* section_syntax_indicator, '0', reserved and section_length */
+  GST_WRITE_UINT16_BE (data + 1, 0xb000 | (size - 3));
+  /* reserved */
+  GST_WRITE_UINT16_BE (data + 3, 0xffff);
+  /* reserved, version_number and current_next_indicator */
+  data[5] = 0xc1;
+  /* section_number and last_section_number */
+  data[6] = data[7] = 0;
+
+  while (offset < size - 4) {
+    guint left = size - 4 - offset - 2;
+    guint length = MIN (left, 255);
+
+    /* don't leave a single byte, too short for a descriptor */
+    if (left - length == 1)
+      length--;
+
+    data[offset] = g_rand_int_range (rand, 0x80, 0x100);
+    data[offset + 1] = length;
+    for (i = 0; i < length; i++)
+      data[offset + 2 + i] = g_rand_int_range (rand, 0, 256);
+    offset += 2 + length;
+  }
+
+  GST_WRITE_UINT32_BE (data + size - 4, reference_crc32 (data, size - 4));
+}
+
+/* Returns the number of @sections accepted by @crc */
+static guint
+check_sections (const Crc * crc, guint8 * sections, guint n_sections,
+    guint size)
+{
+  guint i, n_accepted = 0;
+
+  for (i = 0; i < n_sections; i++) {
+    GstMpegtsSection *section;
+
+    section = gst_mpegts_section_new (0x0001,
+        g_memdup (sections + i * size, size), size);
+    if (crc->check_section (section))
+      n_accepted++;
+    gst_mpegts_section_unref (section);
+  }
+
+  return n_accepted;
+}
+
+/* Returns the fastest of @iterations runs, in microseconds */
+static gint64
+run_benchmark (const Crc * crc, guint8 * sections, guint n_sections,
+    guint size, gint iterations, guint * n_accepted)
+{
+  gint64 start_time, elapsed, best_time = G_MAXINT64;
+  gint i;
+
+  for (i = 0; i < iterations; i++) {
+    start_time = g_get_monotonic_time ();
+    *n_accepted = check_sections (crc, sections, n_sections, size);
+    elapsed = g_get_monotonic_time () - start_time;
+
+    best_time = MIN (best_time, elapsed);
+  }
+
+  return best_time;
+}
+
+/* JSON numbers must not depend on the locale */
+static void
+print_json_double (gdouble value)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  g_print ("%s", g_ascii_formatd (buf, sizeof (buf), "%.3f", value));
+}
+
+static void
+print_result (const Crc * crc, guint n_sections, guint size, gint iterations,
+    gint64 best_time, gint64 reference_time, gboolean last)
+{
+  /* don't divide by 0 on runs too short to be timed */
+  gdouble seconds = MAX (best_time, 1) / (gdouble) G_USEC_PER_SEC;
+  gdouble reference_seconds = MAX (reference_time, 1) / (gdouble)
+      G_USEC_PER_SEC;
+
+  g_print ("    {\n");
+  g_print ("      \"crc\": \"%s\",\n", crc->name);
+  g_print ("      \"sections\": %u,\n", n_sections);
+  g_print ("      \"section_size\": %u,\n", size);
+  g_print ("      \"iterations\": %d,\n", iterations);
+  g_print ("      \"best_seconds\": ");
+  print_json_double (seconds);
+  g_print (",\n      \"mb_per_s\": ");
+  print_json_double ((gdouble) n_sections * size / seconds / 1e6);
+  g_print (",\n      \"sections_per_s\": ");
+  print_json_double (n_sections / seconds);
+  g_print (",\n      \"speedup\": ");
+  print_json_double (reference_seconds / seconds);
+  g_print ("\n    }%s\n", last ? "" : ",");
+}
+
+gint
+main (gint argc, gchar ** argv)
+{
+  gint n_sections = 10000, size = 1024, iterations = 5;
+  GOptionEntry options[] = {
+    {"sections", 's', 0, G_OPTION_ARG_INT, &n_sections,
+        "Number of sections (default: 10000)", "N"},
+    {"size", 'b', 0, G_OPTION_ARG_INT, &size,
+        "Size of the sections in bytes, from 16 to 4096 (default: 1024)",
+        "BYTES"},
+    {"iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+        "Number of runs of each CRC (default: 5)", "N"},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GRand *rand;
+  guint8 *sections;
+  gint64 best_time, reference_time = 0;
+  guint i, n_accepted;
+  gint ret = 0;
+
+  ctx = g_option_context_new ("- measure the throughput of the MPEG-TS "
+      "section CRC32");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_option_context_free (ctx);
+    g_error_free (err);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (n_sections < 1 || iterations < 1 || size < MIN_SECTION_SIZE
+      || size > MAX_SECTION_SIZE) {
+    g_printerr ("invalid number of sections, size or iterations\n");
+    return 1;
+  }
+
+  gst_mpegts_initialize ();
+  init_reference_crc_tab ();
+
+  rand = g_rand_new_with_seed (0x435243);
+  sections = g_malloc ((gsize) n_sections * size);
+  for (i = 0; i < n_sections; i++)
+    generate_section (sections + i * size, size, rand);
+  g_rand_free (rand);
+
+  for (i = 0; i < G_N_ELEMENTS (crcs); i++) {
+    n_accepted = check_sections (&crcs[i], sections, n_sections, size);
+    if (n_accepted != n_sections) {
+      g_printerr ("%s: rejected %u valid sections\n", crcs[i].name,
+          n_sections - n_accepted);
+      ret = 1;
+    }
+  }
+
+  /* time the CRC alone, without parsing the descriptors */
+  for (i = 0; i < n_sections; i++)
+    sections[(i + 1) * size - 1] ^= 0xff;
+
+  g_print ("{\n  \"benchmarks\": [\n");
+  for (i = 0; i < G_N_ELEMENTS (crcs); i++) {
+    best_time = run_benchmark (&crcs[i], sections, n_sections, size,
+        iterations, &n_accepted);
+    if (i == 0)
+      reference_time = best_time;
+    if (n_accepted != 0) {
+      g_printerr ("%s: accepted %u invalid sections\n", crcs[i].name,
+          n_accepted);
+      ret = 1;
+    }
+
+    print_result (&crcs[i], n_sections, size, iterations, best_time,
+        reference_time, i + 1 == G_N_ELEMENTS (crcs));
+  }
+  g_print ("  ]\n}\n");
+
+  g_free (sections);
+
+  return ret;
+}
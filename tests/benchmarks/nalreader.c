@@ -0,0 +1,508 @@
+/*
+ * nalreader.c - Throughput of the NAL unit bit reader
+ *
+ * Parses the syntax elements of H.264 sequence parameter sets and slice
+ * headers with the NalReader of the codecparsers library, and with the
+ * reader it replaced, which loaded its cache one byte at a time and read
+ * the exp-Golomb codes one bit at a time:
+ *
+ *   nalreader --units 100000 --iterations 5
+ *
+ * The units are generated with random values, biased towards the small
+ * ones found in real streams, and carry emulation prevention bytes where
+ * needed. For each syntax and reader, the units are parsed --iterations
+ * times and the fastest run is reported as JSON, in MB/s (10^6 bytes per
+ * second) and units per second, along with the speedup of the NalReader.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/gst.h>
+#include <gst/codecparsers/nalutils.h>
+
+typedef enum
+{
+  ELEMENT_BITS,
+  ELEMENT_UE,
+  ELEMENT_SE
+} ElementType;
+
+/* A syntax element, @arg is the number of bits of ELEMENT_BITS and the
+ * maximum absolute value of the exp-Golomb codes */
+typedef struct
+{
+  ElementType type;
+  guint arg;
+} Element;
+
+#define BITS(n) { ELEMENT_BITS, n }
+#define UE(max) { ELEMENT_UE, max }
+#define SE(max) { ELEMENT_SE, max }
+
+/* High profile SPS with cropping and VUI timing information */
+static const Element sps_elements[] = {
+  BITS (8), BITS (8), BITS (8), UE (31),
+  UE (3), UE (6), UE (6), BITS (1), BITS (1),
+  UE (12), UE (2), UE (12), UE (16), BITS (1),
+  UE (511), UE (511), BITS (1), BITS (1),
+  BITS (1), UE (16), UE (16), UE (16), UE (16),
+  BITS (1), BITS (1), BITS (8), BITS (1), BITS (1), BITS (3), BITS (1),
+  BITS (1), BITS (8), BITS (8), BITS (8), BITS (1),
+  BITS (1), BITS (32), BITS (32), BITS (1),
+  BITS (1), BITS (1), BITS (1), BITS (1), BITS (1),
+  UE (16), UE (16), UE (16), UE (16), UE (16), UE (16)
+};
+
+/* P slice header with reordering, weighted prediction of 4 references,
+ * reference marking and deblocking control */
+static const Element slice_elements[] = {
+  UE (8159), UE (9), UE (255), BITS (8), BITS (8),
+  BITS (1), UE (31),
+  BITS (1), UE (3), UE (1000), UE (3), UE (1000), UE (3),
+  UE (7), UE (7),
+  BITS (1), SE (128), SE (127), BITS (1), SE (128), SE (127), SE (128),
+  SE (127),
+  BITS (1), SE (128), SE (127), BITS (1), SE (128), SE (127), SE (128),
+  SE (127),
+  BITS (1), SE (128), SE (127), BITS (1), SE (128), SE (127), SE (128),
+  SE (127),
+  BITS (1), SE (128), SE (127), BITS (1), SE (128), SE (127), SE (128),
+  SE (127),
+  BITS (1), BITS (1),
+  UE (2), SE (26), UE (2), SE (6), SE (6)
+};
+
+typedef struct
+{
+  const gchar *name;
+  const Element *elements;
+  guint n_elements;
+} Syntax;
+
+static const Syntax syntaxes[] = {
+  {"sps", sps_elements, G_N_ELEMENTS (sps_elements)},
+  {"slice", slice_elements, G_N_ELEMENTS (slice_elements)}
+};
+
+/* Units stored back to back in @data, @offsets has n_units + 1 entries */
+typedef struct
+{
+  GByteArray *data;
+  GArray *offsets;
+} Units;
+
+/* Byte-wise reader, as the NalReader used to be. It works on the same
+ * NalReader structure, set up with nal_reader_init() */
+
+static gboolean
+byte_reader_read (NalReader * nr, guint nbits)
+{
+  if (nr->byte * 8 + (nbits - nr->bits_in_cache) > nr->size * 8)
+    return FALSE;
+
+  while (nr->bits_in_cache < nbits) {
+    guint8 byte;
+    gboolean check_three_byte;
+
+    check_three_byte = TRUE;
+  next_byte:
+    if (nr->byte >= nr->size)
+      return FALSE;
+
+    byte = nr->data[nr->byte++];
+
+    if (check_three_byte && byte == 0x03 && nr->first_byte == 0x00 &&
+        ((nr->cache & 0xff) == 0)) {
+      check_three_byte = FALSE;
+      nr->n_epb++;
+      goto next_byte;
+    }
+    nr->cache = (nr->cache << 8) | nr->first_byte;
+    nr->first_byte = byte;
+    nr->bits_in_cache += 8;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+byte_reader_get_bits_uint32 (NalReader * nr, guint32 * val, guint nbits)
+{
+  guint shift;
+
+  if (!byte_reader_read (nr, nbits))
+    return FALSE;
+
+  shift = nr->bits_in_cache - nbits;
+  *val = nr->first_byte >> shift;
+  *val |= nr->cache << (8 - shift);
+  if (nbits < 32)
+    *val &= ((guint32) 1 << nbits) - 1;
+
+  nr->bits_in_cache = shift;
+
+  return TRUE;
+}
+
+static gboolean
+byte_reader_get_ue (NalReader * nr, guint32 * val)
+{
+  guint i = 0;
+  guint32 bit;
+  guint32 value;
+
+  if (!byte_reader_get_bits_uint32 (nr, &bit, 1))
+    return FALSE;
+
+  while (bit == 0) {
+    i++;
+    if (!byte_reader_get_bits_uint32 (nr, &bit, 1))
+      return FALSE;
+  }
+
+  if (i > 32)
+    return FALSE;
+
+  if (!byte_reader_get_bits_uint32 (nr, &value, i))
+    return FALSE;
+
+  *val = (1 << i) - 1 + value;
+
+  return TRUE;
+}
+
+static gboolean
+byte_reader_get_se (NalReader * nr, gint32 * val)
+{
+  guint32 value;
+
+  if (!byte_reader_get_ue (nr, &value))
+    return FALSE;
+
+  if (value % 2)
+    *val = (value / 2) + 1;
+  else
+    *val = -(value / 2);
+
+  return TRUE;
+}
+
+/* Parses all the units with one reader, as the parsers do with the READ_*
+ * macros, and returns the sum of the values read */
+#define DEFINE_PARSE_UNITS(prefix, get_bits, get_ue, get_se)                 \
+static guint32                                                              \
+prefix##_parse_units (const Syntax * syntax, const Units * units)           \
+{                                                                           \
+  const guint *offsets = (const guint *) units->offsets->data;              \
+  guint32 sum = 0, uval;                                                    \
+  gint32 sval;                                                              \
+  guint i, j;                                                               \
+                                                                            \
+  for (i = 0; i + 1 < units->offsets->len; i++) {                           \
+    NalReader nr;                                                           \
+                                                                            \
+    nal_reader_init (&nr, units->data->data + offsets[i],                   \
+        offsets[i + 1] - offsets[i]);                                       \
+                                                                            \
+    for (j = 0; j < syntax->n_elements; j++) {                              \
+      switch (syntax->elements[j].type) {                                   \
+        case ELEMENT_BITS:                                                  \
+          if (!get_bits (&nr, &uval, syntax->elements[j].arg))              \
+            goto error;                                                     \
+          sum += uval;                                                      \
+          break;                                                            \
+        case ELEMENT_UE:                                                    \
+          if (!get_ue (&nr, &uval))                                         \
+            goto error;                                                     \
+          sum += uval;                                                      \
+          break;                                                            \
+        case ELEMENT_SE:                                                    \
+          if (!get_se (&nr, &sval))                                         \
+            goto error;                                                     \
+          sum += sval;                                                      \
+          break;                                                            \
+      }                                                                     \
+    }                                                                       \
+    continue;                                                               \
+                                                                            \
+  error:                                                                    \
+    g_error ("unit %u: failed to read element %u", i, j);                   \
+  }                                                                         \
+                                                                            \
+  return sum;                                                               \
+}
+
+DEFINE_PARSE_UNITS (byte_reader, byte_reader_get_bits_uint32,
+    byte_reader_get_ue, byte_reader_get_se);
+DEFINE_PARSE_UNITS (nal_reader, nal_reader_get_bits_uint32,
+    nal_reader_get_ue, nal_reader_get_se);
+
+typedef struct
+{
+  const gchar *name;
+  guint32 (*parse_units) (const Syntax * syntax, const Units * units);
+} Reader;
+
+static const Reader readers[] = {
+  {"byte-wise", byte_reader_parse_units},
+  {"nal_reader", nal_reader_parse_units}
+};
+
+/* Bit writer for the generated units */
+typedef struct
+{
+  GByteArray *rbsp;
+  guint64 cache;
+  guint bits;
+} Writer;
+
+static void
+writer_put_bits (Writer * w, guint32 value, guint nbits)
+{
+  if (nbits > 16) {
+    writer_put_bits (w, value >> 16, nbits - 16);
+    nbits = 16;
+  }
+
+  w->cache = (w->cache << nbits) | (value & ((1 << nbits) - 1));
+  w->bits += nbits;
+
+  while (w->bits >= 8) {
+    guint8 byte = w->cache >> (w->bits - 8);
+
+    g_byte_array_append (w->rbsp, &byte, 1);
+    w->bits -= 8;
+  }
+}
+
+static void
+writer_put_ue (Writer * w, guint32 value)
+{
+  guint len = g_bit_storage (value + 1);
+
+  writer_put_bits (w, 0, len - 1);
+  writer_put_bits (w, value + 1, len);
+}
+
+/* Small values are the most frequent, one half of the values is below 4 */
+static guint32
+random_value (GRand * rand, guint max)
+{
+  if (g_rand_boolean (rand))
+    return g_rand_int_range (rand, 0, MIN (max, 3) + 1);
+  return g_rand_int_range (rand, 0, max + 1);
+}
+
+/* Appends a unit with random values for @syntax to @units */
+static void
+generate_unit (const Syntax * syntax, Units * units, Writer * w,
+    GRand * rand)
+{
+  guint i, zeros = 0, offset;
+
+  g_byte_array_set_size (w->rbsp, 0);
+  w->cache = 0;
+  w->bits = 0;
+
+  for (i = 0; i < syntax->n_elements; i++) {
+    const Element *e = &syntax->elements[i];
+    guint32 value;
+
+    switch (e->type) {
+      case ELEMENT_BITS:
+        value = g_rand_int (rand);
+        /* flags and other small fields are mostly 0 */
+        if (e->arg < 8 && g_rand_boolean (rand))
+          value = 0;
+        writer_put_bits (w, value, e->arg);
+        break;
+      case ELEMENT_UE:
+        writer_put_ue (w, random_value (rand, e->arg));
+        break;
+      case ELEMENT_SE:
+        value = random_value (rand, e->arg);
+        writer_put_ue (w, g_rand_boolean (rand) && value ? 2 * value - 1 :
+            2 * value);
+        break;
+    }
+  }
+
+  /* rbsp_trailing_bits */
+  writer_put_bits (w, 1, 1);
+  if (w->bits)
+    writer_put_bits (w, 0, 8 - w->bits);
+
+  /* insert the emulation prevention bytes */
+  for (i = 0; i < w->rbsp->len; i++) {
+    guint8 byte = w->rbsp->data[i];
+
+    if (zeros == 2 && byte <= 0x03) {
+      static const guint8 epb = 0x03;
+
+      g_byte_array_append (units->data, &epb, 1);
+      zeros = 0;
+    }
+    g_byte_array_append (units->data, &byte, 1);
+    zeros = byte == 0x00 ? zeros + 1 : 0;
+  }
+
+  offset = units->data->len;
+  g_array_append_val (units->offsets, offset);
+}
+
+static void
+generate_units (const Syntax * syntax, Units * units, guint n_units)
+{
+  GRand *rand = g_rand_new_with_seed (0x4e414c);
+  Writer w = { g_byte_array_new (), 0, 0 };
+  guint i, offset = 0;
+
+  units->data = g_byte_array_new ();
+  units->offsets = g_array_new (FALSE, FALSE, sizeof (guint));
+  g_array_append_val (units->offsets, offset);
+
+  for (i = 0; i < n_units; i++)
+    generate_unit (syntax, units, &w, rand);
+
+  g_byte_array_free (w.rbsp, TRUE);
+  g_rand_free (rand);
+}
+
+/* Returns the fastest of @iterations runs, in microseconds, and stores the
+ * sum of the values read in @sum */
+static gint64
+run_benchmark (const Reader * reader, const Syntax * syntax,
+    const Units * units, gint iterations, guint32 * sum)
+{
+  gint64 start_time, elapsed, best_time = G_MAXINT64;
+  gint i;
+
+  for (i = 0; i < iterations; i++) {
+    start_time = g_get_monotonic_time ();
+    *sum = reader->parse_units (syntax, units);
+    elapsed = g_get_monotonic_time () - start_time;
+
+    best_time = MIN (best_time, elapsed);
+  }
+
+  return best_time;
+}
+
+/* JSON numbers must not depend on the locale */
+static void
+print_json_double (gdouble value)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  g_print ("%s", g_ascii_formatd (buf, sizeof (buf), "%.3f", value));
+}
+
+static void
+print_result (const Reader * reader, const Syntax * syntax,
+    const Units * units, gint iterations, gint64 best_time,
+    gint64 reference_time, gboolean last)
+{
+  /* don't divide by 0 on runs too short to be timed */
+  gdouble seconds = MAX (best_time, 1) / (gdouble) G_USEC_PER_SEC;
+  gdouble reference_seconds = MAX (reference_time, 1) / (gdouble)
+      G_USEC_PER_SEC;
+  guint n_units = units->offsets->len - 1;
+
+  g_print ("    {\n");
+  g_print ("      \"reader\": \"%s\",\n", reader->name);
+  g_print ("      \"syntax\": \"%s\",\n", syntax->name);
+  g_print ("      \"bytes\": %u,\n", units->data->len);
+  g_print ("      \"units\": %u,\n", n_units);
+  g_print ("      \"iterations\": %d,\n", iterations);
+  g_print ("      \"best_seconds\": ");
+  print_json_double (seconds);
+  g_print (",\n      \"mb_per_s\": ");
+  print_json_double (units->data->len / seconds / 1e6);
+  g_print (",\n      \"units_per_s\": ");
+  print_json_double (n_units / seconds);
+  g_print (",\n      \"speedup\": ");
+  print_json_double (reference_seconds / seconds);
+  g_print ("\n    }%s\n", last ? "" : ",");
+}
+
+gint
+main (gint argc, gchar ** argv)
+{
+  gint n_units = 100000, iterations = 5;
+  GOptionEntry options[] = {
+    {"units", 'u', 0, G_OPTION_ARG_INT, &n_units,
+        "Number of units of each syntax (default: 100000)", "N"},
+    {"iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+        "Number of runs of each reader (default: 5)", "N"},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  guint i, j;
+  gint ret = 0;
+
+  ctx = g_option_context_new ("- measure the throughput of the NAL unit bit "
+      "reader");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_option_context_free (ctx);
+    g_error_free (err);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (n_units < 1 || iterations < 1) {
+    g_printerr ("invalid number of units or iterations\n");
+    return 1;
+  }
+
+  g_print ("{\n  \"benchmarks\": [\n");
+  for (i = 0; i < G_N_ELEMENTS (syntaxes); i++) {
+    const Syntax *syntax = &syntaxes[i];
+    gint64 best_time, reference_time = 0;
+    guint32 sum, reference_sum = 0;
+    Units units;
+
+    generate_units (syntax, &units, n_units);
+
+    for (j = 0; j < G_N_ELEMENTS (readers); j++) {
+      best_time = run_benchmark (&readers[j], syntax, &units, iterations,
+          &sum);
+      if (j == 0) {
+        reference_time = best_time;
+        reference_sum = sum;
+      } else if (sum != reference_sum) {
+        g_printerr ("%s: %s read different values than %s\n", syntax->name,
+            readers[j].name, readers[0].name);
+        ret = 1;
+      }
+
+      print_result (&readers[j], syntax, &units, iterations, best_time,
+          reference_time, i + 1 == G_N_ELEMENTS (syntaxes)
+          && j + 1 == G_N_ELEMENTS (readers));
+    }
+
+    g_array_free (units.offsets, TRUE);
+    g_byte_array_free (units.data, TRUE);
+  }
+  g_print ("  ]\n}\n");
+
+  return ret;
+}
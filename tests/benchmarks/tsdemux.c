@@ -0,0 +1,411 @@
+/*
+ * tsdemux.c - Throughput of the MPEG transport stream demuxer and parser
+ *
+ * Feeds a synthetic transport stream from memory to tsparse and tsdemux
+ * in push mode and measures how fast they go through it:
+ *
+ *   tsdemux --elements tsparse,tsdemux --size 256 --buffer-size 65536
+ *
+ * The stream carries a PAT and a PMT every 100 ms, an H.264 video stream
+ * of 25 frames per second with a PCR on each frame, and an AAC audio
+ * stream with 21 ms frames interleaved with it. The plugin must be in the
+ * plugin path, e.g. when run from the build tree:
+ *
+ *   GST_PLUGIN_PATH=$(top_builddir)/gst/mpegtsdemux ./tsdemux
+ *
+ * For each element, the pipeline runs --iterations times and the fastest
+ * run is reported as JSON, in MB/s (10^6 bytes per second) and packets
+ * per second.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/gst.h>
+
+#define PACKET_SIZE 188
+
+#define PMT_PID 0x1000
+#define VIDEO_PID 0x100
+#define AUDIO_PID 0x101
+
+/* Average sizes of the frames, the video ones vary by +-50% */
+#define VIDEO_FRAME_SIZE 20000
+#define AUDIO_FRAME_SIZE 400
+
+/* 90 kHz durations */
+#define VIDEO_FRAME_DURATION 3600
+#define AUDIO_FRAME_DURATION 1920
+#define PSI_INTERVAL 9000
+
+typedef struct
+{
+  GByteArray *data;
+  guint8 cc[0x2000];
+} Stream;
+
+static guint32
+crc32_mpeg (const guint8 * data, guint size)
+{
+  guint32 crc = 0xffffffff;
+  guint i, j;
+
+  for (i = 0; i < size; i++) {
+    crc ^= (guint32) data[i] << 24;
+    for (j = 0; j < 8; j++)
+      crc = crc & 0x80000000 ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+/* Writes a packet with @size bytes of @payload (at most 184), stuffed with
+ * an adaptation field, which carries @pcr if it is not -1 */
+static void
+write_packet (Stream * stream, guint16 pid, gboolean pusi, gint64 pcr,
+    const guint8 * payload, guint size)
+{
+  guint8 packet[PACKET_SIZE];
+  guint af_size = PACKET_SIZE - 4 - size;
+
+  g_assert (size <= PACKET_SIZE - 4 - (pcr != -1 ? 8 : 0));
+
+  packet[0] = 0x47;
+  packet[1] = (pusi ? 0x40 : 0x00) | (pid >> 8);
+  packet[2] = pid & 0xff;
+  packet[3] = (af_size ? 0x30 : 0x10) | stream->cc[pid];
+  stream->cc[pid] = (stream->cc[pid] + 1) & 0xf;
+
+  if (af_size) {
+    guint8 *af = packet + 4;
+
+    /* adaptation_field_length, then the flags if there is room */
+    af[0] = af_size - 1;
+    if (af_size > 1) {
+      af[1] = pcr != -1 ? 0x10 : 0x00;
+      memset (af + 2, 0xff, af_size - 2);
+      if (pcr != -1) {
+        guint64 base = pcr / 300, ext = pcr % 300;
+
+        af[2] = base >> 25;
+        af[3] = base >> 17;
+        af[4] = base >> 9;
+        af[5] = base >> 1;
+        af[6] = ((base & 1) << 7) | 0x7e | (ext >> 8);
+        af[7] = ext;
+      }
+    }
+  }
+
+  memcpy (packet + 4 + af_size, payload, size);
+  g_byte_array_append (stream->data, packet, PACKET_SIZE);
+}
+
+/* Writes a section in one packet, completing its header and CRC */
+static void
+write_section (Stream * stream, guint16 pid, guint8 * section, guint size)
+{
+  guint8 payload[PACKET_SIZE - 4];
+  guint32 crc;
+
+  section[1] = 0xb0 | ((size - 3) >> 8);
+  section[2] = (size - 3) & 0xff;
+  crc = crc32_mpeg (section, size - 4);
+  GST_WRITE_UINT32_BE (section + size - 4, crc);
+
+  payload[0] = 0;               /* pointer_field */
+  memcpy (payload + 1, section, size);
+  memset (payload + 1 + size, 0xff, sizeof (payload) - 1 - size);
+  write_packet (stream, pid, TRUE, -1, payload, sizeof (payload));
+}
+
+static void
+write_psi (Stream * stream)
+{
+  guint8 pat[] = {
+    0x00, 0, 0, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0x00, 0x01, 0xe0 | (PMT_PID >> 8), PMT_PID & 0xff,
+    0, 0, 0, 0
+  };
+  guint8 pmt[] = {
+    0x02, 0, 0, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0xe0 | (VIDEO_PID >> 8), VIDEO_PID & 0xff, 0xf0, 0x00,
+    0x1b, 0xe0 | (VIDEO_PID >> 8), VIDEO_PID & 0xff, 0xf0, 0x00,
+    0x0f, 0xe0 | (AUDIO_PID >> 8), AUDIO_PID & 0xff, 0xf0, 0x00,
+    0, 0, 0, 0
+  };
+
+  write_section (stream, 0, pat, sizeof (pat));
+  write_section (stream, PMT_PID, pmt, sizeof (pmt));
+}
+
+/* Writes a PES packet of @size bytes of payload, with a PTS. Video PES
+ * packets are unbounded and carry a PCR in their first packet */
+static void
+write_pes (Stream * stream, guint16 pid, guint8 stream_id, guint64 pts,
+    guint size, GRand * rand)
+{
+  guint8 packet[PACKET_SIZE - 4];
+  gboolean video = stream_id == 0xe0;
+  guint pes_length = video ? 0 : size + 8;
+  guint header = 14, offset = 0, chunk, room;
+  gint64 pcr = video ? (gint64) (pts - 2 * VIDEO_FRAME_DURATION) * 300 : -1;
+
+  packet[0] = 0x00;
+  packet[1] = 0x00;
+  packet[2] = 0x01;
+  packet[3] = stream_id;
+  packet[4] = pes_length >> 8;
+  packet[5] = pes_length & 0xff;
+  packet[6] = 0x80;
+  packet[7] = 0x80;             /* PTS only */
+  packet[8] = 5;
+  packet[9] = 0x21 | ((pts >> 29) & 0x0e);
+  packet[10] = pts >> 22;
+  packet[11] = 0x01 | ((pts >> 14) & 0xfe);
+  packet[12] = pts >> 7;
+  packet[13] = 0x01 | ((pts << 1) & 0xfe);
+
+  while (offset < size) {
+    room = sizeof (packet) - header - (pcr != -1 ? 8 : 0);
+    chunk = MIN (room, size - offset);
+    /* the payload is not looked at, any data will do */
+    memset (packet + header, g_rand_int_range (rand, 0, 256), chunk);
+    write_packet (stream, pid, header > 0, pcr, packet, header + chunk);
+    offset += chunk;
+    header = 0;
+    pcr = -1;
+  }
+}
+
+static GByteArray *
+generate_stream (gsize size)
+{
+  GRand *rand = g_rand_new_with_seed (0x545344);
+  Stream *stream = g_new0 (Stream, 1);
+  GByteArray *data;
+  guint64 video_pts = 2 * VIDEO_FRAME_DURATION, audio_pts = video_pts;
+  guint64 psi_pts = 0;
+
+  stream->data = g_byte_array_sized_new (size + 1024 * 1024);
+
+  while (stream->data->len < size) {
+    if (psi_pts <= video_pts) {
+      write_psi (stream);
+      psi_pts += PSI_INTERVAL;
+    }
+
+    write_pes (stream, VIDEO_PID, 0xe0, video_pts,
+        g_rand_int_range (rand, VIDEO_FRAME_SIZE / 2,
+            VIDEO_FRAME_SIZE * 3 / 2), rand);
+    video_pts += VIDEO_FRAME_DURATION;
+
+    while (audio_pts < video_pts) {
+      write_pes (stream, AUDIO_PID, 0xc0, audio_pts, AUDIO_FRAME_SIZE, rand);
+      audio_pts += AUDIO_FRAME_DURATION;
+    }
+  }
+
+  data = stream->data;
+  g_free (stream);
+  g_rand_free (rand);
+
+  return data;
+}
+
+static gchar *
+make_pipeline_description (const gchar * element)
+{
+  /* tsdemux has a source pad per elementary stream */
+  if (g_str_equal (element, "tsdemux"))
+    return g_strdup ("appsrc name=src ! tsdemux name=demux "
+        "demux. ! fakesink sync=false async=false "
+        "demux. ! fakesink sync=false async=false");
+
+  return g_strdup_printf ("appsrc name=src ! %s ! fakesink sync=false",
+      element);
+}
+
+/* Returns the time taken to go through @data, in microseconds, or -1 on
+ * error */
+static gint64
+run_pipeline (const gchar * description, GstBuffer * data, gsize buffer_size)
+{
+  GstElement *pipeline, *src;
+  GstBus *bus;
+  GstMessage *msg;
+  GError *err = NULL;
+  GstFlowReturn flow;
+  gint64 start_time, elapsed = -1;
+  gsize offset, size = gst_buffer_get_size (data);
+
+  pipeline = gst_parse_launch (description, &err);
+  if (!pipeline) {
+    g_printerr ("could not create pipeline: %s\n", err->message);
+    g_error_free (err);
+    return -1;
+  }
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  g_object_set (src, "format", GST_FORMAT_BYTES, "max-bytes", (guint64) 0,
+      NULL);
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+
+  /* queue the whole stream at once, the buffers share the memory of
+   * @data */
+  start_time = g_get_monotonic_time ();
+  for (offset = 0; offset < size; offset += buffer_size) {
+    GstBuffer *buf = gst_buffer_copy_region (data, GST_BUFFER_COPY_MEMORY,
+        offset, MIN (buffer_size, size - offset));
+
+    GST_BUFFER_OFFSET (buf) = offset;
+    g_signal_emit_by_name (src, "push-buffer", buf, &flow);
+    gst_buffer_unref (buf);
+  }
+  g_signal_emit_by_name (src, "end-of-stream", &flow);
+  gst_object_unref (src);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+    elapsed = g_get_monotonic_time () - start_time;
+  } else {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("pipeline error: %s\n", err->message);
+    g_error_free (err);
+  }
+
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+/* JSON numbers must not depend on the locale */
+static void
+print_json_double (gdouble value)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  g_print ("%s", g_ascii_formatd (buf, sizeof (buf), "%.3f", value));
+}
+
+static void
+print_result (const gchar * element, gsize size, gsize buffer_size,
+    gint iterations, gint64 best_time, gboolean last)
+{
+  gdouble seconds = MAX (best_time, 1) / (gdouble) G_USEC_PER_SEC;
+
+  g_print ("    {\n");
+  g_print ("      \"element\": \"%s\",\n", element);
+  g_print ("      \"bytes\": %" G_GSIZE_FORMAT ",\n", size);
+  g_print ("      \"buffer_size\": %" G_GSIZE_FORMAT ",\n", buffer_size);
+  g_print ("      \"iterations\": %d,\n", iterations);
+  g_print ("      \"best_seconds\": ");
+  print_json_double (seconds);
+  g_print (",\n      \"mb_per_s\": ");
+  print_json_double (size / seconds / 1e6);
+  g_print (",\n      \"packets_per_s\": ");
+  print_json_double (size / PACKET_SIZE / seconds);
+  g_print ("\n    }%s\n", last ? "" : ",");
+}
+
+gint
+main (gint argc, gchar ** argv)
+{
+  gchar *elements = NULL;
+  gint size = 256, buffer_size = 65536, iterations = 3;
+  GOptionEntry options[] = {
+    {"elements", 'e', 0, G_OPTION_ARG_STRING, &elements,
+        "Comma separated elements to measure (default: tsparse,tsdemux)",
+        "ELEMENT,..."},
+    {"size", 's', 0, G_OPTION_ARG_INT, &size,
+        "Size of the stream in MB (default: 256)", "N"},
+    {"buffer-size", 'b', 0, G_OPTION_ARG_INT, &buffer_size,
+        "Size of the input buffers in bytes (default: 65536)", "BYTES"},
+    {"iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+        "Number of runs for each element (default: 3)", "N"},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GByteArray *stream;
+  GstBuffer *data;
+  gchar **names;
+  gsize stream_size;
+  guint i;
+  gint j, ret = 0;
+
+  ctx = g_option_context_new ("- measure the throughput of the MPEG "
+      "transport stream demuxer and parser");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_option_context_free (ctx);
+    g_error_free (err);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (size < 1 || buffer_size < 1 || iterations < 1) {
+    g_printerr ("invalid stream size, buffer size or iterations\n");
+    return 1;
+  }
+
+  stream = generate_stream ((gsize) size * 1000 * 1000);
+  stream_size = stream->len;
+  data = gst_buffer_new_wrapped (g_byte_array_free (stream, FALSE),
+      stream_size);
+
+  names = g_strsplit (elements ? elements : "tsparse,tsdemux", ",", -1);
+
+  g_print ("{\n  \"benchmarks\": [\n");
+  for (i = 0; names[i]; i++) {
+    gchar *desc = make_pipeline_description (names[i]);
+    gint64 best_time = G_MAXINT64, elapsed;
+
+    for (j = 0; j < iterations; j++) {
+      elapsed = run_pipeline (desc, data, buffer_size);
+      if (elapsed < 0)
+        break;
+      best_time = MIN (best_time, elapsed);
+    }
+    g_free (desc);
+
+    if (j < iterations) {
+      ret = 1;
+      break;
+    }
+
+    print_result (names[i], stream_size, buffer_size, iterations, best_time,
+        names[i + 1] == NULL);
+  }
+  g_print ("  ]\n}\n");
+
+  gst_buffer_unref (data);
+  g_strfreev (names);
+  g_free (elements);
+
+  return ret;
+}
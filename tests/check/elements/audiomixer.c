@@ -1910,6 +1910,150 @@ GST_START_TEST (test_sinkpad_property_controller)
 
 GST_END_TEST;
 
+#define MANY_INPUTS 8
+#define MANY_INPUTS_SAMPLES 4000
+#define MANY_INPUTS_STEP 137
+
+/* the samples pad @i adds to the output */
+static gint
+many_inputs_sample (gint i)
+{
+  gint value = 16 * (i + 1);
+
+  if (i == 4)
+    return 0;
+  return (i % 2) ? value / 2 : value;
+}
+
+GST_START_TEST (test_many_inputs)
+{
+  GstSegment segment;
+  GstElement *bin, *audiomixer, *sink;
+  GstElement *queues[MANY_INPUTS];
+  GstPad *sinkpads[MANY_INPUTS], *queue_sinkpads[MANY_INPUTS];
+  GstBus *bus;
+  GstCaps *caps;
+  GList *received_buffers = NULL, *l;
+  gint i, n_samples = 0;
+
+  main_loop = g_main_loop_new (NULL, FALSE);
+
+  bin = gst_pipeline_new ("pipeline");
+  bus = gst_element_get_bus (bin);
+  gst_bus_add_signal_watch_full (bus, G_PRIORITY_HIGH);
+
+  g_signal_connect (bus, "message::error", (GCallback) message_received, bin);
+  g_signal_connect (bus, "message::warning", (GCallback) message_received, bin);
+  g_signal_connect (bus, "message::eos", (GCallback) message_received, bin);
+
+  /* output buffers spanning several of the blocks the inputs are mixed in */
+  audiomixer = gst_element_factory_make ("audiomixer", "audiomixer");
+  g_object_set (audiomixer, "output-buffer-duration", 5 * GST_SECOND, NULL);
+  sink = gst_element_factory_make ("fakesink", "sink");
+  g_object_set (sink, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", (GCallback) handoff_buffer_collect_cb,
+      &received_buffers);
+  gst_bin_add_many (GST_BIN (bin), audiomixer, sink, NULL);
+  fail_unless (gst_element_link (audiomixer, sink));
+
+  caps = gst_caps_new_simple ("audio/x-raw",
+      "format", G_TYPE_STRING, GST_AUDIO_NE (S16),
+      "layout", G_TYPE_STRING, "interleaved",
+      "rate", G_TYPE_INT, 1000, "channels", G_TYPE_INT, 1, NULL);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+
+  for (i = 0; i < MANY_INPUTS; i++) {
+    GstPad *pad;
+
+    queues[i] = gst_element_factory_make ("queue", NULL);
+    gst_bin_add (GST_BIN (bin), queues[i]);
+    sinkpads[i] = gst_element_get_request_pad (audiomixer, "sink_%u");
+    fail_if (sinkpads[i] == NULL);
+    pad = gst_element_get_static_pad (queues[i], "src");
+    fail_unless (gst_pad_link (pad, sinkpads[i]) == GST_PAD_LINK_OK);
+    gst_object_unref (pad);
+    queue_sinkpads[i] = gst_element_get_static_pad (queues[i], "sink");
+
+    /* halved, muted and untouched inputs */
+    if (i == 4)
+      g_object_set (sinkpads[i], "mute", TRUE, NULL);
+    else if (i % 2)
+      g_object_set (sinkpads[i], "volume", 0.5, NULL);
+  }
+
+  fail_unless (gst_element_set_state (bin,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+
+  for (i = 0; i < MANY_INPUTS; i++) {
+    GstBuffer *buffer;
+    GstMapInfo map;
+    gint16 *samples;
+    gint j;
+
+    gst_pad_send_event (queue_sinkpads[i], gst_event_new_stream_start ("test"));
+    gst_pad_set_caps (queue_sinkpads[i], caps);
+    gst_pad_send_event (queue_sinkpads[i], gst_event_new_segment (&segment));
+
+    /* each input starts at a different offset in the output */
+    buffer = gst_buffer_new_and_alloc (MANY_INPUTS_SAMPLES * 2);
+    gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+    samples = (gint16 *) map.data;
+    for (j = 0; j < MANY_INPUTS_SAMPLES; j++)
+      samples[j] = 16 * (i + 1);
+    gst_buffer_unmap (buffer, &map);
+    GST_BUFFER_TIMESTAMP (buffer) = i * MANY_INPUTS_STEP * GST_MSECOND;
+    GST_BUFFER_DURATION (buffer) = MANY_INPUTS_SAMPLES * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_chain (queue_sinkpads[i], buffer),
+        GST_FLOW_OK);
+    gst_pad_send_event (queue_sinkpads[i], gst_event_new_eos ());
+  }
+  gst_caps_unref (caps);
+
+  g_idle_add ((GSourceFunc) set_playing, bin);
+  g_main_loop_run (main_loop);
+
+  for (l = received_buffers; l; l = l->next) {
+    GstBuffer *buffer = l->data;
+    GstMapInfo map;
+    gint16 *samples;
+    gint j;
+
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    samples = (gint16 *) map.data;
+    for (j = 0; j < map.size / 2; j++) {
+      gint t = GST_BUFFER_OFFSET (buffer) + j;
+      gint expected = 0;
+
+      for (i = 0; i < MANY_INPUTS; i++) {
+        if (t >= i * MANY_INPUTS_STEP &&
+            t < i * MANY_INPUTS_STEP + MANY_INPUTS_SAMPLES)
+          expected += many_inputs_sample (i);
+      }
+      if (samples[j] != expected)
+        fail ("sample %d is %d instead of %d", t, samples[j], expected);
+    }
+    n_samples += map.size / 2;
+    gst_buffer_unmap (buffer, &map);
+  }
+  fail_unless_equals_int (n_samples,
+      (MANY_INPUTS - 1) * MANY_INPUTS_STEP + MANY_INPUTS_SAMPLES);
+
+  g_list_free_full (received_buffers, (GDestroyNotify) gst_buffer_unref);
+
+  for (i = 0; i < MANY_INPUTS; i++) {
+    gst_element_release_request_pad (audiomixer, sinkpads[i]);
+    gst_object_unref (sinkpads[i]);
+    gst_object_unref (queue_sinkpads[i]);
+  }
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_bus_remove_signal_watch (bus);
+  gst_object_unref (bus);
+  gst_object_unref (bin);
+  g_main_loop_unref (main_loop);
+}
+
+GST_END_TEST;
+
 static Suite *
 audiomixer_suite (void)
 {
@@ -1935,6 +2079,7 @@ audiomixer_suite (void)
   tcase_add_test (tc_chain, test_sync_unaligned);
   tcase_add_test (tc_chain, test_segment_base_handling);
   tcase_add_test (tc_chain, test_sinkpad_property_controller);
+  tcase_add_test (tc_chain, test_many_inputs);
 
   /* Use a longer timeout */
 #ifdef HAVE_VALGRIND
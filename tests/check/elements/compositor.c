@@ -1905,6 +1905,374 @@ GST_START_TEST (test_start_time_first_live_drop_3_unlinked_1)
 
 GST_END_TEST;
 
+static GstBuffer *
+_composite_one_frame (const gchar * format, const gchar * background,
+    guint n_threads)
+{
+  GstElement *pipeline, *sink;
+  GstSample *sample = NULL;
+  GstBuffer *buffer;
+  GstStateChangeReturn state_res;
+  gchar *desc;
+
+  /* odd sizes and positions, inputs overlapping several stripes and the
+   * edges of the frame */
+  desc = g_strdup_printf ("videotestsrc num-buffers=1 pattern=ball ! "
+      "video/x-raw,format=%s,width=64,height=48 ! mix.sink_0 "
+      "videotestsrc num-buffers=1 pattern=smpte ! "
+      "video/x-raw,format=%s,width=50,height=41 ! mix.sink_1 "
+      "compositor name=mix n-threads=%u background=%s "
+      "sink_0::xpos=-7 sink_0::ypos=-5 sink_1::xpos=31 sink_1::ypos=29 "
+      "sink_1::alpha=0.5 ! video/x-raw,format=%s,width=100,height=75 ! "
+      "appsink name=sink", format, format, n_threads, background, format);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  state_res = gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  ck_assert_int_ne (state_res, GST_STATE_CHANGE_FAILURE);
+  state_res = gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+  ck_assert_int_ne (state_res, GST_STATE_CHANGE_FAILURE);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_emit_by_name (sink, "pull-preroll", &sample);
+  fail_unless (sample != NULL);
+  buffer = gst_buffer_ref (gst_sample_get_buffer (sample));
+  gst_sample_unref (sample);
+  gst_object_unref (sink);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return buffer;
+}
+
+GST_START_TEST (test_n_threads)
+{
+  const gchar *formats[] = { "I420", "NV12", "Y41B", "YUY2", "ARGB", "RGB" };
+  const gchar *backgrounds[] = { "checker", "black", "transparent" };
+  guint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    for (j = 0; j < G_N_ELEMENTS (backgrounds); j++) {
+      GstBuffer *serial, *parallel;
+      GstMapInfo map;
+
+      GST_INFO ("testing %s with a %s background", formats[i],
+          backgrounds[j]);
+
+      /* the stripes must give the same output as a single pass */
+      serial = _composite_one_frame (formats[i], backgrounds[j], 1);
+      parallel = _composite_one_frame (formats[i], backgrounds[j], 3);
+      fail_unless_equals_int (gst_buffer_get_size (serial),
+          gst_buffer_get_size (parallel));
+      fail_unless (gst_buffer_map (serial, &map, GST_MAP_READ));
+      fail_unless (gst_buffer_memcmp (parallel, 0, map.data, map.size) == 0);
+      gst_buffer_unmap (serial, &map);
+
+      gst_buffer_unref (serial);
+      gst_buffer_unref (parallel);
+    }
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_mixed_formats)
+{
+  GstElement *pipeline, *sink;
+  GstSample *sample;
+  GstBuffer *first = NULL;
+  GstMapInfo map;
+  GstStateChangeReturn state_res;
+  gint n_buffers = 0;
+
+  /* the inputs are converted in parallel into recycled buffers, which must
+   * not change the output of the static patterns */
+  pipeline = gst_parse_launch ("videotestsrc num-buffers=5 pattern=smpte ! "
+      "video/x-raw,format=YUY2,width=64,height=48 ! mix.sink_0 "
+      "videotestsrc num-buffers=5 pattern=smpte75 ! "
+      "video/x-raw,format=NV12,width=64,height=48 ! mix.sink_1 "
+      "videotestsrc num-buffers=5 pattern=colors ! "
+      "video/x-raw,format=AYUV,width=32,height=32 ! mix.sink_2 "
+      "compositor name=mix sink_1::xpos=32 sink_2::ypos=16 "
+      "sink_2::alpha=0.5 ! video/x-raw,format=I420,width=96,height=64 ! "
+      "appsink name=sink sync=false", NULL);
+  fail_unless (pipeline != NULL);
+
+  state_res = gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  ck_assert_int_ne (state_res, GST_STATE_CHANGE_FAILURE);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  while (TRUE) {
+    GstBuffer *buffer;
+
+    sample = NULL;
+    g_signal_emit_by_name (sink, "pull-sample", &sample);
+    if (!sample)
+      break;
+
+    buffer = gst_sample_get_buffer (sample);
+    if (!first) {
+      first = gst_buffer_ref (buffer);
+      fail_unless (gst_buffer_map (first, &map, GST_MAP_READ));
+    } else {
+      fail_unless_equals_int (gst_buffer_get_size (buffer), map.size);
+      fail_unless (gst_buffer_memcmp (buffer, 0, map.data, map.size) == 0);
+    }
+    gst_sample_unref (sample);
+    n_buffers++;
+  }
+  fail_unless_equals_int (n_buffers, 5);
+
+  gst_buffer_unmap (first, &map);
+  gst_buffer_unref (first);
+  gst_object_unref (sink);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+#define OCCLUDER_X 13
+#define OCCLUDER_Y 9
+#define OCCLUDER_WIDTH 90
+#define OCCLUDER_HEIGHT 60
+
+static GstBuffer *
+_composite_occluded_frame (const gchar * format, const gchar * background,
+    gboolean below, gboolean occluder, GstVideoInfo * info)
+{
+  GstElement *pipeline, *sink;
+  GstSample *sample = NULL;
+  GstBuffer *buffer;
+  GstStateChangeReturn state_res;
+  GString *desc = g_string_new (NULL);
+
+  /* the occluder hides parts of the background and of sink_0, sink_2 is
+   * blended next to it */
+  if (below)
+    g_string_append_printf (desc, "videotestsrc num-buffers=1 pattern=smpte ! "
+        "video/x-raw,format=%s,width=128,height=96 ! mix.sink_0 "
+        "videotestsrc num-buffers=1 pattern=ball ! "
+        "video/x-raw,format=%s,width=40,height=40 ! mix.sink_2 ",
+        format, format);
+  if (occluder)
+    g_string_append_printf (desc, "videotestsrc num-buffers=1 "
+        "pattern=zone-plate ! video/x-raw,format=%s,width=%d,height=%d ! "
+        "mix.sink_1 ", format, OCCLUDER_WIDTH, OCCLUDER_HEIGHT);
+  g_string_append_printf (desc, "compositor name=mix n-threads=2 "
+      "background=%s sink_0::xpos=-7 sink_0::ypos=-5 sink_1::xpos=%d "
+      "sink_1::ypos=%d sink_1::zorder=1 sink_2::xpos=110 sink_2::ypos=70 "
+      "sink_2::alpha=0.5 sink_2::zorder=2 ! "
+      "video/x-raw,format=%s,width=160,height=120 ! appsink name=sink",
+      background, OCCLUDER_X, OCCLUDER_Y, format);
+
+  pipeline = gst_parse_launch (desc->str, NULL);
+  g_string_free (desc, TRUE);
+  fail_unless (pipeline != NULL);
+
+  state_res = gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  ck_assert_int_ne (state_res, GST_STATE_CHANGE_FAILURE);
+  state_res = gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+  ck_assert_int_ne (state_res, GST_STATE_CHANGE_FAILURE);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_emit_by_name (sink, "pull-preroll", &sample);
+  fail_unless (sample != NULL);
+  buffer = gst_buffer_ref (gst_sample_get_buffer (sample));
+  fail_unless (gst_video_info_from_caps (info, gst_sample_get_caps (sample)));
+  gst_sample_unref (sample);
+  gst_object_unref (sink);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return buffer;
+}
+
+/* Compares the samples of @buf1 and @buf2 inside the occluder if @inside,
+ * outside of it otherwise */
+static void
+_compare_occluded_frames (GstVideoInfo * info, GstBuffer * buf1,
+    GstBuffer * buf2, gboolean inside)
+{
+  const GstVideoFormatInfo *finfo = info->finfo;
+  GstVideoFrame frame1, frame2;
+  gint comp, x, y, x0, y0, x1, y1;
+
+  fail_unless (gst_video_frame_map (&frame1, info, buf1, GST_MAP_READ));
+  fail_unless (gst_video_frame_map (&frame2, info, buf2, GST_MAP_READ));
+
+  for (comp = 0; comp < GST_VIDEO_FRAME_N_COMPONENTS (&frame1); comp++) {
+    gint w_sub = GST_VIDEO_FORMAT_INFO_W_SUB (finfo, comp);
+    gint h_sub = GST_VIDEO_FORMAT_INFO_H_SUB (finfo, comp);
+    gint pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (&frame1, comp);
+    gint stride = GST_VIDEO_FRAME_COMP_STRIDE (&frame1, comp);
+    const guint8 *data1 = GST_VIDEO_FRAME_COMP_DATA (&frame1, comp);
+    const guint8 *data2 = GST_VIDEO_FRAME_COMP_DATA (&frame2, comp);
+
+    /* the occluder in samples of the component, its position being rounded
+     * to whole chroma samples */
+    x0 = GST_ROUND_UP_N (OCCLUDER_X, 1 << GST_VIDEO_FORMAT_INFO_W_SUB (finfo,
+            1));
+    y0 = GST_ROUND_UP_N (OCCLUDER_Y, 1 << GST_VIDEO_FORMAT_INFO_H_SUB (finfo,
+            1));
+    x1 = -((-(x0 + OCCLUDER_WIDTH)) >> w_sub);
+    y1 = -((-(y0 + OCCLUDER_HEIGHT)) >> h_sub);
+    x0 >>= w_sub;
+    y0 >>= h_sub;
+
+    for (y = 0; y < GST_VIDEO_FRAME_COMP_HEIGHT (&frame1, comp); y++) {
+      for (x = 0; x < GST_VIDEO_FRAME_COMP_WIDTH (&frame1, comp); x++) {
+        gboolean in_occluder = x >= x0 && x < x1 && y >= y0 && y < y1;
+
+        if (in_occluder != inside)
+          continue;
+
+        if (data1[y * stride + x * pstride] != data2[y * stride + x * pstride])
+          fail ("component %d differs at %d,%d %s the occluder", comp, x, y,
+              inside ? "inside" : "outside");
+      }
+    }
+  }
+
+  gst_video_frame_unmap (&frame1);
+  gst_video_frame_unmap (&frame2);
+}
+
+GST_START_TEST (test_occlusion)
+{
+  const gchar *formats[] = { "I420", "NV12", "Y41B", "YUY2", "RGB", "xRGB" };
+  const gchar *backgrounds[] = { "checker", "white" };
+  guint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    for (j = 0; j < G_N_ELEMENTS (backgrounds); j++) {
+      GstBuffer *all, *below, *occluder;
+      GstVideoInfo info;
+
+      GST_INFO ("testing %s with a %s background", formats[i],
+          backgrounds[j]);
+
+      all = _composite_occluded_frame (formats[i], backgrounds[j], TRUE,
+          TRUE, &info);
+      below = _composite_occluded_frame (formats[i], backgrounds[j], TRUE,
+          FALSE, &info);
+      occluder = _composite_occluded_frame (formats[i], backgrounds[j], FALSE,
+          TRUE, &info);
+
+      /* the opaque occluder hides whatever is below it, and only that */
+      _compare_occluded_frames (&info, all, below, FALSE);
+      _compare_occluded_frames (&info, all, occluder, TRUE);
+
+      gst_buffer_unref (all);
+      gst_buffer_unref (below);
+      gst_buffer_unref (occluder);
+    }
+  }
+}
+
+GST_END_TEST;
+
+/* Composites a still input, repeated after its EOS, with a moving ball in
+ * front of it */
+static GPtrArray *
+_composite_partial_frames (const gchar * format, gboolean partial_updates,
+    gdouble * recomposed_fraction)
+{
+  GstElement *pipeline, *mix, *sink;
+  GstSample *sample;
+  GstStructure *stats = NULL;
+  GstStateChangeReturn state_res;
+  GPtrArray *buffers;
+  guint64 frames;
+  gchar *desc;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=1 pattern=smpte ! "
+      "video/x-raw,format=%s,width=128,height=96 ! mix.sink_0 "
+      "videotestsrc num-buffers=10 pattern=ball ! "
+      "video/x-raw,format=%s,width=40,height=36 ! mix.sink_1 "
+      "compositor name=mix partial-updates=%s sink_0::xpos=-7 "
+      "sink_0::ypos=-5 sink_0::ignore-eos=true sink_1::xpos=41 "
+      "sink_1::ypos=39 sink_1::alpha=0.5 ! "
+      "video/x-raw,format=%s,width=160,height=120 ! "
+      "appsink name=sink sync=false", format, format,
+      partial_updates ? "true" : "false", format);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  state_res = gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  ck_assert_int_ne (state_res, GST_STATE_CHANGE_FAILURE);
+
+  buffers = g_ptr_array_new_with_free_func ((GDestroyNotify) gst_buffer_unref);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  while (TRUE) {
+    sample = NULL;
+    g_signal_emit_by_name (sink, "pull-sample", &sample);
+    if (!sample)
+      break;
+
+    g_ptr_array_add (buffers, gst_buffer_ref (gst_sample_get_buffer (sample)));
+    gst_sample_unref (sample);
+  }
+  gst_object_unref (sink);
+
+  mix = gst_bin_get_by_name (GST_BIN (pipeline), "mix");
+  g_object_get (mix, "stats", &stats, NULL);
+  fail_unless (stats != NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "frames", &frames));
+  fail_unless_equals_uint64 (frames, buffers->len);
+  fail_unless (gst_structure_get_double (stats, "recomposed-fraction",
+          recomposed_fraction));
+  gst_structure_free (stats);
+  gst_object_unref (mix);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return buffers;
+}
+
+GST_START_TEST (test_partial_updates)
+{
+  const gchar *formats[] = { "I420", "YUY2", "RGB" };
+  guint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    GPtrArray *full, *partial;
+    gdouble full_fraction, partial_fraction;
+    GstMapInfo map;
+
+    GST_INFO ("testing %s", formats[i]);
+
+    full = _composite_partial_frames (formats[i], FALSE, &full_fraction);
+    partial = _composite_partial_frames (formats[i], TRUE, &partial_fraction);
+
+    /* only the first frame and the ball are composited, to the same frames */
+    fail_unless (full->len > 1);
+    fail_unless_equals_int (partial->len, full->len);
+    for (j = 0; j < full->len; j++) {
+      GstBuffer *buffer = g_ptr_array_index (partial, j);
+
+      fail_unless (gst_buffer_map (g_ptr_array_index (full, j), &map,
+              GST_MAP_READ));
+      fail_unless_equals_int (gst_buffer_get_size (buffer), map.size);
+      fail_unless (gst_buffer_memcmp (buffer, 0, map.data, map.size) == 0);
+      gst_buffer_unmap (g_ptr_array_index (full, j), &map);
+    }
+
+    fail_unless_equals_float (full_fraction, 1.0);
+    fail_unless (partial_fraction < 0.5);
+
+    g_ptr_array_unref (full);
+    g_ptr_array_unref (partial);
+  }
+}
+
+GST_END_TEST;
+
 static Suite *
 compositor_suite (void)
 {
@@ -1936,6 +2304,10 @@ compositor_suite (void)
   tcase_add_test (tc_chain, test_start_time_first_live_drop_0);
   tcase_add_test (tc_chain, test_start_time_first_live_drop_3);
   tcase_add_test (tc_chain, test_start_time_first_live_drop_3_unlinked_1);
+  tcase_add_test (tc_chain, test_n_threads);
+  tcase_add_test (tc_chain, test_mixed_formats);
+  tcase_add_test (tc_chain, test_occlusion);
+  tcase_add_test (tc_chain, test_partial_updates);
 
   return s;
 }
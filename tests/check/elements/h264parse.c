@@ -24,6 +24,7 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
 #include "parser.h"
 
 #define SRC_CAPS_TMPL   "video/x-h264, parsed=(boolean)false"
@@ -416,6 +417,261 @@ h264parse_packetized_suite (void)
 }
 
 
+/* size of the payload of the filler data NAL of the chunked stream, big
+ * enough to span many input buffers */
+#define FILLER_SIZE 16384
+
+/* SPS, PPS, IDR frame followed by a big filler data NAL, IDR frame */
+static guint8 *
+make_chunked_stream (gsize * size)
+{
+  GByteArray *stream = g_byte_array_new ();
+  const guint8 filler_header[] = { 0x00, 0x00, 0x00, 0x01, 0x0c };
+  const guint8 trailing_bits = 0x80;
+  guint8 *filler;
+
+  g_byte_array_append (stream, h264_sps, sizeof (h264_sps));
+  g_byte_array_append (stream, h264_pps, sizeof (h264_pps));
+  g_byte_array_append (stream, h264_idrframe, sizeof (h264_idrframe));
+  g_byte_array_append (stream, filler_header, sizeof (filler_header));
+  filler = g_malloc (FILLER_SIZE);
+  memset (filler, 0xff, FILLER_SIZE);
+  g_byte_array_append (stream, filler, FILLER_SIZE);
+  g_free (filler);
+  g_byte_array_append (stream, &trailing_bits, 1);
+  g_byte_array_append (stream, h264_idrframe, sizeof (h264_idrframe));
+
+  *size = stream->len;
+  return g_byte_array_free (stream, FALSE);
+}
+
+/* pushes @data in buffers of @chunk_size bytes, and returns the output */
+static GstBuffer *
+push_chunked_stream (const guint8 * data, gsize size, gsize chunk_size,
+    guint * n_buffers)
+{
+  GstHarness *h = gst_harness_new ("h264parse");
+  GstBuffer *out = gst_buffer_new ();
+  GstBuffer *buf;
+  gint64 start;
+  gsize offset;
+
+  gst_harness_set_caps_str (h, "video/x-h264, stream-format=byte-stream",
+      "video/x-h264, stream-format=byte-stream, alignment=au");
+
+  start = g_get_monotonic_time ();
+  for (offset = 0; offset < size; offset += chunk_size) {
+    gsize len = MIN (chunk_size, size - offset);
+
+    buf = gst_buffer_new_allocate (NULL, len, NULL);
+    gst_buffer_fill (buf, 0, data + offset, len);
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+  GST_INFO ("parsed %" G_GSIZE_FORMAT " bytes in chunks of %" G_GSIZE_FORMAT
+      " bytes in %" G_GINT64_FORMAT " us", size, chunk_size,
+      g_get_monotonic_time () - start);
+
+  *n_buffers = 0;
+  while ((buf = gst_harness_try_pull (h))) {
+    out = gst_buffer_append (out, buf);
+    (*n_buffers)++;
+  }
+
+  gst_harness_teardown (h);
+
+  return out;
+}
+
+GST_START_TEST (test_parse_chunked)
+{
+  GstBuffer *ref, *out;
+  guint8 *stream;
+  gsize size, chunk_sizes[] = { 1, 7, 1400 };
+  guint i, n_ref, n_out;
+
+  stream = make_chunked_stream (&size);
+
+  ref = push_chunked_stream (stream, size, size, &n_ref);
+  fail_unless_equals_int (n_ref, 2);
+
+  /* the output does not depend on how the input is split */
+  for (i = 0; i < G_N_ELEMENTS (chunk_sizes); i++) {
+    out = push_chunked_stream (stream, size, chunk_sizes[i], &n_out);
+    fail_unless_equals_int (n_out, n_ref);
+    fail_unless_equals_int (gst_buffer_get_size (out),
+        gst_buffer_get_size (ref));
+    fail_unless (gst_buffer_memcmp (out, 0, stream, size) == 0);
+    gst_buffer_unref (out);
+  }
+
+  gst_buffer_unref (ref);
+  g_free (stream);
+}
+
+GST_END_TEST;
+
+#ifndef GST_DISABLE_GST_DEBUG
+static guint n_repeated_sps, n_repeated_pps;
+
+/* counts the parameter sets h264parse recognized as repeated, i.e. didn't
+ * parse again */
+static void
+count_repeated_params (GstDebugCategory * category, GstDebugLevel level,
+    const gchar * file, const gchar * function, gint line, GObject * object,
+    GstDebugMessage * message, gpointer user_data)
+{
+  const gchar *msg;
+
+  if (g_strcmp0 (gst_debug_category_get_name (category), "h264parse") != 0)
+    return;
+
+  msg = gst_debug_message_get (message);
+  if (!msg || !g_str_has_suffix (msg, " repeated"))
+    return;
+
+  if (g_str_has_prefix (msg, "SPS "))
+    n_repeated_sps++;
+  else if (g_str_has_prefix (msg, "PPS "))
+    n_repeated_pps++;
+}
+#endif
+
+GST_START_TEST (test_parse_repeated_params)
+{
+  GstHarness *h = gst_harness_new ("h264parse");
+  GstBuffer *buf;
+  GstEvent *event;
+  guint i, n_caps = 0;
+
+  gst_harness_set_caps_str (h, "video/x-h264, stream-format=byte-stream",
+      "video/x-h264, stream-format=byte-stream, alignment=au");
+
+#ifndef GST_DISABLE_GST_DEBUG
+  n_repeated_sps = n_repeated_pps = 0;
+  gst_debug_set_threshold_for_name ("h264parse", GST_LEVEL_LOG);
+  gst_debug_add_log_function (count_repeated_params, NULL, NULL);
+#endif
+
+  /* SPS and PPS repeated unchanged before each frame are only parsed the
+   * first time, and only cause one caps event */
+  for (i = 0; i < 10; i++) {
+    buf = gst_buffer_new_allocate (NULL, sizeof (h264_sps) +
+        sizeof (h264_pps) + sizeof (h264_idrframe), NULL);
+    gst_buffer_fill (buf, 0, h264_sps, sizeof (h264_sps));
+    gst_buffer_fill (buf, sizeof (h264_sps), h264_pps, sizeof (h264_pps));
+    gst_buffer_fill (buf, sizeof (h264_sps) + sizeof (h264_pps),
+        h264_idrframe, sizeof (h264_idrframe));
+    GST_BUFFER_PTS (buf) = i * GST_SECOND / 10;
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+#ifndef GST_DISABLE_GST_DEBUG
+  gst_debug_remove_log_function (count_repeated_params);
+  gst_debug_unset_threshold_for_name ("h264parse");
+  fail_unless_equals_int (n_repeated_sps, 9);
+  fail_unless_equals_int (n_repeated_pps, 9);
+#endif
+
+  while ((event = gst_harness_try_pull_event (h))) {
+    if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS)
+      n_caps++;
+    gst_event_unref (event);
+  }
+  fail_unless_equals_int (n_caps, 1);
+  fail_unless_equals_int (gst_harness_buffers_received (h), 10);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_parse_config_interval)
+{
+  GstHarness *h = gst_harness_new ("h264parse");
+  GstBuffer *buf, *in_bufs[3];
+  GstMapInfo map, in_map;
+  GstMemory *mem;
+  gsize size;
+  guint i;
+
+  g_object_set (h->element, "config-interval", 1, NULL);
+  gst_harness_set_caps_str (h, "video/x-h264, stream-format=byte-stream",
+      "video/x-h264, stream-format=byte-stream, alignment=au");
+
+  /* SPS/PPS only in the first AU, then one IDR per second */
+  for (i = 0; i < 3; i++) {
+    size = sizeof (h264_idrframe);
+    if (i == 0)
+      size += sizeof (h264_sps) + sizeof (h264_pps);
+    buf = gst_buffer_new_allocate (NULL, size, NULL);
+    if (i == 0) {
+      gst_buffer_fill (buf, 0, h264_sps, sizeof (h264_sps));
+      gst_buffer_fill (buf, sizeof (h264_sps), h264_pps, sizeof (h264_pps));
+    }
+    gst_buffer_fill (buf, size - sizeof (h264_idrframe), h264_idrframe,
+        sizeof (h264_idrframe));
+    GST_BUFFER_PTS (buf) = i * GST_SECOND;
+    in_bufs[i] = gst_buffer_ref (buf);
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  gst_buffer_unref (gst_harness_pull (h));
+  gst_buffer_unref (in_bufs[0]);
+
+  /* SPS/PPS are inserted in front of the following IDRs */
+  for (i = 1; i < 3; i++) {
+    buf = gst_harness_pull (h);
+    fail_unless (buf != NULL);
+
+    /* the parameter sets are in one memory, followed by the IDR which is
+     * still the memory of the input buffer */
+    fail_unless_equals_int (gst_buffer_n_memory (buf), 2);
+    mem = gst_buffer_peek_memory (buf, 0);
+    fail_unless_equals_int (gst_memory_get_sizes (mem, NULL, NULL),
+        sizeof (h264_sps) + sizeof (h264_pps));
+    mem = gst_buffer_peek_memory (buf, 1);
+    fail_unless (gst_memory_map (mem, &map, GST_MAP_READ));
+    fail_unless (gst_buffer_map (in_bufs[i], &in_map, GST_MAP_READ));
+    fail_unless (map.data == in_map.data);
+    gst_buffer_unmap (in_bufs[i], &in_map);
+    gst_memory_unmap (mem, &map);
+    gst_buffer_unref (in_bufs[i]);
+
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, sizeof (h264_sps) + sizeof (h264_pps) +
+        sizeof (h264_idrframe));
+    fail_unless (memcmp (map.data, h264_sps, sizeof (h264_sps)) == 0);
+    fail_unless (memcmp (map.data + sizeof (h264_sps), h264_pps,
+            sizeof (h264_pps)) == 0);
+    fail_unless (memcmp (map.data + sizeof (h264_sps) + sizeof (h264_pps),
+            h264_idrframe, sizeof (h264_idrframe)) == 0);
+    gst_buffer_unmap (buf, &map);
+    fail_if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT));
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+h264parse_chunked_suite (void)
+{
+  Suite *s = suite_create ("h264parse_chunked");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_parse_chunked);
+  tcase_add_test (tc_chain, test_parse_repeated_params);
+  tcase_add_test (tc_chain, test_parse_config_interval);
+
+  return s;
+}
+
 /*
  * TODO:
  *   - Both push- and pull-modes need to be tested
@@ -522,5 +778,11 @@ main (int argc, char **argv)
   nf += srunner_ntests_failed (sr);
   srunner_free (sr);
 
+  s = h264parse_chunked_suite ();
+  sr = srunner_create (s);
+  srunner_run_all (sr, CK_NORMAL);
+  nf += srunner_ntests_failed (sr);
+  srunner_free (sr);
+
   return nf;
 }
@@ -24,6 +24,7 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
 #include "parser.h"
 
 #define SRC_CAPS_TMPL   "video/mpeg, mpegversion=(int)4, systemstream=(boolean)false, parsed=(boolean)false"
@@ -150,6 +151,61 @@ GST_START_TEST (test_parse_detect_stream)
 GST_END_TEST;
 
 
+GST_START_TEST (test_parse_gop_index)
+{
+  GstHarness *h = gst_harness_new ("mpeg4videoparse");
+  GstBus *bus = gst_bus_new ();
+  GstMessage *msg;
+  const GstStructure *s;
+  const GValue *offsets;
+  const gchar *types[] = { "IPP", "IP" };
+  const guint64 expected_offsets[] = { 0, 56, 75, 94, 113 };
+  GstBuffer *buf;
+  gsize offset = 0;
+  guint i, j, n = 0;
+
+  g_object_set (h->element, "gop-index", TRUE, NULL);
+  gst_element_set_bus (h->element, bus);
+  gst_harness_set_src_caps_str (h, SRC_CAPS_TMPL);
+
+  /* config + I, P, P, I, P; only the VOP coding type differs */
+  buf = gst_buffer_new_allocate (NULL,
+      sizeof (mpeg4_config) + 5 * sizeof (mpeg4_iframe), NULL);
+  gst_buffer_fill (buf, 0, mpeg4_config, sizeof (mpeg4_config));
+  offset += sizeof (mpeg4_config);
+  for (i = 0; i < 5; i++) {
+    gst_buffer_fill (buf, offset, mpeg4_iframe, sizeof (mpeg4_iframe));
+    if (i != 0 && i != 3)
+      gst_buffer_memset (buf, offset + 4, 0x50, 1);
+    offset += sizeof (mpeg4_iframe);
+  }
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  for (i = 0; i < G_N_ELEMENTS (types); i++) {
+    msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT);
+    fail_unless (msg != NULL);
+    s = gst_message_get_structure (msg);
+    fail_unless (gst_structure_has_name (s, "gop-index"));
+    fail_unless_equals_string (gst_structure_get_string (s, "picture-types"),
+        types[i]);
+    offsets = gst_structure_get_value (s, "offsets");
+    fail_unless_equals_int (gst_value_array_get_size (offsets),
+        strlen (types[i]));
+    for (j = 0; j < strlen (types[i]); j++, n++)
+      fail_unless_equals_uint64 (g_value_get_uint64 (gst_value_array_get_value
+              (offsets, j)), expected_offsets[n]);
+    gst_message_unref (msg);
+  }
+  fail_unless (gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT) == NULL);
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 static Suite *
 mpeg4videoparse_suite (void)
 {
@@ -171,6 +227,7 @@ mpeg4videoparse_suite (void)
   tcase_add_test (tc_chain, test_parse_drain_single);
   tcase_add_test (tc_chain, test_parse_split);
   tcase_add_test (tc_chain, test_parse_detect_stream);
+  tcase_add_test (tc_chain, test_parse_gop_index);
 
   return s;
 }
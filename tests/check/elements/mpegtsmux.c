@@ -803,6 +803,181 @@ GST_START_TEST (test_keyframe_flag_propagation)
 
 GST_END_TEST;
 
+/* The PCR must be accurate to +/- 500 ns (ISO/IEC 13818-1, 2.4.2.2), in
+ * 27 MHz ticks */
+#define PCR_TOLERANCE (27000000 / 2000000)
+
+/* Returns the PCR of the TS packet at @data, or -1 if it doesn't have one */
+static gint64
+get_packet_pcr (const guint8 * data)
+{
+  guint64 pcr_base;
+  guint pcr_ext;
+
+  /* adaptation field with at least the flags and the PCR flag set */
+  if (!(data[3] & 0x20) || data[4] < 7 || !(data[5] & 0x10))
+    return -1;
+
+  pcr_base = ((guint64) GST_READ_UINT32_BE (data + 6) << 1) | (data[10] >> 7);
+  pcr_ext = ((data[10] & 0x01) << 8) | data[11];
+
+  return pcr_base * 300 + pcr_ext;
+}
+
+GST_START_TEST (test_constant_bitrate)
+{
+  GstElement *mux;
+  gchar *padname;
+  GstBuffer *inbuffer;
+  GstCaps *caps;
+  GList *l;
+  gsize total_size = 0;
+  gsize first_pcr_offset = 0;
+  gint64 first_pcr = -1;
+  guint null_packets = 0, pcr_packets = 0;
+  gint i;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  /* 1 Mbit/s */
+  g_object_set (mux, "bitrate", (guint64) 1000000, NULL);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* 1 second of 200 kbit/s input */
+  for (i = 0; i <= 25; i++) {
+    inbuffer = gst_buffer_new_and_alloc (1000);
+    gst_buffer_memset (inbuffer, 0, 0, 1000);
+    GST_BUFFER_PTS (inbuffer) = i * 40 * GST_MSECOND;
+    if (i % KEYFRAME_DISTANCE != 0)
+      GST_BUFFER_FLAG_SET (inbuffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  }
+
+  for (l = buffers; l; l = l->next) {
+    GstMapInfo map;
+    gsize offset;
+
+    gst_buffer_map (GST_BUFFER (l->data), &map, GST_MAP_READ);
+    fail_unless (map.size % 188 == 0);
+    for (offset = 0; offset < map.size; offset += 188) {
+      gint64 pcr;
+
+      fail_unless_equals_int (map.data[offset], 0x47);
+      if ((GST_READ_UINT16_BE (map.data + offset + 1) & 0x1FFF) == 0x1FFF)
+        null_packets++;
+
+      /* The PCR grows linearly with the byte position, at the bitrate: 216
+       * ticks of 27 MHz per byte at 1 Mbit/s */
+      pcr = get_packet_pcr (map.data + offset);
+      if (pcr == -1)
+        continue;
+
+      if (first_pcr == -1) {
+        first_pcr = pcr;
+        first_pcr_offset = total_size + offset;
+      } else {
+        gint64 expected = first_pcr +
+            (gint64) (total_size + offset - first_pcr_offset) * 216;
+
+        GST_LOG ("PCR %" G_GINT64_FORMAT ", expected %" G_GINT64_FORMAT, pcr,
+            expected);
+        fail_unless (ABS (pcr - expected) <= PCR_TOLERANCE,
+            "PCR %" G_GINT64_FORMAT " at offset %" G_GSIZE_FORMAT
+            " is off by %" G_GINT64_FORMAT " ticks", pcr, total_size + offset,
+            pcr - expected);
+      }
+      pcr_packets++;
+    }
+    total_size += map.size;
+    gst_buffer_unmap (GST_BUFFER (l->data), &map);
+  }
+
+  /* One second of output is 125000 bytes, plus the packets of the last
+   * input buffer */
+  GST_DEBUG ("%" G_GSIZE_FORMAT " bytes, %u null packets", total_size,
+      null_packets);
+  fail_unless (total_size >= 120000 && total_size <= 135000);
+  fail_unless (null_packets > 0);
+  /* one PCR every 40 ms */
+  fail_unless (pcr_packets >= 20);
+
+  gst_check_drop_buffers ();
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_repeated_tables)
+{
+  GstElement *mux;
+  gchar *padname;
+  GstBuffer *inbuffer;
+  GstCaps *caps;
+  GList *l;
+  guint8 first_pat[188];
+  guint n_pat = 0, cc = 0;
+  gint i;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  for (i = 0; i < 50; i++) {
+    inbuffer = gst_buffer_new_and_alloc (100);
+    gst_buffer_memset (inbuffer, 0, 0, 100);
+    GST_BUFFER_PTS (inbuffer) = i * 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  }
+
+  /* The PAT is repeated unchanged, with an increasing continuity counter */
+  for (l = buffers; l; l = l->next) {
+    GstMapInfo map;
+    gsize offset;
+
+    gst_buffer_map (GST_BUFFER (l->data), &map, GST_MAP_READ);
+    for (offset = 0; offset + 188 <= map.size; offset += 188) {
+      guint8 *packet = map.data + offset;
+
+      if ((GST_READ_UINT16_BE (packet + 1) & 0x1FFF) != 0x0000)
+        continue;
+
+      if (n_pat == 0) {
+        memcpy (first_pat, packet, 188);
+        cc = packet[3] & 0x0f;
+      } else {
+        cc = (cc + 1) & 0x0f;
+        fail_unless_equals_int (packet[3] & 0x0f, cc);
+        fail_unless (memcmp (first_pat, packet, 3) == 0);
+        fail_unless (memcmp (first_pat + 4, packet + 4, 184) == 0);
+      }
+      n_pat++;
+    }
+    gst_buffer_unmap (GST_BUFFER (l->data), &map);
+  }
+
+  /* default PAT interval is 100ms */
+  fail_unless (n_pat >= 15);
+
+  gst_check_drop_buffers ();
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
 static Suite *
 mpegtsmux_suite (void)
 {
@@ -819,6 +994,8 @@ mpegtsmux_suite (void)
   tcase_add_test (tc_chain, test_multiple_state_change);
   tcase_add_test (tc_chain, test_align);
   tcase_add_test (tc_chain, test_keyframe_flag_propagation);
+  tcase_add_test (tc_chain, test_constant_bitrate);
+  tcase_add_test (tc_chain, test_repeated_tables);
 
   return s;
 }
@@ -0,0 +1,241 @@
+/*
+ * GStreamer
+ *
+ * unit test for vc1parse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define SRC_CAPS_TMPL   "video/x-wmv, wmvversion=(int)3, format=(string)WVC1, stream-format=(string)bdu"
+
+/* Advanced profile BDUs, without their start codes, from the codecparsers
+ * library test */
+static const guint8 vc1_seq_hdr[] = {
+  0xdb, 0xfe, 0x3b, 0xf2, 0x1b, 0xca, 0x3b, 0xf8, 0x86, 0xf1, 0x80, 0xca,
+  0x02, 0x02, 0x03, 0x09, 0xa5, 0xb8, 0xd7, 0x07, 0xfc
+};
+
+static const guint8 vc1_entrypoint[] = {
+  0x5a, 0xc7, 0xfc, 0xef, 0xc8, 0x6c, 0x40
+};
+
+static const guint8 vc1_iframe[] = {
+  0x69, 0x1c, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f,
+  0x16, 0x0c, 0x0f, 0x13, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f,
+  0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3,
+  0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc,
+  0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f,
+  0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0,
+  0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f,
+  0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3,
+  0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc,
+  0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f,
+  0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0,
+  0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f,
+  0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3,
+  0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc,
+  0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f,
+  0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0,
+  0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f,
+  0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3, 0xf0, 0xfc, 0x3f, 0x0f, 0xc3,
+  0xf0, 0xfc, 0x3f, 0x0f
+};
+
+static const guint8 vc1_pframe[] = {
+  0x24, 0x20, 0x04, 0xbf, 0x85, 0x88, 0x65, 0xc1, 0x00, 0xdc, 0x4c, 0x06,
+  0xce, 0x05, 0x01, 0x01, 0x41, 0x0c, 0x60, 0x42, 0x67, 0xff, 0xfb, 0x85,
+  0x0b, 0x9c, 0x56, 0x0d, 0x0b, 0x1b, 0x8c, 0x08, 0x08, 0x47, 0x1b, 0xce,
+  0xc1, 0x83, 0x09, 0x8a, 0xa1, 0x83, 0x09, 0x16, 0x7f, 0xff, 0x98, 0x94,
+  0xff, 0x81, 0x4f, 0xf9, 0x41, 0xe1, 0x83, 0x01, 0xff, 0xff, 0x14, 0x40,
+  0xcd, 0x70, 0xd7, 0xf2, 0xf7, 0xc1, 0xf1, 0x18, 0x59, 0xff, 0xfc, 0x51,
+  0x18, 0x68, 0x2c, 0xd4, 0x54, 0x16, 0xbf, 0xfe, 0x0c, 0xf1, 0x81, 0x28,
+  0x67, 0xff, 0x86, 0x39, 0x05, 0xe6, 0x5f, 0xff, 0xe0, 0x48, 0xc0, 0xff,
+  0xfe, 0x61, 0x18, 0x37, 0xff, 0x97, 0xdc, 0x1c, 0x45, 0x06, 0x06, 0xff,
+  0xf0, 0x30, 0x7d, 0x17, 0xff, 0xff, 0x86, 0x07, 0x03, 0xff, 0xf9, 0x01,
+  0xf0, 0x7f, 0xff, 0xdf, 0xc1, 0x20, 0x9f, 0xfd, 0x0c, 0x0f, 0x86, 0x7f,
+  0xff, 0xee, 0x50, 0xef, 0xfe, 0xc1, 0xa5, 0xc6, 0x1b, 0xff, 0xff, 0x86,
+  0x61, 0x9f, 0xfc, 0x1c, 0x1f, 0xa2, 0xff, 0xff, 0xe0, 0xf8, 0x10, 0x1f,
+  0xfe, 0x0e, 0x0f, 0x99, 0x95, 0xff, 0xff, 0xb8, 0x3e, 0xe5, 0xff, 0x81,
+  0x83, 0xe1, 0x6b, 0xff, 0xff, 0x40, 0xc0, 0x7c, 0x30, 0xbf, 0xe0, 0xb2,
+  0x0e, 0x09, 0x61, 0x53, 0xff, 0xfd, 0x60, 0x20, 0xfc, 0x27, 0xf0, 0x96,
+  0x51, 0x26, 0x6c, 0xcf, 0xff, 0xff, 0xe7, 0x60, 0xe0, 0xb5, 0xee, 0x82,
+  0xa0, 0xb8, 0x41, 0x32, 0x3f, 0x2f, 0xcd, 0x3f, 0xa0, 0xa8, 0x96, 0x8e,
+  0x2a, 0x4c, 0x08, 0x6e, 0x36, 0x1a, 0x83, 0x2a, 0x8b, 0x02, 0xcb, 0x2f,
+  0xff, 0xe9, 0xf8, 0xa4, 0x0e, 0x00, 0x12, 0xc1, 0x88, 0xc3, 0x0c, 0x05,
+  0x51, 0x44, 0x61, 0xa3, 0x0b, 0x18, 0x58, 0x38, 0x70, 0x97, 0xff, 0xff,
+  0xf8, 0x8c, 0x14, 0x2c, 0x0c, 0x19, 0x86, 0x0c, 0x27, 0x09, 0xc1, 0x03,
+  0x08, 0x62, 0xc0, 0xff, 0xff, 0xfe, 0x94, 0x6d, 0x22, 0x77, 0xc0, 0x44,
+  0x71, 0x1c, 0x60, 0xe5, 0xb7, 0xff, 0xfe, 0xbf, 0xba, 0x57, 0x82, 0x0c,
+  0x24, 0xc8, 0x5a, 0xbf, 0xff, 0xff, 0xcb, 0x14, 0xc8, 0x30, 0x43, 0x16,
+  0x29, 0x51, 0x86, 0x0b, 0x00, 0x51, 0x60, 0x60, 0xc0, 0x17, 0x75, 0xff,
+  0xf9, 0x77, 0x0e, 0x18, 0x4b, 0x84, 0xc5, 0x47, 0x11, 0xc5, 0x10, 0x68,
+  0x1b, 0x8c, 0x00, 0x6a, 0x71, 0x60, 0xc0, 0x46, 0xe2, 0xe0, 0x22, 0x65,
+  0xff, 0xd6, 0x09, 0x0e, 0x01, 0x15, 0x55, 0x85, 0x48, 0x28, 0x8f, 0xc2,
+  0x42, 0x06, 0x1c, 0x23, 0x8b, 0x01, 0x42, 0x74, 0x08, 0x61, 0x9f, 0xff,
+  0xc2, 0xca, 0x19, 0x81, 0x02, 0x10, 0x20, 0xc0, 0x1c, 0x5c, 0x13, 0x84,
+  0xe6, 0x1a, 0x8b, 0x02, 0x38, 0x98, 0x09, 0x98, 0xa3, 0xff, 0xfd, 0xc9,
+  0x05, 0x5e, 0x82, 0x18, 0xc1, 0x40, 0xc6, 0xf6, 0x04, 0x14, 0x40, 0x60,
+  0x80, 0xfd, 0x04, 0x6f, 0xff, 0xf4, 0x58, 0x0a, 0xf8, 0x86, 0x30, 0x02,
+  0x14, 0x44, 0xe2, 0xc2, 0x43, 0x3c, 0x1b, 0xff, 0x86, 0xb5, 0x66, 0x16,
+  0xf0, 0x7f, 0xa0, 0x9c, 0x5e, 0x84, 0x07, 0xd1, 0x73, 0xff, 0xee, 0x88,
+  0xc2, 0xe1, 0x7f, 0xfc, 0xc0, 0xf0, 0x59, 0x65, 0xfe, 0x9f, 0x70, 0xbf,
+  0xff, 0xdc, 0x1e, 0x2a, 0x02, 0x57, 0xff, 0xc0, 0x26, 0x2d, 0x3c, 0x4d,
+  0x5f, 0xff, 0xc4, 0xc1, 0x30, 0x11, 0x15, 0xc4, 0xaf, 0xfc, 0x5c, 0x0e,
+  0x0e, 0x0e, 0x84, 0x8c, 0x34, 0x34, 0xbf, 0xff, 0x11, 0x81, 0x30, 0x10,
+  0x48, 0x87, 0xf9, 0x43, 0x05, 0x25, 0x04, 0x11, 0x43, 0x70, 0x4f, 0xff,
+  0xfd, 0x04, 0xe1, 0x0e, 0xfe, 0x6f, 0x83, 0x88, 0xe1, 0x98, 0x76, 0x0f,
+  0xfc, 0x89, 0x0e, 0xe7, 0xc2, 0x78, 0x4c, 0x24, 0xd4, 0x18, 0x8c, 0xbf,
+  0x27, 0x16, 0xd0, 0xb0, 0xc9, 0xf4, 0x12, 0x6a, 0x08, 0xe4, 0x5c, 0x24,
+  0xbf, 0x46, 0x60, 0xf6, 0x53, 0xf5, 0x6c, 0xff, 0x2e, 0x32, 0x09, 0x1e,
+  0xab, 0x09, 0x00, 0x1e, 0x88, 0x56, 0x6e, 0x7a, 0x1c, 0xd0, 0x30, 0x3c,
+  0xab, 0xf0, 0x44, 0x5a, 0x90, 0x4f, 0x9a, 0xf0, 0xe6, 0x7d, 0x62, 0xc1,
+  0x87, 0x4b, 0xdb, 0xfd, 0x68, 0xd9, 0x35, 0x3b, 0x01, 0x04, 0x81, 0x2c,
+  0x24, 0xee, 0xb3, 0x9b, 0x65, 0x30, 0x49, 0x20, 0xa8, 0x08, 0xf6, 0xaf,
+  0x33, 0x80, 0x38, 0x49, 0xa3, 0x94, 0x6e, 0x35, 0x06, 0x4d, 0xc3, 0x30,
+  0x92, 0x7c, 0x3c, 0x6b, 0x9e, 0xd5, 0x31, 0x4d, 0x69, 0x87, 0x2e, 0x04,
+  0x7e, 0x04, 0x12, 0x5f, 0xa3, 0x0a, 0xe4, 0x5b, 0x21, 0x6c, 0x45, 0x54,
+  0x29, 0x11, 0x48, 0x8a, 0xa8, 0x52, 0x22, 0xa8, 0x33, 0x06, 0xe0, 0xbd,
+  0xe8, 0x41, 0x00, 0x03, 0x52, 0xe7, 0x00, 0x7d, 0xf0, 0x42, 0x4d, 0x0f,
+  0x20, 0x26, 0x24, 0x09, 0xbb, 0x48, 0x1c, 0xeb, 0xa5, 0xa2, 0x0e, 0xed,
+  0x11, 0x66, 0x97, 0x93, 0xb8, 0x4a, 0x70, 0x8a, 0x75, 0x38, 0x47, 0xc1,
+  0x26, 0x3e, 0x50, 0x87, 0x33, 0xf2, 0x37, 0xc7, 0x3b, 0x67, 0x09, 0x33,
+  0x44, 0xfc, 0xcd, 0xda, 0x19, 0xa6, 0x3f, 0x27, 0xec, 0x24, 0x12, 0x64,
+  0x06, 0x13, 0xdd, 0x9e, 0x81, 0x92, 0x17, 0x5f, 0xb3, 0xd9, 0x37, 0xf2,
+  0x0f, 0x15, 0x00, 0x87, 0xb3, 0xe6, 0xc9, 0xc1, 0xbc, 0x24, 0x7f, 0x0f,
+  0x7c, 0x76, 0x4c, 0xe0, 0xfb, 0xf7, 0x66, 0x4c, 0x9c, 0x19, 0x32, 0x6f,
+  0xb2, 0x64, 0xfa, 0x00, 0x01, 0x26, 0xaa, 0xa4, 0x16, 0x45, 0x1f, 0x94,
+  0xee, 0xde, 0x33, 0x09, 0x2e, 0x48, 0xc2, 0x4b, 0xf4, 0x62, 0x91, 0x16,
+  0x00, 0x52, 0x20, 0xe2, 0xba, 0xe2, 0x35, 0x42, 0xa7, 0xa0, 0x9c, 0x9e,
+  0xcc, 0x39, 0x9d, 0x31, 0x00, 0xc3, 0xe0, 0x2a, 0x1f, 0x85, 0x61, 0xd3,
+  0x63, 0x3f, 0x22, 0xa8, 0xd9, 0xc1, 0x50, 0x50, 0x2f, 0x21, 0xb1, 0xd8,
+  0x49, 0x34, 0xa0, 0xb0, 0x0c, 0x7d, 0xe9, 0x53, 0x27, 0x09, 0xf9, 0x1b,
+  0x33, 0x5d, 0x93, 0xb8, 0x48, 0x89, 0xbb, 0x18, 0x4e, 0xf0, 0x44, 0x86,
+  0x13, 0x7a, 0x16, 0xc4, 0x36, 0xc7, 0x24, 0xe2, 0x39, 0x20, 0x20, 0x62,
+  0xb0, 0xf1, 0xa0, 0x21, 0xc7, 0x2a, 0xdf, 0xd6, 0xd1, 0x5e, 0xcf, 0xba,
+  0x09, 0x92, 0xa4, 0xb7, 0xd6, 0x7b, 0x0b, 0xaa, 0x60, 0xe7, 0x8c, 0xe2,
+  0xfb, 0xf8, 0xb1, 0x96, 0x70, 0xc5, 0xf7, 0x3d, 0x7a, 0xce, 0x13, 0x09,
+  0x0f, 0xd4, 0x2c, 0xfe, 0x30, 0xdd, 0xdc, 0x11, 0xb1, 0x4e, 0xab, 0x98,
+  0x0d, 0x45, 0xf0, 0x41, 0x9d, 0x0c, 0xd6, 0xa1, 0x8e, 0x5c, 0xf4, 0xdf,
+  0x93, 0x88, 0x3f, 0x23, 0x61, 0x23, 0x6e, 0xf4, 0x78, 0xac, 0xfa, 0x00,
+  0x00, 0x07, 0x1f, 0x94, 0xe9, 0x13, 0xd3, 0x05, 0x61, 0x99, 0x22, 0x49,
+  0xf8, 0x6d, 0xb9, 0xb3, 0x83, 0xa6, 0x70, 0x78, 0xf3, 0x37, 0x54, 0xdf,
+  0xb6, 0x82, 0x67, 0x07, 0x3d, 0x66, 0xea, 0x86, 0x72, 0xd3, 0x38, 0x3b,
+  0x0a, 0xcd, 0xd5, 0x0e, 0x00, 0x07, 0x19, 0x6d, 0x92, 0x77, 0x3e, 0x0d,
+  0xba, 0x66, 0xa6, 0x8c, 0x8d, 0x48, 0xf2, 0xe2, 0x38, 0x31, 0x7f, 0x71,
+  0xf9, 0xe8, 0x6c, 0x46, 0xb1, 0x91, 0xc5, 0x6a, 0xbb, 0x16, 0x36, 0x44,
+  0xb3, 0x67, 0x64, 0xcf, 0xee, 0xcc, 0x04, 0x61, 0x7b, 0x91, 0x7e, 0xcd,
+  0x47, 0x27, 0x16, 0x0f, 0x04, 0x8f, 0x02, 0x84, 0x8f, 0x85, 0xb5, 0xb3,
+  0x5a, 0x81, 0x23, 0xa8
+};
+
+/* appends the BDU @data of type @sc with its start code to @buf */
+static GstBuffer *
+append_bdu (GstBuffer * buf, guint8 sc, const guint8 * data, gsize size)
+{
+  guint8 *bdu = g_malloc (size + 4);
+
+  bdu[0] = bdu[1] = 0x00;
+  bdu[2] = 0x01;
+  bdu[3] = sc;
+  memcpy (bdu + 4, data, size);
+
+  return gst_buffer_append (buf, gst_buffer_new_wrapped (bdu, size + 4));
+}
+
+GST_START_TEST (test_parse_gop_index)
+{
+  GstHarness *h = gst_harness_new ("vc1parse");
+  GstBus *bus = gst_bus_new ();
+  GstMessage *msg;
+  const GstStructure *s;
+  const GValue *offsets;
+  const gchar *types[] = { "IPP", "IP" };
+  guint64 expected_offsets[5];
+  guint64 offset;
+  GstBuffer *buf;
+  guint i, j, n = 0;
+
+  gst_element_set_bus (h->element, bus);
+  gst_harness_set_src_caps_str (h, SRC_CAPS_TMPL);
+
+  /* the sequence and entry point headers go through before the index is
+   * enabled, the frame headers still need them to be parsed */
+  buf = gst_buffer_new ();
+  buf = append_bdu (buf, 0x0f, vc1_seq_hdr, sizeof (vc1_seq_hdr));
+  buf = append_bdu (buf, 0x0e, vc1_entrypoint, sizeof (vc1_entrypoint));
+  offset = gst_buffer_get_size (buf);
+  expected_offsets[0] = offset;
+  buf = append_bdu (buf, 0x0d, vc1_iframe, sizeof (vc1_iframe));
+  offset += 4 + sizeof (vc1_iframe);
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+
+  g_object_set (h->element, "gop-index", TRUE, NULL);
+
+  /* then P, P, I, P */
+  buf = gst_buffer_new ();
+  for (i = 1; i < 5; i++) {
+    expected_offsets[i] = offset;
+    if (i == 3) {
+      buf = append_bdu (buf, 0x0d, vc1_iframe, sizeof (vc1_iframe));
+      offset += 4 + sizeof (vc1_iframe);
+    } else {
+      buf = append_bdu (buf, 0x0d, vc1_pframe, sizeof (vc1_pframe));
+      offset += 4 + sizeof (vc1_pframe);
+    }
+  }
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  for (i = 0; i < G_N_ELEMENTS (types); i++) {
+    msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT);
+    fail_unless (msg != NULL);
+    s = gst_message_get_structure (msg);
+    fail_unless (gst_structure_has_name (s, "gop-index"));
+    fail_unless_equals_string (gst_structure_get_string (s, "picture-types"),
+        types[i]);
+    offsets = gst_structure_get_value (s, "offsets");
+    fail_unless_equals_int (gst_value_array_get_size (offsets),
+        strlen (types[i]));
+    for (j = 0; j < strlen (types[i]); j++, n++)
+      fail_unless_equals_uint64 (g_value_get_uint64 (gst_value_array_get_value
+              (offsets, j)), expected_offsets[n]);
+    gst_message_unref (msg);
+  }
+  fail_unless (gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT) == NULL);
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+vc1parse_suite (void)
+{
+  Suite *s = suite_create ("vc1parse");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_parse_gop_index);
+
+  return s;
+}
+
+GST_CHECK_MAIN (vc1parse);
@@ -0,0 +1,188 @@
+/*
+ * GStreamer
+ *
+ * unit test for vp9parse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define SRC_CAPS  "video/x-vp9, framerate=(fraction)30/1"
+
+/* key frame, profile 0, BT.601, 320x240, followed by garbage */
+static const guint8 vp9_keyframe[] = {
+  0x82, 0x49, 0x83, 0x42, 0x20, 0x13, 0xf0, 0x0e,
+  0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/* superframe of a hidden inter frame, taking its size from the last
+ * reference, and of a frame showing an existing frame */
+static const guint8 vp9_superframe[] = {
+  /* hidden inter frame */
+  0x84, 0x00, 0x20, 0x49, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  /* show existing frame 0 */
+  0x88,
+  /* index: 2 frames, 1 byte per size */
+  0xc1, 0x10, 0x01, 0xc1
+};
+
+#define HIDDEN_FRAME_SIZE 16
+#define SHOWN_FRAME_SIZE 1
+
+static GstBuffer *
+new_buffer (const guint8 * data, gsize size, GstClockTime pts)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, size, NULL);
+
+  gst_buffer_fill (buf, 0, data, size);
+  GST_BUFFER_PTS (buf) = pts;
+  GST_BUFFER_DTS (buf) = pts;
+
+  return buf;
+}
+
+static void
+check_caps (GstHarness * h, const gchar * alignment)
+{
+  GstCaps *caps = gst_pad_get_current_caps (h->sinkpad);
+  GstStructure *s;
+  gint width, height, fps_n, fps_d;
+
+  fail_unless (caps != NULL);
+  s = gst_caps_get_structure (caps, 0);
+  fail_unless (gst_structure_has_name (s, "video/x-vp9"));
+  fail_unless (gst_structure_get_int (s, "width", &width));
+  fail_unless (gst_structure_get_int (s, "height", &height));
+  fail_unless_equals_int (width, 320);
+  fail_unless_equals_int (height, 240);
+  fail_unless (gst_structure_get_fraction (s, "framerate", &fps_n, &fps_d));
+  fail_unless_equals_int (fps_n, 30);
+  fail_unless_equals_int (fps_d, 1);
+  fail_unless_equals_string (gst_structure_get_string (s, "profile"), "0");
+  fail_unless_equals_string (gst_structure_get_string (s, "chroma-format"),
+      "4:2:0");
+  fail_unless_equals_string (gst_structure_get_string (s, "alignment"),
+      alignment);
+  gst_caps_unref (caps);
+}
+
+GST_START_TEST (test_parse_super_frame)
+{
+  GstHarness *h = gst_harness_new ("vp9parse");
+  GstBuffer *buf;
+
+  gst_harness_set_src_caps_str (h, SRC_CAPS);
+
+  fail_unless_equals_int (gst_harness_push (h, new_buffer (vp9_keyframe,
+              sizeof (vp9_keyframe), 0)), GST_FLOW_OK);
+  fail_unless_equals_int (gst_harness_push (h, new_buffer (vp9_superframe,
+              sizeof (vp9_superframe), 33 * GST_MSECOND)), GST_FLOW_OK);
+
+  check_caps (h, "super-frame");
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 2);
+
+  buf = gst_harness_pull (h);
+  fail_unless_equals_int (gst_buffer_get_size (buf), sizeof (vp9_keyframe));
+  fail_if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT));
+  gst_buffer_unref (buf);
+
+  /* the superframe is pushed as is */
+  buf = gst_harness_pull (h);
+  fail_unless_equals_int (gst_buffer_get_size (buf), sizeof (vp9_superframe));
+  fail_unless (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT));
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (buf), 33 * GST_MSECOND);
+  gst_buffer_unref (buf);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_parse_split_super_frame)
+{
+  GstHarness *h = gst_harness_new ("vp9parse");
+  GstBuffer *in, *buf;
+  GstMapInfo in_map, map;
+
+  gst_harness_set_sink_caps_str (h, "video/x-vp9, alignment=(string)frame");
+  gst_harness_set_src_caps_str (h, SRC_CAPS);
+
+  fail_unless_equals_int (gst_harness_push (h, new_buffer (vp9_keyframe,
+              sizeof (vp9_keyframe), 0)), GST_FLOW_OK);
+  in = new_buffer (vp9_superframe, sizeof (vp9_superframe), 33 * GST_MSECOND);
+  fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (in)),
+      GST_FLOW_OK);
+
+  check_caps (h, "frame");
+  /* key frame, hidden frame, shown frame, the index is dropped */
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 3);
+
+  buf = gst_harness_pull (h);
+  fail_unless_equals_int (gst_buffer_get_size (buf), sizeof (vp9_keyframe));
+  fail_if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT));
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (buf), 0);
+  gst_buffer_unref (buf);
+
+  fail_unless (gst_buffer_map (in, &in_map, GST_MAP_READ));
+
+  buf = gst_harness_pull (h);
+  fail_unless_equals_int (gst_buffer_get_size (buf), HIDDEN_FRAME_SIZE);
+  fail_unless (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT));
+  fail_unless (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DECODE_ONLY));
+  fail_if (GST_BUFFER_PTS_IS_VALID (buf));
+  fail_unless_equals_uint64 (GST_BUFFER_DTS (buf), 33 * GST_MSECOND);
+  /* the frames share the memory of the superframe */
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  fail_unless (map.data == in_map.data);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+
+  buf = gst_harness_pull (h);
+  fail_unless_equals_int (gst_buffer_get_size (buf), SHOWN_FRAME_SIZE);
+  fail_unless (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT));
+  fail_if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DECODE_ONLY));
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (buf), 33 * GST_MSECOND);
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  fail_unless (map.data == in_map.data + HIDDEN_FRAME_SIZE);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+
+  gst_buffer_unmap (in, &in_map);
+  gst_buffer_unref (in);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+vp9parse_suite (void)
+{
+  Suite *s = suite_create ("vp9parse");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_parse_super_frame);
+  tcase_add_test (tc_chain, test_parse_split_super_frame);
+
+  return s;
+}
+
+GST_CHECK_MAIN (vp9parse);
@@ -144,6 +144,19 @@ static guint8 slice_eoseq_slice[] = {
   0x00, 0x00, 0x00, 0x01, 0x0b
 };
 
+/* SPS, PPS, IDR slice */
+static guint8 sps_pps_slice[] = {
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x4d, 0x40, 0x15,
+  0xec, 0xa4, 0xbf, 0x2e, 0x02, 0x20, 0x00, 0x00,
+  0x03, 0x00, 0x2e, 0xe6, 0xb2, 0x80, 0x01, 0xe2,
+  0xc5, 0xb2, 0xc0,
+  0x00, 0x00, 0x00, 0x01, 0x68, 0xeb, 0xec, 0xb2,
+  0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x00,
+  0x10, 0xff, 0xfe, 0xf6, 0xf0, 0xfe, 0x05, 0x36,
+  0x56, 0x04, 0x50, 0x96, 0x7b, 0x3f, 0x53, 0xe1,
+  0x00, 0x00, 0x00, 0x01, 0x0b
+};
+
 GST_START_TEST (test_h264_parse_slice_dpa)
 {
   GstH264ParserResult res;
@@ -211,6 +224,55 @@ GST_START_TEST (test_h264_parse_slice_eoseq_slice)
 
 GST_END_TEST;
 
+GST_START_TEST (test_h264_parse_slice_hdr_depth)
+{
+  GstH264ParserResult res;
+  GstH264NalUnit nalu;
+  GstH264SliceHdr full, au;
+  GstH264NalParser *const parser = gst_h264_nal_parser_new ();
+  guint offset = 0;
+
+  /* SPS and PPS */
+  while (TRUE) {
+    res = gst_h264_parser_identify_nalu (parser, sps_pps_slice, offset,
+        sizeof (sps_pps_slice), &nalu);
+    assert_equals_int (res, GST_H264_PARSER_OK);
+    if (nalu.type == GST_H264_NAL_SLICE_IDR)
+      break;
+
+    res = gst_h264_parser_parse_nal (parser, &nalu);
+    assert_equals_int (res, GST_H264_PARSER_OK);
+    offset = nalu.offset + nalu.size;
+  }
+
+  res = gst_h264_parser_parse_slice_hdr_with_depth (parser, &nalu, &full,
+      GST_H264_SLICE_HDR_PARSE_DEPTH_FULL);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  res = gst_h264_parser_parse_slice_hdr_with_depth (parser, &nalu, &au,
+      GST_H264_SLICE_HDR_PARSE_DEPTH_AU_BOUNDARY);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+
+  /* the fields needed to delimit access units are the same */
+  fail_unless (GST_H264_IS_I_SLICE (&au));
+  assert_equals_int (au.type, full.type);
+  assert_equals_int (au.first_mb_in_slice, full.first_mb_in_slice);
+  assert_equals_int (au.frame_num, full.frame_num);
+  assert_equals_int (au.field_pic_flag, full.field_pic_flag);
+  assert_equals_int (au.idr_pic_id, full.idr_pic_id);
+  assert_equals_int (au.pic_order_cnt_lsb, full.pic_order_cnt_lsb);
+  fail_unless (au.pps == full.pps);
+
+  /* and the rest is left alone */
+  fail_unless (full.header_size > 0);
+  assert_equals_int (au.header_size, 0);
+  assert_equals_int (au.slice_qp_delta, 0);
+  fail_unless (full.slice_qp_delta != 0);
+
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
 static Suite *
 h264parser_suite (void)
 {
@@ -221,6 +283,7 @@ h264parser_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_h264_parse_slice_dpa);
   tcase_add_test (tc_chain, test_h264_parse_slice_eoseq_slice);
+  tcase_add_test (tc_chain, test_h264_parse_slice_hdr_depth);
 
   return s;
 }
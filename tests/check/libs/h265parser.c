@@ -0,0 +1,125 @@
+/* GStreamer
+ *
+ * unit test for the H.265 parser library
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <gst/check/gstcheck.h>
+#include <gst/codecparsers/gsth265parser.h>
+
+/* VPS, SPS and PPS of a 64x64 Main profile stream with 16x16 CTBs and
+ * dependent slice segments enabled, followed by an IDR picture made of an
+ * I slice segment with a slice_qp_delta of 3 and a dependent slice segment
+ * starting at CTB 8, and an end of sequence */
+static const guint8 vps_sps_pps_slices[] = {
+  0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+  0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+  0x1e, 0xac, 0x09, 0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01, 0x60,
+  0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+  0x1e, 0xa0, 0x20, 0x81, 0x05, 0x96, 0xb5, 0xbc, 0x20, 0x80, 0x00, 0x00,
+  0x00, 0x01, 0x44, 0x01, 0xe0, 0x71, 0x80, 0x12, 0x00, 0x00, 0x00, 0x01,
+  0x26, 0x01, 0xac, 0xd0, 0xaf, 0x00, 0x00, 0x03, 0x00, 0x12, 0x34, 0x00,
+  0x00, 0x00, 0x01, 0x26, 0x01, 0x38, 0x80, 0x56, 0x78, 0x00, 0x00, 0x01,
+  0x48, 0x01
+};
+
+GST_START_TEST (test_h265_parse_slice_hdr_depth)
+{
+  GstH265ParserResult res;
+  GstH265NalUnit nalu;
+  GstH265SliceHdr full, au;
+  GstH265Parser *const parser = gst_h265_parser_new ();
+  guint offset = 0;
+
+  /* VPS, SPS and PPS */
+  while (TRUE) {
+    res = gst_h265_parser_identify_nalu (parser, vps_sps_pps_slices, offset,
+        sizeof (vps_sps_pps_slices), &nalu);
+    assert_equals_int (res, GST_H265_PARSER_OK);
+    if (nalu.type == GST_H265_NAL_SLICE_IDR_W_RADL)
+      break;
+
+    res = gst_h265_parser_parse_nal (parser, &nalu);
+    assert_equals_int (res, GST_H265_PARSER_OK);
+    offset = nalu.offset + nalu.size;
+  }
+
+  /* the first slice segment stops after the slice type */
+  res = gst_h265_parser_parse_slice_hdr_with_depth (parser, &nalu, &full,
+      GST_H265_SLICE_HDR_PARSE_DEPTH_FULL);
+  assert_equals_int (res, GST_H265_PARSER_OK);
+  res = gst_h265_parser_parse_slice_hdr_with_depth (parser, &nalu, &au,
+      GST_H265_SLICE_HDR_PARSE_DEPTH_AU_BOUNDARY);
+  assert_equals_int (res, GST_H265_PARSER_OK);
+
+  fail_unless (GST_H265_IS_I_SLICE (&au));
+  assert_equals_int (au.type, full.type);
+  assert_equals_int (au.first_slice_segment_in_pic_flag, 1);
+  assert_equals_int (au.first_slice_segment_in_pic_flag,
+      full.first_slice_segment_in_pic_flag);
+  assert_equals_int (au.dependent_slice_segment_flag, 0);
+  fail_unless (au.pps == full.pps);
+
+  fail_unless (full.header_size > 0);
+  assert_equals_int (au.header_size, 0);
+  assert_equals_int (full.qp_delta, 3);
+  assert_equals_int (au.qp_delta, 0);
+
+  /* the dependent slice segment stops right after its address, before the
+   * slice type it shares with the previous slice segment */
+  offset = nalu.offset + nalu.size;
+  res = gst_h265_parser_identify_nalu (parser, vps_sps_pps_slices, offset,
+      sizeof (vps_sps_pps_slices), &nalu);
+  assert_equals_int (res, GST_H265_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H265_NAL_SLICE_IDR_W_RADL);
+
+  res = gst_h265_parser_parse_slice_hdr_with_depth (parser, &nalu, &full,
+      GST_H265_SLICE_HDR_PARSE_DEPTH_FULL);
+  assert_equals_int (res, GST_H265_PARSER_OK);
+  res = gst_h265_parser_parse_slice_hdr_with_depth (parser, &nalu, &au,
+      GST_H265_SLICE_HDR_PARSE_DEPTH_AU_BOUNDARY);
+  assert_equals_int (res, GST_H265_PARSER_OK);
+
+  assert_equals_int (au.first_slice_segment_in_pic_flag, 0);
+  assert_equals_int (au.dependent_slice_segment_flag, 1);
+  assert_equals_int (au.dependent_slice_segment_flag,
+      full.dependent_slice_segment_flag);
+  assert_equals_int (au.segment_address, 8);
+  assert_equals_int (au.segment_address, full.segment_address);
+  fail_unless (au.pps == full.pps);
+
+  fail_unless (full.header_size > 0);
+  assert_equals_int (au.header_size, 0);
+
+  gst_h265_parser_free (parser);
+}
+
+GST_END_TEST;
+
+static Suite *
+h265parser_suite (void)
+{
+  Suite *s = suite_create ("H265 Parser library");
+
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_h265_parse_slice_hdr_depth);
+
+  return s;
+}
+
+GST_CHECK_MAIN (h265parser);
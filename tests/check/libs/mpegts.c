@@ -210,6 +210,88 @@ GST_START_TEST (test_mpegts_pmt)
 
 GST_END_TEST;
 
+/* Bitwise reference implementation of the MPEG-2 CRC32 */
+static guint32
+reference_crc32 (const guint8 * data, gsize size)
+{
+  guint32 crc = 0xffffffff;
+  gsize i;
+  gint j;
+
+  for (i = 0; i < size; i++) {
+    crc ^= (guint32) data[i] << 24;
+    for (j = 0; j < 8; j++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+GST_START_TEST (test_mpegts_section_crc)
+{
+  guint8 info[4] = { 0x01, 0x02, 0x03, 0x04 };
+  gint n;
+
+  /* Create PMTs of increasing size, so that the CRC is computed over
+   * sections of all lengths modulo 8 */
+  for (n = 0; n < 48; n++) {
+    GstMpegtsPMT *pmt;
+    GstMpegtsPMTStream *stream;
+    GstMpegtsSection *section;
+    guint8 *data, *copy;
+    gsize data_size;
+    guint32 crc;
+    gint i;
+
+    pmt = gst_mpegts_pmt_new ();
+    pmt->pcr_pid = 0x40;
+    pmt->program_number = 1;
+
+    for (i = 0; i < n; i++) {
+      stream = gst_mpegts_pmt_stream_new ();
+      stream->stream_type = GST_MPEGTS_STREAM_TYPE_VIDEO_H264;
+      stream->pid = 0x40 + i;
+      g_ptr_array_add (stream->descriptors,
+          gst_mpegts_descriptor_from_registration ("HDMV", info, i % 5));
+      g_ptr_array_add (pmt->streams, stream);
+    }
+
+    section = gst_mpegts_section_from_pmt (pmt, 0x30);
+    fail_if (section == NULL);
+
+    data = gst_mpegts_section_packetize (section, &data_size);
+    fail_if (data == NULL);
+    fail_unless (data_size > 4);
+    data = g_memdup (data, data_size);
+    gst_mpegts_section_unref (section);
+
+    crc = GST_READ_UINT32_BE (data + data_size - 4);
+    fail_unless_equals_int (crc, reference_crc32 (data, data_size - 4));
+
+    /* The packetized data must pass the CRC check when parsed back */
+    copy = g_memdup (data, data_size);
+    section = gst_mpegts_section_new (0x30, copy, data_size);
+    fail_if (section == NULL);
+    pmt = (GstMpegtsPMT *) gst_mpegts_section_get_pmt (section);
+    fail_if (pmt == NULL);
+    fail_unless_equals_int (pmt->streams->len, n);
+    gst_mpegts_section_unref (section);
+
+    /* ... and fail it as soon as any byte is corrupted */
+    copy = g_memdup (data, data_size);
+    copy[data_size / 2] ^= 0x10;
+    section = gst_mpegts_section_new (0x30, copy, data_size);
+    if (section) {
+      fail_unless (gst_mpegts_section_get_pmt (section) == NULL);
+      gst_mpegts_section_unref (section);
+    }
+
+    g_free (data);
+  }
+}
+
+GST_END_TEST;
+
 
 GST_START_TEST (test_mpegts_nit)
 {
@@ -572,6 +654,7 @@ mpegts_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_mpegts_pat);
   tcase_add_test (tc_chain, test_mpegts_pmt);
+  tcase_add_test (tc_chain, test_mpegts_section_crc);
   tcase_add_test (tc_chain, test_mpegts_nit);
   tcase_add_test (tc_chain, test_mpegts_sdt);
   tcase_add_test (tc_chain, test_mpegts_atsc_stt);
@@ -0,0 +1,336 @@
+/* GStreamer
+ *
+ * unit test for the NAL unit bit reader of the codec parsers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+/* the NalReader is internal to the library, this links to the
+ * libgstnalutils convenience library */
+#include <gst/codecparsers/nalutils.h>
+
+/* Reference reader, loading the cache one byte at a time and decoding the
+ * exp-Golomb codes one bit at a time, as the NalReader used to. It works on
+ * the same NalReader structure, set up with nal_reader_init() */
+
+static gboolean
+ref_read (NalReader * nr, guint nbits)
+{
+  if (nr->byte * 8 + (nbits - nr->bits_in_cache) > nr->size * 8)
+    return FALSE;
+
+  while (nr->bits_in_cache < nbits) {
+    guint8 byte;
+    gboolean check_three_byte;
+
+    check_three_byte = TRUE;
+  next_byte:
+    if (nr->byte >= nr->size)
+      return FALSE;
+
+    byte = nr->data[nr->byte++];
+
+    if (check_three_byte && byte == 0x03 && nr->first_byte == 0x00 &&
+        ((nr->cache & 0xff) == 0)) {
+      check_three_byte = FALSE;
+      nr->n_epb++;
+      goto next_byte;
+    }
+    nr->cache = (nr->cache << 8) | nr->first_byte;
+    nr->first_byte = byte;
+    nr->bits_in_cache += 8;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+ref_get_bits (NalReader * nr, guint32 * val, guint nbits)
+{
+  guint shift;
+
+  if (!ref_read (nr, nbits))
+    return FALSE;
+
+  shift = nr->bits_in_cache - nbits;
+  *val = nr->first_byte >> shift;
+  *val |= nr->cache << (8 - shift);
+  if (nbits < 32)
+    *val &= ((guint32) 1 << nbits) - 1;
+
+  nr->bits_in_cache = shift;
+
+  return TRUE;
+}
+
+static gboolean
+ref_skip (NalReader * nr, guint nbits)
+{
+  if (!ref_read (nr, nbits))
+    return FALSE;
+
+  nr->bits_in_cache -= nbits;
+
+  return TRUE;
+}
+
+static gboolean
+ref_get_ue (NalReader * nr, guint32 * val)
+{
+  guint i = 0;
+  guint32 bit;
+  guint32 value;
+
+  if (!ref_get_bits (nr, &bit, 1))
+    return FALSE;
+
+  while (bit == 0) {
+    i++;
+    if (!ref_get_bits (nr, &bit, 1))
+      return FALSE;
+  }
+
+  if (i > 32)
+    return FALSE;
+
+  if (!ref_get_bits (nr, &value, i))
+    return FALSE;
+
+  *val = (1 << i) - 1 + value;
+
+  return TRUE;
+}
+
+static gboolean
+ref_get_se (NalReader * nr, gint32 * val)
+{
+  guint32 value;
+
+  if (!ref_get_ue (nr, &value))
+    return FALSE;
+
+  if (value % 2)
+    *val = (value / 2) + 1;
+  else
+    *val = -(value / 2);
+
+  return TRUE;
+}
+
+static gboolean
+ref_is_byte_aligned (NalReader * nr)
+{
+  return nr->bits_in_cache == 0;
+}
+
+/* Reads @data with both readers, first @lead bits then random reads until
+ * the end of the data, and checks they always agree */
+static void
+compare_readers (const guint8 * data, guint size, guint lead, GRand * rand)
+{
+  NalReader nr, ref;
+  guint32 val, ref_val;
+  gint32 sval, ref_sval;
+  gboolean ret, ref_ret;
+  guint step;
+
+  nal_reader_init (&nr, data, size);
+  nal_reader_init (&ref, data, size);
+
+  while (lead > 0) {
+    guint n = MIN (lead, 32);
+
+    fail_unless (nal_reader_get_bits_uint32 (&nr, &val, n));
+    fail_unless (ref_get_bits (&ref, &ref_val, n));
+    fail_unless_equals_int (val, ref_val);
+    lead -= n;
+  }
+
+  for (step = 0;; step++) {
+    guint op = g_rand_int_range (rand, 0, 7);
+    guint n;
+
+    val = ref_val = 0;
+    switch (op) {
+      case 0:{
+        guint8 v8 = 0;
+
+        n = g_rand_int_range (rand, 0, 9);
+        ret = nal_reader_get_bits_uint8 (&nr, &v8, n);
+        val = v8;
+        ref_ret = ref_get_bits (&ref, &ref_val, n);
+        break;
+      }
+      case 1:{
+        guint16 v16 = 0;
+
+        n = g_rand_int_range (rand, 0, 17);
+        ret = nal_reader_get_bits_uint16 (&nr, &v16, n);
+        val = v16;
+        ref_ret = ref_get_bits (&ref, &ref_val, n);
+        break;
+      }
+      case 2:
+        n = g_rand_int_range (rand, 0, 33);
+        ret = nal_reader_get_bits_uint32 (&nr, &val, n);
+        ref_ret = ref_get_bits (&ref, &ref_val, n);
+        break;
+      case 3:
+        ret = nal_reader_get_ue (&nr, &val);
+        ref_ret = ref_get_ue (&ref, &ref_val);
+        break;
+      case 4:
+        sval = ref_sval = 0;
+        ret = nal_reader_get_se (&nr, &sval);
+        ref_ret = ref_get_se (&ref, &ref_sval);
+        val = sval;
+        ref_val = ref_sval;
+        break;
+      case 5:
+        n = g_rand_int_range (rand, 0, 33);
+        ret = nal_reader_skip (&nr, n);
+        ref_ret = ref_skip (&ref, n);
+        break;
+      default:
+        ret = nal_reader_is_byte_aligned (&nr);
+        ref_ret = ref_is_byte_aligned (&ref);
+        break;
+    }
+
+    fail_unless_equals_int (ret, ref_ret);
+    /* the readers may stop at different places in the middle of a failed
+     * read */
+    if (!ret && op < 6)
+      break;
+
+    if (val != ref_val || nal_reader_get_pos (&nr) != nal_reader_get_pos (&ref)
+        || nal_reader_get_epb_count (&nr) != nal_reader_get_epb_count (&ref))
+      fail ("operation %u at step %u: value %u, position %u, %u EPB instead "
+          "of %u, %u, %u", op, step, val, nal_reader_get_pos (&nr),
+          nal_reader_get_epb_count (&nr), ref_val, nal_reader_get_pos (&ref),
+          nal_reader_get_epb_count (&ref));
+  }
+}
+
+/* Random data with many zero bytes, so that there are long exp-Golomb
+ * codes and accidental start code emulations */
+static void
+fill_random (guint8 * data, guint size, GRand * rand)
+{
+  guint i;
+
+  for (i = 0; i < size; i++) {
+    switch (g_rand_int_range (rand, 0, 4)) {
+      case 0:
+        data[i] = 0x00;
+        break;
+      case 1:
+        data[i] = g_rand_int_range (rand, 0, 4);
+        break;
+      default:
+        data[i] = g_rand_int_range (rand, 0, 256);
+        break;
+    }
+  }
+}
+
+GST_START_TEST (test_nal_reader_epb_offsets)
+{
+  GRand *rand = g_rand_new_with_seed (0x4e414c);
+  guint8 data[64];
+  guint offset, lead, i;
+
+  /* an emulation prevention byte at every byte offset in the first 32-bit
+   * refills, each read after every number of bits left in the cache */
+  for (offset = 0; offset < 16; offset++) {
+    for (lead = 0; lead < 72; lead++) {
+      for (i = 0; i < 4; i++) {
+        fill_random (data, sizeof (data), rand);
+        data[offset] = 0x00;
+        data[offset + 1] = 0x00;
+        data[offset + 2] = 0x03;
+        data[offset + 3] = g_rand_int_range (rand, 0, 4);
+
+        compare_readers (data, sizeof (data), lead, rand);
+      }
+    }
+  }
+
+  g_rand_free (rand);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_nal_reader_epb_runs)
+{
+  GRand *rand = g_rand_new_with_seed (0x455042);
+  guint8 data[96];
+  guint lead, i, j;
+
+  /* back to back emulation prevention bytes, a 0x03 following one of them
+   * is data */
+  for (lead = 0; lead < 72; lead++) {
+    for (i = 0; i < 4; i++) {
+      for (j = 0; j < sizeof (data); j++) {
+        static const guint8 pattern[] = { 0x00, 0x00, 0x03, 0x03 };
+
+        data[j] = pattern[(j + i) % (i == 0 ? 3 : 4)];
+      }
+      compare_readers (data, sizeof (data), lead, rand);
+    }
+  }
+
+  g_rand_free (rand);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_nal_reader_random)
+{
+  GRand *rand = g_rand_new_with_seed (0x524e44);
+  guint8 data[256];
+  guint i;
+
+  for (i = 0; i < 2000; i++) {
+    guint size = g_rand_int_range (rand, 1, sizeof (data) + 1);
+
+    fill_random (data, size, rand);
+    compare_readers (data, size, 0, rand);
+  }
+
+  g_rand_free (rand);
+}
+
+GST_END_TEST;
+
+static Suite *
+nalutils_suite (void)
+{
+  Suite *s = suite_create ("NAL unit reader");
+
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_nal_reader_epb_offsets);
+  tcase_add_test (tc_chain, test_nal_reader_epb_runs);
+  tcase_add_test (tc_chain, test_nal_reader_random);
+
+  return s;
+}
+
+GST_CHECK_MAIN (nalutils);
@@ -0,0 +1,325 @@
+/*
+ * scan-gop.c - Print the picture types and offsets of the GOPs of
+ * MPEG-4 Part 2 and VC-1 advanced profile elementary stream files
+ *
+ * The file is mapped and split into as many byte ranges as there are
+ * threads. Each thread indexes the pictures whose start code is in its
+ * range, independently of the others, and the results are then merged.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/gst.h>
+#include <gst/codecparsers/gstmpeg4parser.h>
+#include <gst/codecparsers/gstvc1parser.h>
+
+/* The parser functions take 32 bits sizes, so look for the next start code
+ * in windows of at most this size */
+#define SCAN_WINDOW_SIZE (64 * 1024 * 1024)
+
+typedef enum
+{
+  CODEC_MPEG4,
+  CODEC_VC1
+} Codec;
+
+typedef struct
+{
+  guint64 offset;
+  gchar type;
+} Picture;
+
+typedef struct
+{
+  Codec codec;
+  const guint8 *data;
+  guint64 size;
+  /* only for VC-1 */
+  GstVC1SeqHdr seq_hdr;
+} Stream;
+
+typedef struct
+{
+  const Stream *stream;
+  guint64 start, end;
+  GArray *pictures;
+} Range;
+
+static gchar
+vc1_picture_type (GstVC1PictureType ptype)
+{
+  switch (ptype) {
+    case GST_VC1_PICTURE_TYPE_I:
+      return 'I';
+    case GST_VC1_PICTURE_TYPE_P:
+      return 'P';
+    case GST_VC1_PICTURE_TYPE_B:
+    case GST_VC1_PICTURE_TYPE_BI:
+      return 'B';
+    default:
+      return 'S';
+  }
+}
+
+/* Looks for the next start code at or after @pos. Returns FALSE at the end
+ * of the stream, otherwise sets @sc to the offset of the start code, or to -1
+ * if there is none in the scanned window, and @type to the type of the
+ * picture it starts, or to 0 */
+static gboolean
+scan_next_start_code (const Stream * stream, GstVC1SeqHdr * seq_hdr,
+    guint64 pos, gint64 * sc, gchar * type)
+{
+  const guint8 *data = stream->data + pos;
+  gsize size = MIN (stream->size - pos, SCAN_WINDOW_SIZE);
+
+  *sc = -1;
+  *type = 0;
+
+  if (stream->codec == CODEC_MPEG4) {
+    GstMpeg4Packet packet;
+
+    switch (gst_mpeg4_parse (&packet, FALSE, NULL, data, 0, size)) {
+      case GST_MPEG4_PARSER_OK:
+      case GST_MPEG4_PARSER_NO_PACKET_END:
+        break;
+      case GST_MPEG4_PARSER_NO_PACKET:
+        return size == SCAN_WINDOW_SIZE;
+      default:
+        return FALSE;
+    }
+
+    if (packet.type == GST_MPEG4_VIDEO_OBJ_PLANE && packet.offset + 1 < size)
+      *type = "IPBS"[data[packet.offset + 1] >> 6];
+
+    *sc = pos + packet.offset - 3;
+  } else {
+    GstVC1BDU bdu;
+    GstVC1FrameHdr frame_hdr;
+
+    switch (gst_vc1_identify_next_bdu (data, size, &bdu)) {
+      case GST_VC1_PARSER_OK:
+        break;
+      case GST_VC1_PARSER_NO_BDU_END:
+        bdu.size = size - bdu.offset;
+        break;
+      case GST_VC1_PARSER_NO_BDU:
+        return size == SCAN_WINDOW_SIZE;
+      default:
+        return FALSE;
+    }
+
+    if (bdu.type == GST_VC1_FRAME &&
+        gst_vc1_parse_frame_header (data + bdu.offset, bdu.size, &frame_hdr,
+            seq_hdr, NULL) == GST_VC1_PARSER_OK)
+      *type = vc1_picture_type (frame_hdr.ptype);
+
+    *sc = pos + bdu.sc_offset;
+  }
+
+  return TRUE;
+}
+
+static gpointer
+scan_range (gpointer user_data)
+{
+  Range *range = user_data;
+  GstVC1SeqHdr seq_hdr = range->stream->seq_hdr;
+  guint64 pos = range->start;
+  Picture picture;
+  gint64 sc;
+
+  while (pos < range->end) {
+    if (!scan_next_start_code (range->stream, &seq_hdr, pos, &sc,
+            &picture.type))
+      break;
+
+    if (sc < 0) {
+      /* keep the bytes which might be the start of a start code */
+      pos += SCAN_WINDOW_SIZE - 3;
+      continue;
+    }
+
+    if (sc >= range->end)
+      break;
+
+    if (picture.type) {
+      picture.offset = sc;
+      g_array_append_val (range->pictures, picture);
+    }
+
+    /* continue after the start code prefix */
+    pos = sc + 3;
+  }
+
+  return NULL;
+}
+
+/* the sequence header and entry point are needed to parse the frame headers
+ * of the advanced profile, only the first ones of the file are used */
+static gboolean
+parse_vc1_headers (Stream * stream)
+{
+  GstVC1EntryPointHdr entrypoint;
+  GstVC1BDU bdu;
+  gboolean have_seq_hdr = FALSE;
+  guint64 pos = 0;
+  gsize size;
+
+  while (pos < stream->size) {
+    size = MIN (stream->size - pos, SCAN_WINDOW_SIZE);
+    if (gst_vc1_identify_next_bdu (stream->data + pos, size, &bdu) !=
+        GST_VC1_PARSER_OK)
+      return FALSE;
+
+    if (bdu.type == GST_VC1_SEQUENCE) {
+      if (gst_vc1_parse_sequence_header (stream->data + pos + bdu.offset,
+              bdu.size, &stream->seq_hdr) != GST_VC1_PARSER_OK)
+        return FALSE;
+      have_seq_hdr = TRUE;
+    } else if (bdu.type == GST_VC1_ENTRYPOINT && have_seq_hdr) {
+      return gst_vc1_parse_entry_point_header (stream->data + pos + bdu.offset,
+          bdu.size, &entrypoint, &stream->seq_hdr) == GST_VC1_PARSER_OK;
+    }
+
+    pos += bdu.offset;
+  }
+
+  return FALSE;
+}
+
+static void
+print_gops (GArray * pictures)
+{
+  GString *types = g_string_new (NULL);
+  guint64 gop_offset = 0;
+  guint i;
+
+  for (i = 0; i < pictures->len; i++) {
+    Picture *picture = &g_array_index (pictures, Picture, i);
+
+    if (picture->type == 'I' && types->len > 0) {
+      g_print ("%" G_GUINT64_FORMAT " %s\n", gop_offset, types->str);
+      g_string_truncate (types, 0);
+    }
+    if (types->len == 0)
+      gop_offset = picture->offset;
+    g_string_append_c (types, picture->type);
+  }
+
+  if (types->len > 0)
+    g_print ("%" G_GUINT64_FORMAT " %s\n", gop_offset, types->str);
+
+  g_string_free (types, TRUE);
+}
+
+gint
+main (int argc, char **argv)
+{
+  GMappedFile *file;
+  GError *err = NULL;
+  Stream stream = { 0, };
+  Range *ranges;
+  GThread **threads;
+  GArray *pictures;
+  gint n_threads = 0;
+  gint64 start_time, elapsed;
+  gint i;
+  GOptionEntry options[] = {
+    {"threads", 't', 0, G_OPTION_ARG_INT, &n_threads,
+        "Number of threads (default: number of processors)", "N"},
+    {NULL}
+  };
+  GOptionContext *ctx;
+
+  ctx = g_option_context_new ("FILE - index the GOPs of an MPEG-4 Part 2 or "
+      "VC-1 advanced profile elementary stream");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_option_context_free (ctx);
+    g_error_free (err);
+    return 1;
+  }
+  if (argc != 2) {
+    gchar *help = g_option_context_get_help (ctx, TRUE, NULL);
+
+    g_printerr ("%s", help);
+    g_free (help);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (n_threads <= 0)
+    n_threads = g_get_num_processors ();
+
+  file = g_mapped_file_new (argv[1], FALSE, &err);
+  if (!file) {
+    g_printerr ("failed to open %s: %s\n", argv[1], err->message);
+    g_error_free (err);
+    return 1;
+  }
+
+  stream.data = (const guint8 *) g_mapped_file_get_contents (file);
+  stream.size = g_mapped_file_get_length (file);
+
+  /* VC-1 advanced profile streams start with a sequence header */
+  if (stream.size >= 4 && stream.data[0] == 0 && stream.data[1] == 0 &&
+      stream.data[2] == 1 && stream.data[3] == GST_VC1_SEQUENCE) {
+    stream.codec = CODEC_VC1;
+    if (!parse_vc1_headers (&stream)) {
+      g_printerr ("failed to parse VC-1 sequence header and entry point\n");
+      g_mapped_file_unref (file);
+      return 1;
+    }
+  } else {
+    stream.codec = CODEC_MPEG4;
+  }
+
+  start_time = g_get_monotonic_time ();
+
+  ranges = g_new0 (Range, n_threads);
+  threads = g_new0 (GThread *, n_threads);
+  for (i = 0; i < n_threads; i++) {
+    ranges[i].stream = &stream;
+    ranges[i].start = stream.size * i / n_threads;
+    ranges[i].end = stream.size * (i + 1) / n_threads;
+    ranges[i].pictures = g_array_new (FALSE, FALSE, sizeof (Picture));
+    threads[i] = g_thread_new ("scan-gop", scan_range, &ranges[i]);
+  }
+
+  pictures = g_array_new (FALSE, FALSE, sizeof (Picture));
+  for (i = 0; i < n_threads; i++) {
+    g_thread_join (threads[i]);
+    g_array_append_vals (pictures, ranges[i].pictures->data,
+        ranges[i].pictures->len);
+    g_array_free (ranges[i].pictures, TRUE);
+  }
+
+  elapsed = g_get_monotonic_time () - start_time;
+
+  print_gops (pictures);
+  g_printerr ("%u pictures in %" G_GUINT64_FORMAT " bytes, %d threads, "
+      "%.1f MB/s\n", pictures->len, stream.size, n_threads,
+      elapsed > 0 ? stream.size / (gdouble) elapsed : 0.0);
+
+  g_array_free (pictures, TRUE);
+  g_free (threads);
+  g_free (ranges);
+  g_mapped_file_unref (file);
+
+  return 0;
+}